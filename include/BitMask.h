@@ -0,0 +1,94 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef BIT_MASK_H
+#define BIT_MASK_H
+
+#include "MTypes.h"
+#include "MatrixSupport.h"
+
+// Binary mask of nslis x nrows x ncols voxels, stored as bit-packed rows
+// (one bit per voxel, a whole number of words per row). Morphology works on
+// whole words using shifts, ANDs and ORs. A 2D mask has one slice.
+// Conversion from and to UChrMat/UChrMat3D is provided by asBitMask(),
+// asUChrMat(const BitMask&) and asUChrMat3D(const BitMask&).
+
+typedef unsigned long BitWord;
+
+class BitMask {
+public:
+  static const unsigned bitsPerWord = 8*sizeof(BitWord);
+
+// Constructors/destructor
+  BitMask(unsigned nslis = 0, unsigned nrows = 0, unsigned ncols = 0);
+  // From a byte mask (non-zero voxels are set), passed as slice/row arrays
+  BitMask(const unsigned char * const * const *mask,
+	  unsigned nslis, unsigned nrows, unsigned ncols);
+  BitMask(const BitMask&);
+  ~BitMask();
+
+  BitMask& operator = (const BitMask&);
+
+// Get functions
+  unsigned getslis() const { return _slis; }
+  unsigned getrows() const { return _rows; }
+  unsigned getcols() const { return _cols; }
+  Boolean  operator () (unsigned slice, unsigned row, unsigned col) const {
+    return (_row(slice, row)[col/bitsPerWord] >> (col % bitsPerWord)) & 1; }
+  unsigned long count() const; // Number of voxels set
+  // Copies slice (or all slices) into a byte mask of 0's and 1's
+  void     getSlice(unsigned slice, unsigned char **mask) const;
+  void     getBytes(unsigned char ***mask) const;
+
+// Set functions
+  void     set(unsigned slice, unsigned row, unsigned col, Boolean value = TRUE);
+  BitMask& clear();
+
+// Logical operators
+  BitMask& operator &= (const BitMask&);
+  BitMask& operator |= (const BitMask&);
+  BitMask& invert();
+
+// Morphology
+  // Erosion and dilation follow the conventions of Mat::erode() and
+  // Mat::dilate() (strel origin at (ks/2, kr/2, kc/2); voxels outside the
+  // mask are 0); the strel weights are ignored.
+  BitMask  erode(const CompiledStrel& strel) const;
+  BitMask  dilate(const CompiledStrel& strel) const;
+  BitMask  open(const CompiledStrel& strel) const  { return erode(strel).dilate(strel); }
+  BitMask  close(const CompiledStrel& strel) const { return dilate(strel).erode(strel); }
+  // Sets all background voxels that are not 6-connected (4-connected in a
+  // 2D mask) to the border of the mask
+  BitMask  fillHoles() const;
+
+private:
+  unsigned  _slis, _rows, _cols;
+  unsigned  _wordsPerRow;
+  BitWord  *_words;
+
+  BitWord       *_row(unsigned slice, unsigned row) {
+    return _words + (slice*_rows + row)*_wordsPerRow; }
+  const BitWord *_row(unsigned slice, unsigned row) const {
+    return _words + (slice*_rows + row)*_wordsPerRow; }
+  BitWord  _lastWordMask() const;
+  void     _allocate(unsigned nslis, unsigned nrows, unsigned ncols);
+  BitMask  _morphology(const CompiledStrel& strel, Boolean dilate) const;
+};
+
+#endif
@@ -21,10 +21,35 @@ $State: Exp $
 #define HISTOGRAM_H
 
 #include <iostream>		/* (bert) changed from iostream.h */
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "MTypes.h"
 #include "ValueMap.h"
 #include "SimpleArray.h"
 
+// Types whose values are few enough to be counted directly by raw value
+// (see Histogram::add(const Type * const *, unsigned, unsigned long))
+template <class Type> struct _HistogramRaw { enum { range = 0 };
+  static unsigned index(const Type&)      { return 0; }
+  static double   value(unsigned)         { return 0; } };
+template <> struct _HistogramRaw<char> { enum { range = 256 };
+  static unsigned index(char v)           { return (unsigned char) v; }
+  static double   value(unsigned i)       { return char(i); } };
+template <> struct _HistogramRaw<signed char> { enum { range = 256 };
+  static unsigned index(signed char v)    { return (unsigned char) v; }
+  static double   value(unsigned i)       { return (signed char) i; } };
+template <> struct _HistogramRaw<unsigned char> { enum { range = 256 };
+  static unsigned index(unsigned char v)  { return v; }
+  static double   value(unsigned i)       { return i; } };
+template <> struct _HistogramRaw<short> { enum { range = 65536 };
+  static unsigned index(short v)          { return (unsigned short) v; }
+  static double   value(unsigned i)       { return short(i); } };
+template <> struct _HistogramRaw<unsigned short> { enum { range = 65536 };
+  static unsigned index(unsigned short v) { return v; }
+  static double   value(unsigned i)       { return i; } };
+
 class Histogram : private SimpleArray<unsigned> {
   double    _min, _max; // True extrema (i.e., not the bin centers)
   double    _binWidth;
@@ -66,6 +91,7 @@ public:
   double    majority(unsigned *bin = 0) const;
   double    biModalThreshold() const;
   double    varianceThreshold() const;
+  DblArray  varianceThresholds(unsigned nClasses = 3) const; // 2 or 3 classes
   double    kullbackThreshold() const;
   double    pctThreshold(double pct) const;
   double    entropy() const;
@@ -74,14 +100,22 @@ public:
 
 // Set functions
   Boolean add(double value) {
-    if ((value < _min) || (value > _max))
-      return FALSE;
-    unsigned index = (unsigned) _valueToBinMap(value);
+    const unsigned index = _index(value);
     if (index >= _size)
-      index = _size - 1;
+      return FALSE;
     _contents[index]++;
     return TRUE;
   }
+  // Adds nRows rows of nCols values each, as add(double) would, and returns
+  // the number of values within range. 8- and 16-bit integers are counted
+  // by raw value in interleaved sub-histograms when there are enough of
+  // them; other values are binned in blocks. With OpenMP, large inputs are
+  // split over threads filling partial histograms, which are then merged
+  // pairwise.
+  template <class Type>
+  unsigned long add(const Type * const *rows, unsigned nRows, unsigned long nCols);
+  template <class Type>
+  unsigned long add(const Type *values, unsigned long n) { return add(&values, 1, n); }
 
 // Other operators
   Histogram&  operator += (const Histogram& hist);
@@ -97,8 +131,162 @@ public:
 // Friends
   friend std::ostream&    operator << (std::ostream& os, const Histogram& hist);
   friend SimpleArray<double> asDblArray(const Histogram& hist);
+
+private:
+  template <class Type>
+  unsigned long _add(const Type * const *rows, unsigned nRows, unsigned long nCols);
+
+  // Bin of value, or _size if value is out of range
+  unsigned _index(double value) const {
+    if (!(value >= _min) || !(value <= _max))
+      return _size;
+    const double x = _valueToBinMap(value);
+    return (x < _size) ? unsigned(x) : _size - 1;
+  }
 };
 
+template <class Type>
+unsigned long
+Histogram::add(const Type * const *rows, unsigned nRows, unsigned long nCols)
+{
+#ifdef _OPENMP
+  // Each thread gets at least as many values as it has counters to clear
+  const unsigned long n = nRows*nCols;
+  const unsigned long minPerThread = 
+    (_HistogramRaw<Type>::range > 16384) ? _HistogramRaw<Type>::range : 16384;
+  int nThreads = omp_in_parallel() ? 1 : omp_get_max_threads();
+  if (n/minPerThread < (unsigned long) nThreads)
+    nThreads = int(n/minPerThread);
+
+  if (_size && (nThreads > 1)) {
+    Histogram    *partial = new Histogram[nThreads];
+    unsigned long nAdded  = 0;
+
+#pragma omp parallel num_threads(nThreads) reduction(+:nAdded)
+    {
+      const int t  = omp_get_thread_num();
+      const int nt = omp_get_num_threads();
+
+      partial[t] = *this;
+      partial[t].clear(0);
+
+      // Split the rows, or the columns if there are too few rows
+      if (nRows >= unsigned(nt)) {
+	const unsigned r0 = unsigned((unsigned long) t*nRows/nt);
+	const unsigned r1 = unsigned((unsigned long) (t + 1)*nRows/nt);
+	nAdded += partial[t]._add(rows + r0, r1 - r0, nCols);
+      }
+      else {
+	const unsigned long c0 = t*nCols/nt;
+	const unsigned long c1 = (t + 1)*nCols/nt;
+	const Type **sub = new const Type *[nRows];
+	for (unsigned r = 0; r < nRows; r++)
+	  sub[r] = rows[r] + c0;
+	nAdded += partial[t]._add(sub, nRows, c1 - c0);
+	delete [] sub;
+      }
+
+      for (int step = 1; step < nt; step *= 2) {
+#pragma omp barrier
+	if (!(t % (2*step)) && (t + step < nt))
+	  partial[t] += partial[t + step];
+      }
+    }
+
+    *this += partial[0];
+    delete [] partial;
+    return nAdded;
+  }
+#endif
+
+  return _add(rows, nRows, nCols);
+}
+
+template <class Type>
+unsigned long
+Histogram::_add(const Type * const *rows, unsigned nRows, unsigned long nCols)
+{
+  const unsigned long n = (unsigned long) nRows*nCols;
+  unsigned long nAdded  = 0;
+  if (!_size || !n)
+    return 0;
+
+  const unsigned range = _HistogramRaw<Type>::range;
+  if (range && (n >= range)) {
+    // Four sub-histograms, so that consecutive equal values do not stall on
+    // the same counter; binned afterwards, one count per raw value
+    unsigned *raw = new unsigned[4*range];
+    memset(raw, 0, 4*range*sizeof(unsigned));
+
+    for (unsigned r = 0; r < nRows; r++) {
+      const Type *value = rows[r];
+      unsigned long i = 0;
+      for (; i + 4 <= nCols; i += 4) {
+	raw[          _HistogramRaw<Type>::index(value[i])]++;
+	raw[range   + _HistogramRaw<Type>::index(value[i + 1])]++;
+	raw[2*range + _HistogramRaw<Type>::index(value[i + 2])]++;
+	raw[3*range + _HistogramRaw<Type>::index(value[i + 3])]++;
+      }
+      for (; i < nCols; i++)
+	raw[_HistogramRaw<Type>::index(value[i])]++;
+    }
+
+    for (unsigned v = 0; v < range; v++) {
+      const unsigned count = raw[v] + raw[range + v] + raw[2*range + v] + raw[3*range + v];
+      if (count) {
+	const unsigned index = _index(_HistogramRaw<Type>::value(v));
+	if (index < _size) {
+	  _contents[index] += count;
+	  nAdded += count;
+	}
+      }
+    }
+
+    delete [] raw;
+    return nAdded;
+  }
+
+  // Bin indices are computed a block at a time, out-of-range values
+  // going to an extra bin
+  const unsigned blockSize = 256;
+  const double   factor = _valueToBinMap.factor();
+  const double   offset = _valueToBinMap.offset();
+  const double   min    = _min;
+  const double   max    = _max;
+  const unsigned size   = _size;
+  const double   last   = size;
+  const double   lastBin = last - 1;
+  unsigned       index[blockSize];
+  unsigned      *count = new unsigned[size + 1];
+  memset(count, 0, (size + 1)*sizeof(unsigned));
+
+  for (unsigned r = 0; r < nRows; r++) {
+    const Type *value = rows[r];
+    for (unsigned long start = 0; start < nCols; start += blockSize) {
+      const unsigned m = (nCols - start < blockSize) ? unsigned(nCols - start) : blockSize;
+      unsigned i;
+
+      const Type *block = value + start;
+      for (i = 0; i < m; i++) {
+	const double v = double(block[i]);
+	double       x = offset + factor*v;
+	x = (x > 0) ? x : 0;
+	x = (x < last) ? x : lastBin;
+	index[i] = ((v >= min) & (v <= max)) ? unsigned(int(x)) : size;
+      }
+      for (i = 0; i < m; i++)
+	count[index[i]]++;
+    }
+  }
+
+  for (unsigned i = 0; i < size; i++)
+    _contents[i] += count[i];
+  nAdded = n - count[_size];
+  delete [] count;
+
+  return nAdded;
+}
+
 // (bert) - moved the following three functions from inside class definition:
 //
 inline DblArray pdf(const Histogram& hist) { return hist.pdf(); }
@@ -114,10 +302,25 @@ template <class Type>
 Histogram &
 add(Histogram & hist, const SimpleArray <Type> & array)
 {
-  if (array.size()) {
+  if (!array.size())
+    return hist;
+
+  if (array.hasContents())
+    hist.add(array.contents(), array.size());
+  else {
+    // Copy blocks of elements through the iterator
+    const unsigned blockSize = 4096;
+    Type *block = new Type[blockSize];
     array.resetIterator();
-    for (unsigned i = array.size(); i; i--)
-      hist.add(array++);
+    for (unsigned start = 0; start < array.size(); start += blockSize) {
+      unsigned n = array.size() - start;
+      if (n > blockSize)
+	n = blockSize;
+      for (unsigned i = 0; i < n; i++)
+	block[i] = array++;
+      hist.add(block, n);
+    }
+    delete [] block;
   }
 
   return hist;
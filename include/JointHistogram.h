@@ -0,0 +1,268 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef JOINT_HISTOGRAM_H
+#define JOINT_HISTOGRAM_H
+
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "MTypes.h"
+
+// Joint histogram of two images, for mutual information based registration.
+// The bins of each image follow the Histogram conventions: min and max are
+// the centers of the first and last bin, and values beyond the outer bin
+// edges are not counted. Counts are weights, as partial volume filling
+// spreads a voxel over up to eight bins. Images are passed as slice/row
+// pointer arrays; see add(JointHistogram&, const Mat3D&, const Mat3D&) for
+// Mat3D's. The counts and the per-thread partial histograms are allocated
+// once, so that an existing JointHistogram can be cleared and refilled
+// (e.g., for every transformation tried by amoeba) without reallocation.
+
+class JointHistogram {
+public:
+// Constructors/destructor
+  JointHistogram(double min1 = 0, double max1 = 0, unsigned nBins1 = 0,
+		 double min2 = 0, double max2 = 0, unsigned nBins2 = 0);
+  JointHistogram(const JointHistogram&);
+  ~JointHistogram();
+
+  JointHistogram& operator = (const JointHistogram&);
+
+// Get functions
+  unsigned nBins1() const { return _nBins[0]; }
+  unsigned nBins2() const { return _nBins[1]; }
+  double   operator () (unsigned i, unsigned j) const { return _count[i*_nBins[1] + j]; }
+  double   n() const;                   // Total weight
+  double   binWidth1() const            { return _binWidth[0]; }
+  double   binWidth2() const            { return _binWidth[1]; }
+  double   binCenter1(unsigned i) const { return _min[0] + (i + 0.5)*_binWidth[0]; }
+  double   binCenter2(unsigned j) const { return _min[1] + (j + 0.5)*_binWidth[1]; }
+  // Bin of a value of image 1 or 2; -1 if out of range
+  int      bin1(double value) const     { return _bin(0, value); }
+  int      bin2(double value) const     { return _bin(1, value); }
+
+// Information measures (in bits)
+  double   entropy1() const;
+  double   entropy2() const;
+  double   jointEntropy() const;
+  double   mutualInformation() const;           // H1 + H2 - H12
+  double   normalizedMutualInformation() const; // (H1 + H2)/H12
+
+// Set functions
+  JointHistogram& clear();
+  Boolean  add(double value1, double value2, double weight = 1.0);
+
+  // Adds the corresponding voxels of two nslis x nrows x ncols images.
+  // If mask is given, only voxels with a non-zero mask value are used; only
+  // every step'th voxel along each dimension is used. Returns the weight
+  // added.
+  template <class T1, class T2>
+  double add(const T1 * const * const *image1, const T2 * const * const *image2,
+	     unsigned nslis, unsigned nrows, unsigned ncols,
+	     const unsigned char * const * const *mask = 0, unsigned step = 1);
+
+  // Partial volume filling. Voxel (s, r, c) of image1 maps to position
+  // transform * (s, r, c, 1) of image2 (transform is a row-major 3 x 4
+  // matrix, in voxels of image2), and is spread over the bins of the eight
+  // neighbours of that position with trilinear weights. Voxels mapping
+  // outside image2 are skipped. mask and step apply to image1.
+  template <class T1, class T2>
+  double addPartialVolume(const T1 * const * const *image1, 
+			  unsigned nslis1, unsigned nrows1, unsigned ncols1,
+			  const T2 * const * const *image2,
+			  unsigned nslis2, unsigned nrows2, unsigned ncols2,
+			  const double transform[12],
+			  const unsigned char * const * const *mask = 0, unsigned step = 1);
+
+private:
+  double    _min[2], _max[2];  // True extrema (i.e., not the bin centers)
+  double    _binWidth[2];
+  unsigned  _nBins[2];
+  double   *_count;
+  double   *_partial;          // Per-thread partial histograms
+  unsigned  _nPartial;         // # partial histograms allocated
+  unsigned  _nFill;            // # threads of the current fill
+
+  int       _bin(unsigned image, double value) const {
+    if (!(value >= _min[image]) || !(value <= _max[image]))
+      return -1;
+    const int i = int((value - _min[image])/_binWidth[image]);
+    return (i < int(_nBins[image])) ? i : int(_nBins[image]) - 1;
+  }
+  unsigned  _size() const { return _nBins[0]*_nBins[1]; }
+  unsigned  _threads(unsigned nJobs);          // # threads to fill with
+  double   *_counts(unsigned thread) {         // Counts to be filled by thread
+    return (_nFill > 1) ? _partial + thread*_size() : _count; }
+  void      _merge(unsigned nThreads);         // Adds the partial histograms
+  double    _entropy(const double *count, unsigned n, unsigned stride, 
+		     unsigned nSums, unsigned sumStride) const;
+};
+
+template <class T1, class T2>
+double
+JointHistogram::add(const T1 * const * const *image1, const T2 * const * const *image2,
+		    unsigned nslis, unsigned nrows, unsigned ncols,
+		    const unsigned char * const * const *mask, unsigned step)
+{
+  if (!_count || !nslis || !nrows || !ncols)
+    return 0;
+  if (!step)
+    step = 1;
+
+  const int      nSteps   = int((nslis + step - 1)/step);
+  const unsigned nThreads = _threads(nSteps);
+  const unsigned nBins2   = _nBins[1];
+  double         total    = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nThreads) reduction(+:total)
+#endif
+  {
+#ifdef _OPENMP
+    double *count = _counts(omp_get_thread_num());
+#pragma omp for schedule(static)
+#else
+    double *count = _count;
+#endif
+    for (int k = 0; k < nSteps; k++) {
+      const unsigned s = k*step;
+      for (unsigned r = 0; r < nrows; r += step) {
+	const T1            *row1    = image1[s][r];
+	const T2            *row2    = image2[s][r];
+	const unsigned char *maskRow = mask ? mask[s][r] : 0;
+	for (unsigned c = 0; c < ncols; c += step) {
+	  if (maskRow && !maskRow[c])
+	    continue;
+	  const int b1 = _bin(0, double(row1[c]));
+	  const int b2 = _bin(1, double(row2[c]));
+	  if ((b1 >= 0) && (b2 >= 0)) {
+	    count[b1*nBins2 + b2]++;
+	    total++;
+	  }
+	}
+      }
+    }
+  }
+
+  _merge(nThreads);
+
+  return total;
+}
+
+template <class T1, class T2>
+double
+JointHistogram::addPartialVolume(const T1 * const * const *image1, 
+				 unsigned nslis1, unsigned nrows1, unsigned ncols1,
+				 const T2 * const * const *image2,
+				 unsigned nslis2, unsigned nrows2, unsigned ncols2,
+				 const double transform[12],
+				 const unsigned char * const * const *mask, unsigned step)
+{
+  if (!_count || !nslis1 || !nrows1 || !ncols1 || !nslis2 || !nrows2 || !ncols2)
+    return 0;
+  if (!step)
+    step = 1;
+
+  const int      nSteps   = int((nslis1 + step - 1)/step);
+  const unsigned nThreads = _threads(nSteps);
+  const unsigned nBins2   = _nBins[1];
+  const double   last[3]  = {nslis2 - 1.0, nrows2 - 1.0, ncols2 - 1.0};
+  double         total    = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nThreads) reduction(+:total)
+#endif
+  {
+#ifdef _OPENMP
+    double *count = _counts(omp_get_thread_num());
+#pragma omp for schedule(static)
+#else
+    double *count = _count;
+#endif
+    for (int k = 0; k < nSteps; k++) {
+      const unsigned s = k*step;
+      for (unsigned r = 0; r < nrows1; r += step) {
+	const T1            *row1    = image1[s][r];
+	const unsigned char *maskRow = mask ? mask[s][r] : 0;
+	// Position in image2 of voxel (s, r, 0), and its step along the row
+	double p0[3], dp[3];
+	unsigned d;
+	for (d = 0; d < 3; d++) {
+	  const double *t = transform + 4*d;
+	  p0[d] = t[0]*s + t[1]*r + t[3];
+	  dp[d] = t[2];
+	}
+
+	for (unsigned c = 0; c < ncols1; c += step) {
+	  if (maskRow && !maskRow[c])
+	    continue;
+	  const int b1 = _bin(0, double(row1[c]));
+	  if (b1 < 0)
+	    continue;
+
+	  // Lower neighbour and trilinear weights along each dimension
+	  unsigned i0[3];
+	  double   w[3][2];
+	  for (d = 0; d < 3; d++) {
+	    const double p = p0[d] + dp[d]*c;
+	    if (!(p >= 0) || !(p <= last[d]))
+	      break;
+	    i0[d] = unsigned(p);
+	    if (i0[d] && (double(i0[d]) == last[d]))
+	      i0[d]--;
+	    w[d][1] = p - i0[d];
+	    w[d][0] = 1 - w[d][1];
+	  }
+	  if (d < 3)
+	    continue;
+
+	  double *countRow = count + b1*nBins2;
+	  for (unsigned ds = 0; ds < 2; ds++) {
+	    if (!w[0][ds])
+	      continue;
+	    for (unsigned dr = 0; dr < 2; dr++) {
+	      const double wsr = w[0][ds]*w[1][dr];
+	      if (!wsr)
+		continue;
+	      const T2 *row2 = image2[i0[0] + ds][i0[1] + dr];
+	      for (unsigned dc = 0; dc < 2; dc++) {
+		const double weight = wsr*w[2][dc];
+		if (!weight)
+		  continue;
+		const int b2 = _bin(1, double(row2[i0[2] + dc]));
+		if (b2 >= 0) {
+		  countRow[b2] += weight;
+		  total        += weight;
+		}
+	      }
+	    }
+	  }
+	}
+      }
+    }
+  }
+
+  _merge(nThreads);
+
+  return total;
+}
+
+#endif
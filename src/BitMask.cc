@@ -0,0 +1,566 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#include <config.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <iostream>
+using namespace std;
+#include "trivials.h"
+#include "BitMask.h"
+
+const unsigned BitMask::bitsPerWord;
+
+//
+// Word operations on bit rows
+//
+
+// Word w of a row of nSrc words, shifted so that bit i of the result is bit
+// i + shift of the row (0 outside the row)
+static inline BitWord
+_shiftedWord(const BitWord *src, unsigned nSrc, int q, unsigned r, unsigned w)
+{
+  int i = int(w) + q;
+  BitWord low  = ((i >= 0) && (i < int(nSrc))) ? src[i] : 0;
+  if (!r)
+    return low;
+  BitWord high = ((i + 1 >= 0) && (i + 1 < int(nSrc))) ? src[i + 1] : 0;
+  return (low >> r) | (high << (BitMask::bitsPerWord - r));
+}
+
+static inline void
+_splitShift(int shift, int& q, unsigned& r)
+{
+  const int bits = BitMask::bitsPerWord;
+  q = (shift >= 0) ? shift/bits : -((-shift + bits - 1)/bits);
+  r = unsigned(shift - q*bits);
+}
+
+// dst &= src shifted by shift bits
+static void
+_andShifted(BitWord *dst, unsigned nDst, const BitWord *src, unsigned nSrc, int shift)
+{
+  int q; unsigned r;
+  _splitShift(shift, q, r);
+  for (unsigned w = 0; w < nDst; w++)
+    dst[w] &= _shiftedWord(src, nSrc, q, r, w);
+}
+
+// dst |= src shifted by shift bits
+static void
+_orShifted(BitWord *dst, unsigned nDst, const BitWord *src, unsigned nSrc, int shift)
+{
+  int q; unsigned r;
+  _splitShift(shift, q, r);
+  for (unsigned w = 0; w < nDst; w++)
+    dst[w] |= _shiftedWord(src, nSrc, q, r, w);
+}
+
+// AND (erosion) or OR (dilation) of a row over a window of length bits:
+// bit i becomes the AND/OR of bits i ... i + length - 1. The window is
+// doubled in each step, so this takes about log2(length) shifts.
+static void
+_runRow(BitWord *row, unsigned nWords, unsigned length, Boolean dilate, BitWord *tmp)
+{
+  unsigned done = 1;
+  while (done < length) {
+    unsigned step = std::min(done, length - done);
+    for (unsigned w = 0; w < nWords; w++)
+      tmp[w] = row[w];
+    if (dilate)
+      _orShifted(row, nWords, tmp, nWords, step);
+    else
+      _andShifted(row, nWords, tmp, nWords, step);
+    done += step;
+  }
+}
+
+static inline BitWord
+_reverse(BitWord x)
+{
+  unsigned shift = BitMask::bitsPerWord;
+  BitWord  mask  = ~BitWord(0);
+  while ((shift >>= 1) > 0) {
+    mask ^= mask << shift;
+    x = ((x >> shift) & mask) | ((x << shift) & ~mask);
+  }
+  return x;
+}
+
+// Voxels of background within runs that hold a seed; towards higher bits,
+// a carry through a run of background bits sets all of it
+static inline BitWord
+_fillUp(BitWord background, BitWord seed)
+{
+  return (((background + seed) ^ background) & background) | seed;
+}
+
+// Extends the seeds in row (a subset of background) to the full runs of
+// background along the row that contain them
+static void
+_fillRow(BitWord *row, const BitWord *background, unsigned nWords)
+{
+  const unsigned topBit = BitMask::bitsPerWord - 1;
+  BitWord carry = 0;
+  int w;
+
+  for (w = 0; w < int(nWords); w++) {
+    BitWord seed = row[w] | (carry & background[w]);
+    row[w] = _fillUp(background[w], seed);
+    carry  = (row[w] >> topBit) & 1;
+  }
+
+  carry = 0;
+  for (w = int(nWords) - 1; w >= 0; w--) {
+    BitWord seed = row[w] | ((carry << topBit) & background[w]);
+    row[w] = _reverse(_fillUp(_reverse(background[w]), _reverse(seed)));
+    carry  = row[w] & 1;
+  }
+}
+
+static inline unsigned
+_count(BitWord x)
+{
+  unsigned n = 0;
+  for (; x; n++)
+    x &= x - 1;
+  return n;
+}
+
+//
+// Constructors/destructor
+//
+
+BitMask::BitMask(unsigned nslis, unsigned nrows, unsigned ncols)
+{
+  _allocate(nslis, nrows, ncols);
+}
+
+BitMask::BitMask(const unsigned char * const * const *mask,
+		 unsigned nslis, unsigned nrows, unsigned ncols)
+{
+  _allocate(nslis, nrows, ncols);
+
+  for (unsigned s = 0; s < _slis; s++)
+    for (unsigned r = 0; r < _rows; r++) {
+      BitWord             *row  = _row(s, r);
+      const unsigned char *src  = mask[s][r];
+      for (unsigned c = 0; c < _cols; c++)
+	if (src[c])
+	  row[c/bitsPerWord] |= BitWord(1) << (c % bitsPerWord);
+    }
+}
+
+BitMask::BitMask(const BitMask& mask)
+{
+  _allocate(mask._slis, mask._rows, mask._cols);
+  unsigned long nWords = (unsigned long) _slis*_rows*_wordsPerRow;
+  for (unsigned long i = 0; i < nWords; i++)
+    _words[i] = mask._words[i];
+}
+
+BitMask::~BitMask()
+{
+  delete [] _words;
+}
+
+BitMask&
+BitMask::operator = (const BitMask& mask)
+{
+  if (this != &mask) {
+    delete [] _words;
+    _allocate(mask._slis, mask._rows, mask._cols);
+    unsigned long nWords = (unsigned long) _slis*_rows*_wordsPerRow;
+    for (unsigned long i = 0; i < nWords; i++)
+      _words[i] = mask._words[i];
+  }
+
+  return *this;
+}
+
+//
+// Get functions
+//
+
+unsigned long
+BitMask::count() const
+{
+  unsigned long n = 0;
+  unsigned long nWords = (unsigned long) _slis*_rows*_wordsPerRow;
+  for (unsigned long i = 0; i < nWords; i++)
+    n += _count(_words[i]);
+
+  return n;
+}
+
+void
+BitMask::getSlice(unsigned slice, unsigned char **mask) const
+{
+  assert(slice < _slis);
+
+  for (unsigned r = 0; r < _rows; r++) {
+    const BitWord *row = _row(slice, r);
+    unsigned char *dst = mask[r];
+    for (unsigned c = 0; c < _cols; c++)
+      dst[c] = (row[c/bitsPerWord] >> (c % bitsPerWord)) & 1;
+  }
+}
+
+void
+BitMask::getBytes(unsigned char ***mask) const
+{
+  for (unsigned s = 0; s < _slis; s++)
+    getSlice(s, mask[s]);
+}
+
+//
+// Set functions
+//
+
+void
+BitMask::set(unsigned slice, unsigned row, unsigned col, Boolean value)
+{
+  assert((slice < _slis) && (row < _rows) && (col < _cols));
+
+  BitWord  bit   = BitWord(1) << (col % bitsPerWord);
+  BitWord& word  = _row(slice, row)[col/bitsPerWord];
+  if (value)
+    word |= bit;
+  else
+    word &= ~bit;
+}
+
+BitMask&
+BitMask::clear()
+{
+  unsigned long nWords = (unsigned long) _slis*_rows*_wordsPerRow;
+  for (unsigned long i = 0; i < nWords; i++)
+    _words[i] = 0;
+
+  return *this;
+}
+
+//
+// Logical operators
+//
+
+BitMask&
+BitMask::operator &= (const BitMask& mask)
+{
+  if ((_slis != mask._slis) || (_rows != mask._rows) || (_cols != mask._cols)) {
+    cerr << "BitMask::operator &=: masks have different dimensions" << endl;
+    return *this;
+  }
+
+  unsigned long nWords = (unsigned long) _slis*_rows*_wordsPerRow;
+  for (unsigned long i = 0; i < nWords; i++)
+    _words[i] &= mask._words[i];
+
+  return *this;
+}
+
+BitMask&
+BitMask::operator |= (const BitMask& mask)
+{
+  if ((_slis != mask._slis) || (_rows != mask._rows) || (_cols != mask._cols)) {
+    cerr << "BitMask::operator |=: masks have different dimensions" << endl;
+    return *this;
+  }
+
+  unsigned long nWords = (unsigned long) _slis*_rows*_wordsPerRow;
+  for (unsigned long i = 0; i < nWords; i++)
+    _words[i] |= mask._words[i];
+
+  return *this;
+}
+
+BitMask&
+BitMask::invert()
+{
+  if (!_wordsPerRow)
+    return *this;
+
+  const BitWord lastWordMask = _lastWordMask();
+
+  for (unsigned s = 0; s < _slis; s++)
+    for (unsigned r = 0; r < _rows; r++) {
+      BitWord *row = _row(s, r);
+      for (unsigned w = 0; w < _wordsPerRow; w++)
+	row[w] = ~row[w];
+      row[_wordsPerRow - 1] &= lastWordMask;
+    }
+
+  return *this;
+}
+
+//
+// Morphology
+//
+
+BitMask
+BitMask::erode(const CompiledStrel& strel) const
+{
+  return _morphology(strel, FALSE);
+}
+
+BitMask
+BitMask::dilate(const CompiledStrel& strel) const
+{
+  return _morphology(strel, TRUE);
+}
+
+// A line segment of a strel: taps (slice, row, col + i), 0 <= i < length,
+// as offsets from the output voxel
+struct _BitSegment {
+  int      slice, row, col;
+  unsigned length;
+};
+
+static int
+_compareTaps(const void *a, const void *b)
+{
+  const int *tapA = (const int *) a;
+  const int *tapB = (const int *) b;
+  for (unsigned i = 0; i < 3; i++)
+    if (tapA[i] != tapB[i])
+      return (tapA[i] < tapB[i]) ? -1 : 1;
+  return 0;
+}
+
+static int
+_compareSegments(const void *a, const void *b)
+{
+  unsigned lengthA = ((const _BitSegment *) a)->length;
+  unsigned lengthB = ((const _BitSegment *) b)->length;
+  return (lengthA < lengthB) ? -1 : (lengthA > lengthB) ? 1 : 0;
+}
+
+// Erosion is the AND, dilation the OR, of the mask shifted by every tap of
+// the strel. The taps are grouped into segments along the columns; each
+// input row is first reduced over every segment length with _runRow(),
+// on a row extended so that windows overlapping its ends are kept, and
+// every segment then costs one shifted AND/OR per output word.
+BitMask
+BitMask::_morphology(const CompiledStrel& strel, Boolean dilate) const
+{
+  BitMask result(_slis, _rows, _cols);
+  if (!_slis || !_rows || !_cols)
+    return result;
+
+  const unsigned nTaps = strel.nTaps();
+  const int      sign  = dilate ? -1 : 1;
+  unsigned i, s, r, w;
+
+  if (!dilate)
+    result.invert();
+
+  if (!nTaps)
+    return result;
+
+  // Taps as offsets from the output voxel, sorted by slice, row and column
+  int *tap = new int[3*nTaps];
+  for (i = 0; i < nTaps; i++) {
+    tap[3*i]     = sign*strel.sliceOffset(i);
+    tap[3*i + 1] = sign*strel.rowOffset(i);
+    tap[3*i + 2] = sign*strel.colOffset(i);
+  }
+  qsort(tap, nTaps, 3*sizeof(int), _compareTaps);
+
+  // Segments along the columns, sorted by length
+  _BitSegment *segment = new _BitSegment[nTaps];
+  unsigned nSegments = 0;
+  int lo = 0, hi = 0;
+  for (i = 0; i < nTaps; i++) {
+    const int *t = tap + 3*i;
+    if (nSegments && (t[0] == segment[nSegments - 1].slice) &&
+	(t[1] == segment[nSegments - 1].row) &&
+	(t[2] == segment[nSegments - 1].col + int(segment[nSegments - 1].length)))
+      segment[nSegments - 1].length++;
+    else {
+      _BitSegment& seg = segment[nSegments++];
+      seg.slice  = t[0];
+      seg.row    = t[1];
+      seg.col    = t[2];
+      seg.length = 1;
+    }
+    lo = std::min(lo, t[2]);
+    hi = std::max(hi, t[2]);
+  }
+  qsort(segment, nSegments, sizeof(_BitSegment), _compareSegments);
+
+  // Extended rows hold column x of the image at bit x - lo
+  const unsigned extWords = (_cols - lo + hi + bitsPerWord - 1)/bitsPerWord;
+  BitWord *run = new BitWord[(unsigned long) _slis*_rows*extWords];
+  BitWord *tmp = new BitWord[extWords];
+
+  unsigned first = 0;
+  while (first < nSegments) {
+    unsigned length = segment[first].length;
+    unsigned last = first;
+    while ((last < nSegments) && (segment[last].length == length))
+      last++;
+
+    for (s = 0; s < _slis; s++)
+      for (r = 0; r < _rows; r++) {
+	BitWord *extRow = run + (s*_rows + r)*extWords;
+	for (w = 0; w < extWords; w++)
+	  extRow[w] = 0;
+	_orShifted(extRow, extWords, _row(s, r), _wordsPerRow, lo);
+	_runRow(extRow, extWords, length, dilate, tmp);
+      }
+
+    for (s = 0; s < _slis; s++)
+      for (r = 0; r < _rows; r++) {
+	BitWord *outRow = result._row(s, r);
+	for (i = first; i < last; i++) {
+	  int srcS = int(s) + segment[i].slice;
+	  int srcR = int(r) + segment[i].row;
+	  if ((srcS < 0) || (srcS >= int(_slis)) || (srcR < 0) || (srcR >= int(_rows))) {
+	    // Outside the mask, everything is 0
+	    if (!dilate)
+	      for (w = 0; w < _wordsPerRow; w++)
+		outRow[w] = 0;
+	    continue;
+	  }
+	  const BitWord *extRow = run + (srcS*_rows + srcR)*extWords;
+	  if (dilate)
+	    _orShifted(outRow, _wordsPerRow, extRow, extWords, segment[i].col - lo);
+	  else
+	    _andShifted(outRow, _wordsPerRow, extRow, extWords, segment[i].col - lo);
+	}
+      }
+
+    first = last;
+  }
+
+  // Clear the bits beyond the last column
+  const BitWord lastWordMask = _lastWordMask();
+  for (s = 0; s < _slis; s++)
+    for (r = 0; r < _rows; r++)
+      result._row(s, r)[_wordsPerRow - 1] &= lastWordMask;
+
+  delete [] tap;
+  delete [] segment;
+  delete [] run;
+  delete [] tmp;
+
+  return result;
+}
+
+// The background connected to the border is grown by sweeps through the
+// mask, forwards and backwards, until nothing changes. In each row, the
+// seeds taken from the previous row and slice are extended along runs of
+// background with word arithmetic.
+BitMask
+BitMask::fillHoles() const
+{
+  BitMask background(*this);
+  background.invert();
+
+  BitMask outside(_slis, _rows, _cols);
+  if (!_slis || !_rows || !_cols)
+    return outside;
+
+  const unsigned lastCol  = _cols - 1;
+  const BitWord  firstBit = 1;
+  const BitWord  lastBit  = BitWord(1) << (lastCol % bitsPerWord);
+  unsigned s, r, w;
+
+  // Seeds on the border
+  for (s = 0; s < _slis; s++)
+    for (r = 0; r < _rows; r++) {
+      BitWord       *row   = outside._row(s, r);
+      const BitWord *bgRow = background._row(s, r);
+      if (((_slis > 1) && ((s == 0) || (s == _slis - 1))) || (r == 0) || (r == _rows - 1))
+	for (w = 0; w < _wordsPerRow; w++)
+	  row[w] = bgRow[w];
+      else {
+	row[0] |= bgRow[0] & firstBit;
+	row[lastCol/bitsPerWord] |= bgRow[lastCol/bitsPerWord] & lastBit;
+      }
+      _fillRow(row, bgRow, _wordsPerRow);
+    }
+
+  Boolean changed = TRUE;
+  while (changed) {
+    changed = FALSE;
+
+    for (unsigned pass = 0; pass < 2; pass++) {
+      const Boolean forward = (pass == 0) ? TRUE : FALSE;
+      const int     step    = forward ? -1 : 1;
+      for (unsigned is = 0; is < _slis; is++)
+	for (unsigned ir = 0; ir < _rows; ir++) {
+	  s = forward ? is : _slis - 1 - is;
+	  r = forward ? ir : _rows - 1 - ir;
+	  BitWord       *row       = outside._row(s, r);
+	  const BitWord *bgRow     = background._row(s, r);
+	  int            prevRow   = int(r) + step;
+	  int            prevSlice = int(s) + step;
+	  Boolean        grown     = FALSE;
+
+	  for (w = 0; w < _wordsPerRow; w++) {
+	    BitWord seed = 0;
+	    if ((prevRow >= 0) && (prevRow < int(_rows)))
+	      seed |= outside._row(s, prevRow)[w];
+	    if ((prevSlice >= 0) && (prevSlice < int(_slis)))
+	      seed |= outside._row(prevSlice, r)[w];
+	    seed &= bgRow[w] & ~row[w];
+	    if (seed) {
+	      row[w] |= seed;
+	      grown = TRUE;
+	    }
+	  }
+
+	  if (grown) {
+	    _fillRow(row, bgRow, _wordsPerRow);
+	    changed = TRUE;
+	  }
+	}
+    }
+  }
+
+  // Everything that is not outside is (filled) foreground
+  return outside.invert();
+}
+
+//
+// Private functions
+//
+
+BitWord
+BitMask::_lastWordMask() const
+{
+  unsigned nBits = _cols % bitsPerWord;
+  return nBits ? (BitWord(1) << nBits) - 1 : ~BitWord(0);
+}
+
+void
+BitMask::_allocate(unsigned nslis, unsigned nrows, unsigned ncols)
+{
+  _slis = nslis;
+  _rows = nrows;
+  _cols = ncols;
+  _wordsPerRow = (ncols + bitsPerWord - 1)/bitsPerWord;
+
+  unsigned long nWords = (unsigned long) _slis*_rows*_wordsPerRow;
+  _words = new BitWord[nWords ? nWords : 1];
+  for (unsigned long i = 0; i < nWords; i++)
+    _words[i] = 0;
+}
@@ -300,6 +300,36 @@ Histogram::biModalThreshold() const
 }
 
 
+// Cumulative bin counts and first and second moments of the bin index:
+// entry k of m0, m1 and m2 holds the sums over bins 0..k-1. Using the bin
+// index rather than the bin value keeps the sums exact for all but huge
+// histograms.
+static void
+_cumulativeMoments(const unsigned *counts, unsigned n, double *m0, double *m1,
+		   double *m2)
+{
+  m0[0] = m1[0] = m2[0] = 0;
+  for (unsigned i = 0; i < n; i++) {
+    const double c = counts[i];
+    m0[i + 1] = m0[i] + c;
+    m1[i + 1] = m1[i] + c*i;
+    m2[i + 1] = m2[i] + c*i*i;
+  }
+}
+
+// Count (returned in weight) and variance (in bins^2) of bins from..to-1
+static double
+_classVariance(const double *m0, const double *m1, const double *m2,
+	       unsigned from, unsigned to, double *weight)
+{
+  *weight = m0[to] - m0[from];
+  if (*weight <= 0)
+    return 0;
+  const double mean = (m1[to] - m1[from]) / *weight;
+  const double var  = (m2[to] - m2[from]) / *weight - mean*mean;
+  return (var > 0) ? var : 0;
+}
+
 // function which is used to find the threshold of a histogram
 // based on minimum variance threshold obtained from Haralick and Shapiro book
 
@@ -311,51 +341,74 @@ Histogram::varianceThreshold() const
     return 0.0;
   }
 
-  double var = 0;
-  double varMin = MAXDOUBLE;
-  unsigned N = n();
-  double   mean1;
-  double   mean2;
-  double   var1;
-  double   var2;
-  double   q1;
-  double   q2;
-  double   offset = _binWidth/2;
-  
-  int i = 0;
-  int t = 0;
-  
-  for (unsigned k = 0 ; k < _size ; k++) {
-     mean1 = mean2 = var1 = var2 = q1 = q2 = 0;
-     for ( i=0 ;  i<=k ; i++)   q1 += double(_contents[i])/N;
-     for ( i=k+1; i<_size ; i++) q2 += double(_contents[i])/N;
-
-     if (q1 != 0) {
-       for ( i=0; i<=k ; i++) 
-	 mean1 += _valueToBinMap.reverse(i) * (double(_contents[i])/N) / q1; 
-       for ( i=0; i<=k ; i++)
-	 var1  += SQR(_valueToBinMap.reverse(i)-mean1)*(double(_contents[i])/N) / q1;
-     }
+  DblArray threshold(varianceThresholds(2));
+  return threshold.size() ? threshold[0] : binCenter(0);
+}
 
-     if (q2 != 0){
-       for ( i=k+1; i<_size ; i++)
-	 mean2 += _valueToBinMap.reverse(i) * (double(_contents[i])/N) / q2; 
-       for ( i=k+1; i<_size ; i++)
-	 var2  += SQR(_valueToBinMap.reverse(i)-mean2)*(double(_contents[i])/N) / q2;
-     }
-     
-     var = q1 * var1 +  q2 * var2;
-     
-     if (var < varMin) {
-	t = k;
+// Minimum within-class variance thresholds separating nClasses (2 or 3)
+// classes; class j holds the bins up to and including the bin centered on
+// threshold j. The class variances are taken from cumulative moments, so
+// this takes O(nBins) for two classes and O(nBins^2) for three.
+
+DblArray
+Histogram::varianceThresholds(unsigned nClasses) const
+{
+  if (!_size) {
+    cerr << "Warning! Histogram::varianceThresholds() called on empty Histogram" << endl;
+    return DblArray(0);
+  }
+
+  if ((nClasses < 2) || (nClasses > 3)) {
+    cerr << "Histogram::varianceThresholds() supports 2 or 3 classes only" << endl;
+    return DblArray(0);
+  }
+
+  double *m0 = new double[3*(_size + 1)];
+  double *m1 = m0 + _size + 1;
+  double *m2 = m1 + _size + 1;
+  _cumulativeMoments(_contents, _size, m0, m1, m2);
+
+  // The within-class scatter, sum(q_j*var_j) up to the constant factor
+  // binWidth^2/N, is minimized
+  double   varMin = MAXDOUBLE;
+  unsigned t[2]   = {0, 0};
+  double   q1, q2, q3;
+
+  if (nClasses == 2) {
+    for (unsigned k = 0; k < _size; k++) {
+      const double var1 = _classVariance(m0, m1, m2, 0, k + 1, &q1);
+      const double var2 = _classVariance(m0, m1, m2, k + 1, _size, &q2);
+      const double var  = q1*var1 + q2*var2;
+      if (var < varMin) {
+	t[0]   = k;
 	varMin = var;
-     }
+      }
+    }
+  }
+  else {
+    for (unsigned k = 0; k < _size; k++) {
+      const double var1 = _classVariance(m0, m1, m2, 0, k + 1, &q1);
+      for (unsigned l = k + 1; l < _size; l++) {
+	const double var2 = _classVariance(m0, m1, m2, k + 1, l + 1, &q2);
+	const double var3 = _classVariance(m0, m1, m2, l + 1, _size, &q3);
+	const double var  = q1*var1 + q2*var2 + q3*var3;
+	if (var < varMin) {
+	  t[0]   = k;
+	  t[1]   = l;
+	  varMin = var;
+	}
+      }
+    }
   }
-  
-  return _valueToBinMap.reverse(t) + offset;
-}
 
+  delete [] m0;
 
+  DblArray threshold(nClasses - 1);
+  for (unsigned j = 0; j < nClasses - 1; j++)
+    threshold[j] = binCenter(t[j]);
+
+  return threshold;
+}
 
 // function which is used to find the threshold of a histogram
 // based on minimum kullback function obtained from Haralick and Shapiro book
@@ -371,37 +424,25 @@ Histogram::kullbackThreshold() const
   double H = 0;
   double HMin = MAXDOUBLE;
   unsigned N = n();
-  double   mean1;
-  double   mean2;
   double   var1;
   double   var2;
   double   q1;
   double   q2;
-  double   offset = _binWidth/2;
+  double   binVar = SQR(_binWidth);
   double    pi=4*atan(1.0);	/* constant, 3.14159.... */
   
-  int i = 0;
   int t = 0;
+
+  double *m0 = new double[3*(_size + 1)];
+  double *m1 = m0 + _size + 1;
+  double *m2 = m1 + _size + 1;
+  _cumulativeMoments(_contents, _size, m0, m1, m2);
   
   for (unsigned k = 0 ; k < _size ; k++) {
-     mean1 = mean2 = var1 = var2 = q1 = q2 = 0;
-     for ( i=0 ;  i<=k ; i++)   q1 += double(_contents[i])/N;
-     for ( i=k+1; i<_size ; i++) q2 += double(_contents[i])/N;
-
-     if (q1 != 0){
-       for ( i=0; i<=k ; i++)
-	 mean1 += _valueToBinMap.reverse(i) * (double(_contents[i])/N) / q1; 
-       for ( i=0; i<=k ; i++) 
-	 var1  += SQR(_valueToBinMap.reverse(i)-mean1)*(double(_contents[i])/N) / q1;
-     }
-
-     if (q2 != 0){
-       for ( i=k+1; i<_size ; i++)
-	 mean2 += _valueToBinMap.reverse(i) * (double(_contents[i])/N) / q2; 
-       for ( i=k+1; i<_size ; i++) 
-	 var2  += SQR(_valueToBinMap.reverse(i)-mean2)*(double(_contents[i])/N) / q2;
-     }
-     
+     var1 = binVar*_classVariance(m0, m1, m2, 0, k + 1, &q1);
+     var2 = binVar*_classVariance(m0, m1, m2, k + 1, _size, &q2);
+     q1 /= N;
+     q2 /= N;
      
      if (var1 > 0 && var2 > 0 && q1 > 0 && q2 > 0) {
        H  = (1+log10(2*pi))/2;
@@ -416,8 +457,10 @@ Histogram::kullbackThreshold() const
        HMin = H;
      }
   }
+
+  delete [] m0;
   
-  return _valueToBinMap.reverse(t) + offset;
+  return binCenter(t);
 }
 
 double
@@ -0,0 +1,258 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#include <config.h>
+#include <math.h>
+#include <iostream>
+using namespace std;
+#include "trivials.h"
+#include "JointHistogram.h"
+
+//
+// Constructors/destructor
+//
+
+// Bins of one image, as in Histogram(min, max, nBins)
+static void
+_binning(double min, double max, unsigned& nBins, double& binWidth, 
+	 double& trueMin, double& trueMax)
+{
+  if (max < min) {
+    const double tmp = min; min = max; max = tmp;
+  }
+
+  if (!nBins) {
+    nBins    = unsigned(::ceil(max - min + 1));
+    binWidth = 1.0;
+  }
+  else if (max == min)
+    binWidth = 1.0/nBins;
+  else if (nBins <= 1)
+    binWidth = max - min;
+  else
+    binWidth = (max - min)/(nBins - 1);
+
+  trueMin = min - binWidth/2;
+  trueMax = max + binWidth/2;
+}
+
+JointHistogram::JointHistogram(double min1, double max1, unsigned nBins1,
+			       double min2, double max2, unsigned nBins2)
+{
+  _nBins[0] = nBins1;
+  _nBins[1] = nBins2;
+  _binning(min1, max1, _nBins[0], _binWidth[0], _min[0], _max[0]);
+  _binning(min2, max2, _nBins[1], _binWidth[1], _min[1], _max[1]);
+
+  _count    = _size() ? new double[_size()] : 0;
+  _partial  = 0;
+  _nPartial = 0;
+  _nFill    = 1;
+  clear();
+}
+
+JointHistogram::JointHistogram(const JointHistogram& hist)
+{
+  _count    = 0;
+  _partial  = 0;
+  _nPartial = 0;
+  _nBins[0] = _nBins[1] = 0;
+  *this = hist;
+}
+
+JointHistogram::~JointHistogram()
+{
+  delete [] _count;
+  delete [] _partial;
+}
+
+JointHistogram&
+JointHistogram::operator = (const JointHistogram& hist)
+{
+  if (this == &hist) return *this;
+
+  if (_size() != hist._size()) {
+    delete [] _count;
+    delete [] _partial;
+    _count    = hist._size() ? new double[hist._size()] : 0;
+    _partial  = 0;
+    _nPartial = 0;
+  }
+
+  for (unsigned i = 0; i < 2; i++) {
+    _min[i]      = hist._min[i];
+    _max[i]      = hist._max[i];
+    _binWidth[i] = hist._binWidth[i];
+    _nBins[i]    = hist._nBins[i];
+  }
+  _nFill = 1;
+  if (_size())
+    memcpy(_count, hist._count, _size()*sizeof(double));
+
+  return *this;
+}
+
+//
+// Get functions
+//
+
+double
+JointHistogram::n() const
+{
+  double sum = 0;
+  for (unsigned i = 0; i < _size(); i++)
+    sum += _count[i];
+
+  return sum;
+}
+
+// Entropy of the distribution with n entries; entry i is the sum of the
+// nSums counts count[i*stride + k*sumStride]
+double
+JointHistogram::_entropy(const double *count, unsigned n, unsigned stride,
+			 unsigned nSums, unsigned sumStride) const
+{
+  const double N = this->n();
+  if (N <= 0)
+    return 0.0;
+
+  double entropy = 0;
+  for (unsigned i = 0; i < n; i++) {
+    const double *countPtr = count + i*stride;
+    double p = 0;
+    for (unsigned k = 0; k < nSums; k++, countPtr += sumStride)
+      p += *countPtr;
+    p /= N;
+    if (p > 0)
+      entropy += p*::log(p);
+  }
+
+  return -entropy/::log(2.0);
+}
+
+double
+JointHistogram::entropy1() const
+{
+  return _entropy(_count, _nBins[0], _nBins[1], _nBins[1], 1);
+}
+
+double
+JointHistogram::entropy2() const
+{
+  return _entropy(_count, _nBins[1], 1, _nBins[0], _nBins[1]);
+}
+
+double
+JointHistogram::jointEntropy() const
+{
+  return _entropy(_count, _size(), 1, 1, 0);
+}
+
+double
+JointHistogram::mutualInformation() const
+{
+  return entropy1() + entropy2() - jointEntropy();
+}
+
+// Ranges from 1 (independent images) to 2 (identical binned images)
+double
+JointHistogram::normalizedMutualInformation() const
+{
+  const double H12 = jointEntropy();
+  if (H12 <= 0)
+    return 2.0;
+
+  return (entropy1() + entropy2())/H12;
+}
+
+//
+// Set functions
+//
+
+JointHistogram&
+JointHistogram::clear()
+{
+  if (_size())
+    memset(_count, 0, _size()*sizeof(double));
+  return *this;
+}
+
+Boolean
+JointHistogram::add(double value1, double value2, double weight)
+{
+  if (!_count)
+    return FALSE;
+
+  const int b1 = _bin(0, value1);
+  const int b2 = _bin(1, value2);
+  if ((b1 < 0) || (b2 < 0))
+    return FALSE;
+
+  _count[b1*_nBins[1] + b2] += weight;
+  return TRUE;
+}
+
+//
+// Private functions
+//
+
+unsigned
+JointHistogram::_threads(unsigned nJobs)
+{
+  unsigned nThreads = 1;
+#ifdef _OPENMP
+  if (!omp_in_parallel())
+    nThreads = MIN(unsigned(omp_get_max_threads()), nJobs);
+#endif
+  if (!nThreads)
+    nThreads = 1;
+
+  if (nThreads > 1) {
+    if (nThreads > _nPartial) {
+      delete [] _partial;
+      _partial  = new double[nThreads*_size()];
+      _nPartial = nThreads;
+    }
+    memset(_partial, 0, nThreads*_size()*sizeof(double));
+  }
+
+  _nFill = nThreads;
+  return nThreads;
+}
+
+void
+JointHistogram::_merge(unsigned nThreads)
+{
+  _nFill = 1;
+  if (nThreads <= 1)
+    return;
+
+  const int size = int(_size());
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i = 0; i < size; i++) {
+    const double *partial = _partial + i;
+    double sum = 0;
+    for (unsigned t = 0; t < nThreads; t++, partial += size)
+      sum += *partial;
+    _count[i] += sum;
+  }
+}
@@ -502,6 +502,7 @@ Array<Type>&
 Array<Type>::reorder(const Array<unsigned>& indices)
 {
   Array<Type>     temp(*this);
+  const Type     *tempPtr = temp.contents();
   Type           *elPtr  = _contents;
   const unsigned *indexPtr = indices.contents();
 
@@ -509,7 +510,7 @@ Array<Type>::reorder(const Array<unsigned>& indices)
 
   for (unsigned i = n; i; i--, elPtr++, indexPtr++)
     if (*indexPtr < _size)
-      *elPtr = temp[*indexPtr];
+      *elPtr = tempPtr[*indexPtr];
 
   return *this;
 }
@@ -744,6 +745,8 @@ _INSTANTIATE_ARRAY(dcomplex);
 _INSTANTIATE_ARRAY(Path);
 #include "ValueMap.h"
 _INSTANTIATE_ARRAY(LinearMap);
+#include "Labeling.h"
+_INSTANTIATE_ARRAY(Component);
 #include "SimpleArray.h"
 _INSTANTIATE_ARRAY(SimpleArray<unsigned> );
 _INSTANTIATE_ARRAY(SimpleArray<float> );
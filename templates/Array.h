@@ -114,6 +114,9 @@ public:
   virtual Type *contents();
   virtual operator const Type *() const;
   virtual operator Type *();
+  // FALSE if the elements are not stored contiguously, in which case
+  // contents() is not available (e.g., CachedArray)
+  virtual Boolean hasContents() const { return TRUE; }
 
 // Other functions
   Array&  operator = (const Array&);        // Copy
@@ -670,14 +670,39 @@ CachedArray<Type>::map(const ValueMap& map) const
 {
   CachedArray<Type> result(this->_size);
 
+  // Map blocks of elements at once
+  const unsigned block = 256;
+  Type buffer[block];
+
   resetIterator();
   result.resetIterator();
-  for (unsigned i = this->_size; i; i--)
-    result++ = Type(map((*this)++));
+  for (unsigned i = 0; i < this->_size; i += block) {
+    const unsigned count = (this->_size - i < block) ? this->_size - i : block;
+    unsigned j;
+    for (j = 0; j < count; j++)
+      buffer[j] = (*this)++;
+    mapValues(map, buffer, buffer, count);
+    for (j = 0; j < count; j++)
+      result++ = buffer[j];
+  }
 
   return result;
 }
 
+template <class Type>
+unsigned long
+CachedArray<Type>::addTo(Histogram& hist) const
+{
+  unsigned long nAdded = 0;
+
+  for (unsigned start = 0; start < this->_size; start += _blockSize) {
+    const unsigned count = (this->_size - start < _blockSize) ? this->_size - start : _blockSize;
+    nAdded += hist.add((const Type *) _block(start)->_contents, count);
+  }
+
+  return nAdded;
+}
+
 //
 // Private functions
 //
@@ -876,9 +901,7 @@ CachedArray<Type>::_histMedian(unsigned nBelow, unsigned nAbove)
 
 
   Histogram hist(floor, ceil, MAX(this->_size/100, 10));
-  resetIterator();
-  for (unsigned i = this->_size; i; i--)
-    hist.add((*this)++);
+  addTo(hist);
 
   if (this->_debug) {
       //  cout << endl << "Contents: " << *this << endl;
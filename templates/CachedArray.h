@@ -32,6 +32,7 @@ $State: Exp $
 
 template <class Type> class CachedArray;
 template <class Type> class CacheBlock;
+class Histogram;
 
 /*
 typedef CachedArray<char>          CachedBoolArray;
@@ -146,6 +147,7 @@ public:
   Type          *contents()        { this->_notImplementedError(); return 0; }
   operator const Type *() const    { this->_notImplementedError(); return 0; }
   operator       Type *()          { this->_notImplementedError(); return 0; }
+  Boolean hasContents() const      { return FALSE; }
 
   // Get functions
   double hitRate() const;
@@ -171,6 +173,9 @@ public:
   CachedArray sample(unsigned maxN) const;
   CachedArray applyElementWise(Type (*function) (Type)) const;
   CachedArray map(const ValueMap& map) const;
+  // Adds all elements to hist (see Histogram::add()), one cache block at a
+  // time; returns the number of elements within range
+  unsigned long addTo(Histogram& hist) const;
 
   CachedArray ln() const;                    // Natural logarithm of all elements
   CachedArray log() const;                   // Base-10 logarithm of all elements
@@ -205,6 +210,10 @@ private:
 template <class Type>
 CachedArray<Type> operator ^ (double base, const CachedArray<Type>& array);
 
+template <class Type>
+Histogram& add(Histogram& hist, const CachedArray<Type>& array) {
+  array.addTo(hist); return hist; }
+
 /********************************************************************
  * CacheBlock class
  *
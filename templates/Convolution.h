@@ -0,0 +1,670 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _CONVOLUTION_H
+#define _CONVOLUTION_H
+
+/******************************************************************************
+ * Convolution kernels shared by Mat<Type> and Mat3D<Type>. Images and kernels
+ * are passed as slice/row pointer arrays (el[slice][row][col]), so that a 2D
+ * Mat can be passed as a single slice. Both the image and the kernel origin
+ * follow Mat::convolv2d: output(s, r, c) is the sum over the kernel of
+ *
+ *   kernel(a, b, d) * input(s + sOff - a, r + rOff - b, c + cOff - d)
+ *
+ * with xOff = kx - 1 - kx/2 (i.e., the kernel centre for odd sizes). Samples
+ * outside the image are supplied according to a BorderMode, without padded
+ * copies of the image. The output may be the input itself (in-place
+ * convolution).
+ *
+ * Separable kernels are given as one factor per dimension (slices, rows,
+ * columns), so that kernel(a, b, d) = f0[a] * f1[b] * f2[d]. The factors and
+ * the intermediate results of separable passes are kept in the accumulator
+ * type: double for real images, dcomplex for complex ones.
+ *****************************************************************************/
+
+#include <math.h>
+#include <iostream>
+#include "dcomplex.h"
+#ifdef USE_FCOMPMAT
+  #include "fcomplex.h"
+#endif
+#include "MTypes.h"
+#include "MatrixSupport.h"
+
+// Conversion between element types and the (real, imag) pairs used by the
+// FFT routines. Integral types are rounded on the way back.
+template <class Type>
+inline void _convSplit(const Type& value, double& re, double& im) {
+  re = double(value); im = 0; }
+inline void _convSplit(const dcomplex& value, double& re, double& im) {
+  re = value.real(); im = value.imag(); }
+#ifdef USE_FCOMPMAT
+inline void _convSplit(const fcomplex& value, double& re, double& im) {
+  re = value.real(); im = value.imag(); }
+#endif
+
+template <class Type>
+inline void _convStore(double re, double, Type& value) {
+  value = Type(floor(re + 0.5)); }
+inline void _convStore(double re, double, double& value) { value = re; }
+inline void _convStore(double re, double, float& value)  { value = float(re); }
+inline void _convStore(double re, double im, dcomplex& value) {
+  value = dcomplex(re, im); }
+#ifdef USE_FCOMPMAT
+inline void _convStore(double re, double im, fcomplex& value) {
+  value = fcomplex(re, im); }
+#endif
+
+// Accumulator type for separable convolution passes
+template <class Type>
+struct ConvAccumulator { typedef double Acc; };
+template <>
+struct ConvAccumulator<dcomplex> { typedef dcomplex Acc; };
+#ifdef USE_FCOMPMAT
+template <>
+struct ConvAccumulator<fcomplex> { typedef dcomplex Acc; };
+#endif
+
+inline void _convFromAcc(double value, double& result) { result = value; }
+template <class Type>
+inline void _convFromAcc(double value, Type& result) {
+  _convStore(value, 0, result); }
+template <class Type>
+inline void _convFromAcc(const dcomplex& value, Type& result) {
+  _convStore(value.real(), value.imag(), result); }
+
+inline double _convMagnitude(double value) { return fabs(value); }
+inline double _convMagnitude(const dcomplex& value) { return std::abs(value); }
+
+// Relative tolerance for accepting a kernel as separable
+template <class Type>
+inline double _convTolerance(const Type&) { return 1e-12; }
+inline double _convTolerance(const float&) { return 1e-6; }
+#ifdef USE_FCOMPMAT
+inline double _convTolerance(const fcomplex&) { return 1e-6; }
+#endif
+
+// Tests whether a kernel is the outer product of three 1D factors (i.e., is
+// of rank 1), and if so returns TRUE and stores the factors in f0, f1 and f2
+// (of length kslis, krows and kcols; any of them may be 0). The factors are
+// taken through the kernel element of largest magnitude, and accepted if they
+// reproduce every element to within a relative tolerance.
+template <class Type>
+Boolean
+separateKernel(const Type * const * const *kernel,
+	       unsigned kslis, unsigned krows, unsigned kcols,
+	       typename ConvAccumulator<Type>::Acc *f0 = 0,
+	       typename ConvAccumulator<Type>::Acc *f1 = 0,
+	       typename ConvAccumulator<Type>::Acc *f2 = 0)
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  if (!kslis || !krows || !kcols)
+    return FALSE;
+
+  unsigned a, b, d;
+  unsigned p0 = 0, p1 = 0, p2 = 0;
+  double   maxMagnitude = 0;
+  for (a = 0; a < kslis; a++)
+    for (b = 0; b < krows; b++)
+      for (d = 0; d < kcols; d++) {
+	double magnitude = _convMagnitude(Acc(kernel[a][b][d]));
+	if (magnitude > maxMagnitude) {
+	  maxMagnitude = magnitude;
+	  p0 = a; p1 = b; p2 = d;
+	}
+      }
+
+  Acc *u = new Acc[kslis];
+  Acc *v = new Acc[krows];
+  Acc *w = new Acc[kcols];
+  Acc pivot = Acc(kernel[p0][p1][p2]);
+  for (a = 0; a < kslis; a++)
+    u[a] = Acc(kernel[a][p1][p2]);
+  for (b = 0; b < krows; b++)
+    v[b] = maxMagnitude ? Acc(kernel[p0][b][p2])/pivot : Acc(1);
+  for (d = 0; d < kcols; d++)
+    w[d] = maxMagnitude ? Acc(kernel[p0][p1][d])/pivot : Acc(1);
+
+  double  tolerance = _convTolerance(kernel[0][0][0])*maxMagnitude;
+  Boolean separable = TRUE;
+  for (a = 0; separable && (a < kslis); a++)
+    for (b = 0; separable && (b < krows); b++)
+      for (d = 0; d < kcols; d++)
+	if (_convMagnitude(Acc(kernel[a][b][d]) - u[a]*v[b]*w[d]) > tolerance) {
+	  separable = FALSE;
+	  break;
+	}
+
+  if (separable) {
+    if (f0) for (a = 0; a < kslis; a++) f0[a] = u[a];
+    if (f1) for (b = 0; b < krows; b++) f1[b] = v[b];
+    if (f2) for (d = 0; d < kcols; d++) f2[d] = w[d];
+  }
+
+  delete [] u;
+  delete [] v;
+  delete [] w;
+
+  return separable;
+}
+
+// Copies a line of n samples into ext, extended by lo samples before and hi
+// samples after it according to the border mode.
+template <class Dst, class Src>
+inline void
+_convExtendLine(Dst *ext, const Src *src, unsigned n, unsigned lo, unsigned hi,
+		BorderMode border)
+{
+  unsigned x;
+  int      i;
+  for (x = 0; x < lo; x++) {
+    i = borderIndex(int(x) - int(lo), n, border);
+    ext[x] = (i < 0) ? Dst(0) : Dst(src[i]);
+  }
+  for (x = 0; x < n; x++)
+    ext[lo + x] = Dst(src[x]);
+  for (x = 0; x < hi; x++) {
+    i = borderIndex(int(n + x), n, border);
+    ext[lo + n + x] = (i < 0) ? Dst(0) : Dst(src[i]);
+  }
+}
+
+// One convolution pass along an extended line (see _convExtendLine(), with
+// lo = k/2 and hi = k - 1 - k/2): dst += ext * weights. The loop runs along the
+// line for each tap.
+template <class Acc, class Src>
+inline void
+_convLine(Acc *dst, const Src *ext, unsigned n, const Src *weights, unsigned k)
+{
+  for (unsigned d = 0; d < k; d++) {
+    const Src weight = weights[d];
+    if (weight == Src(0))
+      continue;
+    const Src *src = ext + k - 1 - d;
+    for (unsigned i = 0; i < n; i++)
+      dst[i] += weight*src[i];
+  }
+}
+
+// Adds weight * src to dst, element by element
+template <class Acc>
+inline void
+_convAddLine(Acc *dst, const Acc *src, unsigned n, Acc weight)
+{
+  for (unsigned i = 0; i < n; i++)
+    dst[i] += weight*src[i];
+}
+
+// Separable convolution with factors f0 (slices), f1 (rows) and f2 (columns).
+// Passes along dimensions with a factor of length 1 are replaced by a scale.
+// The column pass runs on one plane at a time, the row and slice passes add
+// whole (contiguous) rows; a volume-sized buffer is only needed for the slice
+// pass. Since each plane (or, for the slice pass, the volume) is read before
+// it is written, the passes may run in place.
+template <class Type>
+void
+convolveSeparable(Type ***out, const Type * const * const *in,
+		  unsigned nslis, unsigned nrows, unsigned ncols,
+		  const typename ConvAccumulator<Type>::Acc *f0, unsigned kslis,
+		  const typename ConvAccumulator<Type>::Acc *f1, unsigned krows,
+		  const typename ConvAccumulator<Type>::Acc *f2, unsigned kcols,
+		  BorderMode border = BORDER_ZERO)
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  if (!nslis || !nrows || !ncols)
+    return;
+
+  Acc gain = 1;
+  if (kslis == 1) gain *= f0[0];
+  if (krows == 1) gain *= f1[0];
+  if (kcols == 1) gain *= f2[0];
+
+  const unsigned long planeSize = (unsigned long) nrows*ncols;
+  const int rOff = krows - 1 - krows/2;
+  const int sOff = kslis - 1 - kslis/2;
+
+  Acc *plane  = new Acc[planeSize];
+  Acc *line   = new Acc[ncols + kcols - 1];
+  Acc *volume = (kslis > 1) ? new Acc[nslis*planeSize] : 0;
+  unsigned s, r, c;
+
+  for (s = 0; s < nslis; s++) {
+    // Column pass
+    for (r = 0; r < nrows; r++) {
+      Acc        *planePtr = plane + r*ncols;
+      const Type *inPtr    = in[s][r];
+      if (kcols > 1) {
+	_convExtendLine(line, inPtr, ncols, kcols/2, kcols - 1 - kcols/2, border);
+	for (c = 0; c < ncols; c++)
+	  planePtr[c] = 0;
+	_convLine(planePtr, line, ncols, f2, kcols);
+      }
+      else
+	for (c = 0; c < ncols; c++)
+	  planePtr[c] = Acc(inPtr[c]);
+    }
+
+    // Row pass
+    for (r = 0; r < nrows; r++) {
+      Acc *linePtr = (kslis > 1) ? volume + s*planeSize + r*ncols : line;
+      if (krows > 1) {
+	for (c = 0; c < ncols; c++)
+	  linePtr[c] = 0;
+	for (unsigned b = 0; b < krows; b++) {
+	  int inRow = borderIndex(int(r) + rOff - int(b), nrows, border);
+	  if ((inRow >= 0) && (f1[b] != Acc(0)))
+	    _convAddLine(linePtr, plane + inRow*ncols, ncols, f1[b]);
+	}
+      }
+      else
+	for (c = 0; c < ncols; c++)
+	  linePtr[c] = plane[r*ncols + c];
+
+      if (kslis == 1) {
+	Type *outPtr = out[s][r];
+	for (c = 0; c < ncols; c++)
+	  _convFromAcc(gain*linePtr[c], outPtr[c]);
+      }
+    }
+  }
+
+  // Slice pass
+  if (kslis > 1) {
+    for (s = 0; s < nslis; s++)
+      for (r = 0; r < nrows; r++) {
+	for (c = 0; c < ncols; c++)
+	  line[c] = 0;
+	for (unsigned a = 0; a < kslis; a++) {
+	  int inSlice = borderIndex(int(s) + sOff - int(a), nslis, border);
+	  if ((inSlice >= 0) && (f0[a] != Acc(0)))
+	    _convAddLine(line, volume + inSlice*planeSize + r*ncols, ncols, f0[a]);
+	}
+	Type *outPtr = out[s][r];
+	for (c = 0; c < ncols; c++)
+	  _convFromAcc(gain*line[c], outPtr[c]);
+      }
+  }
+
+  delete [] plane;
+  delete [] line;
+  if (volume)
+    delete [] volume;
+}
+
+// Makes a contiguous copy of an image, with slice/row pointer arrays; used
+// where a method cannot run in place. Release with _convFreeCopy().
+template <class Type>
+Type ***
+_convCopy(const Type * const * const *in, unsigned nslis, unsigned nrows,
+	  unsigned ncols)
+{
+  Type  *data   = new Type[(unsigned long) nslis*nrows*ncols];
+  Type **rows   = new Type *[nslis*nrows];
+  Type ***slices = new Type **[nslis];
+  for (unsigned s = 0; s < nslis; s++) {
+    slices[s] = rows + s*nrows;
+    for (unsigned r = 0; r < nrows; r++) {
+      slices[s][r] = data + ((unsigned long) s*nrows + r)*ncols;
+      for (unsigned c = 0; c < ncols; c++)
+	slices[s][r][c] = in[s][r][c];
+    }
+  }
+  return slices;
+}
+
+template <class Type>
+void
+_convFreeCopy(Type ***copy)
+{
+  delete [] copy[0][0];
+  delete [] copy[0];
+  delete [] copy;
+}
+
+// Direct convolution. Each input row is extended by the border mode into a
+// row buffer, and the innermost loop runs along contiguous output and
+// extended input columns for each kernel tap.
+//   When run in place, output rows (or planes, for kernels spanning several
+// slices) are held back in a small queue until no later output depends on the
+// input they replace; with BORDER_WRAP the first few input rows (planes) are
+// also kept, as they are read again at the end.
+template <class Type>
+void
+convolveDirect(Type ***out, const Type * const * const *in,
+	       unsigned nslis, unsigned nrows, unsigned ncols,
+	       const Type * const * const *kernel,
+	       unsigned kslis, unsigned krows, unsigned kcols,
+	       BorderMode border = BORDER_ZERO)
+{
+  if (!nslis || !nrows || !ncols)
+    return;
+
+  const int sOff = kslis - 1 - kslis/2;
+  const int rOff = krows - 1 - krows/2;
+  const int cOff = kcols - 1 - kcols/2;
+  unsigned  s, r, c;
+
+  // In place, the queue holds back output units (rows, or planes if the
+  // kernel spans several slices) by the number of units preceding the
+  // kernel origin
+  Boolean  planes = (kslis > 1);
+  unsigned nUnits = planes ? nslis : nrows;
+  unsigned kUnits = planes ? kslis : krows;
+  Boolean  inPlace = (out[0][0] == in[0][0]);
+  Type  ***copy   = 0;
+  if (inPlace && (nUnits <= kUnits)) {
+    // Too small for the queue to be of use
+    copy    = _convCopy(in, nslis, nrows, ncols);
+    in      = copy;
+    inPlace = FALSE;
+  }
+
+  const unsigned long unitSize = planes ? (unsigned long) nrows*ncols : ncols;
+  const unsigned delay = inPlace ? kUnits/2 : 0;
+  const unsigned nHead = (inPlace && (border == BORDER_WRAP)) ? kUnits - 1 - kUnits/2 : 0;
+  Type *queue = inPlace ? new Type[(delay + 1)*unitSize] : 0;
+  Type *head  = nHead ? new Type[nHead*unitSize] : 0;
+  Type *ext   = new Type[ncols + kcols - 1];
+
+  for (s = 0; s < nslis; s++) {
+    if (head && (!planes || !s))
+      for (unsigned u = 0; u < nHead; u++)
+	for (r = 0; r < (planes ? nrows : 1); r++)
+	  for (c = 0; c < ncols; c++)
+	    head[u*unitSize + r*ncols + c] = in[planes ? u : s][planes ? r : u][c];
+
+    for (r = 0; r < nrows; r++) {
+      Type *outPtr;
+      if (!inPlace)
+	outPtr = out[s][r];
+      else if (planes)
+	outPtr = queue + (s % (delay + 1))*unitSize + r*ncols;
+      else
+	outPtr = queue + (r % (delay + 1))*unitSize;
+      for (c = 0; c < ncols; c++)
+	outPtr[c] = 0;
+
+      for (unsigned a = 0; a < kslis; a++) {
+	int inSlice = borderIndex(int(s) + sOff - int(a), nslis, border);
+	if (inSlice < 0)
+	  continue;
+	for (unsigned b = 0; b < krows; b++) {
+	  int inRow = borderIndex(int(r) + rOff - int(b), nrows, border);
+	  if (inRow < 0)
+	    continue;
+	  unsigned unit = planes ? inSlice : inRow;
+	  const Type *inPtr = (unit < nHead) ? 
+	    head + unit*unitSize + (planes ? inRow*ncols : 0) : in[inSlice][inRow];
+	  _convExtendLine(ext, inPtr, ncols, kcols - 1 - cOff, cOff, border);
+	  _convLine(outPtr, ext, ncols, kernel[a][b], kcols);
+	}
+      }
+
+      // Release the row that no longer serves as input
+      if (inPlace && !planes && (r >= delay))
+	for (c = 0; c < ncols; c++)
+	  out[s][r - delay][c] = queue[((r - delay) % (delay + 1))*unitSize + c];
+    }
+
+    if (inPlace && !planes)
+      for (r = (nrows > delay) ? nrows - delay : 0; r < nrows; r++)
+	for (c = 0; c < ncols; c++)
+	  out[s][r][c] = queue[(r % (delay + 1))*unitSize + c];
+
+    // Release the plane that no longer serves as input
+    if (inPlace && planes && (s >= delay))
+      for (r = 0; r < nrows; r++)
+	for (c = 0; c < ncols; c++)
+	  out[s - delay][r][c] = queue[((s - delay) % (delay + 1))*unitSize + r*ncols + c];
+  }
+
+  if (inPlace && planes)
+    for (s = (nslis > delay) ? nslis - delay : 0; s < nslis; s++)
+      for (r = 0; r < nrows; r++)
+	for (c = 0; c < ncols; c++)
+	  out[s][r][c] = queue[(s % (delay + 1))*unitSize + r*ncols + c];
+
+  delete [] ext;
+  if (queue)
+    delete [] queue;
+  if (head)
+    delete [] head;
+  if (copy)
+    _convFreeCopy(copy);
+}
+
+// FFT convolution using overlap-save. Along each dimension the image is cut
+// into blocks of fftConvolutionLength() - k + 1 output samples; each block is
+// read with a k - 1 sample lead-in, transformed, multiplied by the kernel
+// spectrum and transformed back, and the wrapped-around lead-in is discarded.
+// Dimensions along which the kernel has length 1 are not transformed. In
+// place, the input is copied first.
+template <class Type>
+void
+convolveFFT(Type ***out, const Type * const * const *in,
+	    unsigned nslis, unsigned nrows, unsigned ncols,
+	    const Type * const * const *kernel,
+	    unsigned kslis, unsigned krows, unsigned kcols,
+	    BorderMode border = BORDER_ZERO)
+{
+  if (!nslis || !nrows || !ncols)
+    return;
+
+  Type ***copy = 0;
+  if (out[0][0] == in[0][0])
+    in = copy = _convCopy(in, nslis, nrows, ncols);
+
+  unsigned n[3] = {nslis, nrows, ncols};
+  unsigned k[3] = {kslis, krows, kcols};
+  unsigned length[3], block[3];
+  int      lead[3];
+  Boolean  transform[3];
+  unsigned axis;
+
+  for (axis = 0; axis < 3; axis++) {
+    length[axis] = fftConvolutionLength(n[axis], k[axis]);
+    transform[axis] = (length[axis] != 0);
+    if (!transform[axis])
+      length[axis] = n[axis];
+    block[axis] = length[axis] - k[axis] + 1;
+    // Input position of the first sample of a block, relative to the block's
+    // first output sample
+    lead[axis] = int(k[axis] - 1 - k[axis]/2) - int(k[axis] - 1);
+  }
+
+  const unsigned long planeSize = (unsigned long) length[1]*length[2];
+  const unsigned long volume    = length[0]*planeSize;
+  double scale = 1.0;
+  for (axis = 0; axis < 3; axis++)
+    if (transform[axis])
+      scale /= length[axis];
+
+  // Kernel spectrum; it has length 1 along dimensions that are not
+  // transformed, and is repeated along them
+  unsigned kLength[3];
+  for (axis = 0; axis < 3; axis++)
+    kLength[axis] = transform[axis] ? length[axis] : 1;
+  const unsigned long kPlaneSize = (unsigned long) kLength[1]*kLength[2];
+  const unsigned long kVolume    = kLength[0]*kPlaneSize;
+  double *kernelRe = new double[kVolume];
+  double *kernelIm = new double[kVolume];
+  double *re = new double[volume];
+  double *im = new double[volume];
+  unsigned long i;
+  for (i = 0; i < kVolume; i++)
+    kernelRe[i] = kernelIm[i] = 0;
+
+  unsigned s, r, c;
+  for (s = 0; s < kslis; s++)
+    for (r = 0; r < krows; r++) {
+      double *kernelRePtr = kernelRe + s*kPlaneSize + r*kLength[2];
+      double *kernelImPtr = kernelIm + s*kPlaneSize + r*kLength[2];
+      for (c = 0; c < kcols; c++)
+	_convSplit(kernel[s][r][c], kernelRePtr[c], kernelImPtr[c]);
+    }
+
+  for (axis = 0; axis < 3; axis++)
+    if (transform[axis])
+      fftAxis(axis, kLength[0], kLength[1], kLength[2], kernelRe, kernelIm);
+
+  for (unsigned s0 = 0; s0 < nslis; s0 += block[0]) {
+    for (unsigned r0 = 0; r0 < nrows; r0 += block[1]) {
+      for (unsigned c0 = 0; c0 < ncols; c0 += block[2]) {
+	// Load the block
+	for (s = 0; s < length[0]; s++) {
+	  int inSlice = borderIndex(int(s0) + lead[0] + int(s), nslis, border);
+	  for (r = 0; r < length[1]; r++) {
+	    int inRow = borderIndex(int(r0) + lead[1] + int(r), nrows, border);
+	    double *rePtr = re + s*planeSize + r*length[2];
+	    double *imPtr = im + s*planeSize + r*length[2];
+	    if ((inSlice < 0) || (inRow < 0)) {
+	      for (c = 0; c < length[2]; c++)
+		rePtr[c] = imPtr[c] = 0;
+	      continue;
+	    }
+	    const Type *inPtr = in[inSlice][inRow];
+	    int first = int(c0) + lead[2];
+	    for (c = 0; c < length[2]; c++) {
+	      int inCol = borderIndex(first + int(c), ncols, border);
+	      if (inCol < 0)
+		rePtr[c] = imPtr[c] = 0;
+	      else
+		_convSplit(inPtr[inCol], rePtr[c], imPtr[c]);
+	    }
+	  }
+	}
+
+	for (axis = 0; axis < 3; axis++)
+	  if (transform[axis])
+	    fftAxis(axis, length[0], length[1], length[2], re, im);
+
+	for (s = 0; s < length[0]; s++)
+	  for (r = 0; r < length[1]; r++) {
+	    double *rePtr = re + s*planeSize + r*length[2];
+	    double *imPtr = im + s*planeSize + r*length[2];
+	    unsigned long kOffset = (transform[0] ? s*kPlaneSize : 0) + 
+	      (transform[1] ? r*kLength[2] : 0);
+	    const double *kernelRePtr = kernelRe + kOffset;
+	    const double *kernelImPtr = kernelIm + kOffset;
+	    if (transform[2])
+	      for (c = 0; c < length[2]; c++) {
+		double a = rePtr[c], b = imPtr[c];
+		rePtr[c] = a*kernelRePtr[c] - b*kernelImPtr[c];
+		imPtr[c] = a*kernelImPtr[c] + b*kernelRePtr[c];
+	      }
+	    else
+	      for (c = 0; c < length[2]; c++) {
+		double a = rePtr[c], b = imPtr[c];
+		rePtr[c] = a*kernelRePtr[0] - b*kernelImPtr[0];
+		imPtr[c] = a*kernelImPtr[0] + b*kernelRePtr[0];
+	      }
+	  }
+
+	for (axis = 0; axis < 3; axis++)
+	  if (transform[axis])
+	    fftAxis(axis, length[0], length[1], length[2], re, im, TRUE);
+
+	// Store the valid part of the block
+	for (s = 0; (s < block[0]) && (s0 + s < nslis); s++)
+	  for (r = 0; (r < block[1]) && (r0 + r < nrows); r++) {
+	    unsigned long offset = (s + k[0] - 1)*planeSize +
+	      (r + k[1] - 1)*length[2] + k[2] - 1;
+	    const double *rePtr = re + offset;
+	    const double *imPtr = im + offset;
+	    Type *outPtr = out[s0 + s][r0 + r] + c0;
+	    for (c = 0; (c < block[2]) && (c0 + c < ncols); c++)
+	      _convStore(rePtr[c]*scale, imPtr[c]*scale, outPtr[c]);
+	  }
+      }
+    }
+  }
+
+  delete [] kernelRe;
+  delete [] kernelIm;
+  delete [] re;
+  delete [] im;
+  if (copy)
+    _convFreeCopy(copy);
+}
+
+// Returns the method used to convolve with the given kernel. CONV_AUTO takes
+// into account whether the kernel is separable; CONV_SEPARABLE falls back to
+// CONV_DIRECT (with a warning) if it is not.
+template <class Type>
+ConvolutionMethod
+convolutionMethod(unsigned nslis, unsigned nrows, unsigned ncols,
+		  const Type * const * const *kernel,
+		  unsigned kslis, unsigned krows, unsigned kcols,
+		  ConvolutionMethod method = CONV_AUTO)
+{
+  if ((method != CONV_AUTO) && (method != CONV_SEPARABLE))
+    return method;
+
+  Boolean separable = separateKernel(kernel, kslis, krows, kcols);
+  if ((method == CONV_SEPARABLE) && !separable) {
+    std::cerr << "Warning: kernel is not separable; using direct convolution"
+	      << std::endl;
+    return CONV_DIRECT;
+  }
+
+  return convolutionMethod(nslis, nrows, ncols, kslis, krows, kcols, method,
+			   separable);
+}
+
+// Convolves using the specified method, resolving CONV_AUTO from the sizes
+// and the kernel
+template <class Type>
+void
+convolve(Type ***out, const Type * const * const *in,
+	 unsigned nslis, unsigned nrows, unsigned ncols,
+	 const Type * const * const *kernel,
+	 unsigned kslis, unsigned krows, unsigned kcols,
+	 ConvolutionMethod method = CONV_AUTO, BorderMode border = BORDER_ZERO)
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  if (!kslis || !krows || !kcols)
+    method = CONV_DIRECT;
+
+  switch (convolutionMethod(nslis, nrows, ncols, kernel, kslis, krows, kcols, method)) {
+  case CONV_SEPARABLE: {
+    Acc *f0 = new Acc[kslis];
+    Acc *f1 = new Acc[krows];
+    Acc *f2 = new Acc[kcols];
+    separateKernel(kernel, kslis, krows, kcols, f0, f1, f2);
+    convolveSeparable(out, in, nslis, nrows, ncols, f0, kslis, f1, krows, f2, kcols,
+		      border);
+    delete [] f0;
+    delete [] f1;
+    delete [] f2;
+    break;
+  }
+  case CONV_FFT:
+    convolveFFT(out, in, nslis, nrows, ncols, kernel, kslis, krows, kcols, border);
+    break;
+  default:
+    convolveDirect(out, in, nslis, nrows, ncols, kernel, kslis, krows, kcols, border);
+    break;
+  }
+}
+
+#endif
@@ -0,0 +1,211 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _DISTANCE_TRANSFORM_H
+#define _DISTANCE_TRANSFORM_H
+
+/******************************************************************************
+ * Exact squared Euclidean distance transform, shared by Mat<Type> and
+ * Mat3D<Type> (images are passed as slice/row pointer arrays). For every
+ * element, the squared distance to the nearest non-zero element of the
+ * input is computed, in units of the voxel spacing given for each dimension.
+ * Elements of an image without any non-zero element are set to MAXDOUBLE.
+ *
+ * The transform is separable: one pass of the Felzenszwalb-Huttenlocher
+ * lower envelope of parabolas along each dimension (columns, rows, slices),
+ * which is linear in the number of elements. The lines of each pass are
+ * independent, and are distributed over threads when OpenMP is enabled.
+ * Optionally, the linear index (slice*nrows + row)*ncols + col of the
+ * nearest non-zero element is returned as well (-1 if there is none).
+ *****************************************************************************/
+
+#include "MTypes.h"
+
+// Lower envelope of the parabolas (w*(p - q))^2 + f[q] over all q with a
+// finite f[q] (< MAXDOUBLE): d[p] is its value at p, and nearest[p] the q
+// that attains it (n if there is none). v and z hold n and n + 1 elements.
+inline void
+_edtLine(const double *f, unsigned n, double w, double *d, unsigned *nearest,
+	 unsigned *v, double *z)
+{
+  int k = -1;
+  unsigned p, q;
+
+  for (q = 0; q < n; q++) {
+    if (f[q] >= MAXDOUBLE)
+      continue;
+
+    const double xq = w*q;
+    if (k < 0) {
+      k = 0;
+      v[0] = q;
+      z[0] = -MAXDOUBLE;
+      z[1] = MAXDOUBLE;
+      continue;
+    }
+
+    // Drop the parabolas hidden by the new one (z[0] stops this)
+    double s;
+    for (;;) {
+      const double xv = w*v[k];
+      s = ((f[q] + xq*xq) - (f[v[k]] + xv*xv))/(2*(xq - xv));
+      if (s > z[k])
+	break;
+      k--;
+    }
+    k++;
+    v[k]     = q;
+    z[k]     = s;
+    z[k + 1] = MAXDOUBLE;
+  }
+
+  if (k < 0) {
+    for (p = 0; p < n; p++) {
+      d[p]       = MAXDOUBLE;
+      nearest[p] = n;
+    }
+    return;
+  }
+
+  k = 0;
+  for (p = 0; p < n; p++) {
+    const double xp = w*p;
+    while (z[k + 1] < xp)
+      k++;
+    const double dx = xp - w*v[k];
+    d[p]       = dx*dx + f[v[k]];
+    nearest[p] = v[k];
+  }
+}
+
+// Working storage for one thread
+struct _EDTBuffers {
+  double   *f, *d, *z;
+  unsigned *v, *nearest;
+  int      *featureIn;
+
+  _EDTBuffers(unsigned n) {
+    f = new double[n];
+    d = new double[n];
+    z = new double[n + 1];
+    v = new unsigned[n];
+    nearest    = new unsigned[n];
+    featureIn  = new int[n];
+  }
+  ~_EDTBuffers() {
+    delete [] f; delete [] d; delete [] z; delete [] v; delete [] nearest;
+    delete [] featureIn;
+  }
+};
+
+// One pass along rows (axis 1) or slices (axis 0) of dist (and feature).
+// Line i runs through column i % ncols of row or slice i / ncols.
+inline void
+_edtPass(double ***dist, int ***feature, unsigned nslis, unsigned nrows,
+	 unsigned ncols, unsigned axis, double spacing)
+{
+  const unsigned n      = (axis == 0) ? nslis : nrows;
+  const int      nLines = int(((axis == 0) ? nrows : nslis)*ncols);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    _EDTBuffers buffer(n);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int line = 0; line < nLines; line++) {
+      const unsigned outer = unsigned(line)/ncols;
+      const unsigned col   = unsigned(line)%ncols;
+      unsigned j;
+
+      for (j = 0; j < n; j++) {
+	buffer.f[j] = (axis == 0) ? dist[j][outer][col] : dist[outer][j][col];
+	if (feature)
+	  buffer.featureIn[j] = (axis == 0) ? feature[j][outer][col] : feature[outer][j][col];
+      }
+
+      _edtLine(buffer.f, n, spacing, buffer.d, buffer.nearest, buffer.v, buffer.z);
+
+      for (j = 0; j < n; j++) {
+	double& d = (axis == 0) ? dist[j][outer][col] : dist[outer][j][col];
+	d = buffer.d[j];
+	if (feature) {
+	  int& index = (axis == 0) ? feature[j][outer][col] : feature[outer][j][col];
+	  index = (buffer.nearest[j] < n) ? buffer.featureIn[buffer.nearest[j]] : -1;
+	}
+      }
+    }
+  }
+}
+
+// Squared Euclidean distance transform of in into dist; spacing holds the
+// element spacing along slices, rows and columns. If feature is non-zero, it
+// receives the index of the nearest non-zero element.
+template <class Type>
+void
+distanceTransform(double ***dist, const Type * const * const *in,
+		  unsigned nslis, unsigned nrows, unsigned ncols,
+		  const double spacing[3], int ***feature = 0)
+{
+  if (!nslis || !nrows || !ncols)
+    return;
+
+  // Along the columns
+  const int nLines = int(nslis*nrows);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    _EDTBuffers buffer(ncols);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int line = 0; line < nLines; line++) {
+      const unsigned slice = unsigned(line)/nrows;
+      const unsigned row   = unsigned(line)%nrows;
+      const Type    *inRow = in[slice][row];
+      double        *dRow  = dist[slice][row];
+      unsigned c;
+
+      for (c = 0; c < ncols; c++)
+	buffer.f[c] = (inRow[c] != Type(0)) ? 0.0 : MAXDOUBLE;
+
+      _edtLine(buffer.f, ncols, spacing[2], dRow, buffer.nearest, buffer.v, buffer.z);
+
+      if (feature) {
+	int *featureRow = feature[slice][row];
+	for (c = 0; c < ncols; c++)
+	  featureRow[c] = (buffer.nearest[c] < ncols)
+	    ? int(line*ncols + buffer.nearest[c]) : -1;
+      }
+    }
+  }
+
+  if (nrows > 1)
+    _edtPass(dist, feature, nslis, nrows, ncols, 1, spacing[1]);
+  if (nslis > 1)
+    _edtPass(dist, feature, nslis, nrows, ncols, 0, spacing[0]);
+}
+
+#endif
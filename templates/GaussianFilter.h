@@ -0,0 +1,168 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _GAUSSIAN_FILTER_H
+#define _GAUSSIAN_FILTER_H
+
+/******************************************************************************
+ * Recursive Gaussian filtering and Gaussian derivatives, shared by Mat<Type>
+ * and Mat3D<Type> (images are passed as slice/row pointer arrays). Each
+ * dimension is smoothed by a RecursiveGaussian (see MatrixSupport.h), whose
+ * cost per element does not depend on sigma, and then optionally
+ * differentiated by central differences of order 1 or 2, in units of
+ * elements. The image is taken to be constant beyond its borders.
+ *
+ * Sigma is given in elements per dimension; a sigma of 0 leaves that
+ * dimension unsmoothed. For a FWHM in mm, sigma = FWHM/(sqrt(8 ln 2)*spacing).
+ *
+ * The passes run in the accumulator type on a contiguous copy of the image.
+ * Along columns, each row is one line; along rows and slices, the recursion
+ * runs over whole rows (planes) at once, so that the inner loops are
+ * contiguous. Lines and blocks are distributed over threads when OpenMP is
+ * enabled.
+ *****************************************************************************/
+
+#include <algorithm>
+#include <iostream>
+#include "MTypes.h"
+#include "MatrixSupport.h"
+#include "Convolution.h"
+
+// One pass along dimension axis (0: slices, 1: rows, 2: columns) of the
+// contiguous image data, in independent blocks of lines.
+template <class Acc>
+void
+_gaussianPass(Acc *data, unsigned nslis, unsigned nrows, unsigned ncols,
+	      unsigned axis, double sigma, unsigned order)
+{
+  const unsigned      block = 64;
+  const unsigned long plane = (unsigned long) nrows*ncols;
+  unsigned      n, batch;
+  unsigned long stride;
+  int           nTasks;
+
+  switch (axis) {
+  case 0:
+    n = nslis; stride = plane; batch = block;
+    nTasks = int((plane + block - 1)/block);
+    break;
+  case 1:
+    n = nrows; stride = ncols; batch = block;
+    nTasks = int(nslis*((ncols + block - 1)/block));
+    break;
+  default:
+    n = ncols; stride = 1; batch = 1;
+    nTasks = int(nslis*nrows);
+    break;
+  }
+
+  RecursiveGaussian gaussian(sigma);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    Acc *work = new Acc[5*batch];
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int task = 0; task < nTasks; task++) {
+      Acc     *start;
+      unsigned count;
+
+      switch (axis) {
+      case 0:
+	start = data + (unsigned long) task*block;
+	count = (unsigned) std::min((unsigned long) block, plane - (unsigned long) task*block);
+	break;
+      case 1: {
+	const unsigned perSlice = (ncols + block - 1)/block;
+	const unsigned col      = (unsigned(task) % perSlice)*block;
+	start = data + (unsigned(task)/perSlice)*plane + col;
+	count = std::min(block, ncols - col);
+	break;
+      }
+      default:
+	start = data + (unsigned long) task*ncols;
+	count = 1;
+	break;
+      }
+
+      gaussian.filter(start, n, stride, count, order, work);
+    }
+
+    delete [] work;
+  }
+}
+
+// Gaussian filter of in into out (which may be in); sigma and order hold the
+// sigma (in elements) and the derivative order (0, 1 or 2) along slices,
+// rows and columns.
+template <class Type>
+void
+gaussianFilter(Type ***out, const Type * const * const *in,
+	       unsigned nslis, unsigned nrows, unsigned ncols,
+	       const double sigma[3], const unsigned order[3])
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  if (!nslis || !nrows || !ncols)
+    return;
+
+  unsigned axis;
+
+  for (axis = 0; axis < 3; axis++)
+    if (order[axis] > 2) {
+      std::cerr << "gaussianFilter: derivative order must be 0, 1 or 2" << std::endl;
+      return;
+    }
+
+  const int nLines = int(nslis*nrows);
+  Acc *data = new Acc[(unsigned long) nLines*ncols];
+  int line;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (line = 0; line < nLines; line++) {
+    const Type *inRow   = in[unsigned(line)/nrows][unsigned(line)%nrows];
+    Acc        *dataRow = data + (unsigned long) line*ncols;
+    for (unsigned c = 0; c < ncols; c++)
+      dataRow[c] = Acc(inRow[c]);
+  }
+
+  for (axis = 3; axis-- > 0;)
+    if (sigma[axis] > 0 || order[axis])
+      _gaussianPass(data, nslis, nrows, ncols, axis, sigma[axis], order[axis]);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (line = 0; line < nLines; line++) {
+    Type      *outRow  = out[unsigned(line)/nrows][unsigned(line)%nrows];
+    const Acc *dataRow = data + (unsigned long) line*ncols;
+    for (unsigned c = 0; c < ncols; c++)
+      _convFromAcc(dataRow[c], outRow[c]);
+  }
+
+  delete [] data;
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _IIR_FILTER_H
+#define _IIR_FILTER_H
+
+/******************************************************************************
+ * Filtering of all rows or all columns of a matrix (passed as a row pointer
+ * array) with an IIRFilter (see MatrixSupport.h). Each row (or column) is one
+ * signal, e.g. the time course of one voxel. Blocks of signals are gathered
+ * into an interleaved buffer in the accumulator type, so that the recursion
+ * runs over a whole block at once with contiguous inner loops; blocks are
+ * distributed over threads when OpenMP is enabled.
+ *****************************************************************************/
+
+#include <algorithm>
+#include "MTypes.h"
+#include "MatrixSupport.h"
+#include "Convolution.h"
+
+// Filters every row (alongRows) or every column of in into out (which may be
+// in), forward only or with zero phase (forward and backward).
+template <class Type>
+void
+iirFilter(Type **out, const Type * const *in, unsigned nrows, unsigned ncols,
+	  const IIRFilter& filter, Boolean alongRows, Boolean zeroPhase = FALSE)
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  if (!nrows || !ncols || !filter.isValid())
+    return;
+
+  const unsigned block     = 64;
+  const unsigned n         = alongRows ? ncols : nrows; // Samples per signal
+  const unsigned nSignals  = alongRows ? nrows : ncols;
+  const int      nBlocks   = int((nSignals + block - 1)/block);
+  const unsigned extLength = zeroPhase ? n + 2*filter.padding(n) : 0;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    Acc *data  = new Acc[n*block];
+    Acc *state = new Acc[filter.order()*block + 1];
+    Acc *work  = new Acc[(filter.order() + 1)*block];
+    Acc *ext   = zeroPhase ? new Acc[extLength*block] : 0;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int blk = 0; blk < nBlocks; blk++) {
+      const unsigned s0    = unsigned(blk)*block;
+      const unsigned count = std::min(block, nSignals - s0);
+      unsigned j, s;
+
+      // data[j*count + s] is sample j of signal s0 + s
+      if (alongRows)
+	for (s = 0; s < count; s++) {
+	  const Type *inRow = in[s0 + s];
+	  for (j = 0; j < n; j++)
+	    data[j*count + s] = Acc(inRow[j]);
+	}
+      else
+	for (j = 0; j < n; j++) {
+	  const Type *inRow = in[j] + s0;
+	  for (s = 0; s < count; s++)
+	    data[j*count + s] = Acc(inRow[s]);
+	}
+
+      if (zeroPhase)
+	filter.applyZeroPhase(data, n, long(count), count, ext, work);
+      else {
+	for (s = 0; s < filter.order()*count; s++)
+	  state[s] = Acc(0);
+	filter.apply(data, n, long(count), count, state, work);
+      }
+
+      if (alongRows)
+	for (s = 0; s < count; s++) {
+	  Type *outRow = out[s0 + s];
+	  for (j = 0; j < n; j++)
+	    _convFromAcc(data[j*count + s], outRow[j]);
+	}
+      else
+	for (j = 0; j < n; j++) {
+	  Type *outRow = out[j] + s0;
+	  for (s = 0; s < count; s++)
+	    _convFromAcc(data[j*count + s], outRow[s]);
+	}
+    }
+
+    delete [] data;
+    delete [] state;
+    delete [] work;
+    delete [] ext;
+  }
+}
+
+#endif
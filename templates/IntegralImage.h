@@ -0,0 +1,233 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _INTEGRAL_IMAGE_H
+#define _INTEGRAL_IMAGE_H
+
+/******************************************************************************
+ * Summed-area tables (integral images and volumes) of the values and squared
+ * values of an image, for box sums, means and variances in constant time per
+ * box. Images are passed as slice/row pointer arrays, so that a Mat is a
+ * single slice.
+ *
+ * The tables hold (nslis + 1) x (nrows + 1) x (ncols + 1) prefix sums, built
+ * by one pass per dimension; the lines (or planes) of each pass are
+ * distributed over threads when OpenMP is enabled. To limit cancellation in
+ * variances, the image mean is subtracted from all values before summing.
+ *****************************************************************************/
+
+#include <math.h>
+#include <algorithm>
+#include "trivials.h"
+
+// Statistics computed by IntegralImage::boxFilter()
+enum BoxStatistic { BOX_SUM, BOX_MEAN, BOX_VARIANCE };
+
+class IntegralImage {
+public:
+  template <class Type>
+  IntegralImage(const Type * const * const *in, unsigned nslis, unsigned nrows,
+		unsigned ncols, Boolean squares = TRUE) {
+    _slis  = nslis;
+    _rows  = nrows;
+    _cols  = ncols;
+    _shift = 0;
+    const unsigned long size = (unsigned long) (nslis + 1)*(nrows + 1)*(ncols + 1);
+    _sum   = new double[size];
+    _sumSq = squares ? new double[size] : 0;
+
+    unsigned s, r, c;
+    if (nslis && nrows && ncols) {
+      for (s = 0; s < nslis; s++)
+	for (r = 0; r < nrows; r++)
+	  for (c = 0; c < ncols; c++)
+	    _shift += double(in[s][r][c]);
+      _shift /= double(nslis)*nrows*ncols;
+    }
+
+    // Zero borders (s, r or c == 0), and the running sums along each row
+    const int nLines = int((nslis + 1)*(nrows + 1));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) private(c)
+#endif
+    for (int line = 0; line < nLines; line++) {
+      const unsigned sl  = unsigned(line)/(nrows + 1);
+      const unsigned rl  = unsigned(line)%(nrows + 1);
+      double        *sum = _sum + (unsigned long) line*(ncols + 1);
+      double        *sq  = _sumSq ? _sumSq + (unsigned long) line*(ncols + 1) : 0;
+      sum[0] = 0;
+      if (sq)
+	sq[0] = 0;
+      if (!sl || !rl) {
+	for (c = 1; c <= ncols; c++) {
+	  sum[c] = 0;
+	  if (sq)
+	    sq[c] = 0;
+	}
+	continue;
+      }
+      const Type *row = in[sl - 1][rl - 1];
+      for (c = 0; c < ncols; c++) {
+	const double v = double(row[c]) - _shift;
+	sum[c + 1] = sum[c] + v;
+	if (sq)
+	  sq[c + 1] = sq[c] + v*v;
+      }
+    }
+
+    _accumulate(_sum);
+    if (_sumSq)
+      _accumulate(_sumSq);
+  }
+  ~IntegralImage() { delete [] _sum; delete [] _sumSq; }
+
+  unsigned getslis() const { return _slis; }
+  unsigned getrows() const { return _rows; }
+  unsigned getcols() const { return _cols; }
+
+  // Statistics of the box [s0, s1) x [r0, r1) x [c0, c1). The variance is
+  // that of the box population, and requires the squared-value table. The
+  // mean and variance of an empty box are 0.
+  unsigned long count(unsigned s0, unsigned s1, unsigned r0, unsigned r1,
+		      unsigned c0, unsigned c1) const {
+    return (unsigned long) (s1 - s0)*(r1 - r0)*(c1 - c0); }
+  double   sum(unsigned s0, unsigned s1, unsigned r0, unsigned r1,
+	       unsigned c0, unsigned c1) const {
+    return _boxSum(_sum, s0, s1, r0, r1, c0, c1) + _shift*count(s0, s1, r0, r1, c0, c1); }
+  double   mean(unsigned s0, unsigned s1, unsigned r0, unsigned r1,
+		unsigned c0, unsigned c1) const;
+  double   variance(unsigned s0, unsigned s1, unsigned r0, unsigned r1,
+		    unsigned c0, unsigned c1) const;
+
+  // Box statistic over the kslis x krows x kcols window centered (at
+  // (kslis/2, krows/2, kcols/2)) on every element, clipped to the image,
+  // into out (nslis x nrows x ncols). As with rankFilter(), out is left
+  // untouched if any window dimension is 0.
+  void     boxFilter(double ***out, unsigned kslis, unsigned krows, unsigned kcols,
+		     BoxStatistic statistic = BOX_MEAN) const;
+
+private:
+  unsigned  _slis, _rows, _cols;
+  double    _shift;
+  double   *_sum, *_sumSq;
+
+  IntegralImage(const IntegralImage&);
+  IntegralImage& operator = (const IntegralImage&);
+
+  double _boxSum(const double *table, unsigned s0, unsigned s1, unsigned r0,
+		 unsigned r1, unsigned c0, unsigned c1) const {
+    const unsigned long rowStride   = _cols + 1;
+    const unsigned long sliceStride = (unsigned long) (_rows + 1)*rowStride;
+    const double *a = table + s0*sliceStride, *b = table + s1*sliceStride;
+    const unsigned long i00 = r0*rowStride, i01 = r1*rowStride;
+    return ((b[i01 + c1] - b[i01 + c0] - b[i00 + c1] + b[i00 + c0]) -
+	    (a[i01 + c1] - a[i01 + c0] - a[i00 + c1] + a[i00 + c0]));
+  }
+  void _accumulate(double *table);
+};
+
+inline double
+IntegralImage::mean(unsigned s0, unsigned s1, unsigned r0, unsigned r1,
+		    unsigned c0, unsigned c1) const
+{
+  const unsigned long n = count(s0, s1, r0, r1, c0, c1);
+  if (!n)
+    return 0;
+  return _boxSum(_sum, s0, s1, r0, r1, c0, c1)/n + _shift;
+}
+
+inline double
+IntegralImage::variance(unsigned s0, unsigned s1, unsigned r0, unsigned r1,
+			unsigned c0, unsigned c1) const
+{
+  if (!_sumSq || !count(s0, s1, r0, r1, c0, c1))
+    return 0;
+  const double n    = double(count(s0, s1, r0, r1, c0, c1));
+  const double m    = _boxSum(_sum, s0, s1, r0, r1, c0, c1)/n;
+  const double var  = _boxSum(_sumSq, s0, s1, r0, r1, c0, c1)/n - m*m;
+  return (var > 0) ? var : 0;
+}
+
+// Prefix sums along rows and slices (those along columns are done while
+// filling the table)
+inline void
+IntegralImage::_accumulate(double *table)
+{
+  const unsigned long rowStride   = _cols + 1;
+  const unsigned long sliceStride = (unsigned long) (_rows + 1)*rowStride;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int s = 1; s <= int(_slis); s++)
+    for (unsigned r = 1; r <= _rows; r++) {
+      double       *row  = table + s*sliceStride + r*rowStride;
+      const double *prev = row - rowStride;
+      for (unsigned c = 1; c <= _cols; c++)
+	row[c] += prev[c];
+    }
+
+  if (_slis > 1) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int r = 1; r <= int(_rows); r++)
+      for (unsigned s = 2; s <= _slis; s++) {
+	double       *row  = table + s*sliceStride + r*rowStride;
+	const double *prev = row - sliceStride;
+	for (unsigned c = 1; c <= _cols; c++)
+	  row[c] += prev[c];
+      }
+  }
+}
+
+inline void
+IntegralImage::boxFilter(double ***out, unsigned kslis, unsigned krows,
+			 unsigned kcols, BoxStatistic statistic) const
+{
+  if (!kslis || !krows || !kcols)
+    return;
+
+  const int nLines = int(_slis*_rows);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int line = 0; line < nLines; line++) {
+    const unsigned s  = unsigned(line)/_rows;
+    const unsigned r  = unsigned(line)%_rows;
+    const unsigned s0 = (s > kslis/2) ? s - kslis/2 : 0;
+    const unsigned s1 = std::min(s + kslis - kslis/2, _slis);
+    const unsigned r0 = (r > krows/2) ? r - krows/2 : 0;
+    const unsigned r1 = std::min(r + krows - krows/2, _rows);
+    double *outRow = out[s][r];
+
+    for (unsigned c = 0; c < _cols; c++) {
+      const unsigned c0 = (c > kcols/2) ? c - kcols/2 : 0;
+      const unsigned c1 = std::min(c + kcols - kcols/2, _cols);
+      switch (statistic) {
+      case BOX_SUM:      outRow[c] = sum(s0, s1, r0, r1, c0, c1); break;
+      case BOX_VARIANCE: outRow[c] = variance(s0, s1, r0, r1, c0, c1); break;
+      default:           outRow[c] = mean(s0, s1, r0, r1, c0, c1); break;
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,312 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _LABELING_H
+#define _LABELING_H
+
+/******************************************************************************
+ * Connected-component labeling, shared by Mat<Type> and Mat3D<Type> (images
+ * are passed as slice/row pointer arrays). The non-zero elements of the input
+ * are labeled 1..n in raster order of their first element; background
+ * elements are labeled 0. Connectivity is 4 or 8 (within each slice), or 6,
+ * 18 or 26 (in 3D).
+ *
+ * Labeling is done in two passes with a union-find of provisional labels
+ * (with path compression). The image lines (rows of all slices) are split
+ * into blocks that are labeled independently, in parallel when OpenMP is
+ * enabled; the labels are then merged across block boundaries, resolved, and
+ * written back, again in parallel. The result does not depend on the number
+ * of threads.
+ *****************************************************************************/
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <algorithm>
+#include <iostream>
+#include "Array.h"
+
+// Size and bounding box of a connected component
+struct Component {
+  unsigned long size;
+  unsigned      minSlice, maxSlice;
+  unsigned      minRow, maxRow;
+  unsigned      minCol, maxCol;
+};
+
+// Root of label x; halves the path on the way
+inline int
+_labelRoot(int *parent, int x)
+{
+  while (parent[x] != x) {
+    parent[x] = parent[parent[x]];
+    x = parent[x];
+  }
+  return x;
+}
+
+// Merges the sets of labels a and b under the smaller root, and returns it.
+// Roots thus always precede their descendants.
+inline int
+_labelUnion(int *parent, int a, int b)
+{
+  a = _labelRoot(parent, a);
+  b = _labelRoot(parent, b);
+  if (a < b) {
+    parent[b] = a;
+    return a;
+  }
+  parent[a] = b;
+  return b;
+}
+
+// Provisional labels of one block of lines
+struct _LabelBlock {
+  int      *parent;
+  unsigned  nLabels, capacity;
+
+  _LabelBlock() : parent(0), nLabels(0), capacity(0) {}
+  ~_LabelBlock() { delete [] parent; }
+
+  int newLabel() {
+    if (nLabels + 1 >= capacity) {
+      capacity = (capacity < 64) ? 128 : 2*capacity;
+      int *newParent = new int[capacity];
+      for (unsigned i = 0; i <= nLabels; i++)
+	newParent[i] = parent ? parent[i] : 0;
+      delete [] parent;
+      parent = newParent;
+    }
+    nLabels++;
+    parent[nLabels] = int(nLabels);
+    return int(nLabels);
+  }
+};
+
+// Offsets (slice, row, col) of the neighbours preceding an element in raster
+// order, for the given connectivity. Returns the number of neighbours, or 0
+// if the connectivity is not supported.
+inline unsigned
+_labelNeighbours(unsigned connectivity, int offsets[13][3])
+{
+  unsigned n = 0;
+  for (int ds = -1; ds <= 0; ds++)
+    for (int dr = -1; dr <= 1; dr++)
+      for (int dc = -1; dc <= 1; dc++) {
+	if ((ds == 0) && ((dr > 0) || ((dr == 0) && (dc >= 0))))
+	  continue;
+	const int order = (ds != 0) + (dr != 0) + (dc != 0);
+	Boolean use;
+	switch (connectivity) {
+	case 4:  use = (ds == 0) && (order == 1); break;
+	case 8:  use = (ds == 0); break;
+	case 6:  use = (order == 1); break;
+	case 18: use = (order <= 2); break;
+	case 26: use = TRUE; break;
+	default: return 0;
+	}
+	if (use) {
+	  offsets[n][0] = ds;
+	  offsets[n][1] = dr;
+	  offsets[n][2] = dc;
+	  n++;
+	}
+      }
+  return n;
+}
+
+// Labels the connected non-zero elements of in into labels, and returns the
+// number of components. If components is non-zero, it receives the size and
+// bounding box of each component (element i describes label i + 1).
+template <class Type>
+unsigned
+labelComponents(int ***labels, const Type * const * const *in,
+		unsigned nslis, unsigned nrows, unsigned ncols,
+		unsigned connectivity, Array<Component> *components = 0)
+{
+  int offsets[13][3];
+  const unsigned nNeighbours = _labelNeighbours(connectivity, offsets);
+  if (!nNeighbours) {
+    std::cerr << "labelComponents: connectivity must be 4, 8, 6, 18 or 26" << std::endl;
+    if (components)
+      components->newSize(0);
+    return 0;
+  }
+
+  const int nLines = int(nslis*nrows);
+  if (!nLines || !ncols) {
+    if (components)
+      components->newSize(0);
+    return 0;
+  }
+
+  // Blocks of consecutive lines
+#ifdef _OPENMP
+  int nBlocks = 4*omp_get_max_threads();
+#else
+  int nBlocks = 1;
+#endif
+  if (nBlocks > nLines)
+    nBlocks = nLines;
+  const int linesPerBlock = (nLines + nBlocks - 1)/nBlocks;
+  nBlocks = (nLines + linesPerBlock - 1)/linesPerBlock;
+
+  _LabelBlock *blocks = new _LabelBlock[nBlocks];
+  int block;
+
+  // First pass: provisional labels within each block
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (block = 0; block < nBlocks; block++) {
+    _LabelBlock&  labelBlock = blocks[block];
+    const int     firstLine  = block*linesPerBlock;
+    const int     endLine    = std::min(firstLine + linesPerBlock, nLines);
+    const int    *neighbourRow[13];
+
+    for (int line = firstLine; line < endLine; line++) {
+      const int   slice = line/int(nrows);
+      const int   row   = line%int(nrows);
+      const Type *inRow = in[slice][row];
+      int        *lRow  = labels[slice][row];
+      unsigned    k;
+
+      for (k = 0; k < nNeighbours; k++) {
+	const int s = slice + offsets[k][0];
+	const int r = row + offsets[k][1];
+	neighbourRow[k] = ((s >= 0) && (r >= 0) && (r < int(nrows)) &&
+			   (s*int(nrows) + r >= firstLine)) ? labels[s][r] : 0;
+      }
+
+      for (int col = 0; col < int(ncols); col++) {
+	if (inRow[col] == Type(0)) {
+	  lRow[col] = 0;
+	  continue;
+	}
+
+	int label = 0;
+	for (k = 0; k < nNeighbours; k++) {
+	  const int c = col + offsets[k][2];
+	  if (!neighbourRow[k] || (c < 0) || (c >= int(ncols)) || !neighbourRow[k][c])
+	    continue;
+	  if (!label)
+	    label = neighbourRow[k][c];
+	  else if (label != neighbourRow[k][c])
+	    label = _labelUnion(labelBlock.parent, label, neighbourRow[k][c]);
+	}
+	lRow[col] = label ? label : labelBlock.newLabel();
+      }
+    }
+  }
+
+  // Global label of local label l of block b is offset[b] + l
+  int *offset = new int[nBlocks + 1];
+  offset[0] = 0;
+  for (block = 0; block < nBlocks; block++)
+    offset[block + 1] = offset[block] + int(blocks[block].nLabels);
+
+  int *parent = new int[offset[nBlocks] + 1];
+  parent[0] = 0;
+  for (block = 0; block < nBlocks; block++) {
+    for (unsigned i = 1; i <= blocks[block].nLabels; i++)
+      parent[offset[block] + i] = offset[block] + blocks[block].parent[i];
+  }
+  delete [] blocks;
+
+  // Merge across block boundaries. Neighbours lie at most nrows + 1 lines back.
+  for (block = 1; block < nBlocks; block++) {
+    const int firstLine = block*linesPerBlock;
+    const int endLine   = std::min(firstLine + int(nrows) + 1,
+				   std::min(firstLine + linesPerBlock, nLines));
+
+    for (int line = firstLine; line < endLine; line++) {
+      const int  slice = line/int(nrows);
+      const int  row   = line%int(nrows);
+      const int *lRow  = labels[slice][row];
+
+      for (unsigned k = 0; k < nNeighbours; k++) {
+	const int s = slice + offsets[k][0];
+	const int r = row + offsets[k][1];
+	const int neighbourLine = s*int(nrows) + r;
+	if ((s < 0) || (r < 0) || (r >= int(nrows)) || (neighbourLine >= firstLine))
+	  continue;
+
+	const int *nRow        = labels[s][r];
+	const int  nOffset     = offset[neighbourLine/linesPerBlock];
+	const int  colStart    = std::max(0, -offsets[k][2]);
+	const int  colEnd      = std::min(int(ncols), int(ncols) - offsets[k][2]);
+	for (int col = colStart; col < colEnd; col++)
+	  if (lRow[col] && nRow[col + offsets[k][2]])
+	    _labelUnion(parent, offset[block] + lRow[col],
+			nOffset + nRow[col + offsets[k][2]]);
+      }
+    }
+  }
+
+  // Resolve: roots precede their descendants, so one forward pass suffices
+  int nComponents = 0;
+  for (int i = 1; i <= offset[nBlocks]; i++)
+    parent[i] = (parent[i] == i) ? ++nComponents : parent[parent[i]];
+
+  // Second pass: final labels
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int line = 0; line < nLines; line++) {
+    const int  blockOffset = offset[line/linesPerBlock];
+    int       *lRow        = labels[line/int(nrows)][line%int(nrows)];
+    for (unsigned col = 0; col < ncols; col++)
+      if (lRow[col])
+	lRow[col] = parent[blockOffset + lRow[col]];
+  }
+
+  delete [] parent;
+  delete [] offset;
+
+  if (components) {
+    components->newSize(nComponents);
+    Component *component = *components;
+    for (int i = 0; i < nComponents; i++) {
+      component[i].size     = 0;
+      component[i].minSlice = nslis; component[i].maxSlice = 0;
+      component[i].minRow   = nrows; component[i].maxRow   = 0;
+      component[i].minCol   = ncols; component[i].maxCol   = 0;
+    }
+
+    for (unsigned slice = 0; slice < nslis; slice++)
+      for (unsigned row = 0; row < nrows; row++) {
+	const int *lRow = labels[slice][row];
+	for (unsigned col = 0; col < ncols; col++)
+	  if (lRow[col]) {
+	    Component& c = component[lRow[col] - 1];
+	    c.size++;
+	    if (slice < c.minSlice) c.minSlice = slice;
+	    if (slice > c.maxSlice) c.maxSlice = slice;
+	    if (row < c.minRow)     c.minRow   = row;
+	    if (row > c.maxRow)     c.maxRow   = row;
+	    if (col < c.minCol)     c.minCol   = col;
+	    if (col > c.maxCol)     c.maxCol   = col;
+	  }
+      }
+  }
+
+  return unsigned(nComponents);
+}
+
+#endif
@@ -1444,7 +1444,32 @@ template <class Type>
 Type
 Mat<Type>::median(Type minVal, Type maxVal) const
 {
-  return array(minVal, maxVal).medianVolatile();
+  return percentile(50, minVal, maxVal);
+}
+
+template <class Type>
+Type
+Mat<Type>::percentile(double pct, Type minVal, Type maxVal) const
+{
+  Type value = 0;
+  if (!::percentiles((const Type **) _el, _rows, _cols, &pct, 1, &value, minVal, maxVal))
+    cerr << "Warning! Mat::percentile() called without elements in range" << endl;
+
+  return value;
+}
+
+template <class Type>
+SimpleArray<Type>
+Mat<Type>::percentiles(const SimpleArray<double>& pct, Type minVal, Type maxVal) const
+{
+  SimpleArray<Type> values(pct.size());
+  values.clear(0);
+  if (pct.size() && 
+      !::percentiles((const Type **) _el, _rows, _cols, pct.contents(), pct.size(),
+		     values.contents(), minVal, maxVal))
+    cerr << "Warning! Mat::percentiles() called without elements in range" << endl;
+
+  return values;
 }
 
 //
@@ -1871,53 +1896,99 @@ Mat<Type>::rowhouse(const Mat<Type>& V) const
 //
 template <class Type>
 Mat<Type>
-Mat<Type>::convolv2d(const Mat<Type>& filter) const
+Mat<Type>::convolv2d(const Mat<Type>& filter, ConvolutionMethod method,
+		      BorderMode border) const
 {
-  unsigned    row,column, i, j;
-  unsigned    dead_rows, dead_cols, kernel_rows, kernel_cols, l_cols, l_rows;
-  Type   *outptr, *inptr, *filterptr;
-
   Mat<Type> out(_rows,_cols);
-  Mat<Type> filterrev = filter.rotate180();
-  kernel_rows = filter.getrows();
-  kernel_cols = filter.getcols();
-  dead_rows = kernel_rows/2;
-  dead_cols = kernel_cols/2;
-  l_rows = 2*dead_rows + _rows;
-  l_cols = 2*dead_cols +_cols;
-  Mat<Type> large(l_rows, l_cols);
-  Mat<Type> outlarge(l_rows, l_cols);
-
-/*copy in into center of large*/
-  for(i=0; i < _rows ; i++){
-    for(j=0; j < _cols ; j++)
-      large._el[i+dead_rows][j+dead_cols] = _el[i][j];
-  }
-
-  for(row=0; row < large._rows -kernel_rows+1; row++){
-    outptr = outlarge._el[row+dead_rows];
-    for (column=0; column<large._cols-kernel_cols+1; column++){
-      Type sumval = 0;
-      for (i=0; i< kernel_rows; i++){
-	inptr = large._el[i+row];
-	inptr = inptr + column;
-	filterptr = (Type *) filterrev._el[i];
-	for (j=0; j< kernel_cols; j++)
-	  sumval += (*inptr++) * (*filterptr++);
-      }
 
-      outptr[column+dead_cols] = sumval;
-    }
+  if (_rows && _cols) {
+    Type **outEl = out._el;
+    const Type * const *filterEl = filter._el;
+    convolve(&outEl, &_el, 1, _rows, _cols, &filterEl, 1, filter._rows, filter._cols,
+	     method, border);
   }
-  
-  for(i=0; i < _rows ; i++){
-    for(j=0; j < _cols ; j++)
-      out._el[i][j] = outlarge._el[i+dead_rows][j+dead_cols];
+
+  return(out);
+}
+
+//
+//-------------------------//
+//
+template <class Type>
+Mat<Type>&
+Mat<Type>::convolv2dInPlace(const Mat<Type>& filter, ConvolutionMethod method,
+			    BorderMode border)
+{
+  if (_rows && _cols) {
+    const Type * const *filterEl = filter._el;
+    convolve(&_el, &_el, 1, _rows, _cols, &filterEl, 1, filter._rows, filter._cols,
+	     method, border);
+  }
+
+  return *this;
+}
+
+//
+//-------------------------//
+//
+template <class Type>
+Mat<Type>
+Mat<Type>::convolv2d(const Mat<Type>& columnFilter, const Mat<Type>& rowFilter,
+		      BorderMode border) const
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  if (!columnFilter.isvector() || !rowFilter.isvector()) {
+    cerr << "Mat<Type>::convolv2d: separable filter factors must be vectors" << endl;
+    return Mat<Type>(_rows, _cols);
+  }
+
+  unsigned krows = columnFilter.length();
+  unsigned kcols = rowFilter.length();
+  Acc *f0 = new Acc[1];
+  Acc *f1 = new Acc[krows];
+  Acc *f2 = new Acc[kcols];
+  unsigned i;
+
+  f0[0] = 1;
+  for (i = 0; i < krows; i++)
+    f1[i] = Acc((columnFilter._cols == 1) ? columnFilter._el[i][0] : columnFilter._el[0][i]);
+  for (i = 0; i < kcols; i++)
+    f2[i] = Acc((rowFilter._cols == 1) ? rowFilter._el[i][0] : rowFilter._el[0][i]);
+
+  Mat<Type> out(_rows, _cols);
+  if (_rows && _cols) {
+    Type **outEl = out._el;
+    convolveSeparable(&outEl, &_el, 1, _rows, _cols, f0, 1, f1, krows, f2, kcols, border);
   }
 
+  delete [] f0;
+  delete [] f1;
+  delete [] f2;
+
   return(out);
 }
 
+//
+//-------------------------//
+//
+template <class Type>
+Mat<Type>
+Mat<Type>::gaussianFilter(double rowSigma, double colSigma,
+			  unsigned rowOrder, unsigned colOrder) const
+{
+  Mat<Type> out(_rows, _cols);
+
+  if (_rows && _cols) {
+    const double   sigma[3] = {0, rowSigma, colSigma};
+    const unsigned order[3] = {0, rowOrder, colOrder};
+    Type **outEl = out._el;
+    ::gaussianFilter(&outEl, &_el, 1, _rows, _cols, sigma, order);
+  }
+
+  return out;
+}
+
 /***************/
 
 template <class Type>
@@ -1930,13 +2001,7 @@ Mat<Type>::histogram(double minin, double maxin, unsigned n) const
   }
 
   Histogram histogram(minin, maxin, n);
-
-  const Type **rowPtr = (const Type **) _el;
-  for (unsigned i = _rows; i; i--) {
-    const Type *elPtr = *rowPtr++;
-    for (unsigned j = _cols; j; j--)
-      histogram.add(*elPtr++);
-  }
+  histogram.add((const Type **) _el, _rows, _cols);
   
   return histogram;
 }
@@ -2397,12 +2462,29 @@ template < class Type>
 Mat<Type>&
 Mat<Type>::map(const ValueMap& valueMap)
 {
-  Type **rowPtr = _el;
-  for(unsigned i = _rows; i; i--) {
-    Type *elPtr = *rowPtr++;
-    for (unsigned j = _cols; j; j--, elPtr++)
-      *elPtr = Type(valueMap(double(*elPtr)));
-  }
+  const int nRows = int(_rows);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i = 0; i < nRows; i++)
+    mapValues(valueMap, _el[i], _el[i], _cols);
+  
+  return(*this);
+}
+
+template < class Type>
+Mat<Type>&
+Mat<Type>::map(const CompiledMap& valueMap)
+{
+  const CompiledMapKernel<Type> kernel(valueMap, nElements());
+  const int nRows = int(_rows);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i = 0; i < nRows; i++)
+    kernel(_el[i], _el[i], _cols);
   
   return(*this);
 }
@@ -2426,74 +2508,110 @@ Mat<Type>::scale(double minout, double maxout, double minin, double maxin)
     maxin = asDouble(max());
   }
 
-  map(LinearMap(minin, maxin, minout, maxout));
-  clip(Type(minout), Type(maxout), Type(minout), Type(maxout));
+  // A single pass, clipping before the conversion to Type
+  CompiledMap scaleMap;
+  map(scaleMap.addScale(minin, maxin, minout, maxout));
 
   return *this;
 }
 
+template <class Type>
+Mat<Type>
+Mat<Type>::resample(unsigned nrows, unsigned ncols, ResampleKernel kernel,
+		    BorderMode border) const
+{
+  Mat<Type> result(nrows, ncols);
+
+  if (*this && result) {
+    const double rowStep = double(_rows)/nrows;
+    const double colStep = double(_cols)/ncols;
+    ResampleTable rowTable(_rows, nrows, rowStep, 0.5*rowStep - 0.5, kernel, border);
+    ResampleTable colTable(_cols, ncols, colStep, 0.5*colStep - 0.5, kernel, border);
+
+    Type **resultEl = result._el;
+    ::resample(&resultEl, &_el, 1, _rows, _cols, 0, &rowTable, &colTable);
+  }
+
+  return result;
+}
+
+template <class Type>
+Mat<Type>
+Mat<Type>::resampleBy(double rowFactor, double colFactor, ResampleKernel kernel,
+		      BorderMode border) const
+{
+  if ((rowFactor <= 0) || (colFactor <= 0)) {
+    cerr << "Mat<Type>::resampleBy(): scale factors must be positive" << endl;
+    return Mat<Type>(*this);
+  }
+
+  return resample(unsigned(floor(_rows*rowFactor + 0.5)),
+		  unsigned(floor(_cols*colFactor + 0.5)), kernel, border);
+}
+
+template <class Type>
+Mat<Type>
+Mat<Type>::reduce(BorderMode border) const
+{
+  Mat<Type> result(pyramidReduceSize(_rows), pyramidReduceSize(_cols));
+
+  Type **resultEl = result._el;
+  pyramidReduce(&resultEl, &_el, 1, _rows, _cols, border);
+
+  return result;
+}
+
+template <class Type>
+Mat<Type>
+Mat<Type>::expand(unsigned nrows, unsigned ncols, BorderMode border) const
+{
+  if ((nrows > 2*_rows) || (ncols > 2*_cols) || (nrows < _rows) || (ncols < _cols) ||
+      ((nrows != _rows) && (nrows < 2*_rows - 1)) ||
+      ((ncols != _cols) && (ncols < 2*_cols - 1))) {
+    cerr << "Mat<Type>::expand(): cannot expand a " << _rows << "x" << _cols
+	 << " matrix to " << nrows << "x" << ncols << endl;
+    return Mat<Type>(*this);
+  }
+
+  Mat<Type> result(nrows, ncols);
+
+  Type **resultEl = result._el;
+  pyramidExpand(&resultEl, 1, nrows, ncols, &_el, 1, _rows, _cols, 0, border);
+
+  return result;
+}
+
+template <class Type>
+Pyramid<Type>
+Mat<Type>::pyramid(unsigned nLevels, Boolean laplacian, BorderMode border) const
+{
+  return Pyramid<Type>(&_el, 1, _rows, _cols, nLevels, laplacian, border);
+}
+
 template <class Type>
 void 
 Mat<Type>::linearinterpolate(unsigned Urow, unsigned Drow, unsigned Ucol, unsigned Dcol, Mat<Type>& y) const
 {
+   if (!*this) {
+     y = Mat<Type>();
+     return;
+   }
 
-   unsigned     i, nrows, ncols, out_rows, out_cols;
-   unsigned     n, m;
-   
-   nrows = _rows;
-   ncols = _cols;
-   
-   out_cols = ((ncols-1)*Urow+1)/Drow;
-   out_rows = ((nrows-1)*Ucol+1)/Dcol;
+   // Column positions follow Urow/Drow, row positions Ucol/Dcol
+   unsigned out_cols = ((_cols-1)*Urow+1)/Drow;
+   unsigned out_rows = ((_rows-1)*Ucol+1)/Dcol;
 
-/**************changed 6/23/94**********************   
-   remake(y, out_rows, out_cols);
-   y.fill((Type)0);
-   y = Zeros<Type>(out_rows, out_cols);
-   
-   yi.fill((Type)0);
-   yi = Zeros<Type>(nrows, out_cols);
-****************************************************/
-   y=Mat<Type> (out_rows,out_cols);
-   Mat<Type> yi(nrows,out_cols);
-   
-   Mat<Type> tempr(1,ncols*Urow+1);
-   
-   for(i=0 ; i < nrows ; i++){
-      tempr.fill((Type)0);
-/*************************
-      tempr = Zeros<Type>(1,ncols*Urow + 1);
-**************************/
-      tempr(0) = _el[i][0];
-      for(n=1 ; n < ncols ; n++){
-	 tempr(n*Urow) = _el[i][n];
-	 for(m=1 ; m < Urow ; m++){
-	    tempr((n-1)*Urow + m) = 
-	       tempr((n-1)*Urow) + (tempr(n*Urow)-tempr((n-1)*Urow))*m/Urow;
-	 }
-      }
-      for(n=0 ; n < out_cols ; n++)
-	 yi(i,n) = tempr(n*Drow);
-   }
-   
-   Mat<Type> tempc(1,nrows*Ucol + 1);
-   
-   for(i=0 ; i < out_cols ; i++){
-/***************changed 6/23/94****************   
-      tempc = Zeros<Type>(1,nrows*Ucol + 1);
-**********************************************/
-      tempc.fill((Type)0);
-      tempc(0) = yi(0,i);
-      for(n=1 ; n < nrows ; n++){
-	 tempc(n*Ucol) = yi(n, i);
-	 for(m=1 ; m < Ucol ; m++){
-	    tempc((n-1)*Ucol + m) = 
-	       tempc((n-1)*Ucol) + (tempc(n*Ucol)-tempc((n-1)*Ucol))*m/Ucol;
-	 }
-      }
-      for(n=0 ; n < out_rows ; n++)
-	 y(n,i) = tempc(n*Dcol);
-   }
+   y = Mat<Type>(out_rows, out_cols);
+   if (!y)
+     return;
+
+   ResampleTable rowTable(_rows, out_rows, double(Dcol)/Ucol, 0, RESAMPLE_LINEAR,
+			  BORDER_CLAMP, FALSE);
+   ResampleTable colTable(_cols, out_cols, double(Drow)/Urow, 0, RESAMPLE_LINEAR,
+			  BORDER_CLAMP, FALSE);
+
+   Type **yEl = y._el;
+   ::resample(&yEl, &_el, 1, _rows, _cols, 0, &rowTable, &colTable);
 }
 
 //
@@ -2502,11 +2620,8 @@ Mat<Type>::linearinterpolate(unsigned Urow, unsigned Drow, unsigned Ucol, unsign
 
 template <class Type>
 Mat<Type> 
-Mat<Type>::filter(Mat<Type>& B,Mat<Type>& A) const
+Mat<Type>::filter(const Mat<Type>& B, const Mat<Type>& A) const
 {
-   unsigned     n, i, P, Q, N;
-   Type  temp;
-   
    if ((B._rows != 1) && (B._cols != 1)){
       cerr << "error in filter: numerator not a vector." << endl;
       cerr << B._rows << "x" << B._cols << endl;
@@ -2527,41 +2642,105 @@ Mat<Type>::filter(Mat<Type>& B,Mat<Type>& A) const
       cerr << "      must be non-zero." << endl;
       exit(1);
    }
-   P = A.length();
-   P=P-1;   
-   Q = B.length();   
-   Q=Q-1;
-   N = this->length();
-   temp = A(0);
-   if (A(0) != 1.0){
-      for (i=0 ; i <= Q ; i++)
-	 B(i) = B(i)/temp;
-      for (i=0 ; i <= P ; i++)
-	 A(i) = A(i)/temp;
+
+   return (_rows == 1) ? filterRows(B, A) : filterColumns(B, A);
+}
+
+//
+//-------------------------//
+//
+template <class Type>
+Mat<Type> 
+Mat<Type>::filtfilt(const Mat<Type>& B, const Mat<Type>& A) const
+{
+   if (!isvector()) {
+      cerr << "Mat<Type>::filtfilt: input not a vector" << endl;
+      return Mat<Type>(_rows, _cols);
    }
-   
-   Mat<Type> y(_rows,_cols);
-   Mat<Type> pastx(1,Q+1);   
-   Mat<Type> pasty(1,P+1);
-   
-   for(n=0 ; n < N ; n++){
-      y(n) = 0;
-      pastx(0) = this->operator () (n);
-      for (i=1 ; i <= P ; i++)
-	 y(n) = y(n) - A(i)*pasty(i);
-      for (i=0 ; i <= Q ; i++)
-	 y(n) = y(n) + B(i)*pastx(i);
-      pasty(0) = y(n);
-      for(i=P ; i > 0 ; i--)
-	 pasty(i) = pasty(i-1);
-      for(i=Q ; i > 0 ; i--)
-	 pastx(i) = pastx(i-1);
+
+   return (_rows == 1) ? filterRows(B, A, TRUE) : filterColumns(B, A, TRUE);
+}
+
+//
+//-------------------------//
+//
+// IIRFilter with the coefficients in the vectors B and A
+template <class Type>
+static IIRFilter
+_iirFilter(const Mat<Type>& B, const Mat<Type>& A)
+{
+   if (!B.isvector() || !A.isvector()) {
+      cerr << "Mat<Type>::filterRows/filterColumns: coefficients not vectors" << endl;
+      return IIRFilter(0, 0, 0, 0);
    }
-   
-   return(y);
+
+   const unsigned nb = B.length(), na = A.length();
+   double *b = new double[nb];
+   double *a = new double[na];
+   unsigned i;
+
+   for (i = 0; i < nb; i++)
+      b[i] = double(B(i));
+   for (i = 0; i < na; i++)
+      a[i] = double(A(i));
+
+   IIRFilter filter(b, nb, a, na);
+
+   delete [] b;
+   delete [] a;
+
+   return filter;
+}
+
+template <class Type>
+Mat<Type> 
+Mat<Type>::filterRows(const Mat<Type>& B, const Mat<Type>& A, Boolean zeroPhase) const
+{
+   Mat<Type> y(_rows, _cols);
+
+   Type **yEl = y._el;
+   iirFilter(yEl, _el, _rows, _cols, _iirFilter(B, A), TRUE, zeroPhase);
+
+   return y;
+}
+
+template <class Type>
+Mat<Type> 
+Mat<Type>::filterColumns(const Mat<Type>& B, const Mat<Type>& A, Boolean zeroPhase) const
+{
+   Mat<Type> y(_rows, _cols);
+
+   Type **yEl = y._el;
+   iirFilter(yEl, _el, _rows, _cols, _iirFilter(B, A), FALSE, zeroPhase);
+
+   return y;
 }
 
 /***************************morphology functions*******************************/
+template <class Type>
+Mat<Type>
+Mat<Type>::erode(const CompiledStrel& strel) const
+{
+  Mat<Type> result(_rows, _cols);
+
+  Type **resultEl = result._el;
+  morphology(&resultEl, &_el, 1, _rows, _cols, strel, FALSE);
+
+  return result;
+}
+
+template <class Type>
+Mat<Type>
+Mat<Type>::dilate(const CompiledStrel& strel) const
+{
+  Mat<Type> result(_rows, _cols);
+
+  Type **resultEl = result._el;
+  morphology(&resultEl, &_el, 1, _rows, _cols, strel, TRUE);
+
+  return result;
+}
+
 #ifdef USE_DBLMAT
 template <class Type>
 Mat<Type>
@@ -2573,104 +2752,84 @@ Mat<Type>::erode(const Mat<double>& strel) const
   if (((strelHeight == 1) && (strelWidth == 1)) || !strelHeight || !strelWidth)
     return Mat<Type>(*this);
 
-  Mat<Type> padMatrix(pad(strelHeight/2, strelWidth/2));
-  Mat<Type> result(_rows, _cols);
-
-  Type   *padMatrixPtr1 = padMatrix._el[0];
-  const double *strelStart = strel.getEl()[0];
-  Type   *resultPtr     = result._el[0];
-
-  unsigned padMatrixPtr2incr = padMatrix._cols - strelWidth;
-  unsigned padMatrixPtr1incr = (strelWidth/2) * 2;
-     
-  for (unsigned y = _rows; y != 0; y--) {
-    for (unsigned x = _cols; x != 0; x--) {
-      Type   *padMatrixPtr2 = padMatrixPtr1;
-      double  minimum = MAXDOUBLE;
-      const double *strelPtr = strelStart;
-      for (register unsigned j = strelHeight; j != 0; j--) {
-	for (register unsigned i = strelWidth; i != 0; i--) {
-	  if (*strelPtr >= 0)
-	    minimum = MIN(minimum, (double) *padMatrixPtr2 - *strelPtr);
-	  strelPtr++;
-	  padMatrixPtr2++;
-	}
-	padMatrixPtr2 += padMatrixPtr2incr;
-      }
-      *resultPtr = Type(minimum);
-      
-      resultPtr++;
-      padMatrixPtr1++;
-    }
-    padMatrixPtr1 += padMatrixPtr1incr;
-  }
-  
-  return result;
+  const double * const *strelEl = strel.getEl();
+  return erode(CompiledStrel(&strelEl, 1, strelHeight, strelWidth));
 }
 
 template <class Type>
 Mat<Type>
 Mat<Type>::dilate(const Mat<double>& strel) const
 {
-   unsigned strelHeight = strel.getrows();
-   unsigned strelWidth  = strel.getcols();
+  unsigned strelHeight = strel.getrows();
+  unsigned strelWidth  = strel.getcols();
+
+  if (((strelHeight == 1) && (strelWidth == 1)) || !strelHeight || !strelWidth)
+    return Mat<Type>(*this);
 
-   if (((strelHeight == 1) && (strelWidth == 1)) || !strelHeight || !strelWidth)
-      return Mat<Type>(*this);
+  const double * const *strelEl = strel.getEl();
+  return dilate(CompiledStrel(&strelEl, 1, strelHeight, strelWidth));
+}
 
-   unsigned r=0;
-   unsigned c=0;
+template <class Type>
+Mat<double>
+Mat<Type>::distanceTransform(double rowSpacing, double colSpacing,
+			     Mat<int> *nearest) const
+{
+  Mat<double> dist(_rows, _cols);
+  if (nearest)
+    nearest->resize(_rows, _cols);
 
-   if ((strelHeight % 2) == 0) {
-      strelHeight++;
-      r++;
-   }
-   
-   if ((strelWidth % 2) == 0) {
-      strelWidth++;
-      c++;
-   }
-   
-   Mat<double> newStrel(strelHeight, strelWidth, -1);
-   newStrel.insert(strel.rotate180(), r, c);
-   
-   Mat<Type> padMatrix(pad(strelHeight/2, strelWidth/2));
-   Mat<Type> result(_rows, _cols);
-   
-   Type   *padMatrixPtr1 = padMatrix._el[0];
-   const double *strelStart    = newStrel.getEl()[0];
-   Type   *resultPtr     = result._el[0];
-   
-   unsigned padMatrixPtr2incr = padMatrix._cols - strelWidth;
-   unsigned padMatrixPtr1incr = (strelWidth/2) * 2;
-   
-   for (unsigned y = _rows; y != 0; y--) {
-      for (unsigned x = _cols; x != 0; x--) {
-	 Type   *padMatrixPtr2 = padMatrixPtr1;
-	 double  maximum = -MAXDOUBLE;
-	 const double *strelPtr = strelStart;
-	 for (register unsigned j = strelHeight; j != 0; j--) {
-	    for (register unsigned i = strelWidth; i != 0; i--) {
-	       if (*strelPtr >= 0)
-		  maximum = MAX(maximum, (double) *padMatrixPtr2 + *strelPtr);
-	       strelPtr++;
-	       padMatrixPtr2++;
-	    }
-	    padMatrixPtr2 += padMatrixPtr2incr;
-	 }
-	 *resultPtr = Type(maximum);
-	 
-	 resultPtr++;
-	 padMatrixPtr1++;
-      }
-      padMatrixPtr1 += padMatrixPtr1incr;
-   }
-   
-   return result;
+  if (_rows && _cols) {
+    const double spacing[3] = { 1.0, rowSpacing, colSpacing };
+    double **distEl    = (double **) dist.getEl();
+    int    **nearestEl = nearest ? (int **) nearest->getEl() : 0;
+    ::distanceTransform(&distEl, &_el, 1, _rows, _cols, spacing,
+			nearest ? &nearestEl : (int ***) 0);
+  }
+
+  return dist;
 }
 
+template <class Type>
+Mat<double>
+Mat<Type>::boxFilter(unsigned height, unsigned width, BoxStatistic statistic) const
+{
+  Mat<double> result(_rows, _cols);
+
+  if (*this) {
+    IntegralImage table(&_el, 1, _rows, _cols, statistic == BOX_VARIANCE);
+    double **resultEl = (double **) result.getEl();
+    table.boxFilter(&resultEl, 1, height, width, statistic);
+  }
+
+  return result;
+}
 #endif // USE_DBLMAT
 
+template <class Type>
+unsigned
+Mat<Type>::label(Mat<int>& labels, unsigned connectivity,
+		 Array<Component> *components) const
+{
+  labels.resize(_rows, _cols);
+
+  int **labelsEl = (int **) labels.getEl();
+  return labelComponents(&labelsEl, &_el, 1, _rows, _cols, connectivity, components);
+}
+
+template <class Type>
+Mat<Type>
+Mat<Type>::rankFilter(unsigned height, unsigned width, double pct,
+		      BorderMode border) const
+{
+  Mat<Type> result(_rows, _cols);
+
+  Type **resultEl = result._el;
+  ::rankFilter(&resultEl, &_el, 1, _rows, _cols, 1, height, width, pct, border);
+
+  return result;
+}
+
 /******************************Old code***************************************
 template <class Type>
 Mat<Type> 
@@ -3150,10 +3309,9 @@ Mat<Type>::_checkMatrixDimensions(const char *path, unsigned& nrows,
 
 template <class Type>
 Mat<Type>&
-Mat<Type>::_fft(unsigned nrows, unsigned ncols, FFTFUNC fftFunc)
+Mat<Type>::_fft(unsigned nrows, unsigned ncols, Boolean inverse)
 {
   using std::max;		// (bert) force it to use the right max()
-  using std::abs;		// (bert) and force the right abs()!
 
   // Verify dimensions of FFT
   if ((nrows > 1) && ((nrows < _rows) || !isPowerOf2(nrows))) {
@@ -3186,80 +3344,83 @@ Mat<Type>::_fft(unsigned nrows, unsigned ncols, FFTFUNC fftFunc)
   // Pad matrix to the final FFT dimensions
   pad(nrows, ncols, (nrows - _rows)/2, (ncols - _cols)/2, 0);
 
-  // Allocate temporary arrays
-  double *real = 0;
-  double *imag = 0;
-  unsigned maxDim = max(doX ? _cols : 1, doY ? _rows : 1);
+  // Take 1D FFT in X (row) direction
+  if (doX) {
+    FFTPlan plan(_cols);
+    _fftBatch(plan, TRUE, inverse);
+  }
+
+  // Take 1D FFT in Y (column) direction
+  if (doY) {
+    FFTPlan plan(_rows);
+    _fftBatch(plan, FALSE, inverse);
+  }
 
-  allocateArray(maxDim, real);
-  allocateArray(maxDim, imag);
-  assert(real && imag);
+  return *this;
+}
 
-  unsigned row, col;
+template <class Type>
+void
+Mat<Type>::_fftBatch(const FFTPlan& plan, Boolean alongRows, Boolean inverse)
+{
+  typedef typename FFTReal<Type>::Real Real;
 
-  // Take 1D FFT in X (row) direction
-  if (doX)
-    for(row = 0; row < _rows; row++) {
-      // Fill temporary FFT array
-      double  *realPtr   = real;
-      double  *imagPtr   = imag;
-      Type *sourcePtr = _el[row];
-      for(col = _cols; col != 0; col--) {
-	dcomplex value(*sourcePtr++);
-	*realPtr++ = value.real();
-	*imagPtr++ = value.imag();
-      }
+  const unsigned n        = plan.length();
+  const unsigned nSignals = alongRows ? _rows : _cols;
 
-      // Calculate 1D FFT
-      fftFunc(_cols, real, imag);
+  Real *real = 0;
+  Real *imag = 0;
+  allocateArray(n*FFT_BATCH, real);
+  allocateArray(n*FFT_BATCH, imag);
+  assert(real && imag);
 
-      // Put results back
-      realPtr   = real;
-      imagPtr   = imag;
-      sourcePtr = _el[row];
-      for(col = _cols; col != 0; col--)
-	*sourcePtr++ = Type(abs(dcomplex(*realPtr++, *imagPtr++)));
-    }
+  for (unsigned first = 0; first < nSignals; first += FFT_BATCH) {
+    unsigned batch = MIN(FFT_BATCH, nSignals - first);
+    unsigned b, j;
 
-  // Take 1D FFT in Y (column) direction
-  if (doY)
-    for(col = 0; col < _cols; col++) {
-      // Fill temporary FFT array
-      double  *realPtr   = real;
-      double  *imagPtr   = imag;
-      Type    *sourcePtr = _el[0] + col;
-      for(row = _rows; row != 0; row--) {
-	dcomplex value(*sourcePtr);
-	*realPtr++ = value.real();
-	*imagPtr++ = value.imag();
-	sourcePtr += _cols;
+    // Interleave the signals of this batch
+    if (alongRows)
+      for (b = 0; b < batch; b++) {
+	const Type *sourcePtr = _el[first + b];
+	for (j = 0; j < n; j++)
+	  _fftLoad(sourcePtr[j], real[j*batch + b], imag[j*batch + b]);
+      }
+    else
+      for (j = 0; j < n; j++) {
+	const Type *sourcePtr = _el[j] + first;
+	for (b = 0; b < batch; b++)
+	  _fftLoad(sourcePtr[b], real[j*batch + b], imag[j*batch + b]);
       }
 
-      // Calculate 1D FFT
-      fftFunc(_rows, real, imag);
-
-      // Put results back
-      realPtr   = real;
-      imagPtr   = imag;
-      sourcePtr = _el[0] + col;
-      for(row = _rows; row != 0; row--) {
-	*sourcePtr = Type(abs(dcomplex(*realPtr++, *imagPtr++)));
-	sourcePtr += _cols;
+    if (inverse)
+      plan.ifft(batch, real, imag);
+    else
+      plan.fft(batch, real, imag);
+
+    // Put results back
+    if (alongRows)
+      for (b = 0; b < batch; b++) {
+	Type *sourcePtr = _el[first + b];
+	for (j = 0; j < n; j++)
+	  _fftStore(real[j*batch + b], imag[j*batch + b], sourcePtr[j]);
       }
-    }
+    else
+      for (j = 0; j < n; j++) {
+	Type *sourcePtr = _el[j] + first;
+	for (b = 0; b < batch; b++)
+	  _fftStore(real[j*batch + b], imag[j*batch + b], sourcePtr[b]);
+      }
+  }
 
-  // Free temporary arrays
   freeArray(real);
   freeArray(imag);
-
-  return *this;
 }
 
 template <class Type>
 Mat<Type>&
 Mat<Type>::ifft(unsigned nrows, unsigned ncols)
 {
-  _fft(nrows, ncols, ::ifft);
+  _fft(nrows, ncols, TRUE);
   unsigned factor = 1;
   if (nrows != 1) factor *= _rows;
   if (ncols != 1) factor *= _cols;
@@ -3267,6 +3428,70 @@ Mat<Type>::ifft(unsigned nrows, unsigned ncols)
   return *this /= factor;
 }
 
+template <class Type>
+Mat<Type>&
+Mat<Type>::fftRows(const FFTPlan& plan)
+{
+  if (_cols > plan.length()) {
+    cerr << "Mat<Type>::fftRows(): FFT plan (" << plan.length() 
+	 << ") shorter than rows (" << _cols << ")" << endl;
+    return *this;
+  }
+
+  pad(_rows, plan.length(), 0, (plan.length() - _cols)/2, 0);
+  _fftBatch(plan, TRUE, FALSE);
+
+  return *this;
+}
+
+template <class Type>
+Mat<Type>&
+Mat<Type>::ifftRows(const FFTPlan& plan)
+{
+  if (_cols > plan.length()) {
+    cerr << "Mat<Type>::ifftRows(): FFT plan (" << plan.length() 
+	 << ") shorter than rows (" << _cols << ")" << endl;
+    return *this;
+  }
+
+  pad(_rows, plan.length(), 0, (plan.length() - _cols)/2, 0);
+  _fftBatch(plan, TRUE, TRUE);
+
+  return *this /= plan.length();
+}
+
+template <class Type>
+Mat<Type>&
+Mat<Type>::fftCols(const FFTPlan& plan)
+{
+  if (_rows > plan.length()) {
+    cerr << "Mat<Type>::fftCols(): FFT plan (" << plan.length() 
+	 << ") shorter than columns (" << _rows << ")" << endl;
+    return *this;
+  }
+
+  pad(plan.length(), _cols, (plan.length() - _rows)/2, 0, 0);
+  _fftBatch(plan, FALSE, FALSE);
+
+  return *this;
+}
+
+template <class Type>
+Mat<Type>&
+Mat<Type>::ifftCols(const FFTPlan& plan)
+{
+  if (_rows > plan.length()) {
+    cerr << "Mat<Type>::ifftCols(): FFT plan (" << plan.length() 
+	 << ") shorter than columns (" << _rows << ")" << endl;
+    return *this;
+  }
+
+  pad(plan.length(), _cols, (plan.length() - _rows)/2, 0, 0);
+  _fftBatch(plan, FALSE, TRUE);
+
+  return *this /= plan.length();
+}
+
 #ifdef HAVE_MATLAB
 //This function converts a Matlab matrix object to a Mat object
 //The first argument is a pointer to a Matlab matrix object
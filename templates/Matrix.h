@@ -72,7 +72,19 @@ extern "C" {
 #include <iostream>		/* (bert) changed from iostream.h */
 #include "MTypes.h"
 #include "MatrixSupport.h"
+#include "Convolution.h"
+#include "Morphology.h"
+#include "DistanceTransform.h"
+#include "Labeling.h"
+#include "RankFilter.h"
+#include "Resample.h"
+#include "Pyramid.h"
+#include "IntegralImage.h"
+#include "GaussianFilter.h"
+#include "IIRFilter.h"
+#include "BitMask.h"
 #include "Histogram.h"
+#include "Percentile.h"
 
 #ifndef MIN
 #define MIN(x, y) ((x < y) ? (x) : (y))
@@ -595,6 +607,11 @@ public:
   // Returns the median of the matrix, only considering elements in the supplied range.
   // By default, the full range of the matrix will be used.
   Type median(Type minVal = 0, Type maxVal = 0) const;
+  // Returns the pct percentile(s), i.e. the element of rank floor(pct/100*(N - 1)),
+  // of the N elements in the supplied range; see Percentile.h
+  Type percentile(double pct, Type minVal = 0, Type maxVal = 0) const;
+  SimpleArray<Type> percentiles(const SimpleArray<double>& pct, Type minVal = 0,
+				Type maxVal = 0) const;
 
   //Returns the sum of all the elements of the ACTIVE matrix
   double  sum() const { return real(csum()); }
@@ -724,7 +741,22 @@ public:
    Mat rowhouse(const Mat& V) const;
 
    //convolve 2d Matrix //taken from red book and modified
-   Mat convolv2d(const Mat& filter) const;
+   //The method defaults to the cheapest one for the filter; samples outside
+   //the matrix are supplied according to the border mode
+   Mat convolv2d(const Mat& filter, ConvolutionMethod method = CONV_AUTO,
+		 BorderMode border = BORDER_ZERO) const;
+   //convolve with a separable filter given by its column and row factors
+   //(vectors), i.e. with the filter columnFilter * rowFilter
+   Mat convolv2d(const Mat& columnFilter, const Mat& rowFilter,
+		 BorderMode border = BORDER_ZERO) const;
+   //In-place version of convolv2d
+   Mat& convolv2dInPlace(const Mat& filter, ConvolutionMethod method = CONV_AUTO,
+			 BorderMode border = BORDER_ZERO);
+   //Gaussian filter with the given sigmas (in elements; 0: no smoothing),
+   //followed by a derivative of order 0, 1 or 2 along each dimension.
+   //Recursive filters make the cost independent of sigma; see GaussianFilter.h
+   Mat gaussianFilter(double rowSigma, double colSigma,
+		      unsigned rowOrder = 0, unsigned colOrder = 0) const;
 
   //Returns a histogram for the calling object using the specified range and # bins
   Histogram histogram(double minin = 0, double maxin = 0, unsigned n = 0) const;
@@ -770,6 +802,11 @@ public:
   Mat  map(const ValueMap& valueMap) const { return mapConst(valueMap); }
   Mat  mapConst(const ValueMap& valueMap) const { 
     Mat<Type> A(*this); return A.map(valueMap);}
+  // Maps the values through a chain of maps in a single pass (through a
+  // table for types of up to 16 bits); see CompiledMap
+  Mat& map(const CompiledMap& valueMap);
+  Mat  map(const CompiledMap& valueMap) const { 
+    Mat<Type> A(*this); return A.map(valueMap);}
 
   // Scales a Matrix (similar to map, but truncates the output range to be
   // [minout, maxout])
@@ -782,28 +819,97 @@ public:
 		  double minin = 0.0, double maxin = 0.0) const {
     Mat<Type> A(*this); return A.scale(minout, maxout, minin, maxin); }
 
+   // Resamples the matrix to nrows x ncols. Output samples are taken at
+   // input position (i + 0.5)*n/nOut - 0.5 along each dimension, i.e. the
+   // pixel centres are aligned. When reducing the size, the kernel is
+   // widened to avoid aliasing.
+   Mat resample(unsigned nrows, unsigned ncols, ResampleKernel kernel = RESAMPLE_LINEAR,
+		BorderMode border = BORDER_CLAMP) const;
+   // Resamples the matrix by arbitrary scale factors (output size rounded)
+   Mat resampleBy(double rowFactor, double colFactor,
+		  ResampleKernel kernel = RESAMPLE_LINEAR,
+		  BorderMode border = BORDER_CLAMP) const;
+
+   // Pyramid steps: reduce() blurs with the binomial kernel [1 4 6 4 1]/16
+   // and halves each dimension (to (n + 1)/2) in a single pass; expand()
+   // interpolates to nrows x ncols, at most twice the size.
+   Mat reduce(BorderMode border = BORDER_CLAMP) const;
+   Mat expand(unsigned nrows, unsigned ncols, BorderMode border = BORDER_CLAMP) const;
+   // Gaussian (or Laplacian) pyramid of nLevels levels, level 0 being the
+   // matrix itself. Mat(p.getrows(l), p.getcols(l), p.data(l)) copies level l.
+   Pyramid<Type> pyramid(unsigned nLevels, Boolean laplacian = FALSE,
+			 BorderMode border = BORDER_CLAMP) const;
+
    //Performs a linear interpolation on the calling object Matrix
    //The y (argument) Matrix recieves the results
    //Urow is the upscale factor for the rows and Drow is the downscale factor
    //for the rows.  Ucol and Dcol are analagous for the columns.
+   //(Output element (0, 0) is aligned with input element (0, 0); see also
+   //resample().)
    void linearinterpolate( unsigned Urow, unsigned Drow, unsigned Ucol, unsigned Dcol,Mat& y) const;
 
    //Applies the filter defined by B and A to the calling object and returns the
    //resultant Matrix.
    //The filter has the form y= (B/A)*x
    //Where x is the calling object and y is the result
-   Mat filter(Mat& B,Mat& A) const;
+   //B, A and the calling object are vectors; see IIRFilter
+   Mat filter(const Mat& B, const Mat& A) const;
+   //Zero-phase version of filter() (Matlab's filtfilt)
+   Mat filtfilt(const Mat& B, const Mat& A) const;
+   //Applies the filter to every row (or column) of the calling object, each
+   //being a separate signal, in a single pass; see IIRFilter.h
+   Mat filterRows(const Mat& B, const Mat& A, Boolean zeroPhase = FALSE) const;
+   Mat filterColumns(const Mat& B, const Mat& A, Boolean zeroPhase = FALSE) const;
 
 /***************************morphology functions*******************************/
    // In the following (greylevel) morphology operations, negative strel
-   // values are considered NaN's and ignored.
+   // values are considered NaN's and ignored. Flat strels (all other values
+   // 0) use running minima/maxima, at a cost independent of the strel size.
+   // A strel used repeatedly can be compiled once into a CompiledStrel.
+   Mat erode(const CompiledStrel& strel) const;
+   Mat dilate(const CompiledStrel& strel) const;
+   Mat open(const CompiledStrel& strel) const  { return erode(strel).dilate(strel); }
+   Mat close(const CompiledStrel& strel) const { return dilate(strel).erode(strel); }
 #ifdef USE_DBLMAT
    Mat erode(const Mat<double>& strel) const;
    Mat dilate(const Mat<double>& strel) const;
    Mat open(const Mat<double>& strel) const  { return erode(strel).dilate(strel); }
    Mat close(const Mat<double>& strel) const { return dilate(strel).erode(strel); }
+
+   // Exact squared Euclidean distance from every element to the nearest
+   // non-zero element, for the given element spacing (MAXDOUBLE if there is
+   // none). If nearest is given, it receives the index (row*ncols + col) of
+   // that element, or -1. Thresholding the result at r^2 gives a dilation
+   // (of the non-zero elements) by a disc of radius r, at any r.
+   Mat<double> distanceTransform(double rowSpacing = 1.0, double colSpacing = 1.0,
+				 Mat<int> *nearest = 0) const;
+
+   // Sum, mean or variance of the height x width window centered on every
+   // element (clipped to the matrix), in constant time per element through
+   // an IntegralImage; all zeros if height or width is 0. Not implemented
+   // for complex matrices.
+   Mat<double> boxFilter(unsigned height, unsigned width,
+			 BoxStatistic statistic = BOX_MEAN) const;
 #endif
 
+   // Labels the connected components of non-zero elements 1..n (in raster
+   // order) into labels, with 0 elsewhere, and returns n. Connectivity is 4
+   // or 8. If components is given, element i receives the size and bounding
+   // box of label i + 1.
+   unsigned label(Mat<int>& labels, unsigned connectivity = 8,
+		  Array<Component> *components = 0) const;
+
+/*****************************rank filters*************************************/
+   // Replaces every element by the pct percentile, i.e. the element of rank
+   // floor(pct/100*(N - 1)), of the N = height x width elements of the
+   // window centered on it. medianFilter() returns the low median, like
+   // median(). Not implemented for complex matrices.
+   Mat rankFilter(unsigned height, unsigned width, double pct,
+		  BorderMode border = BORDER_CLAMP) const;
+   Mat medianFilter(unsigned height, unsigned width,
+		    BorderMode border = BORDER_CLAMP) const {
+     return rankFilter(height, width, 50, border); }
+
   //   Not converted yet
   //   void radialscale(Mat& scale, Mat& y) const;
 
@@ -875,7 +981,7 @@ public:
 
   // Non-const fft function
   Mat& fft(unsigned nrows = 0, unsigned ncols = 0) {
-    return _fft(nrows, ncols, ::fft); }
+    return _fft(nrows, ncols, FALSE); }
   // Const fft function
   Mat  fft(unsigned nrows = 0, unsigned ncols = 0) const { 
     return fftConst(nrows, ncols); }
@@ -892,6 +998,14 @@ public:
   Mat  ifftConst(unsigned nrows = 0, unsigned ncols = 0) const { 
     Mat<Type> A(*this); return A.ifft(nrows, ncols); }
 
+  // Batched fft/ifft of every row (or column) in one call, using a shared
+  // plan. Rows (columns) shorter than the plan length are zero-padded as
+  // above; longer ones are not transformed.
+  Mat& fftRows(const FFTPlan& plan);
+  Mat& ifftRows(const FFTPlan& plan);
+  Mat& fftCols(const FFTPlan& plan);
+  Mat& ifftCols(const FFTPlan& plan);
+
 /****************************End of public functions***************************/
 
 private:
@@ -911,7 +1025,9 @@ private:
   // the size of the file.
   void _checkMatrixDimensions(const char *path, unsigned& nrows, unsigned& ncols) const;
 
-  Mat& _fft(unsigned nrows, unsigned ncols, FFTFUNC fftFunc);
+  Mat& _fft(unsigned nrows, unsigned ncols, Boolean inverse);
+  // Transforms every row (alongRows) or column, which must have the plan length
+  void _fftBatch(const FFTPlan& plan, Boolean alongRows, Boolean inverse);
 
 /***************************End Private functions*****************************/
    
@@ -1091,9 +1207,17 @@ Mat<T> rowhouse(const Mat<T>& A, const Mat<T>& V)
 }
 
 template <class T>
-Mat<T> convolv2d(const Mat<T>& A, const Mat<T>& filter) 
+Mat<T> convolv2d(const Mat<T>& A, const Mat<T>& filter,
+		 ConvolutionMethod method = CONV_AUTO, BorderMode border = BORDER_ZERO) 
+{
+  return A.convolv2d(filter, method, border);
+}
+
+template <class T>
+Mat<T> convolv2d(const Mat<T>& A, const Mat<T>& columnFilter, const Mat<T>& rowFilter,
+		 BorderMode border = BORDER_ZERO) 
 {
-  return A.convolv2d(filter);
+  return A.convolv2d(columnFilter, rowFilter, border);
 }
   
 template <class T>
@@ -1166,6 +1290,12 @@ median(const Mat<T>& A, T minVal, T maxVal)
   return A.median(minVal, maxVal);
 }
 
+template <class T> T 
+percentile(const Mat<T>& A, double pct, T minVal = 0, T maxVal = 0) 
+{ 
+  return A.percentile(pct, minVal, maxVal);
+}
+
 template <class T> 
 Mat<T> applyElementWise(const Mat<T>& A, double (*function)(double))
 { 
@@ -1238,7 +1368,7 @@ void linearinterpolate(const Mat<T>& x, unsigned Urow, unsigned Drow,
 }
   
 template <class T>
-Mat<T> filter(Mat<T>& B, Mat<T>& A, const Mat<T>& x) 
+Mat<T> filter(const Mat<T>& B, const Mat<T>& A, const Mat<T>& x) 
 { 
   return (x.filter(B, A));
 }
@@ -1465,4 +1595,26 @@ public:
 template<class Type>
 SimpleArray<Type> array(const Mat<Type>& A, Type minVal = 0, Type maxVal = 0);
 
+#ifdef USE_UCHRMAT
+//Converts between UChrMat (0/1) and bit-packed masks
+inline BitMask asBitMask(const Mat<unsigned char>& A)
+{
+  const unsigned char * const *el = A.getEl();
+  return BitMask(&el, 1, A.getrows(), A.getcols());
+}
+
+inline Mat<unsigned char> asUChrMat(const BitMask& mask)
+{
+  if (mask.getslis() > 1)
+    std::cerr << "Warning! asUChrMat(const BitMask&): only the first of "
+	      << mask.getslis() << " slices converted" << std::endl;
+
+  Mat<unsigned char> A(mask.getrows(), mask.getcols());
+  if (mask.getslis())
+    mask.getSlice(0, (unsigned char **) A.getEl());
+
+  return A;
+}
+#endif
+
 #endif
@@ -783,7 +783,40 @@ template <class Type>
 Type
 Mat3D<Type>::median(Type minVal, Type maxVal) const
 {
-  return asArray(minVal, maxVal).medianVolatile();
+  return percentile(50, minVal, maxVal);
+}
+
+template <class Type>
+Type
+Mat3D<Type>::percentile(double pct, Type minVal, Type maxVal) const
+{
+  SimpleArray<double> pctArray(1);
+  pctArray[0] = pct;
+
+  SimpleArray<Type> value(percentiles(pctArray, minVal, maxVal));
+  return value.size() ? value[0] : Type(0);
+}
+
+template <class Type>
+SimpleArray<Type>
+Mat3D<Type>::percentiles(const SimpleArray<double>& pct, Type minVal, Type maxVal) const
+{
+  SimpleArray<Type> values(pct.size());
+  values.clear(0);
+  if (!pct.size())
+    return values;
+
+  // All rows at once; see Percentile.h
+  const Type **rows = new const Type *[_slis*_rows];
+  for(unsigned s=0; s < _slis; s++)
+    for(unsigned r=0; r < _rows; r++)
+      rows[s*_rows + r] = _el[s][r];
+  if (!::percentiles(rows, _slis*_rows, _cols, pct.contents(), pct.size(),
+		     values.contents(), minVal, maxVal))
+    cerr << "Warning! Mat3D::percentiles() called without elements in range" << endl;
+  delete [] rows;
+
+  return values;
 }
 
 #ifdef USE_COMPMAT
@@ -793,6 +826,20 @@ Mat3D<complex>::median(complex, complex) const
   cerr << "Mat3D<complex>::median() called but not implemented" << endl;
   return 0;
 }
+
+complex
+Mat3D<complex>::percentile(double, complex, complex) const
+{
+  cerr << "Mat3D<complex>::percentile() called but not implemented" << endl;
+  return 0;
+}
+
+SimpleArray<complex>
+Mat3D<complex>::percentiles(const SimpleArray<double>&, complex, complex) const
+{
+  cerr << "Mat3D<complex>::percentiles() called but not implemented" << endl;
+  return SimpleArray<complex>(0);
+}
 #endif
 
 #ifdef USE_FCOMPMAT
@@ -802,6 +849,20 @@ Mat3D<fcomplex>::median(fcomplex, fcomplex) const
   cerr << "Mat3D<fcomplex>::median() called but not implemented" << endl;
   return 0;
 }
+
+fcomplex
+Mat3D<fcomplex>::percentile(double, fcomplex, fcomplex) const
+{
+  cerr << "Mat3D<fcomplex>::percentile() called but not implemented" << endl;
+  return 0;
+}
+
+SimpleArray<fcomplex>
+Mat3D<fcomplex>::percentiles(const SimpleArray<double>&, fcomplex, fcomplex) const
+{
+  cerr << "Mat3D<fcomplex>::percentiles() called but not implemented" << endl;
+  return SimpleArray<fcomplex>(0);
+}
 #endif
 
 //
@@ -984,6 +1045,42 @@ Mat3D<Type>::map(const ValueMap& valueMap)
   return(*this);
 }
 
+template < class Type>
+Mat3D<Type>&
+Mat3D<Type>::map(const CompiledMap& valueMap)
+{
+  const CompiledMapKernel<Type> kernel(valueMap, (unsigned long) _slis*_rows*_cols);
+  const int nRows = int(_slis*_rows);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i = 0; i < nRows; i++) {
+    Type *row = _el[unsigned(i)/_rows][unsigned(i)%_rows];
+    kernel(row, row, _cols);
+  }
+
+  return(*this);
+}
+
+#ifdef USE_COMPMAT
+Mat3D<complex>&
+Mat3D<complex>::map(const CompiledMap&)
+{
+  cerr << "Mat3D<complex>::map() called but not implemented" << endl;
+  return *this;
+}
+#endif
+
+#ifdef USE_FCOMPMAT
+Mat3D<fcomplex>&
+Mat3D<fcomplex>::map(const CompiledMap&)
+{
+  cerr << "Mat3D<fcomplex>::map() called but not implemented" << endl;
+  return *this;
+}
+#endif
+
 //
 //-------------------------// 
 //
@@ -1000,8 +1097,8 @@ Mat3D<Type>::scale(double minout, double maxout, double minin, double maxin)
     maxin = asDouble(max());
   }
 
-  for(unsigned s = 0; s < _slis; s++)
-    _slices[s].scale(minout, maxout, minin, maxin);
+  CompiledMap scaleMap;
+  map(scaleMap.addScale(minin, maxin, minout, maxout));
    
   return(*this);
 }
@@ -1358,7 +1455,7 @@ Mat3D<Type>::_checkMatrixDimensions(const char *path, unsigned& nslis,
 
 template <class Type>
 Mat3D<Type>&
-Mat3D<Type>::_fft(unsigned nslis, unsigned nrows, unsigned ncols, FFTFUNC fftFunc)
+Mat3D<Type>::_fft(unsigned nslis, unsigned nrows, unsigned ncols, Boolean inverse)
 {
   // Verify dimensions of FFT
   if ((nslis > 1) && ((nslis < _slis) || !isPowerOf2(nslis))) {
@@ -1404,397 +1501,82 @@ Mat3D<Type>::_fft(unsigned nslis, unsigned nrows, unsigned ncols, FFTFUNC fftFun
   // Pad matrix to the final FFT dimensions
   pad(nslis, nrows, ncols, (nslis - _slis)/2, (nrows - _rows)/2, (ncols - _cols)/2, 0);
 
-  // Allocate temporary arrays
-  double *real = 0;
-  double *imag = 0;
-  unsigned maxDim = ::max((doZ ? _slis : 1), (doY ? _rows : 1), (doX ? _cols : 1));
-
-  allocateArray(maxDim, real);
-  allocateArray(maxDim, imag);
-  assert(real && imag);
-
-  unsigned slice, row, col;
-
   // Take 1D FFT in X (row) direction
-  if (doX)
-    for (slice = 0; slice < _slis; slice++)
-      for(row = 0; row < _rows; row++) {
-	// Fill temporary FFT array
-	double  *realPtr   = real;
-	double  *imagPtr   = imag;
-	Type    *sourcePtr = _el[slice][row];
-	for(col = _cols; col; col--) {
-	  complex value(*sourcePtr++);
-	  *realPtr++ = ::real(value);
-	  *imagPtr++ = ::imag(value);
-	}
-	
-	// Calculate 1D FFT
-	fftFunc(_cols, real, imag);
-	
-	// Put results back
-	realPtr   = real;
-	imagPtr   = imag;
-	sourcePtr = _el[slice][row];
-	for(col = _cols; col; col--)
-	  *sourcePtr++ = Type(abs(complex(*realPtr++, *imagPtr++)));
-      }
-
-  // Take 1D FFT in Y (column) direction
-  if (doY)
-    for (slice = 0; slice < _slis; slice++)
-      for(col = 0; col < _cols; col++) {
-	// Fill temporary FFT array
-	double  *realPtr   = real;
-	double  *imagPtr   = imag;
-	Type    *sourcePtr = *_el[slice] + col;
-	for(row = _rows; row; row--) {
-	  complex value(*sourcePtr);
-	  *realPtr++ = ::real(value);
-	  *imagPtr++ = ::imag(value);
-	  sourcePtr += _cols;
-	}
-	
-	// Calculate 1D FFT
-	fftFunc(_rows, real, imag);
-	
-	// Put results back
-	realPtr   = real;
-	imagPtr   = imag;
-	sourcePtr = *_el[slice] + col;
-	for(row = _rows; row; row--) {
-	  *sourcePtr = Type(abs(complex(*realPtr++, *imagPtr++)));
-	  sourcePtr += _cols;
-	}
-      }
-
-  // Take 1D FFT in Z (slice) direction
-  if (doZ) {
-    unsigned offset = 0;
-    for (row = 0; row < _rows; row++)
-      for (col = 0; col < _cols; col++, offset++) {
-	// Fill temporary FFT array
-	double    *realPtr   = real;
-	double    *imagPtr   = imag;
-	Type    ***sourcePtr = _el;
-	for(slice = _slis; slice; slice--) {
-	  complex value(*(**sourcePtr++ + offset));
-	  *realPtr++ = ::real(value);
-	  *imagPtr++ = ::imag(value);
-	}
-	
-	// Calculate 1D FFT
-	fftFunc(_slis, real, imag);
-	
-	// Put results back
-	realPtr   = real;
-	imagPtr   = imag;
-	sourcePtr = _el;
-	for(slice = _slis; slice; slice--)
-	  *(**sourcePtr++ + offset) = Type(abs(complex(*realPtr++, *imagPtr++)));
-      }
+  if (doX) {
+    FFTPlan plan(_cols);
+    _fftBatch(plan, 2, inverse);
   }
-  
-  // Free temporary arrays
-  freeArray(real);
-  freeArray(imag);
-
-  return *this;
-}
-
-#ifdef USE_COMPMAT
-Mat3D<complex>&
-Mat3D<complex>::_fft(unsigned nslis, unsigned nrows, unsigned ncols, FFTFUNC fftFunc)
-{
-  // Verify dimensions of FFT
-  if ((nslis > 1) && ((nslis < _slis) || !isPowerOf2(nslis))) {
-    cerr << "Warning! Mat3D<complex>::fft():" << endl
-	 << "  Requested # slices for FFT (" << nslis << ") invalid;" << endl;
-    nslis = ::max(unsigned(4), nextPowerOf2(::max(nslis, _slis)));
-    cerr << "  increased to " << nslis << endl;
-  }
-
-  if ((nrows > 1) && ((nrows < _rows) || !isPowerOf2(nrows))) {
-    cerr << "Warning! Mat3D<complex>::fft():" << endl
-	 << "  Requested # rows for FFT (" << nrows << ") invalid;" << endl;
-    nrows = ::max(unsigned(4), nextPowerOf2(::max(nrows, _rows)));
-    cerr << "  increased to " << nrows << endl;
-  }
-
-  if ((ncols > 1) && ((ncols < _cols) || !isPowerOf2(ncols))) {
-    cerr << "Warning! Mat3D<complex>::fft():" << endl
-	 << "  Requested # cols for FFT (" << ncols << ") invalid;" << endl;
-    ncols = ::max(unsigned(4), nextPowerOf2(::max(ncols, _cols)));
-    cerr << "  increased to " << ncols << endl;
-  }
-
-  Boolean doX = (ncols != 1) && (_cols != 1) ? TRUE : FALSE;
-  Boolean doY = (nrows != 1) && (_rows != 1) ? TRUE : FALSE;
-  Boolean doZ = (nslis != 1) && (_slis != 1) ? TRUE : FALSE;
-
-  if (!nslis)
-    nslis = ::max(unsigned(4), nextPowerOf2(_slis));
-  else if (nslis == 1)
-    nslis = _slis;
-
-  if (!nrows)
-    nrows = ::max(unsigned(4), nextPowerOf2(_rows));
-  else if (nrows == 1)
-    nrows = _rows;
-
-  if (!ncols)
-    ncols = ::max(unsigned(4), nextPowerOf2(_cols));
-  else if (ncols == 1)
-    ncols = _cols;
-
-  // Pad matrix to the final FFT dimensions
-  pad(nslis, nrows, ncols, (nslis - _slis)/2, (nrows - _rows)/2, (ncols - _cols)/2, 0);
-
-  // Allocate temporary arrays
-  double *real = 0;
-  double *imag = 0;
-  unsigned maxDim = ::max((doZ ? _slis : 1), (doY ? _rows : 1), (doX ? _cols : 1));
-
-  allocateArray(maxDim, real);
-  allocateArray(maxDim, imag);
-  assert(real && imag);
-
-  unsigned slice, row, col;
-
-  // Take 1D FFT in X (row) direction
-  if (doX)
-    for (slice = 0; slice < _slis; slice++)
-      for(row = 0; row < _rows; row++) {
-	// Fill temporary FFT array
-	double  *realPtr   = real;
-	double  *imagPtr   = imag;
-	complex *sourcePtr = _el[slice][row];
-	for(col = _cols; col; col--) {
-	  complex value(*sourcePtr++);
-	  *realPtr++ = ::real(value);
-	  *imagPtr++ = ::imag(value);
-	}
-	
-	// Calculate 1D FFT
-	fftFunc(_cols, real, imag);
-	
-	// Put results back
-	realPtr   = real;
-	imagPtr   = imag;
-	sourcePtr = _el[slice][row];
-	for(col = _cols; col; col--)
-	  *sourcePtr++ = complex(*realPtr++, *imagPtr++);
-      }
 
   // Take 1D FFT in Y (column) direction
-  if (doY)
-    for (slice = 0; slice < _slis; slice++)
-      for(col = 0; col < _cols; col++) {
-	// Fill temporary FFT array
-	double  *realPtr   = real;
-	double  *imagPtr   = imag;
-	complex *sourcePtr = *_el[slice] + col;
-	for(row = _rows; row; row--) {
-	  complex value(*sourcePtr);
-	  *realPtr++ = ::real(value);
-	  *imagPtr++ = ::imag(value);
-	  sourcePtr += _cols;
-	}
-	
-	// Calculate 1D FFT
-	fftFunc(_rows, real, imag);
-	
-	// Put results back
-	realPtr   = real;
-	imagPtr   = imag;
-	sourcePtr = *_el[slice] + col;
-	for(row = _rows; row; row--) {
-	  *sourcePtr = complex(*realPtr++, *imagPtr++);
-	  sourcePtr += _cols;
-	}
-      }
+  if (doY) {
+    FFTPlan plan(_rows);
+    _fftBatch(plan, 1, inverse);
+  }
 
   // Take 1D FFT in Z (slice) direction
   if (doZ) {
-    unsigned offset = 0;
-    for (row = 0; row < _rows; row++)
-      for (col = 0; col < _cols; col++, offset++) {
-	// Fill temporary FFT array
-	double    *realPtr   = real;
-	double    *imagPtr   = imag;
-	complex ***sourcePtr = _el;
-	for(slice = _slis; slice; slice--) {
-	  complex value(*(**sourcePtr++ + offset));
-	  *realPtr++ = ::real(value);
-	  *imagPtr++ = ::imag(value);
-	}
-	
-	// Calculate 1D FFT
-	fftFunc(_slis, real, imag);
-	
-	// Put results back
-	realPtr   = real;
-	imagPtr   = imag;
-	sourcePtr = _el;
-	for(slice = _slis; slice; slice--)
-	  *(**sourcePtr++ + offset) = complex(*realPtr++, *imagPtr++);
-      }
+    FFTPlan plan(_slis);
+    _fftBatch(plan, 0, inverse);
   }
-  
-  // Free temporary arrays
-  freeArray(real);
-  freeArray(imag);
 
   return *this;
 }
-#endif
-
-#ifdef USE_FCOMPMAT
-Mat3D<fcomplex>&
-Mat3D<fcomplex>::_fft(unsigned nslis, unsigned nrows, unsigned ncols, FFTFUNC fftFunc)
-{
-  // Verify dimensions of FFT
-  if ((nslis > 1) && ((nslis < _slis) || !isPowerOf2(nslis))) {
-    cerr << "Warning! Mat3D<fcomplex>::fft():" << endl
-	 << "  Requested # slices for FFT (" << nslis << ") invalid;" << endl;
-    nslis = ::max(unsigned(4), nextPowerOf2(::max(nslis, _slis)));
-    cerr << "  increased to " << nslis << endl;
-  }
 
-  if ((nrows > 1) && ((nrows < _rows) || !isPowerOf2(nrows))) {
-    cerr << "Warning! Mat3D<fcomplex>::fft():" << endl
-	 << "  Requested # rows for FFT (" << nrows << ") invalid;" << endl;
-    nrows = ::max(unsigned(4), nextPowerOf2(::max(nrows, _rows)));
-    cerr << "  increased to " << nrows << endl;
-  }
-
-  if ((ncols > 1) && ((ncols < _cols) || !isPowerOf2(ncols))) {
-    cerr << "Warning! Mat3D<fcomplex>::fft():" << endl
-	 << "  Requested # cols for FFT (" << ncols << ") invalid;" << endl;
-    ncols = ::max(unsigned(4), nextPowerOf2(::max(ncols, _cols)));
-    cerr << "  increased to " << ncols << endl;
-  }
-
-  Boolean doX = (ncols != 1) && (_cols != 1) ? TRUE : FALSE;
-  Boolean doY = (nrows != 1) && (_rows != 1) ? TRUE : FALSE;
-  Boolean doZ = (nslis != 1) && (_slis != 1) ? TRUE : FALSE;
-
-  if (!nslis)
-    nslis = ::max(unsigned(4), nextPowerOf2(_slis));
-  else if (nslis == 1)
-    nslis = _slis;
-
-  if (!nrows)
-    nrows = ::max(unsigned(4), nextPowerOf2(_rows));
-  else if (nrows == 1)
-    nrows = _rows;
-
-  if (!ncols)
-    ncols = ::max(unsigned(4), nextPowerOf2(_cols));
-  else if (ncols == 1)
-    ncols = _cols;
-
-  // Pad matrix to the final FFT dimensions
-  pad(nslis, nrows, ncols, (nslis - _slis)/2, (nrows - _rows)/2, (ncols - _cols)/2, 0);
-
-  // Allocate temporary arrays
-  double *real = 0;
-  double *imag = 0;
-  unsigned maxDim = ::max((doZ ? _slis : 1), (doY ? _rows : 1), (doX ? _cols : 1));
-
-  allocateArray(maxDim, real);
-  allocateArray(maxDim, imag);
-  assert(real && imag);
-
-  unsigned slice, row, col;
-
-  // Take 1D FFT in X (row) direction
-  if (doX)
-    for (slice = 0; slice < _slis; slice++)
-      for(row = 0; row < _rows; row++) {
-	// Fill temporary FFT array
-	double  *realPtr   = real;
-	double  *imagPtr   = imag;
-	fcomplex *sourcePtr = _el[slice][row];
-	for(col = _cols; col; col--) {
-	  fcomplex value(*sourcePtr++);
-	  *realPtr++ = ::real(value);
-	  *imagPtr++ = ::imag(value);
+template <class Type>
+void
+Mat3D<Type>::_fftBatch(const FFTPlan& plan, unsigned axis, Boolean inverse)
+{
+  typedef typename FFTReal<Type>::Real Real;
+
+  // Signals along slices are numbered by (row, col), along rows and
+  // columns by (slice, col) and (slice, row), so consecutive signals
+  // of a batch are adjacent in memory
+  const unsigned n        = plan.length();
+  const unsigned inner    = (axis == 2) ? _rows : _cols;
+  const unsigned nSignals = ((axis == 0) ? _rows : _slis)*inner;
+
+  Real  *real = 0;
+  Real  *imag = 0;
+  Type **elementPtr = 0;
+  allocateArray(n*FFT_BATCH, real);
+  allocateArray(n*FFT_BATCH, imag);
+  allocateArray(n*FFT_BATCH, elementPtr);
+  assert(real && imag && elementPtr);
+
+  for (unsigned first = 0; first < nSignals; first += FFT_BATCH) {
+    unsigned batch = ::min(FFT_BATCH, nSignals - first);
+    unsigned b, j;
+
+    // Interleave the signals of this batch
+    for (b = 0; b < batch; b++) {
+      unsigned outer = (first + b)/inner;
+      unsigned index = (first + b)%inner;
+      for (j = 0; j < n; j++) {
+	Type *sourcePtr;
+	switch (axis) {
+	case 0:  sourcePtr = &_el[j][outer][index]; break;
+	case 1:  sourcePtr = &_el[outer][j][index]; break;
+	default: sourcePtr = &_el[outer][index][j]; break;
 	}
-	
-	// Calculate 1D FFT
-	fftFunc(_cols, real, imag);
-	
-	// Put results back
-	realPtr   = real;
-	imagPtr   = imag;
-	sourcePtr = _el[slice][row];
-	for(col = _cols; col; col--)
-	  *sourcePtr++ = fcomplex(*realPtr++, *imagPtr++);
+	elementPtr[j*batch + b] = sourcePtr;
+	_fftLoad(*sourcePtr, real[j*batch + b], imag[j*batch + b]);
       }
+    }
 
-  // Take 1D FFT in Y (column) direction
-  if (doY)
-    for (slice = 0; slice < _slis; slice++)
-      for(col = 0; col < _cols; col++) {
-	// Fill temporary FFT array
-	double  *realPtr   = real;
-	double  *imagPtr   = imag;
-	fcomplex *sourcePtr = *_el[slice] + col;
-	for(row = _rows; row; row--) {
-	  fcomplex value(*sourcePtr);
-	  *realPtr++ = ::real(value);
-	  *imagPtr++ = ::imag(value);
-	  sourcePtr += _cols;
-	}
-	
-	// Calculate 1D FFT
-	fftFunc(_rows, real, imag);
-	
-	// Put results back
-	realPtr   = real;
-	imagPtr   = imag;
-	sourcePtr = *_el[slice] + col;
-	for(row = _rows; row; row--) {
-	  *sourcePtr = fcomplex(*realPtr++, *imagPtr++);
-	  sourcePtr += _cols;
-	}
-      }
+    if (inverse)
+      plan.ifft(batch, real, imag);
+    else
+      plan.fft(batch, real, imag);
 
-  // Take 1D FFT in Z (slice) direction
-  if (doZ) {
-    unsigned offset = 0;
-    for (row = 0; row < _rows; row++)
-      for (col = 0; col < _cols; col++, offset++) {
-	// Fill temporary FFT array
-	double    *realPtr   = real;
-	double    *imagPtr   = imag;
-	fcomplex ***sourcePtr = _el;
-	for(slice = _slis; slice; slice--) {
-	  fcomplex value(*(**sourcePtr++ + offset));
-	  *realPtr++ = ::real(value);
-	  *imagPtr++ = ::imag(value);
-	}
-	
-	// Calculate 1D FFT
-	fftFunc(_slis, real, imag);
-	
-	// Put results back
-	realPtr   = real;
-	imagPtr   = imag;
-	sourcePtr = _el;
-	for(slice = _slis; slice; slice--)
-	  *(**sourcePtr++ + offset) = fcomplex(*realPtr++, *imagPtr++);
-      }
+    // Put results back
+    for (j = 0; j < n*batch; j++)
+      _fftStore(real[j], imag[j], *elementPtr[j]);
   }
-  
-  // Free temporary arrays
+
   freeArray(real);
   freeArray(imag);
-
-  return *this;
+  freeArray(elementPtr);
 }
-#endif
 
 template <class Type>
 ostream&
@@ -1854,62 +1636,18 @@ Mat3D<Type>::pad(unsigned nslis, unsigned nrows, unsigned ncols,
 /***************************morphology functions*******************************/
 //note works for odd and even se assumung the even se
 //is centered at the right lowest pix_el of the four center pix_els.
-#ifdef USE_DBLMAT
 template <class Type>
 Mat3D<Type>
-Mat3D<Type>::erode(const Mat3D<double>& strel) const
+Mat3D<Type>::erode(const CompiledStrel& strel) const
 {
-  unsigned strelSlices  = strel.getslis();
-  unsigned strelHeight = strel.getrows();
-  unsigned strelWidth  = strel.getcols();
-
-  if (((strelHeight == 1) && (strelWidth == 1) && (strelSlices == 1)) || !strelHeight || !strelWidth || !strelSlices)
-    return Mat3D<Type>(*this);
-
-  Mat3D<Type> padMatrix(pad(strelSlices/2, strelHeight/2, strelWidth/2));
   Mat3D<Type> result(_slis, _rows, _cols);
-  
-  unsigned padMatrixPtr2incr = padMatrix._cols - strelWidth;
-  unsigned padMatrixPtr1incr = (strelWidth/2) * 2;
-  unsigned n;
-  
-  for (unsigned s = 0; s < _slis ; s++){
-     int padk=0;
-     Type *resultPtr = result._el[s][0];
-
-     for (unsigned y = _rows; y != 0; y--) {
-        for (unsigned x = _cols; x != 0; x--) {
-           n=s;
-           double  minimum = MAXDOUBLE;
-        
-           for (register unsigned k = 0; k < strelSlices; k++) {
-              Type *padMatrixPtr2 = padMatrix._el[n++][0] + padk;
-              const double *strelPtr = strel.getEl()[k][0];
-              for (register unsigned j = strelHeight; j != 0; j--) {
-	         for (register unsigned i = strelWidth; i != 0; i--) {
-                    if (*strelPtr >= 0)
-                    minimum = MIN(minimum, (double) *padMatrixPtr2 - *strelPtr);
-                    strelPtr++;
-	            padMatrixPtr2++;
-	         }
-	         padMatrixPtr2 += padMatrixPtr2incr;
-              }
-           }
-           *resultPtr = Type(minimum);
-           resultPtr++;
-           padk++;
-        }
-          padk += padMatrixPtr1incr;
-     }   
-
-  }  //for (unsigned s ...
-  
+  morphology(result._el, _el, _slis, _rows, _cols, strel, FALSE);
   return result;
 }
 
 #ifdef USE_COMPMAT
 Mat3D<complex>
-Mat3D<complex>::erode(const Mat3D<double>&) const
+Mat3D<complex>::erode(const CompiledStrel&) const
 {
   cerr << "Mat3D<complex>::erode() called but not implemented" << endl;
   return Mat3D<complex>(*this);
@@ -1918,114 +1656,279 @@ Mat3D<complex>::erode(const Mat3D<double>&) const
 
 #ifdef USE_FCOMPMAT
 Mat3D<fcomplex>
-Mat3D<fcomplex>::erode(const Mat3D<double>&) const
+Mat3D<fcomplex>::erode(const CompiledStrel&) const
 {
   cerr << "Mat3D<fcomplex>::erode() called but not implemented" << endl;
   return Mat3D<fcomplex>(*this);
 }
 #endif
 
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::dilate(const CompiledStrel& strel) const
+{
+  Mat3D<Type> result(_slis, _rows, _cols);
+  morphology(result._el, _el, _slis, _rows, _cols, strel, TRUE);
+  return result;
+}
+
+#ifdef USE_COMPMAT
+Mat3D<complex>
+Mat3D<complex>::dilate(const CompiledStrel&) const
+{
+  cerr << "Mat3D<complex>::dilate() called but not implemented" << endl;
+  return Mat3D<complex>(*this);
+}
+#endif
+
+#ifdef USE_FCOMPMAT
+Mat3D<fcomplex>
+Mat3D<fcomplex>::dilate(const CompiledStrel&) const
+{
+  cerr << "Mat3D<fcomplex>::dilate() called but not implemented" << endl;
+  return Mat3D<fcomplex>(*this);
+}
+#endif
+
+#ifdef USE_DBLMAT
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::erode(const Mat3D<double>& strel) const
+{
+  unsigned strelSlices = strel.getslis();
+  unsigned strelHeight = strel.getrows();
+  unsigned strelWidth  = strel.getcols();
+
+  if (((strelHeight == 1) && (strelWidth == 1) && (strelSlices == 1)) || !strelHeight || !strelWidth || !strelSlices)
+    return Mat3D<Type>(*this);
+
+  return erode(CompiledStrel(strel.getEl(), strelSlices, strelHeight, strelWidth));
+}
+
 template <class Type>
 Mat3D<Type>
 Mat3D<Type>::dilate(const Mat3D<double>& strel) const
 {
-  unsigned strelSlices  = strel.getslis();
+  unsigned strelSlices = strel.getslis();
   unsigned strelHeight = strel.getrows();
   unsigned strelWidth  = strel.getcols();
-  unsigned sl=0;
-  unsigned r=0;
-  unsigned c=0;
 
   if (((strelHeight == 1) && (strelWidth == 1) && (strelSlices == 1)) || !strelHeight || !strelWidth || !strelSlices)
     return Mat3D<Type>(*this);
 
-   if ((strelSlices % 2) == 0) {
-      strelSlices++;
-      sl++;
-   }
+  return dilate(CompiledStrel(strel.getEl(), strelSlices, strelHeight, strelWidth));
+}
 
-   if ((strelHeight % 2) == 0) {
-      strelHeight++;
-      r++;
-   }
-   
-   if ((strelWidth % 2) == 0) {
-      strelWidth++;
-      c++;
-   }
+template <class Type>
+Mat3D<double>
+Mat3D<Type>::distanceTransform(double sliceSpacing, double rowSpacing, double colSpacing,
+			       Mat3D<int> *nearest) const
+{
+  Mat3D<double> dist(_slis, _rows, _cols);
+  if (nearest)
+    *nearest = Mat3D<int>(_slis, _rows, _cols);
 
-//   strel.display(cout);
-//   cout << endl;
-   
-   Mat3D<double> newstrel(strelSlices, strelHeight, strelWidth, -1);
+  if (*this) {
+    const double spacing[3] = { sliceSpacing, rowSpacing, colSpacing };
+    ::distanceTransform((double ***) dist.getEl(), _el, _slis, _rows, _cols, spacing,
+			nearest ? (int ***) nearest->getEl() : (int ***) 0);
+  }
 
-//   newstrel.display(cout);
-//   cout << endl;
-   
-   newstrel.insert(strel.rotate180(), sl, r, c);
-   
-//   newstrel.display(cout);
-//   cout << endl;
+  return dist;
+}
 
-  Mat3D<Type> padMatrix(pad(strelSlices/2, strelHeight/2, strelWidth/2));
-  Mat3D<Type> result(_slis, _rows, _cols);
+template <class Type>
+Mat3D<double>
+Mat3D<Type>::boxFilter(unsigned depth, unsigned height, unsigned width,
+		       BoxStatistic statistic) const
+{
+  Mat3D<double> result(_slis, _rows, _cols);
+
+  if (*this) {
+    IntegralImage table(_el, _slis, _rows, _cols, statistic == BOX_VARIANCE);
+    table.boxFilter((double ***) result.getEl(), depth, height, width, statistic);
+  }
+
+  return result;
+}
+
+#ifdef USE_COMPMAT
+Mat3D<double>
+Mat3D<complex>::boxFilter(unsigned, unsigned, unsigned, BoxStatistic) const
+{
+  cerr << "Mat3D<complex>::boxFilter() called but not implemented" << endl;
+  return Mat3D<double>(_slis, _rows, _cols, 0.0);
+}
+#endif
+
+#ifdef USE_FCOMPMAT
+Mat3D<double>
+Mat3D<fcomplex>::boxFilter(unsigned, unsigned, unsigned, BoxStatistic) const
+{
+  cerr << "Mat3D<fcomplex>::boxFilter() called but not implemented" << endl;
+  return Mat3D<double>(_slis, _rows, _cols, 0.0);
+}
+#endif
+
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::warp(const Mat<double>& affine, unsigned nslis, unsigned nrows,
+		  unsigned ncols, ResampleKernel kernel, BorderMode border) const
+{
+  if (((affine.getrows() != 3) && (affine.getrows() != 4)) || (affine.getcols() != 4)) {
+    cerr << "Mat3D<Type>::warp(): affine transformation must be 3x4 or 4x4" << endl;
+    return Mat3D<Type>(*this);
+  }
+
+  if (!nslis) nslis = _slis;
+  if (!nrows) nrows = _rows;
+  if (!ncols) ncols = _cols;
+  Mat3D<Type> result(nslis, nrows, ncols);
+
+  double A[12];
+  for (unsigned i = 0; i < 12; i++)
+    A[i] = affine(i/4, i%4);
+
+  ::warpAffine(result._el, nslis, nrows, ncols, _el, _slis, _rows, _cols, A, kernel, border);
+
+  return result;
+}
+
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::warp(const Mat3D<double>& dSlice, const Mat3D<double>& dRow,
+		  const Mat3D<double>& dCol, ResampleKernel kernel, BorderMode border) const
+{
+  const unsigned nslis = dSlice.getslis();
+  const unsigned nrows = dSlice.getrows();
+  const unsigned ncols = dSlice.getcols();
+  if ((dRow.getslis() != nslis) || (dRow.getrows() != nrows) || (dRow.getcols() != ncols) ||
+      (dCol.getslis() != nslis) || (dCol.getrows() != nrows) || (dCol.getcols() != ncols)) {
+    cerr << "Mat3D<Type>::warp(): displacement field components differ in size" << endl;
+    return Mat3D<Type>(*this);
+  }
+
+  Mat3D<Type> result(nslis, nrows, ncols);
+  ::warpField(result._el, nslis, nrows, ncols, _el, _slis, _rows, _cols,
+	      dSlice.getEl(), dRow.getEl(), dCol.getEl(), kernel, border);
 
-  unsigned padMatrixPtr2incr = padMatrix._cols - strelWidth;
-  unsigned padMatrixPtr1incr = (strelWidth/2) * 2;
-  unsigned n;
-  
-  for (unsigned s = 0; s < _slis ; s++){
-     int padk=0;
-     Type *resultPtr = result._el[s][0];
-     
-     for (unsigned y = _rows; y != 0; y--) {
-        for (unsigned x = _cols; x != 0; x--) {
-           n=s;
-           double  maximum = -MAXDOUBLE;
-	   
-           for (register unsigned k = 0; k < strelSlices; k++) {
-              Type *padMatrixPtr2 = padMatrix._el[n++][0] + padk;
-              const double *strelPtr = newstrel.getEl()[k][0];
-              for (register unsigned j = strelHeight; j != 0; j--) {
-	         for (register unsigned i = strelWidth; i != 0; i--) {
-		    if (*strelPtr >= 0)
-		       maximum = MAX(maximum, (double) *padMatrixPtr2 + *strelPtr);
-		    strelPtr++;
-	            padMatrixPtr2++;
-	         }
-	         padMatrixPtr2 += padMatrixPtr2incr;
-              }
-           }
-           *resultPtr = Type(maximum);
-           resultPtr++;
-           padk++;
-        }
-          padk += padMatrixPtr1incr;
-     }   
-
-  }  //for (unsigned s ...
-  
   return result;
 }
+#endif
+
+template <class Type>
+unsigned
+Mat3D<Type>::label(Mat3D<int>& labels, unsigned connectivity,
+		   Array<Component> *components) const
+{
+  if ((labels.getslis() != _slis) || (labels.getrows() != _rows) ||
+      (labels.getcols() != _cols))
+    labels = Mat3D<int>(_slis, _rows, _cols);
+
+  return labelComponents((int ***) labels.getEl(), _el, _slis, _rows, _cols,
+			 connectivity, components);
+}
+
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::rankFilter(unsigned depth, unsigned height, unsigned width, double pct,
+			BorderMode border) const
+{
+  Mat3D<Type> result(_slis, _rows, _cols);
+  ::rankFilter(result._el, _el, _slis, _rows, _cols, depth, height, width, pct, border);
+  return result;
+}
+
 #ifdef USE_COMPMAT
 Mat3D<complex>
-Mat3D<complex>::dilate(const Mat3D<double>&) const
+Mat3D<complex>::rankFilter(unsigned, unsigned, unsigned, double, BorderMode) const
 {
-  cerr << "Mat3D<complex>::dilate() called but not implemented" << endl;
+  cerr << "Mat3D<complex>::rankFilter() called but not implemented" << endl;
   return Mat3D<complex>(*this);
 }
 #endif
 
 #ifdef USE_FCOMPMAT
 Mat3D<fcomplex>
-Mat3D<fcomplex>::dilate(const Mat3D<double>&) const
+Mat3D<fcomplex>::rankFilter(unsigned, unsigned, unsigned, double, BorderMode) const
 {
-  cerr << "Mat3D<fcomplex>::dilate() called but not implemented" << endl;
+  cerr << "Mat3D<fcomplex>::rankFilter() called but not implemented" << endl;
   return Mat3D<fcomplex>(*this);
 }
 #endif
 
-#endif
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::resample(unsigned nslis, unsigned nrows, unsigned ncols,
+		      ResampleKernel kernel, BorderMode border) const
+{
+  Mat3D<Type> result(nslis, nrows, ncols);
+
+  if (*this && nslis && nrows && ncols) {
+    const double sliceStep = double(_slis)/nslis;
+    const double rowStep   = double(_rows)/nrows;
+    const double colStep   = double(_cols)/ncols;
+    ResampleTable sliceTable(_slis, nslis, sliceStep, 0.5*sliceStep - 0.5, kernel, border);
+    ResampleTable rowTable(_rows, nrows, rowStep, 0.5*rowStep - 0.5, kernel, border);
+    ResampleTable colTable(_cols, ncols, colStep, 0.5*colStep - 0.5, kernel, border);
+
+    ::resample(result._el, _el, _slis, _rows, _cols, &sliceTable, &rowTable, &colTable);
+  }
+
+  return result;
+}
+
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::resampleBy(double sliceFactor, double rowFactor, double colFactor,
+			ResampleKernel kernel, BorderMode border) const
+{
+  if ((sliceFactor <= 0) || (rowFactor <= 0) || (colFactor <= 0)) {
+    cerr << "Mat3D<Type>::resampleBy(): scale factors must be positive" << endl;
+    return Mat3D<Type>(*this);
+  }
+
+  return resample(unsigned(floor(_slis*sliceFactor + 0.5)),
+		  unsigned(floor(_rows*rowFactor + 0.5)),
+		  unsigned(floor(_cols*colFactor + 0.5)), kernel, border);
+}
+
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::reduce(BorderMode border) const
+{
+  Mat3D<Type> result(pyramidReduceSize(_slis), pyramidReduceSize(_rows),
+		     pyramidReduceSize(_cols));
+  pyramidReduce(result._el, _el, _slis, _rows, _cols, border);
+  return result;
+}
+
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::expand(unsigned nslis, unsigned nrows, unsigned ncols,
+		    BorderMode border) const
+{
+  if ((nslis > 2*_slis) || (nrows > 2*_rows) || (ncols > 2*_cols) ||
+      (nslis < _slis) || (nrows < _rows) || (ncols < _cols) ||
+      ((nslis != _slis) && (nslis < 2*_slis - 1)) ||
+      ((nrows != _rows) && (nrows < 2*_rows - 1)) ||
+      ((ncols != _cols) && (ncols < 2*_cols - 1))) {
+    cerr << "Mat3D<Type>::expand(): cannot expand a " << _slis << "x" << _rows << "x"
+	 << _cols << " volume to " << nslis << "x" << nrows << "x" << ncols << endl;
+    return Mat3D<Type>(*this);
+  }
+
+  Mat3D<Type> result(nslis, nrows, ncols);
+  pyramidExpand(result._el, nslis, nrows, ncols, _el, _slis, _rows, _cols, 0, border);
+  return result;
+}
+
+template <class Type>
+Pyramid<Type>
+Mat3D<Type>::pyramid(unsigned nLevels, Boolean laplacian, BorderMode border) const
+{
+  return Pyramid<Type>(_el, _slis, _rows, _cols, nLevels, laplacian, border);
+}
 
 //************************
 //reverse the filter or rotate by 180
@@ -2052,6 +1955,96 @@ Mat3D<Type>::rotate180() const
    return Temp;
 }
 
+//
+//-------------------------// 
+//
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::convolve3d(const Mat3D<Type>& kernel, ConvolutionMethod method,
+			BorderMode border) const
+{
+  Mat3D<Type> out(_slis, _rows, _cols);
+
+  if (*this)
+    convolve(out._el, _el, _slis, _rows, _cols,
+	     kernel._el, kernel._slis, kernel._rows, kernel._cols, method, border);
+
+  return out;
+}
+
+//
+//-------------------------// 
+//
+template <class Type>
+Mat3D<Type>&
+Mat3D<Type>::convolve3dInPlace(const Mat3D<Type>& kernel, ConvolutionMethod method,
+			       BorderMode border)
+{
+  if (*this)
+    convolve(_el, _el, _slis, _rows, _cols,
+	     kernel._el, kernel._slis, kernel._rows, kernel._cols, method, border);
+
+  return *this;
+}
+
+//
+//-------------------------// 
+//
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::convolve3d(const Mat<Type>& sliceKernel, const Mat<Type>& rowKernel,
+			const Mat<Type>& colKernel, BorderMode border) const
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  Mat3D<Type> out(_slis, _rows, _cols);
+
+  if (!sliceKernel.isvector() || !rowKernel.isvector() || !colKernel.isvector()) {
+    cerr << "Mat3D<Type>::convolve3d: separable kernel factors must be vectors" << endl;
+    return out;
+  }
+
+  const Mat<Type> *kernels[3] = {&sliceKernel, &rowKernel, &colKernel};
+  unsigned length[3];
+  Acc     *factors[3];
+  for (unsigned k = 0; k < 3; k++) {
+    const Mat<Type>& kernel = *kernels[k];
+    const Type **kernelEl = kernel.getEl();
+    length[k]  = kernel.length();
+    factors[k] = new Acc[length[k]];
+    for (unsigned i = 0; i < length[k]; i++)
+      factors[k][i] = Acc((kernel.getcols() == 1) ? kernelEl[i][0] : kernelEl[0][i]);
+  }
+
+  if (*this)
+    convolveSeparable(out._el, _el, _slis, _rows, _cols, factors[0], length[0],
+		      factors[1], length[1], factors[2], length[2], border);
+
+  for (unsigned k = 0; k < 3; k++)
+    delete [] factors[k];
+
+  return out;
+}
+
+//
+//-------------------------// 
+//
+template <class Type>
+Mat3D<Type>
+Mat3D<Type>::gaussianFilter(double sliceSigma, double rowSigma, double colSigma,
+			    unsigned sliceOrder, unsigned rowOrder, unsigned colOrder) const
+{
+  Mat3D<Type> out(_slis, _rows, _cols);
+
+  if (*this) {
+    const double   sigma[3] = {sliceSigma, rowSigma, colSigma};
+    const unsigned order[3] = {sliceOrder, rowOrder, colOrder};
+    ::gaussianFilter(out._el, _el, _slis, _rows, _cols, sigma, order);
+  }
+
+  return out;
+}
+
 //3D histogram
 //this histogram works in the following way
 //if there is no input in the histogram ex: histogram(), then
@@ -2113,8 +2106,13 @@ Mat3D<Type>::histogram(double minin, double maxin, unsigned n) const
 
   Histogram histogram(minin, maxin, n);
 
+  // All rows at once, so that the fill is split over the whole volume
+  const Type **rows = new const Type *[_slis*_rows];
   for(unsigned s=0; s < _slis; s++)
-    histogram += _slices[s].histogram(minin, maxin, n);
+    for(unsigned r=0; r < _rows; r++)
+      rows[s*_rows + r] = _el[s][r];
+  histogram.add(rows, _slis*_rows, _cols);
+  delete [] rows;
   
   return(histogram);
 }
@@ -2201,7 +2199,7 @@ template <class Type>
 Mat3D<Type>&
 Mat3D<Type>::ifft(unsigned nslis, unsigned nrows, unsigned ncols)
 {
-  _fft(nslis, nrows, ncols, ::ifft);
+  _fft(nslis, nrows, ncols, TRUE);
   unsigned factor = 1;
   if (nslis != 1) factor *= _slis;
   if (nrows != 1) factor *= _rows;
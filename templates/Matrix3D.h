@@ -48,6 +48,8 @@ $State: Exp $
  *****************************************************************************/
 
 #include "Matrix.h"
+#include "Warp.h"
+#include "JointHistogram.h"
 
 template <class Type> class Ones3D;
 template <class Type> class Zeros3D;
@@ -255,6 +257,10 @@ public:
   Type min(unsigned *sli = 0, unsigned *row = 0, unsigned *col = 0) const;
   Type max(unsigned *sli = 0, unsigned *row = 0, unsigned *col = 0) const;
   Type median(Type minVal = 0, Type maxVal = 0) const;
+  // See Mat::percentile()
+  Type percentile(double pct, Type minVal = 0, Type maxVal = 0) const;
+  SimpleArray<Type> percentiles(const SimpleArray<double>& pct, Type minVal = 0,
+				Type maxVal = 0) const;
   
   double  sum() const { return real(csum()); }
   complex csum() const;
@@ -389,6 +395,10 @@ public:
   Mat3D  map(const ValueMap& valueMap) const { return mapConst(valueMap); }
   Mat3D  mapConst(const ValueMap& valueMap) const { 
     Mat3D<Type> A(*this); return A.map(valueMap); }
+  // Single-pass map through a chain of maps; see Mat::map(const CompiledMap&)
+  Mat3D& map(const CompiledMap& valueMap);
+  Mat3D  map(const CompiledMap& valueMap) const { 
+    Mat3D<Type> A(*this); return A.map(valueMap); }
 
   // Scales a Matrix (similar to map; kept for backward compatibility)
   Mat3D& scale(double minout = 0.0, double maxout = 255.0, 
@@ -420,13 +430,85 @@ public:
   
   Mat3D rotate180() const;
 
+  // 3D convolution; same kernel origin as Mat::convolv2d. The method
+  // defaults to the cheapest one for the kernel.
+  Mat3D convolve3d(const Mat3D& kernel, ConvolutionMethod method = CONV_AUTO,
+		   BorderMode border = BORDER_ZERO) const;
+  // 3D convolution with a separable kernel given by its slice, row and column
+  // factors (vectors)
+  Mat3D convolve3d(const Mat<Type>& sliceKernel, const Mat<Type>& rowKernel,
+		   const Mat<Type>& colKernel, BorderMode border = BORDER_ZERO) const;
+  // In-place version of convolve3d
+  Mat3D& convolve3dInPlace(const Mat3D& kernel, ConvolutionMethod method = CONV_AUTO,
+			   BorderMode border = BORDER_ZERO);
+  // Recursive Gaussian filter and derivatives; see Mat::gaussianFilter()
+  Mat3D gaussianFilter(double sliceSigma, double rowSigma, double colSigma,
+		       unsigned sliceOrder = 0, unsigned rowOrder = 0,
+		       unsigned colOrder = 0) const;
+
+  // Greylevel morphology; see Mat::erode()
+  Mat3D erode(const CompiledStrel& strel) const;
+  Mat3D dilate(const CompiledStrel& strel) const;
+  Mat3D open(const CompiledStrel& strel) const  { return erode(strel).dilate(strel); }
+  Mat3D close(const CompiledStrel& strel) const { return dilate(strel).erode(strel); }
 #ifdef USE_DBLMAT
   Mat3D erode(const Mat3D<double>& strel) const;
   Mat3D dilate(const Mat3D<double>& strel) const;
   Mat3D open(const Mat3D<double>& strel) const  { return erode(strel).dilate(strel); }
   Mat3D close(const Mat3D<double>& strel) const { return dilate(strel).erode(strel); }
+
+  // Exact squared Euclidean distance transform; see Mat::distanceTransform().
+  // Indices in nearest are (slice*nrows + row)*ncols + col.
+  Mat3D<double> distanceTransform(double sliceSpacing = 1.0, double rowSpacing = 1.0,
+				  double colSpacing = 1.0, Mat3D<int> *nearest = 0) const;
+
+  // Box sum, mean or variance; see Mat::boxFilter()
+  Mat3D<double> boxFilter(unsigned depth, unsigned height, unsigned width,
+			  BoxStatistic statistic = BOX_MEAN) const;
+
+  // Warps the volume through an affine transformation, given as a 3 x 4 or
+  // 4 x 4 matrix that maps output voxel coordinates (slice, row, col, 1) to
+  // input voxel coordinates. The output has the given dimensions (0: those of
+  // the input). Samples outside the volume follow the border mode.
+  Mat3D warp(const Mat<double>& affine, unsigned nslis = 0, unsigned nrows = 0,
+	     unsigned ncols = 0, ResampleKernel kernel = RESAMPLE_LINEAR,
+	     BorderMode border = BORDER_ZERO) const;
+  // Warps the volume through a displacement field (in voxels), given by its
+  // slice, row and column components; the output has the dimensions of the
+  // field.
+  Mat3D warp(const Mat3D<double>& dSlice, const Mat3D<double>& dRow,
+	     const Mat3D<double>& dCol, ResampleKernel kernel = RESAMPLE_LINEAR,
+	     BorderMode border = BORDER_ZERO) const;
 #endif
 
+  // Connected-component labeling; see Mat::label(). Connectivity is 6, 18
+  // or 26 (or 4 or 8 to label each slice separately).
+  unsigned label(Mat3D<int>& labels, unsigned connectivity = 26,
+		 Array<Component> *components = 0) const;
+
+  // Rank and median filters over depth x height x width windows; see
+  // Mat::rankFilter()
+  Mat3D rankFilter(unsigned depth, unsigned height, unsigned width, double pct,
+		   BorderMode border = BORDER_CLAMP) const;
+  Mat3D medianFilter(unsigned depth, unsigned height, unsigned width,
+		     BorderMode border = BORDER_CLAMP) const {
+    return rankFilter(depth, height, width, 50, border); }
+
+  // Resampling to a given size or by given scale factors; see Mat::resample()
+  Mat3D resample(unsigned nslis, unsigned nrows, unsigned ncols,
+		 ResampleKernel kernel = RESAMPLE_LINEAR,
+		 BorderMode border = BORDER_CLAMP) const;
+  Mat3D resampleBy(double sliceFactor, double rowFactor, double colFactor,
+		   ResampleKernel kernel = RESAMPLE_LINEAR,
+		   BorderMode border = BORDER_CLAMP) const;
+
+  // Pyramids; see Mat::reduce(), Mat::expand() and Mat::pyramid()
+  Mat3D reduce(BorderMode border = BORDER_CLAMP) const;
+  Mat3D expand(unsigned nslis, unsigned nrows, unsigned ncols,
+	       BorderMode border = BORDER_CLAMP) const;
+  Pyramid<Type> pyramid(unsigned nLevels, Boolean laplacian = FALSE,
+			BorderMode border = BORDER_CLAMP) const;
+
   //Returns a histogram for the calling object using the specified range and # bins
   Histogram histogram(double minin = 0, double maxin = 0, unsigned n = 0) const;
   
@@ -448,7 +530,7 @@ public:
 
   // Non-const fft function
   Mat3D& fft(unsigned nslis = 0, unsigned nrows = 0, unsigned ncols = 0) {
-    return _fft(nslis, nrows, ncols, ::fft); }
+    return _fft(nslis, nrows, ncols, FALSE); }
   // Const fft function
   Mat3D  fft(unsigned nslis = 0, unsigned nrows = 0, unsigned ncols = 0) const { 
     return fftConst(nslis, nrows, ncols); }
@@ -470,7 +552,8 @@ private:
   void _setEl();
   void _checkMatrixDimensions(const char *path, 
 			      unsigned& nslis, unsigned& nrows, unsigned& ncols) const;
-  Mat3D& _fft(unsigned nslis, unsigned nrows, unsigned ncols, FFTFUNC fftFunc);
+  Mat3D& _fft(unsigned nslis, unsigned nrows, unsigned ncols, Boolean inverse);
+  void   _fftBatch(const FFTPlan& plan, unsigned axis, Boolean inverse);
 
 // Kept up to here for now
 };
@@ -576,6 +659,12 @@ Type median(const Mat3D<Type>& A, Type minVal = 0, Type maxVal = 0)
   return A.median(minVal, maxVal);
 }
 
+template <class Type>
+Type percentile(const Mat3D<Type>& A, double pct, Type minVal = 0, Type maxVal = 0) 
+{ 
+  return A.percentile(pct, minVal, maxVal);
+}
+
 template <class Type>
 double sum(const Mat3D<Type>& A)           { return A.sum(); }
 
@@ -699,6 +788,22 @@ Mat3D<Type> padConst(const Mat3D<Type>& A, unsigned slicepad, unsigned rowpad,
 template <class Type>
 Mat3D<Type> rotate180(const Mat3D<Type>& A) { return A.rotate180(); }
 
+template <class Type>
+Mat3D<Type> convolve3d(const Mat3D<Type>& A, const Mat3D<Type>& kernel,
+		       ConvolutionMethod method = CONV_AUTO,
+		       BorderMode border = BORDER_ZERO)
+{
+  return A.convolve3d(kernel, method, border);
+}
+
+template <class Type>
+Mat3D<Type> convolve3d(const Mat3D<Type>& A, const Mat<Type>& sliceKernel,
+		       const Mat<Type>& rowKernel, const Mat<Type>& colKernel,
+		       BorderMode border = BORDER_ZERO)
+{
+  return A.convolve3d(sliceKernel, rowKernel, colKernel, border);
+}
+
 #ifdef HAVE_DBLMAT
 template <class Type>
 Mat3D<Type> erode(const Mat3D<Type>& A, const Mat3D<double>& strel)
@@ -731,6 +836,43 @@ Histogram histogram(const Mat3D<Type>& A, double minin = 0, double maxin = 0,
 {
   return A.histogram(minin, maxin, n);
 }
+
+// Adds corresponding voxels of A and B (within mask, if given) to hist; see
+// JointHistogram::add()
+template <class T1, class T2>
+double add(JointHistogram& hist, const Mat3D<T1>& A, const Mat3D<T2>& B,
+	   const Mat3D<unsigned char> *mask = 0, unsigned step = 1)
+{
+  if ((A.getslis() != B.getslis()) || (A.getrows() != B.getrows()) || 
+      (A.getcols() != B.getcols()) || (mask && 
+      ((mask->getslis() != A.getslis()) || (mask->getrows() != A.getrows()) ||
+       (mask->getcols() != A.getcols())))) {
+    std::cerr << "add(JointHistogram&, Mat3D, Mat3D): sizes do not match" << std::endl;
+    return 0;
+  }
+
+  return hist.add(A.getEl(), B.getEl(), A.getslis(), A.getrows(), A.getcols(),
+		  mask ? mask->getEl() : 0, step);
+}
+
+// Partial volume filling of hist, with voxel (s, r, c) of A mapping to
+// voxel transform * (s, r, c, 1) of B; see JointHistogram::addPartialVolume()
+template <class T1, class T2>
+double addPartialVolume(JointHistogram& hist, const Mat3D<T1>& A, const Mat3D<T2>& B,
+			const double transform[12],
+			const Mat3D<unsigned char> *mask = 0, unsigned step = 1)
+{
+  if (mask && ((mask->getslis() != A.getslis()) || (mask->getrows() != A.getrows()) ||
+	       (mask->getcols() != A.getcols()))) {
+    std::cerr << "addPartialVolume(JointHistogram&, Mat3D, Mat3D): mask size does not match" 
+	      << std::endl;
+    return 0;
+  }
+
+  return hist.addPartialVolume(A.getEl(), A.getslis(), A.getrows(), A.getcols(),
+			       B.getEl(), B.getslis(), B.getrows(), B.getcols(),
+			       transform, mask ? mask->getEl() : 0, step);
+}
   
 template <class Type>
 Mat3D<Type> clip(const Mat3D<Type>& A, Type minVal, Type maxVal, Type minFill,
@@ -859,4 +1001,19 @@ public:
   Randnormal3D(unsigned n)  : Mat3D<Type>(n, n, n) {randnormal();} 
   ~Randnormal3D() {}
 };
+#ifdef USE_UCHRMAT
+//Converts between UChrMat3D (0/1) and bit-packed masks
+inline BitMask asBitMask(const Mat3D<unsigned char>& A)
+{
+  return BitMask(A.getEl(), A.getslis(), A.getrows(), A.getcols());
+}
+
+inline Mat3D<unsigned char> asUChrMat3D(const BitMask& mask)
+{
+  Mat3D<unsigned char> A(mask.getslis(), mask.getrows(), mask.getcols());
+  mask.getBytes((unsigned char ***) A.getEl());
+  return A;
+}
+#endif
+
 #endif
@@ -133,6 +133,22 @@ Mat<dcomplex>::median(dcomplex, dcomplex) const
   cerr << "Mat<dcomplex>::median() called but not implemented" << endl;
   return 0;
 }
+
+template <>
+dcomplex
+Mat<dcomplex>::percentile(double, dcomplex, dcomplex) const
+{
+  cerr << "Mat<dcomplex>::percentile() called but not implemented" << endl;
+  return 0;
+}
+
+template <>
+SimpleArray<dcomplex>
+Mat<dcomplex>::percentiles(const SimpleArray<double>&, dcomplex, dcomplex) const
+{
+  cerr << "Mat<dcomplex>::percentiles() called but not implemented" << endl;
+  return SimpleArray<dcomplex>(0);
+}
 #endif // USE_COMPMAT
 
 #ifdef USE_FCOMPMAT
@@ -143,6 +159,22 @@ Mat<fcomplex>::median(fcomplex, fcomplex) const
   cerr << "Mat<fcomplex>::median() called but not implemented" << endl;
   return 0;
 }
+
+template <>
+fcomplex
+Mat<fcomplex>::percentile(double, fcomplex, fcomplex) const
+{
+  cerr << "Mat<fcomplex>::percentile() called but not implemented" << endl;
+  return 0;
+}
+
+template <>
+SimpleArray<fcomplex>
+Mat<fcomplex>::percentiles(const SimpleArray<double>&, fcomplex, fcomplex) const
+{
+  cerr << "Mat<fcomplex>::percentiles() called but not implemented" << endl;
+  return SimpleArray<fcomplex>(0);
+}
 #endif // USE_FCOMPMAT
 
 #ifdef USE_COMPMAT
@@ -547,6 +579,14 @@ Mat<dcomplex>::map(const ValueMap&)
   cerr << "Mat<dcomplex>::map called but not implemented" << endl;
   return *this;
 }
+
+template <>
+Mat<dcomplex>&
+Mat<dcomplex>::map(const CompiledMap&)
+{
+  cerr << "Mat<dcomplex>::map called but not implemented" << endl;
+  return *this;
+}
 #endif // USE_COMPMAT
 
 #ifdef USE_FCOMPMAT
@@ -557,32 +597,87 @@ Mat<fcomplex>::map(const ValueMap&)
   cerr << "Mat<fcomplex>::map called but not implemented" << endl;
   return *this;
 }
-#endif // USE_FCOMPMAT
 
-#ifdef USE_COMPMAT
 template <>
-void 
-Mat<dcomplex>::linearinterpolate(unsigned Urow, unsigned Drow, unsigned Ucol, unsigned Dcol, Mat<dcomplex>& y) const
+Mat<fcomplex>&
+Mat<fcomplex>::map(const CompiledMap&)
 {
-  cerr << "Mat<dcomplex>::linearinterpolate not implemented" << endl;
+  cerr << "Mat<fcomplex>::map called but not implemented" << endl;
+  return *this;
 }
-#endif // USE_COMPMAT
+#endif // USE_FCOMPMAT
 
 #ifdef USE_COMPMAT
 template <>
 Mat<dcomplex> 
-Mat<dcomplex>::filter(Mat<dcomplex>& B,Mat<dcomplex>& A) const
+Mat<dcomplex>::filter(const Mat<dcomplex>& B, const Mat<dcomplex>&) const
 {
   cerr << "Mat<dcomplex>::filter not implemented" << endl;
   return B;
 }
+
+template <>
+Mat<dcomplex> 
+Mat<dcomplex>::filtfilt(const Mat<dcomplex>& B, const Mat<dcomplex>&) const
+{
+  cerr << "Mat<dcomplex>::filtfilt not implemented" << endl;
+  return B;
+}
+
+template <>
+Mat<dcomplex> 
+Mat<dcomplex>::filterRows(const Mat<dcomplex>&, const Mat<dcomplex>&, Boolean) const
+{
+  cerr << "Mat<dcomplex>::filterRows not implemented" << endl;
+  return Mat<dcomplex>(*this);
+}
+
+template <>
+Mat<dcomplex> 
+Mat<dcomplex>::filterColumns(const Mat<dcomplex>&, const Mat<dcomplex>&, Boolean) const
+{
+  cerr << "Mat<dcomplex>::filterColumns not implemented" << endl;
+  return Mat<dcomplex>(*this);
+}
 #endif // USE_COMPMAT
+#ifdef USE_FCOMPMAT
+template <>
+Mat<fcomplex> 
+Mat<fcomplex>::filter(const Mat<fcomplex>& B, const Mat<fcomplex>&) const
+{
+  cerr << "Mat<fcomplex>::filter not implemented" << endl;
+  return B;
+}
+
+template <>
+Mat<fcomplex> 
+Mat<fcomplex>::filtfilt(const Mat<fcomplex>& B, const Mat<fcomplex>&) const
+{
+  cerr << "Mat<fcomplex>::filtfilt not implemented" << endl;
+  return B;
+}
+
+template <>
+Mat<fcomplex> 
+Mat<fcomplex>::filterRows(const Mat<fcomplex>&, const Mat<fcomplex>&, Boolean) const
+{
+  cerr << "Mat<fcomplex>::filterRows not implemented" << endl;
+  return Mat<fcomplex>(*this);
+}
+
+template <>
+Mat<fcomplex> 
+Mat<fcomplex>::filterColumns(const Mat<fcomplex>&, const Mat<fcomplex>&, Boolean) const
+{
+  cerr << "Mat<fcomplex>::filterColumns not implemented" << endl;
+  return Mat<fcomplex>(*this);
+}
+#endif // USE_FCOMPMAT
 
-#ifdef USE_DBLMAT
 #ifdef USE_COMPMAT
 template <>
 Mat<dcomplex>
-Mat<dcomplex>::erode(const Mat<double>&) const
+Mat<dcomplex>::erode(const CompiledStrel&) const
 {
   cerr << "Mat<dcomplex>::erode() called but not implemented" << endl;
   return Mat<dcomplex>(*this);
@@ -592,7 +687,7 @@ Mat<dcomplex>::erode(const Mat<double>&) const
 #ifdef USE_FCOMPMAT
 template <>
 Mat<fcomplex>
-Mat<fcomplex>::erode(const Mat<double>&) const
+Mat<fcomplex>::erode(const CompiledStrel&) const
 {
   cerr << "Mat<fcomplex>::erode() called but not implemented" << endl;
   return Mat<fcomplex>(*this);
@@ -602,7 +697,7 @@ Mat<fcomplex>::erode(const Mat<double>&) const
 #ifdef USE_COMPMAT
 template <>
 Mat<dcomplex>
-Mat<dcomplex>::dilate(const Mat<double>&) const
+Mat<dcomplex>::dilate(const CompiledStrel&) const
 {
   cerr << "Mat<dcomplex>::dilate() called but not implemented" << endl;
   return Mat<dcomplex>(*this);
@@ -612,13 +707,53 @@ Mat<dcomplex>::dilate(const Mat<double>&) const
 #ifdef USE_FCOMPMAT
 template <>
 Mat<fcomplex>
-Mat<fcomplex>::dilate(const Mat<double>&) const
+Mat<fcomplex>::dilate(const CompiledStrel&) const
 {
   cerr << "Mat<fcomplex>::dilate() called but not implemented" << endl;
   return Mat<fcomplex>(*this);
 }
 #endif // USE_FCOMPMAT
 
+#ifdef USE_COMPMAT
+template <>
+Mat<dcomplex>
+Mat<dcomplex>::rankFilter(unsigned, unsigned, double, BorderMode) const
+{
+  cerr << "Mat<dcomplex>::rankFilter() called but not implemented" << endl;
+  return Mat<dcomplex>(*this);
+}
+#endif // USE_COMPMAT
+
+#ifdef USE_FCOMPMAT
+template <>
+Mat<fcomplex>
+Mat<fcomplex>::rankFilter(unsigned, unsigned, double, BorderMode) const
+{
+  cerr << "Mat<fcomplex>::rankFilter() called but not implemented" << endl;
+  return Mat<fcomplex>(*this);
+}
+#endif // USE_FCOMPMAT
+
+#ifdef USE_DBLMAT
+#ifdef USE_COMPMAT
+template <>
+Mat<double>
+Mat<dcomplex>::boxFilter(unsigned, unsigned, BoxStatistic) const
+{
+  cerr << "Mat<dcomplex>::boxFilter() called but not implemented" << endl;
+  return Mat<double>(_rows, _cols, 0.0);
+}
+#endif // USE_COMPMAT
+
+#ifdef USE_FCOMPMAT
+template <>
+Mat<double>
+Mat<fcomplex>::boxFilter(unsigned, unsigned, BoxStatistic) const
+{
+  cerr << "Mat<fcomplex>::boxFilter() called but not implemented" << endl;
+  return Mat<double>(_rows, _cols, 0.0);
+}
+#endif // USE_FCOMPMAT
 #endif // USE_DBLMAT
 
 #ifdef HAVE_MATLAB
@@ -812,221 +947,6 @@ Mat<fcomplex>::saveAscii(const char *) const
 }
 #endif // USE_FCOMPMAT
 
-#ifdef USE_COMPMAT
-template <>
-Mat<dcomplex>&
-Mat<dcomplex>::_fft(unsigned nrows, unsigned ncols, FFTFUNC fftFunc)
-{
-  using std::max;		// (bert) force it to use the right max()
-
-  // Verify dimensions of FFT
-  if ((nrows > 1) && ((nrows < _rows) || !isPowerOf2(nrows))) {
-    cerr << "Warning! Mat<dcomplex>::fft():" << endl
-	 << "  Requested # _rows for FFT (" << nrows << ") invalid;" << endl;
-    nrows = max(unsigned(4), nextPowerOf2(max(nrows, _rows)));
-    cerr << "  increased to " << nrows << endl;
-  }
-
-  if ((ncols > 1) && ((ncols < _cols) || !isPowerOf2(ncols))) {
-    cerr << "Warning! Mat<dcomplex>::fft():" << endl
-	 << "  Requested # _cols for FFT (" << ncols << ") invalid;" << endl;
-    ncols = max(unsigned(4), nextPowerOf2(max(ncols, _cols)));
-    cerr << "  increased to " << ncols << endl;
-  }
-
-  Boolean doX = (ncols != 1) && (_cols > 1) ? TRUE : FALSE;
-  Boolean doY = (nrows != 1) && (_rows > 1) ? TRUE : FALSE;
-
-  if (!nrows)
-    nrows = max(unsigned(4), nextPowerOf2(_rows));
-  else if (nrows == 1)
-    nrows = _rows;
-
-  if (!ncols)
-    ncols = max(unsigned(4), nextPowerOf2(_cols));
-  else if (ncols == 1)
-    ncols = _cols;
-
-  // Pad matrix to the final FFT dimensions
-  pad(nrows, ncols, (nrows - _rows)/2, (ncols - _cols)/2, 0);
-
-  // Allocate temporary arrays
-  double *real = 0;
-  double *imag = 0;
-  unsigned maxDim = max(doX ? _cols : 1, doY ? _rows : 1);
-
-  allocateArray(maxDim, real);
-  allocateArray(maxDim, imag);
-  assert(real && imag);
-
-  unsigned row, col;
-
-  // Take 1D FFT in X (row) direction
-  if (doX)
-    for(row = 0; row < _rows; row++) {
-      // Fill temporary FFT array
-      double  *realPtr   = real;
-      double  *imagPtr   = imag;
-      dcomplex *sourcePtr = _el[row];
-      for(col = _cols; col != 0; col--) {
-	dcomplex value(*sourcePtr++);
-	*realPtr++ = value.real();
-	*imagPtr++ = value.imag();
-      }
-
-      // Calculate 1D FFT
-      fftFunc(_cols, real, imag);
-
-      // Put results back
-      realPtr   = real;
-      imagPtr   = imag;
-      sourcePtr = _el[row];
-      for(col = _cols; col != 0; col--)
-	*sourcePtr++ = dcomplex(*realPtr++, *imagPtr++);
-    }
-
-  // Take 1D FFT in Y (column) direction
-  if (doY)
-    for(col = 0; col < _cols; col++) {
-      // Fill temporary FFT array
-      double  *realPtr   = real;
-      double  *imagPtr   = imag;
-      dcomplex *sourcePtr = _el[0] + col;
-      for(row = _rows; row != 0; row--) {
-	dcomplex value(*sourcePtr);
-	*realPtr++ = value.real();
-	*imagPtr++ = value.imag();
-	sourcePtr += _cols;
-      }
-
-      // Calculate 1D FFT
-      fftFunc(_rows, real, imag);
-
-      // Put results back
-      realPtr   = real;
-      imagPtr   = imag;
-      sourcePtr = _el[0] + col;
-      for(row = _rows; row != 0; row--) {
-	*sourcePtr = dcomplex(*realPtr++, *imagPtr++);
-	sourcePtr += _cols;
-      }
-    }
-
-  // Free temporary arrays
-  freeArray(real);
-  freeArray(imag);
-
-  return *this;
-}
-#endif // USE_COMPMAT
-
-#ifdef USE_FCOMPMAT
-template <>
-Mat<fcomplex>&
-Mat<fcomplex>::_fft(unsigned nrows, unsigned ncols, FFTFUNC fftFunc)
-{
-  using std::max;		// (bert) force it to use the right max()
-
-  // Verify dimensions of FFT
-  if ((nrows > 1) && ((nrows < _rows) || !isPowerOf2(nrows))) {
-    cerr << "Warning! Mat<fcomplex>::fft():" << endl
-	 << "  Requested # _rows for FFT (" << nrows << ") invalid;" << endl;
-    nrows = max(unsigned(4), nextPowerOf2(max(nrows, _rows)));
-    cerr << "  increased to " << nrows << endl;
-  }
-
-  if ((ncols > 1) && ((ncols < _cols) || !isPowerOf2(ncols))) {
-    cerr << "Warning! Mat<fcomplex>::fft():" << endl
-	 << "  Requested # _cols for FFT (" << ncols << ") invalid;" << endl;
-    ncols = max(unsigned(4), nextPowerOf2(max(ncols, _cols)));
-    cerr << "  increased to " << ncols << endl;
-  }
-
-  Boolean doX = (ncols != 1) && (_cols > 1) ? TRUE : FALSE;
-  Boolean doY = (nrows != 1) && (_rows > 1) ? TRUE : FALSE;
-
-  if (!nrows)
-    nrows = max(unsigned(4), nextPowerOf2(_rows));
-  else if (nrows == 1)
-    nrows = _rows;
-
-  if (!ncols)
-    ncols = max(unsigned(4), nextPowerOf2(_cols));
-  else if (ncols == 1)
-    ncols = _cols;
-
-  // Pad matrix to the final FFT dimensions
-  pad(nrows, ncols, (nrows - _rows)/2, (ncols - _cols)/2, 0);
-
-  // Allocate temporary arrays
-  double *real = 0;
-  double *imag = 0;
-  unsigned maxDim = ::max(doX ? _cols : 1, doY ? _rows : 1);
-  allocateArray(maxDim, real);
-  allocateArray(maxDim, imag);
-  assert(real && imag);
-
-  unsigned row, col;
-
-  // Take 1D FFT in X (row) direction
-  if (doX)
-    for(row = 0; row < _rows; row++) {
-      // Fill temporary FFT array
-      double  *realPtr   = real;
-      double  *imagPtr   = imag;
-      fcomplex *sourcePtr = _el[row];
-      for(col = _cols; col != 0; col--) {
-	fcomplex value(*sourcePtr++);
-	*realPtr++ = value.real();
-	*imagPtr++ = value.imag();
-      }
-
-      // Calculate 1D FFT
-      fftFunc(_cols, real, imag);
-
-      // Put results back
-      realPtr   = real;
-      imagPtr   = imag;
-      sourcePtr = _el[row];
-      for(col = _cols; col != 0; col--)
-	*sourcePtr++ = fcomplex(*realPtr++, *imagPtr++);
-    }
-
-  // Take 1D FFT in Y (column) direction
-  if (doY)
-    for(col = 0; col < _cols; col++) {
-      // Fill temporary FFT array
-      double  *realPtr   = real;
-      double  *imagPtr   = imag;
-      fcomplex *sourcePtr = _el[0] + col;
-      for(row = _rows; row != 0; row--) {
-	fcomplex value(*sourcePtr);
-	*realPtr++ = value.real();
-	*imagPtr++ = value.imag();
-	sourcePtr += _cols;
-      }
-
-      // Calculate 1D FFT
-      fftFunc(_rows, real, imag);
-
-      // Put results back
-      realPtr   = real;
-      imagPtr   = imag;
-      sourcePtr = _el[0] + col;
-      for(row = _rows; row != 0; row--) {
-	*sourcePtr = fcomplex(*realPtr++, *imagPtr++);
-	sourcePtr += _cols;
-      }
-    }
-
-  // Free temporary arrays
-  freeArray(real);
-  freeArray(imag);
-
-  return *this;
-}
-#endif // USE_FCOMPMAT
-
 #ifdef HAVE_MATLAB
 #ifdef USE_COMPMAT
 template <>
@@ -25,9 +25,11 @@ $State: Exp $
 
 #include <math.h>
 #include <stdio.h>
+#include <assert.h>
 #include <iostream>		// (bert) changed from iostream.h
 using namespace std;		// (bert) added
 #include "dcomplex.h"
+#include "trivials.h"
 #include "MatrixSupport.h"
 
 
@@ -557,6 +559,617 @@ void fft_basic_float(fcomplex *cbuffer,float *sintab, int buflog, int direct)
 // End of C code
 
 
+// Relative costs used by convolutionMethod(), in units of one direct
+// multiply-add: per butterfly-stage element of a complex FFT, per element
+// of the spectrum multiplication (including loading and storing blocks), and
+// per tap of a separable pass (which goes through an intermediate buffer).
+static const double FFT_STAGE_COST = 1.5;
+static const double FFT_POINT_COST = 6.0;
+static const double SEPARABLE_TAP_COST = 1.5;
+
+static unsigned
+_log2(unsigned n)
+{
+  unsigned l = 0;
+  while (n >>= 1)
+    l++;
+  return l;
+}
+
+unsigned
+fftConvolutionLength(unsigned n, unsigned k)
+{
+  if (k <= 1)
+    return 0;
+
+  // Overlap-save: a block of length N yields N - k + 1 output samples. Pick
+  // the N that minimizes the transform work over the whole signal.
+  unsigned maxN = 2;
+  while (maxN < n + k - 1)
+    maxN *= 2;
+  unsigned N = 2;
+  while (N < k)
+    N *= 2;
+
+  unsigned bestN    = N;
+  double   bestCost = 0;
+  for (; N <= maxN; N *= 2) {
+    unsigned block  = N - k + 1;
+    double   nBlocks = (n + block - 1)/block;
+    double   cost   = nBlocks*N*(_log2(N) + 1);
+    if ((N == bestN) || (cost < bestCost)) {
+      bestN    = N;
+      bestCost = cost;
+    }
+  }
+
+  return bestN;
+}
+
+ConvolutionMethod
+convolutionMethod(unsigned nslis, unsigned nrows, unsigned ncols,
+		  unsigned kslis, unsigned krows, unsigned kcols,
+		  ConvolutionMethod method, Boolean separable)
+{
+  if (method != CONV_AUTO)
+    return method;
+
+  if (!nslis || !nrows || !ncols || !kslis || !krows || !kcols)
+    return CONV_DIRECT;
+
+  unsigned n[3] = {nslis, nrows, ncols};
+  unsigned k[3] = {kslis, krows, kcols};
+
+  double direct  = double(nslis)*nrows*ncols*kslis*krows*kcols;
+  double nBlocks = 1;
+  double volume  = 1;
+  double stages  = 0;
+  for (unsigned axis = 0; axis < 3; axis++) {
+    unsigned N = fftConvolutionLength(n[axis], k[axis]);
+    if (N) {
+      nBlocks *= (n[axis] + N - k[axis])/(N - k[axis] + 1);
+      volume  *= N;
+      stages  += _log2(N);
+    }
+    else
+      volume  *= n[axis];
+  }
+
+  // Forward and inverse transform per block, plus the kernel transform
+  double fft = (nBlocks*2 + 1)*volume*stages*FFT_STAGE_COST 
+    + nBlocks*volume*FFT_POINT_COST;
+
+  ConvolutionMethod best = (fft < direct) ? CONV_FFT : CONV_DIRECT;
+  if (separable) {
+    double sep = double(nslis)*nrows*ncols*SEPARABLE_TAP_COST*
+      (((kslis > 1) ? kslis : 0) + ((krows > 1) ? krows : 0) + ((kcols > 1) ? kcols : 0));
+    if ((sep < fft) && (sep < direct))
+      best = CONV_SEPARABLE;
+  }
+
+  return best;
+}
+
+FFTPlan::FFTPlan(unsigned n)
+{
+  // The transform requires a power of 2
+  _n = 1;
+  while (_n < n)
+    _n *= 2;
+  if (_n != n) {
+    cerr << "Warning! FFTPlan: length " << n << " is not a power of 2;" << endl
+	 << "  increased to " << _n << endl;
+    n = _n;
+  }
+
+  _bitReverse = new unsigned[n];
+  _cos  = new double[n/2 + 1];
+  _sin  = new double[n/2 + 1];
+  _cosf = new float[n/2 + 1];
+  _sinf = new float[n/2 + 1];
+
+  unsigned nBits = _log2(n);
+  for (unsigned j = 0; j < n; j++) {
+    unsigned k = 0;
+    for (unsigned bit = 0; bit < nBits; bit++)
+      if (j & (1 << bit))
+	k |= 1 << (nBits - 1 - bit);
+    _bitReverse[j] = k;
+  }
+
+  for (unsigned k = 0; k <= n/2; k++) {
+    _cos[k]  = cos(2*M_PI*k/n);
+    _sin[k]  = sin(2*M_PI*k/n);
+    _cosf[k] = float(_cos[k]);
+    _sinf[k] = float(_sin[k]);
+  }
+}
+
+FFTPlan::~FFTPlan()
+{
+  delete [] _bitReverse;
+  delete [] _cos;
+  delete [] _sin;
+  delete [] _cosf;
+  delete [] _sinf;
+}
+
+CompiledStrel::CompiledStrel(const double * const * const *strel,
+			     unsigned ks, unsigned kr, unsigned kc)
+{
+  _ks = ks;
+  _kr = kr;
+  _kc = kc;
+
+  _nTaps = 0;
+  _flat  = TRUE;
+  _support = new char[ks*kr*kc];
+
+  unsigned a, b, d, i = 0;
+  for (a = 0; a < ks; a++)
+    for (b = 0; b < kr; b++)
+      for (d = 0; d < kc; d++, i++) {
+	_support[i] = (strel[a][b][d] >= 0);
+	if (_support[i]) {
+	  _nTaps++;
+	  if (strel[a][b][d] != 0)
+	    _flat = FALSE;
+	}
+      }
+
+  _offset = new int[3*_nTaps];
+  _weight = new double[_nTaps];
+
+  for (a = 0, i = 0; a < ks; a++)
+    for (b = 0; b < kr; b++)
+      for (d = 0; d < kc; d++)
+	if (strel[a][b][d] >= 0) {
+	  _offset[3*i]     = int(a) - int(ks/2);
+	  _offset[3*i + 1] = int(b) - int(kr/2);
+	  _offset[3*i + 2] = int(d) - int(kc/2);
+	  _weight[i++]     = strel[a][b][d];
+	}
+}
+
+CompiledStrel::CompiledStrel(const CompiledStrel& strel)
+{
+  _copy(strel);
+}
+
+CompiledStrel::~CompiledStrel()
+{
+  delete [] _offset;
+  delete [] _weight;
+  delete [] _support;
+}
+
+CompiledStrel&
+CompiledStrel::operator = (const CompiledStrel& strel)
+{
+  if (this != &strel) {
+    delete [] _offset;
+    delete [] _weight;
+    delete [] _support;
+    _copy(strel);
+  }
+
+  return *this;
+}
+
+void
+CompiledStrel::_copy(const CompiledStrel& strel)
+{
+  _ks    = strel._ks;
+  _kr    = strel._kr;
+  _kc    = strel._kc;
+  _nTaps = strel._nTaps;
+  _flat  = strel._flat;
+
+  _offset  = new int[3*_nTaps];
+  _weight  = new double[_nTaps];
+  _support = new char[_ks*_kr*_kc];
+
+  unsigned i;
+  for (i = 0; i < 3*_nTaps; i++)
+    _offset[i] = strel._offset[i];
+  for (i = 0; i < _nTaps; i++)
+    _weight[i] = strel._weight[i];
+  for (i = 0; i < _ks*_kr*_kc; i++)
+    _support[i] = strel._support[i];
+}
+
+ResampleTable::ResampleTable(unsigned nIn, unsigned nOut, double step, double origin,
+			     ResampleKernel kernel, BorderMode border,
+			     Boolean antialias)
+{
+  _nIn  = nIn;
+  _nOut = nOut;
+
+  // Kernel stretch and support, in input samples
+  const double stretch = (antialias && (step > 1)) ? step : 1;
+  const double support = resampleSupport(kernel)*stretch;
+
+  _nTaps  = (kernel == RESAMPLE_NEAREST) ? 1 : unsigned(ceil(2*support)) + 1;
+  _index  = new int[_nOut*_nTaps];
+  _weight = new double[_nOut*_nTaps];
+
+  for (unsigned i = 0; i < _nOut; i++) {
+    const double x      = origin + i*step;
+    int          *index  = _index + i*_nTaps;
+    double       *weight = _weight + i*_nTaps;
+
+    if (kernel == RESAMPLE_NEAREST) {
+      index[0]  = borderIndex(int(floor(x + 0.5)), _nIn, border);
+      weight[0] = 1;
+      continue;
+    }
+
+    const int first = int(ceil(x - support));
+    double    sum   = 0;
+    unsigned  t;
+    for (t = 0; t < _nTaps; t++) {
+      index[t]  = borderIndex(first + int(t), _nIn, border);
+      weight[t] = resampleWeight(kernel, (first + int(t) - x)/stretch);
+      sum += weight[t];
+    }
+    if (sum != 0)
+      for (t = 0; t < _nTaps; t++)
+	weight[t] /= sum;
+  }
+}
+
+ResampleTable::ResampleTable(const ResampleTable& table)
+{
+  _copy(table);
+}
+
+ResampleTable::~ResampleTable()
+{
+  delete [] _index;
+  delete [] _weight;
+}
+
+ResampleTable&
+ResampleTable::operator = (const ResampleTable& table)
+{
+  if (this != &table) {
+    delete [] _index;
+    delete [] _weight;
+    _copy(table);
+  }
+
+  return *this;
+}
+
+Boolean
+ResampleTable::isIdentity() const
+{
+  if (_nIn != _nOut)
+    return FALSE;
+
+  for (unsigned i = 0; i < _nOut; i++) {
+    double self = 0;
+    for (unsigned t = 0; t < _nTaps; t++) {
+      const double w = _weight[i*_nTaps + t];
+      if (_index[i*_nTaps + t] == int(i))
+	self += w;
+      else if (fabs(w) > 1e-12)
+	return FALSE;
+    }
+    if (fabs(self - 1) > 1e-12)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+void
+ResampleTable::_copy(const ResampleTable& table)
+{
+  _nIn    = table._nIn;
+  _nOut   = table._nOut;
+  _nTaps  = table._nTaps;
+  _index  = new int[_nOut*_nTaps];
+  _weight = new double[_nOut*_nTaps];
+
+  for (unsigned i = 0; i < _nOut*_nTaps; i++) {
+    _index[i]  = table._index[i];
+    _weight[i] = table._weight[i];
+  }
+}
+
+IIRFilter::IIRFilter(const double *b, unsigned nb, const double *a, unsigned na)
+{
+  _order = 0;
+  _b = _a = _zi = 0;
+
+  if (!nb || !na || (a[0] == 0)) {
+    cerr << "IIRFilter: the first denominator coefficient must be non-zero" << endl;
+    return;
+  }
+
+  unsigned i, j, k;
+
+  _order = ((na > nb) ? na : nb) - 1;
+  _b  = new double[_order + 1];
+  _a  = new double[_order + 1];
+  _zi = new double[_order + 1];
+  for (i = 0; i <= _order; i++) {
+    _b[i] = (i < nb) ? b[i]/a[0] : 0;
+    _a[i] = (i < na) ? a[i]/a[0] : 0;
+  }
+
+  // Steady state for a unit step: solve (I - C^T) zi = b[1:] - a[1:]*b[0],
+  // with C the companion matrix of a, by Gaussian elimination
+  const unsigned n = _order;
+  double *M = new double[n*(n + 1)]; // n rows of n + 1 (right-hand side)
+  for (i = 0; i < n; i++) {
+    double *row = M + i*(n + 1);
+    for (j = 0; j < n; j++)
+      row[j] = (i == j);
+    row[0] += _a[i + 1];
+    if (i + 1 < n)
+      row[i + 1] -= 1;
+    row[n] = _b[i + 1] - _a[i + 1]*_b[0];
+  }
+
+  Boolean singular = FALSE;
+  for (k = 0; k < n && !singular; k++) {
+    unsigned pivot = k;
+    for (i = k + 1; i < n; i++)
+      if (fabs(M[i*(n + 1) + k]) > fabs(M[pivot*(n + 1) + k]))
+	pivot = i;
+    if (fabs(M[pivot*(n + 1) + k]) < 1e-300) {
+      singular = TRUE;
+      break;
+    }
+    if (pivot != k)
+      for (j = 0; j <= n; j++) {
+	const double t = M[k*(n + 1) + j];
+	M[k*(n + 1) + j] = M[pivot*(n + 1) + j];
+	M[pivot*(n + 1) + j] = t;
+      }
+    for (i = k + 1; i < n; i++) {
+      const double f = M[i*(n + 1) + k]/M[k*(n + 1) + k];
+      for (j = k; j <= n; j++)
+	M[i*(n + 1) + j] -= f*M[k*(n + 1) + j];
+    }
+  }
+
+  // A pole at z = 1 has no steady state; start from zero instead
+  for (i = n; i-- > 0;) {
+    double sum = M[i*(n + 1) + n];
+    for (j = i + 1; j < n; j++)
+      sum -= M[i*(n + 1) + j]*_zi[j];
+    _zi[i] = singular ? 0 : sum/M[i*(n + 1) + i];
+  }
+
+  delete [] M;
+}
+
+IIRFilter::IIRFilter(const IIRFilter& filter)
+{
+  _copy(filter);
+}
+
+IIRFilter::~IIRFilter()
+{
+  delete [] _b;
+  delete [] _a;
+  delete [] _zi;
+}
+
+IIRFilter&
+IIRFilter::operator = (const IIRFilter& filter)
+{
+  if (this != &filter) {
+    delete [] _b;
+    delete [] _a;
+    delete [] _zi;
+    _copy(filter);
+  }
+
+  return *this;
+}
+
+unsigned
+IIRFilter::padding(unsigned n) const
+{
+  const unsigned pad = 3*_order;
+  return (n > pad) ? pad : (n ? n - 1 : 0);
+}
+
+void
+IIRFilter::_copy(const IIRFilter& filter)
+{
+  _order = filter._order;
+  _b = _a = _zi = 0;
+
+  if (!filter.isValid())
+    return;
+
+  _b  = new double[_order + 1];
+  _a  = new double[_order + 1];
+  _zi = new double[_order + 1];
+  for (unsigned i = 0; i <= _order; i++) {
+    _b[i]  = filter._b[i];
+    _a[i]  = filter._a[i];
+    _zi[i] = filter._zi[i];
+  }
+}
+
+RecursiveGaussian::RecursiveGaussian(double sigma)
+{
+  _sigma = sigma;
+  if (sigma <= 0) {
+    // Unused by filter()
+    _a[0] = _a[1] = _a[2] = 0;
+    _B = 1;
+    for (unsigned i = 0; i < 3; i++)
+      for (unsigned k = 0; k < 4; k++)
+	_M[i][k] = (k == 3);
+    return;
+  }
+
+  // Poles of the third-order filter for sigma = 2, optimized in the L2 norm
+  // (van Vliet, Young and Verbeek, 1998). Other scales are obtained as
+  // d^(1/q); q is solved for (by bisection) such that the variance of the
+  // causal/anti-causal pair, 2*sum(d/(d - 1)^2), equals sigma^2.
+  const dcomplex d1(1.40098, 1.00236);
+  const double   d3 = 1.85132;
+  double lo = 0.01, hi = 2*sigma + 2, q = 1;
+  for (unsigned iter = 0; iter < 64; iter++) {
+    q = (lo + hi)/2;
+    const dcomplex dq = polar(pow(abs(d1), 1/q), arg(d1)/q);
+    const double   rq = pow(d3, 1/q);
+    const double   variance = 4*real(dq/((dq - 1.0)*(dq - 1.0))) + 2*rq/((rq - 1)*(rq - 1));
+    if (variance < sigma*sigma)
+      lo = q;
+    else
+      hi = q;
+  }
+
+  // Causal recursion y[n] = B x[n] + a1 y[n-1] + a2 y[n-2] + a3 y[n-3], with
+  // poles p = 1/d inside the unit circle
+  const dcomplex p1 = 1.0/polar(pow(abs(d1), 1/q), arg(d1)/q);
+  const double   p3 = 1/pow(d3, 1/q);
+  _a[0] = 2*real(p1) + p3;
+  _a[1] = -(norm(p1) + 2*real(p1)*p3);
+  _a[2] = norm(p1)*p3;
+  _B    = 1 - _a[0] - _a[1] - _a[2];
+
+  // The anti-causal initial values are linear in the last three causal
+  // outputs and the (constant) input beyond the end. Obtain each column of
+  // _M by running both passes over a long extension, until the responses
+  // have decayed.
+  const unsigned L = 70*unsigned(q + 1) + 100;
+  double *w = new double[L + 3];
+  double *y = new double[L + 3];
+  for (unsigned k = 0; k < 4; k++) {
+    // w[0..2] are w[n-3], w[n-2], w[n-1]; w[3 + i] is w[n + i]
+    const double u = (k == 3) ? 1 : 0;
+    w[0] = (k == 2) ? 1 : 0;
+    w[1] = (k == 1) ? 1 : 0;
+    w[2] = (k == 0) ? 1 : 0;
+    unsigned i;
+    for (i = 3; i < L + 3; i++)
+      w[i] = _B*u + _a[0]*w[i - 1] + _a[1]*w[i - 2] + _a[2]*w[i - 3];
+    for (i = L; i < L + 3; i++)
+      y[i] = u;
+    for (i = L; i-- > 3;)
+      y[i] = _B*w[i] + _a[0]*y[i + 1] + _a[1]*y[i + 2] + _a[2]*y[i + 3];
+    for (i = 0; i < 3; i++)
+      _M[i][k] = y[3 + i];
+  }
+  delete [] w;
+  delete [] y;
+}
+
+template <class Real>
+void
+FFTPlan::_transform(unsigned batch, Real *real, Real *imag,
+		    const Real *cosTable, const Real *sinTable, Real sign) const
+{
+  unsigned b;
+
+  // Bit-reversal permutation of whole batch rows
+  for (unsigned j = 0; j < _n; j++) {
+    unsigned k = _bitReverse[j];
+    if (k > j) {
+      Real *re1 = real + j*batch, *re2 = real + k*batch;
+      Real *im1 = imag + j*batch, *im2 = imag + k*batch;
+      for (b = 0; b < batch; b++) {
+	Real t;
+	t = re1[b]; re1[b] = re2[b]; re2[b] = t;
+	t = im1[b]; im1[b] = im2[b]; im2[b] = t;
+      }
+    }
+  }
+
+  // Radix-2 butterflies; the innermost loop runs over the batch
+  for (unsigned half = 1; half < _n; half *= 2) {
+    unsigned step = _n/(2*half);
+    for (unsigned start = 0; start < _n; start += 2*half)
+      for (unsigned m = 0; m < half; m++) {
+	const Real wr = cosTable[m*step];
+	const Real wi = sign*sinTable[m*step];
+	Real *re1 = real + (start + m)*batch, *re2 = re1 + half*batch;
+	Real *im1 = imag + (start + m)*batch, *im2 = im1 + half*batch;
+	for (b = 0; b < batch; b++) {
+	  Real tr = wr*re2[b] - wi*im2[b];
+	  Real ti = wr*im2[b] + wi*re2[b];
+	  re2[b] = re1[b] - tr;
+	  im2[b] = im1[b] - ti;
+	  re1[b] += tr;
+	  im1[b] += ti;
+	}
+      }
+  }
+}
+
+template void FFTPlan::_transform(unsigned, double *, double *, const double *,
+				  const double *, double) const;
+template void FFTPlan::_transform(unsigned, float *, float *, const float *,
+				  const float *, float) const;
+
+void
+fftAxis(unsigned axis, unsigned n0, unsigned n1, unsigned n2,
+	double *real, double *imag, int inverse)
+{
+  if (axis < 2) {
+    // Slices or rows: the signals are already interleaved
+    unsigned n      = (axis == 0) ? n0 : n1;
+    unsigned batch  = (axis == 0) ? n1*n2 : n2;
+    unsigned nOuter = (axis == 0) ? 1 : n0;
+    assert(!(n & (n - 1)));
+    FFTPlan  plan(n);
+    for (unsigned outer = 0; outer < nOuter; outer++) {
+      double *realPtr = real + (unsigned long) outer*n*batch;
+      double *imagPtr = imag + (unsigned long) outer*n*batch;
+      if (inverse)
+	plan.ifft(batch, realPtr, imagPtr);
+      else
+	plan.fft(batch, realPtr, imagPtr);
+    }
+    return;
+  }
+
+  // Columns: gather FFT_BATCH rows at a time into interleaved form
+  assert(!(n2 & (n2 - 1)));
+  FFTPlan plan(n2);
+  unsigned long nRows = (unsigned long) n0*n1;
+  double *re = new double[n2*FFT_BATCH];
+  double *im = new double[n2*FFT_BATCH];
+
+  for (unsigned long row0 = 0; row0 < nRows; row0 += FFT_BATCH) {
+    unsigned batch = (nRows - row0 < FFT_BATCH) ? unsigned(nRows - row0) : FFT_BATCH;
+    unsigned b, j;
+    for (b = 0; b < batch; b++) {
+      const double *realPtr = real + (row0 + b)*n2;
+      const double *imagPtr = imag + (row0 + b)*n2;
+      for (j = 0; j < n2; j++) {
+	re[j*batch + b] = realPtr[j];
+	im[j*batch + b] = imagPtr[j];
+      }
+    }
+    if (inverse)
+      plan.ifft(batch, re, im);
+    else
+      plan.fft(batch, re, im);
+    for (b = 0; b < batch; b++) {
+      double *realPtr = real + (row0 + b)*n2;
+      double *imagPtr = imag + (row0 + b)*n2;
+      for (j = 0; j < n2; j++) {
+	realPtr[j] = re[j*batch + b];
+	imagPtr[j] = im[j*batch + b];
+      }
+    }
+  }
+
+  delete [] re;
+  delete [] im;
+}
+
 void 
 inferDimensions(unsigned long nElements, unsigned& nrows, unsigned& ncols)
 {
@@ -20,6 +20,9 @@ $State: Exp $
 #ifndef _MATRIX_SUPPORT_H
 #define _MATRIX_SUPPORT_H
 
+#include <math.h>
+#include "MTypes.h"
+#include "trivials.h"
 #ifdef USE_COMPMAT
   #include "dcomplex.h"
 #endif
@@ -29,6 +32,443 @@ $State: Exp $
 
 typedef void (*FFTFUNC)(int n, double *real, double *imag);
 
+// Convolution algorithms. CONV_AUTO selects the cheapest one for the
+// image and kernel involved; the others force a specific method.
+enum ConvolutionMethod { CONV_AUTO, CONV_DIRECT, CONV_SEPARABLE, CONV_FFT };
+
+// Treatment of samples outside an image: zero, the nearest edge sample,
+// mirrored about the edge (the edge sample repeated), or periodic.
+enum BorderMode { BORDER_ZERO, BORDER_CLAMP, BORDER_MIRROR, BORDER_WRAP };
+
+// Interpolation kernels for resampling: nearest neighbour, linear, cubic
+// (Keys, a = -0.5) and windowed sinc (Lanczos, 3 lobes)
+enum ResampleKernel { RESAMPLE_NEAREST, RESAMPLE_LINEAR, RESAMPLE_CUBIC, RESAMPLE_LANCZOS };
+
+// Value of an interpolation kernel at offset x, and its support (half width)
+inline double resampleWeight(ResampleKernel kernel, double x) {
+  x = fabs(x);
+  switch (kernel) {
+  case RESAMPLE_LINEAR:
+    return (x < 1) ? 1 - x : 0;
+  case RESAMPLE_CUBIC:
+    if (x < 1)
+      return (1.5*x - 2.5)*x*x + 1;
+    if (x < 2)
+      return ((-0.5*x + 2.5)*x - 4)*x + 2;
+    return 0;
+  case RESAMPLE_LANCZOS:
+    if (x < 1e-12)
+      return 1;
+    if (x < 3)
+      return 3*sin(M_PI*x)*sin(M_PI*x/3)/(M_PI*M_PI*x*x);
+    return 0;
+  default:
+    return (x < 0.5) ? 1 : 0;
+  }
+}
+
+inline double resampleSupport(ResampleKernel kernel) {
+  switch (kernel) {
+  case RESAMPLE_LINEAR:  return 1;
+  case RESAMPLE_CUBIC:   return 2;
+  case RESAMPLE_LANCZOS: return 3;
+  default:               return 0.5;
+  }
+}
+
+// Maps index i to the sample it refers to in a line of n samples, or returns
+// -1 if it refers to a zero outside the line
+inline int borderIndex(int i, unsigned n, BorderMode border) {
+  if ((i >= 0) && (i < int(n)))
+    return i;
+  switch (border) {
+  case BORDER_CLAMP:
+    return (i < 0) ? 0 : int(n) - 1;
+  case BORDER_MIRROR: {
+    int period = 2*int(n);
+    i %= period;
+    if (i < 0) i += period;
+    return (i < int(n)) ? i : period - 1 - i; }
+  case BORDER_WRAP:
+    i %= int(n);
+    return (i < 0) ? i + int(n) : i;
+  default:
+    return -1;
+  }
+}
+
+// Returns the method used to convolve a (nslis x nrows x ncols) image with a
+// (kslis x krows x kcols) kernel, which may or may not be separable. Any
+// method other than CONV_AUTO is returned as is.
+ConvolutionMethod convolutionMethod(unsigned nslis, unsigned nrows, unsigned ncols,
+				    unsigned kslis, unsigned krows, unsigned kcols,
+				    ConvolutionMethod method = CONV_AUTO,
+				    Boolean separable = FALSE);
+
+// Returns the (power of 2) transform length used for overlap-save FFT 
+// convolution of a signal of length n with a kernel of length k, or 0 if
+// no transform is required along that dimension (k == 1).
+unsigned fftConvolutionLength(unsigned n, unsigned k);
+
+// Plan for batched 1D FFTs of length n (a power of 2; any other n is
+// increased to the next power of 2, with a warning, as in Mat::fft()). The
+// signals of a batch are interleaved, i.e. sample j of signal b is stored
+// at [j*batch + b], so that every butterfly operates on all signals at once
+// along a contiguous inner loop. A plan can be shared by any number of
+// transforms. The sign convention matches fft(); like ifft(), the inverse
+// transform is not normalized. Single-precision signals are transformed
+// entirely in float.
+//
+// fft() and ifft() transform length() samples per signal, so real and imag
+// must hold length()*batch values each; when n was rounded up, the caller
+// pads its signals to length() (as Mat::fftRows() does).
+class FFTPlan {
+public:
+  FFTPlan(unsigned n);
+  ~FFTPlan();
+
+  unsigned length() const { return _n; }
+
+  void fft(unsigned batch, double *real, double *imag) const {
+    _transform(batch, real, imag, _cos, _sin, -1.0); }
+  void ifft(unsigned batch, double *real, double *imag) const {
+    _transform(batch, real, imag, _cos, _sin, 1.0); }
+  void fft(unsigned batch, float *real, float *imag) const {
+    _transform(batch, real, imag, _cosf, _sinf, -1.0f); }
+  void ifft(unsigned batch, float *real, float *imag) const {
+    _transform(batch, real, imag, _cosf, _sinf, 1.0f); }
+
+private:
+  unsigned  _n;
+  unsigned *_bitReverse;
+  double   *_cos;
+  double   *_sin;
+  float    *_cosf;
+  float    *_sinf;
+
+  template <class Real>
+  void _transform(unsigned batch, Real *real, Real *imag,
+		  const Real *cosTable, const Real *sinTable, Real sign) const;
+
+  // Not copyable
+  FFTPlan(const FFTPlan&);
+  FFTPlan& operator = (const FFTPlan&);
+};
+
+// Number of signals transformed together when a batch has to be gathered
+// from non-interleaved data
+const unsigned FFT_BATCH = 16;
+
+// In-place FFT (or unnormalized inverse FFT) along one axis (0 = slices,
+// 1 = rows, 2 = columns) of a contiguous (n0 x n1 x n2) complex array. The
+// length along the axis must be a power of 2 (asserted).
+void fftAxis(unsigned axis, unsigned n0, unsigned n1, unsigned n2,
+	     double *real, double *imag, int inverse = 0);
+
+// A greylevel structuring element compiled for erode() and dilate(): the
+// list of active taps (strel values >= 0; negative values are ignored) with
+// their offsets from the strel origin at (ks/2, kr/2, kc/2) and their
+// weights. Compiling once avoids rescanning the strel on every call.
+class CompiledStrel {
+public:
+  CompiledStrel(const double * const * const *strel,
+		unsigned ks, unsigned kr, unsigned kc);
+  CompiledStrel(const CompiledStrel&);
+  ~CompiledStrel();
+  CompiledStrel& operator = (const CompiledStrel&);
+
+  // Bounding box of the original strel
+  unsigned getslis() const { return _ks; }
+  unsigned getrows() const { return _kr; }
+  unsigned getcols() const { return _kc; }
+
+  // Active taps
+  unsigned nTaps()                 const { return _nTaps; }
+  int      sliceOffset(unsigned i) const { return _offset[3*i]; }
+  int      rowOffset(unsigned i)   const { return _offset[3*i + 1]; }
+  int      colOffset(unsigned i)   const { return _offset[3*i + 2]; }
+  double   weight(unsigned i)      const { return _weight[i]; }
+
+  // Flat strels have all active weights equal to 0
+  Boolean  isFlat() const { return _flat; }
+  // Active taps as a (ks x kr x kc) mask
+  const char *support() const { return _support; }
+
+private:
+  unsigned  _ks, _kr, _kc;
+  unsigned  _nTaps;
+  int      *_offset;
+  double   *_weight;
+  char     *_support;
+  Boolean   _flat;
+
+  void _copy(const CompiledStrel&);
+};
+
+// Weights for resampling a line of nIn samples to nOut samples: output
+// sample i is taken at input position origin + i*step, and is the sum over
+// t < nTaps() of weight(i, t) * input[index(i, t)] (index -1 meaning a zero
+// outside the line, per the border mode). Weights are normalized to a sum of
+// 1. With antialias set, the kernel is widened by step when step > 1.
+class ResampleTable {
+public:
+  ResampleTable(unsigned nIn, unsigned nOut, double step, double origin,
+		ResampleKernel kernel = RESAMPLE_LINEAR,
+		BorderMode border = BORDER_CLAMP, Boolean antialias = TRUE);
+  ResampleTable(const ResampleTable&);
+  ~ResampleTable();
+  ResampleTable& operator = (const ResampleTable&);
+
+  unsigned nIn()   const { return _nIn; }
+  unsigned nOut()  const { return _nOut; }
+  unsigned nTaps() const { return _nTaps; }
+  const int    *index(unsigned i)  const { return _index + i*_nTaps; }
+  const double *weight(unsigned i) const { return _weight + i*_nTaps; }
+  int      index(unsigned i, unsigned t)  const { return _index[i*_nTaps + t]; }
+  double   weight(unsigned i, unsigned t) const { return _weight[i*_nTaps + t]; }
+
+  // TRUE if every output sample is the input sample of the same index
+  Boolean  isIdentity() const;
+
+private:
+  unsigned  _nIn, _nOut, _nTaps;
+  int      *_index;
+  double   *_weight;
+
+  void _copy(const ResampleTable&);
+};
+
+// Young-van Vliet recursive Gaussian filter for a given sigma (in samples):
+// a causal and an anti-causal pass of third order, at a cost independent of
+// sigma. The filter has a variance of exactly sigma^2; a sigma of 0 leaves
+// the signal unsmoothed. The signal is taken to be constant beyond both ends;
+// the anti-causal pass is initialized exactly for that extension (Triggs and
+// Sdika), through a matrix computed once here.
+class RecursiveGaussian {
+public:
+  RecursiveGaussian(double sigma);
+
+  double sigma() const { return _sigma; }
+
+  // Filters batch interleaved lines of n samples in place; sample j of line
+  // b is at data[j*stride + b]. The inner loops run over the batch. Order 0
+  // smooths; orders 1 and 2 follow with the central differences
+  // (y[j+1] - y[j-1])/2 and y[j+1] - 2y[j] + y[j-1], where y[-1] and y[n]
+  // are the smoothed values beyond the ends. work must hold 5*batch elements.
+  template <class Acc>
+  void filter(Acc *data, unsigned n, unsigned long stride, unsigned batch,
+	      unsigned order, Acc *work) const;
+
+private:
+  double _sigma;
+  double _B, _a[3];
+  double _M[3][4]; // (w[n-1], w[n-2], w[n-3], x[n-1]) -> (y[n], y[n+1], y[n+2])
+};
+
+template <class Acc>
+void
+RecursiveGaussian::filter(Acc *data, unsigned n, unsigned long stride,
+			  unsigned batch, unsigned order, Acc *work) const
+{
+  if (!n || !batch)
+    return;
+
+  Acc *first = work, *last = work + batch;
+  Acc *init[3] = { work + 2*batch, work + 3*batch, work + 4*batch };
+  unsigned b;
+  int j;
+
+  for (b = 0; b < batch; b++) {
+    first[b] = data[b];
+    last[b]  = data[(n - 1)*stride + b];
+  }
+
+  if (_sigma > 0) {
+    // Causal pass; w[-k] = x[0]
+    for (j = 0; j < int(n); j++) {
+      Acc       *x  = data + j*stride;
+      const Acc *w1 = (j >= 1) ? x - stride : first;
+      const Acc *w2 = (j >= 2) ? x - 2*stride : first;
+      const Acc *w3 = (j >= 3) ? x - 3*stride : first;
+      for (b = 0; b < batch; b++)
+	x[b] = _B*x[b] + _a[0]*w1[b] + _a[1]*w2[b] + _a[2]*w3[b];
+    }
+
+    // Anti-causal initialization
+    const Acc *w1 = data + (n - 1)*stride;
+    const Acc *w2 = (n >= 2) ? w1 - stride : first;
+    const Acc *w3 = (n >= 3) ? w1 - 2*stride : first;
+    for (unsigned k = 0; k < 3; k++)
+      for (b = 0; b < batch; b++)
+	init[k][b] = _M[k][0]*w1[b] + _M[k][1]*w2[b] + _M[k][2]*w3[b] + _M[k][3]*last[b];
+
+    // Anti-causal pass; y[n + k] = init[k]
+    for (j = int(n) - 1; j >= -1; j--) {
+      Acc       *x  = (j >= 0) ? data + j*stride : first;
+      const Acc *y1 = (j + 1 < int(n)) ? data + (j + 1)*stride : init[j + 1 - int(n)];
+      const Acc *y2 = (j + 2 < int(n)) ? data + (j + 2)*stride : init[j + 2 - int(n)];
+      const Acc *y3 = (j + 3 < int(n)) ? data + (j + 3)*stride : init[j + 3 - int(n)];
+      // j = -1 gives y[-1] in first, as w[-1] = x[0]
+      if (j >= 0 || order)
+	for (b = 0; b < batch; b++)
+	  x[b] = _B*x[b] + _a[0]*y1[b] + _a[1]*y2[b] + _a[2]*y3[b];
+    }
+  }
+  else
+    for (b = 0; b < batch; b++)
+      init[0][b] = last[b];
+
+  if (!order)
+    return;
+
+  // Central differences; first holds y[j-1]
+  for (j = 0; j < int(n); j++) {
+    Acc       *x    = data + j*stride;
+    const Acc *next = (j + 1 < int(n)) ? x + stride : init[0];
+    for (b = 0; b < batch; b++) {
+      const Acc y = x[b];
+      x[b] = (order == 1) ? (next[b] - first[b])*0.5 : next[b] - 2.0*y + first[b];
+      first[b] = y;
+    }
+  }
+}
+
+// Rational (IIR) filter y = (B/A)*x, given by its numerator b and denominator
+// a as in Matlab's filter(); the coefficients are normalized by a[0], which
+// must be non-zero (isValid() is FALSE otherwise). Lines are filtered in
+// direct form II transposed, whose state holds order() values per line.
+class IIRFilter {
+public:
+  IIRFilter(const double *b, unsigned nb, const double *a, unsigned na);
+  IIRFilter(const IIRFilter&);
+  ~IIRFilter();
+  IIRFilter& operator = (const IIRFilter&);
+
+  Boolean  isValid() const { return _b != 0; }
+  unsigned order()   const { return _order; }
+  // State reached after a unit step input (Matlab's zi); scaled by the first
+  // sample, it starts a line without the transient of a zero state
+  const double *steadyState() const { return _zi; }
+  // Length of the odd reflections used by applyZeroPhase() (Matlab's
+  // filtfilt(): 3*order(), limited to n - 1)
+  unsigned padding(unsigned n) const;
+
+  // Filters batch interleaved lines of n samples in place; sample j of line
+  // b is at data[j*stride + b] (stride may be negative, to run backward).
+  // The inner loops run over the batch. state holds order() rows of batch
+  // elements, with the initial state on entry and the final one on return;
+  // work holds batch elements.
+  template <class Acc>
+  void apply(Acc *data, unsigned n, long stride, unsigned batch,
+	     Acc *state, Acc *work) const;
+
+  // Zero-phase filtering, as Matlab's filtfilt(): forward and backward over
+  // the lines extended by padding(n) samples at both ends, from steady-state
+  // initial conditions. ext holds (n + 2*padding(n))*batch elements, work
+  // (order() + 1)*batch.
+  template <class Acc>
+  void applyZeroPhase(Acc *data, unsigned n, long stride, unsigned batch,
+		      Acc *ext, Acc *work) const;
+
+private:
+  unsigned  _order;
+  double   *_b, *_a; // _order + 1 coefficients each, _a[0] = 1
+  double   *_zi;     // _order
+
+  void _copy(const IIRFilter&);
+};
+
+template <class Acc>
+void
+IIRFilter::apply(Acc *data, unsigned n, long stride, unsigned batch,
+		 Acc *state, Acc *work) const
+{
+  if (!isValid())
+    return;
+
+  unsigned b, k;
+
+  for (unsigned j = 0; j < n; j++) {
+    Acc *x = data + long(j)*stride;
+
+    if (!_order) {
+      for (b = 0; b < batch; b++)
+	x[b] = _b[0]*x[b];
+      continue;
+    }
+
+    // y = b0*x + z0; z_k = b_(k+1)*x + z_(k+1) - a_(k+1)*y
+    Acc *y = work;
+    for (b = 0; b < batch; b++)
+      y[b] = _b[0]*x[b] + state[b];
+    for (k = 0; k + 1 < _order; k++) {
+      Acc       *z     = state + k*batch;
+      const Acc *zNext = z + batch;
+      for (b = 0; b < batch; b++)
+	z[b] = _b[k + 1]*x[b] + zNext[b] - _a[k + 1]*y[b];
+    }
+    Acc *z = state + (_order - 1)*batch;
+    for (b = 0; b < batch; b++) {
+      z[b] = _b[_order]*x[b] - _a[_order]*y[b];
+      x[b] = y[b];
+    }
+  }
+}
+
+template <class Acc>
+void
+IIRFilter::applyZeroPhase(Acc *data, unsigned n, long stride, unsigned batch,
+			  Acc *ext, Acc *work) const
+{
+  if (!isValid() || !n)
+    return;
+
+  const unsigned pad    = padding(n);
+  const unsigned nExt   = n + 2*pad;
+  const Acc     *first  = data;
+  const Acc     *last   = data + long(n - 1)*stride;
+  Acc           *state  = work + batch;
+  unsigned b, i, k;
+
+  for (i = 0; i < n; i++) {
+    const Acc *x = data + long(i)*stride;
+    Acc       *e = ext + (pad + i)*batch;
+    for (b = 0; b < batch; b++)
+      e[b] = x[b];
+  }
+  for (i = 0; i < pad; i++) {
+    const Acc *left  = data + long(pad - i)*stride;
+    const Acc *right = data + long(n - 2 - i)*stride;
+    Acc       *eLeft  = ext + i*batch;
+    Acc       *eRight = ext + (pad + n + i)*batch;
+    for (b = 0; b < batch; b++) {
+      eLeft[b]  = 2.0*first[b] - left[b];
+      eRight[b] = 2.0*last[b] - right[b];
+    }
+  }
+
+  // Forward
+  const Acc *e0 = ext;
+  for (k = 0; k < _order; k++)
+    for (b = 0; b < batch; b++)
+      state[k*batch + b] = _zi[k]*e0[b];
+  apply(ext, nExt, long(batch), batch, state, work);
+
+  // Backward
+  Acc *eLast = ext + (nExt - 1)*batch;
+  for (k = 0; k < _order; k++)
+    for (b = 0; b < batch; b++)
+      state[k*batch + b] = _zi[k]*eLast[b];
+  apply(eLast, nExt, -long(batch), batch, state, work);
+
+  for (i = 0; i < n; i++) {
+    Acc       *x = data + long(i)*stride;
+    const Acc *e = ext + (pad + i)*batch;
+    for (b = 0; b < batch; b++)
+      x[b] = e[b];
+  }
+}
+
 //c functions declaration:
 // double gauss(double mean, double std_dev);
 
@@ -233,6 +673,42 @@ void freeArray(Type *&array)
   }
 }
 
+// Real type used by the FFT functions for each element type: float and
+// fcomplex data are transformed in single precision, everything else in
+// double precision
+template <class Type>
+struct FFTReal { typedef double Real; };
+template <>
+struct FFTReal<float> { typedef float Real; };
+#ifdef USE_FCOMPMAT
+template <>
+struct FFTReal<fcomplex> { typedef float Real; };
+#endif
+
+// Element conversions for the FFT functions. Complex elements keep the
+// complex result, others store its magnitude.
+template <class Type, class Real>
+inline void _fftLoad(const Type& value, Real& re, Real& im) {
+  re = Real(value); im = 0; }
+template <class Type, class Real>
+inline void _fftStore(Real re, Real im, Type& value) {
+  value = Type(sqrt(re*re + im*im)); }
+#ifdef USE_COMPMAT
+template <class Real>
+inline void _fftLoad(const dcomplex& value, Real& re, Real& im) {
+  re = Real(value.real()); im = Real(value.imag()); }
+template <class Real>
+inline void _fftStore(Real re, Real im, dcomplex& value) {
+  value = dcomplex(re, im); }
+#endif
+#ifdef USE_FCOMPMAT
+template <class Real>
+inline void _fftLoad(const fcomplex& value, Real& re, Real& im) {
+  re = Real(value.real()); im = Real(value.imag()); }
+template <class Real>
+inline void _fftStore(Real re, Real im, fcomplex& value) {
+  value = fcomplex(re, im); }
+#endif
 
 void inferDimensions(unsigned long nElements, unsigned& nrows, unsigned& ncols);
 void inferDimensions(unsigned long nElements, unsigned& nslis, unsigned& nrows, 
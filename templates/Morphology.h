@@ -0,0 +1,391 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _MORPHOLOGY_H
+#define _MORPHOLOGY_H
+
+/******************************************************************************
+ * Greylevel morphology shared by Mat<Type> and Mat3D<Type>. Images are
+ * passed as slice/row pointer arrays, as for the convolution kernels
+ * (Convolution.h). The conventions follow Mat::erode() and Mat::dilate():
+ * negative strel values are ignored, the strel origin is at
+ * (ks/2, kr/2, kc/2), and the image is surrounded by zeros:
+ *
+ *   erosion(s, r, c)  = min  input(s + a - ks/2, r + b - kr/2, c + d - kc/2)
+ *   dilation(s, r, c) = max  input(s - a + ks/2, r - b + kr/2, c - d + kc/2)
+ *
+ * over all strel elements (a, b, d) >= 0, with the strel value subtracted
+ * (erosion) or added (dilation). Strels are compiled into a list of active
+ * taps first (CompiledStrel, see MatrixSupport.h).
+ *   A strel is flat when all its active elements are 0. Running minima and
+ * maxima over a window of k samples are then computed with the van
+ * Herk/Gil-Werman algorithm, at about three comparisons per sample regardless
+ * of k. Box strels (including lines along an axis) are done as one such pass
+ * per dimension; other shapes, such as balls and diamonds, are decomposed
+ * into line segments along the columns, with one pass per distinct segment
+ * length and one comparison per segment.
+ *****************************************************************************/
+
+#include <algorithm>
+#include "MTypes.h"
+#include "MatrixSupport.h"
+#include "miscTemplateFunc.h"
+
+struct _MorphMin {
+  template <class Type>
+  static Type apply(const Type& a, const Type& b) { return (b < a) ? b : a; }
+};
+
+struct _MorphMax {
+  template <class Type>
+  static Type apply(const Type& a, const Type& b) { return (a < b) ? b : a; }
+};
+
+// Running minimum/maximum over a line: dst[x] = Op of src[start + x + t] over
+// 0 <= t < k, for 0 <= x < nOut; samples outside [0, n) are 0. The buffers g
+// and h hold nOut + k - 1 samples each. As all of src is read before dst is
+// written, dst may be src.
+template <class Op, class Type>
+void
+_morphLine(Type *dst, unsigned nOut, const Type *src, unsigned n, int start,
+	   unsigned k, Type *g, Type *h)
+{
+  const unsigned m = nOut + k - 1;
+  unsigned i, phase;
+
+  // Prefix (g) and suffix (h) runs within blocks of k samples
+  for (i = 0, phase = 0; i < m; i++) {
+    int j = start + int(i);
+    h[i] = ((j >= 0) && (j < int(n))) ? src[j] : Type(0);
+    g[i] = phase ? Op::apply(g[i - 1], h[i]) : h[i];
+    if (++phase == k)
+      phase = 0;
+  }
+  for (i = m - 1; i > 0; i--)
+    if (i % k)
+      h[i - 1] = Op::apply(h[i - 1], h[i]);
+
+  for (i = 0; i < nOut; i++)
+    dst[i] = Op::apply(h[i], g[i + k - 1]);
+}
+
+// As _morphLine(), for a line of n rows of width elements each (e.g., the
+// rows of a plane); the running minimum/maximum is taken element by element
+// across rows. The buffers g and h hold (nOut + k - 1) * width samples each.
+template <class Op, class Type>
+void
+_morphRows(Type * const *dst, unsigned nOut, const Type * const *src, unsigned n,
+	   unsigned width, int start, unsigned k, Type *g, Type *h)
+{
+  const unsigned m = nOut + k - 1;
+  unsigned i, phase, c;
+
+  for (i = 0, phase = 0; i < m; i++) {
+    int j = start + int(i);
+    Type *hRow = h + i*width;
+    Type *gRow = g + i*width;
+    if ((j >= 0) && (j < int(n))) {
+      const Type *srcRow = src[j];
+      for (c = 0; c < width; c++)
+	hRow[c] = srcRow[c];
+    }
+    else
+      for (c = 0; c < width; c++)
+	hRow[c] = Type(0);
+    if (phase) {
+      const Type *gPrev = gRow - width;
+      for (c = 0; c < width; c++)
+	gRow[c] = Op::apply(gPrev[c], hRow[c]);
+    }
+    else
+      for (c = 0; c < width; c++)
+	gRow[c] = hRow[c];
+    if (++phase == k)
+      phase = 0;
+  }
+  for (i = m - 1; i > 0; i--)
+    if (i % k) {
+      Type       *hRow  = h + (i - 1)*width;
+      const Type *hNext = h + i*width;
+      for (c = 0; c < width; c++)
+	hRow[c] = Op::apply(hRow[c], hNext[c]);
+    }
+
+  for (i = 0; i < nOut; i++) {
+    Type       *dstRow = dst[i];
+    const Type *hRow   = h + i*width;
+    const Type *gRow   = g + (i + k - 1)*width;
+    for (c = 0; c < width; c++)
+      dstRow[c] = Op::apply(hRow[c], gRow[c]);
+  }
+}
+
+// A segment of a strel row: columns [col, col + length) of row (slice, row)
+struct _MorphSegment {
+  unsigned slice, row, col, length;
+};
+
+template <class Op, class Type>
+void
+_morphologyFlat(Type ***out, const Type * const * const *in,
+		unsigned nslis, unsigned nrows, unsigned ncols,
+		const char *support, unsigned ks, unsigned kr, unsigned kc,
+		int oS, int oR, int oC)
+{
+  unsigned a, b, d, s, r;
+  unsigned nSupport = 0;
+  for (d = 0; d < ks*kr*kc; d++)
+    if (support[d])
+      nSupport++;
+
+  if (nSupport == ks*kr*kc) {
+    // Box: one pass per dimension
+    unsigned maxLength = ::max(nslis + ks, nrows + kr, ncols + kc);
+    Type *g = new Type[maxLength*ncols];
+    Type *h = new Type[maxLength*ncols];
+
+    for (s = 0; s < nslis; s++)
+      for (r = 0; r < nrows; r++)
+	_morphLine<Op>(out[s][r], ncols, in[s][r], ncols, -oC, kc, g, h);
+
+    if (kr > 1)
+      for (s = 0; s < nslis; s++)
+	_morphRows<Op>(out[s], nrows, out[s], nrows, ncols, -oR, kr, g, h);
+
+    if (ks > 1) {
+      Type **slicePtr = new Type*[nslis];
+      for (r = 0; r < nrows; r++) {
+	for (s = 0; s < nslis; s++)
+	  slicePtr[s] = out[s][r];
+	_morphRows<Op>(slicePtr, nslis, slicePtr, nslis, ncols, -oS, ks, g, h);
+      }
+      delete [] slicePtr;
+    }
+
+    delete [] g;
+    delete [] h;
+    return;
+  }
+
+  // Decompose the strel into segments along the columns, sorted by length
+  _MorphSegment *segment = new _MorphSegment[nSupport];
+  unsigned nSegments = 0;
+  for (a = 0; a < ks; a++)
+    for (b = 0; b < kr; b++) {
+      const char *supportRow = support + (a*kr + b)*kc;
+      for (d = 0; d < kc; d++)
+	if (supportRow[d] && (!d || !supportRow[d - 1])) {
+	  _MorphSegment& seg = segment[nSegments++];
+	  seg.slice  = a;
+	  seg.row    = b;
+	  seg.col    = d;
+	  seg.length = 1;
+	  while ((d + seg.length < kc) && supportRow[d + seg.length])
+	    seg.length++;
+	}
+    }
+  for (d = 1; d < nSegments; d++)
+    for (a = d; (a > 0) && (segment[a].length < segment[a - 1].length); a--) {
+      _MorphSegment tmp = segment[a];
+      segment[a] = segment[a - 1];
+      segment[a - 1] = tmp;
+    }
+
+  // Running minima/maxima of every input row over each segment length, for
+  // the column offsets -oC ... ncols - 1 + kc - 1 - oC; rows outside the
+  // image are all 0
+  const unsigned runLength = ncols + kc - 1;
+  Type *run = new Type[nslis*nrows*runLength];
+  Type *zeroRun = new Type[runLength];
+  Type *g = new Type[runLength + kc];
+  Type *h = new Type[runLength + kc];
+  for (d = 0; d < runLength; d++)
+    zeroRun[d] = Type(0);
+
+  unsigned first = 0;
+  while (first < nSegments) {
+    unsigned length = segment[first].length;
+    unsigned last = first;
+    while ((last < nSegments) && (segment[last].length == length))
+      last++;
+
+    for (s = 0; s < nslis; s++)
+      for (r = 0; r < nrows; r++)
+	_morphLine<Op>(run + (s*nrows + r)*runLength, runLength, in[s][r], ncols,
+		       -oC, length, g, h);
+
+    for (s = 0; s < nslis; s++)
+      for (r = 0; r < nrows; r++) {
+	Type *outRow = out[s][r];
+	for (unsigned i = first; i < last; i++) {
+	  int srcS = int(s + segment[i].slice) - oS;
+	  int srcR = int(r + segment[i].row) - oR;
+	  const Type *runRow = ((srcS >= 0) && (srcS < int(nslis)) &&
+				(srcR >= 0) && (srcR < int(nrows)))
+	    ? run + (srcS*nrows + srcR)*runLength : zeroRun;
+	  runRow += segment[i].col;
+	  unsigned c;
+	  if (!i)
+	    for (c = 0; c < ncols; c++)
+	      outRow[c] = runRow[c];
+	  else
+	    for (c = 0; c < ncols; c++)
+	      outRow[c] = Op::apply(outRow[c], runRow[c]);
+	}
+      }
+
+    first = last;
+  }
+
+  delete [] segment;
+  delete [] run;
+  delete [] zeroRun;
+  delete [] g;
+  delete [] h;
+}
+
+// Greylevel erosion/dilation by an arbitrary strel. The image is copied
+// once into a zero-padded buffer, so that every tap becomes a fixed offset
+// into it; for each output row, the taps are then applied one after the
+// other along the whole row, without tests in the innermost loop.
+template <class Op, class Type>
+void
+_morphologySparse(Type ***out, const Type * const * const *in,
+		  unsigned nslis, unsigned nrows, unsigned ncols,
+		  const CompiledStrel& strel, Boolean dilate)
+{
+  const unsigned nTaps = strel.nTaps();
+  const int sign = dilate ? -1 : 1;
+  unsigned i, s, r, c;
+
+  // Padding needed below (lo) and above (hi) each dimension
+  int lo[3] = {0, 0, 0};
+  int hi[3] = {0, 0, 0};
+  for (i = 0; i < nTaps; i++) {
+    int offset[3];
+    offset[0] = sign*strel.sliceOffset(i);
+    offset[1] = sign*strel.rowOffset(i);
+    offset[2] = sign*strel.colOffset(i);
+    for (unsigned dim = 0; dim < 3; dim++) {
+      lo[dim] = std::max(lo[dim], -offset[dim]);
+      hi[dim] = std::max(hi[dim], offset[dim]);
+    }
+  }
+
+  const unsigned pRows = nrows + lo[1] + hi[1];
+  const unsigned pCols = ncols + lo[2] + hi[2];
+  const unsigned long pSize = (unsigned long) (nslis + lo[0] + hi[0])*pRows*pCols;
+
+  Type *padded = new Type[pSize];
+  for (unsigned long j = 0; j < pSize; j++)
+    padded[j] = Type(0);
+  for (s = 0; s < nslis; s++)
+    for (r = 0; r < nrows; r++) {
+      Type       *dst = padded + ((s + lo[0])*pRows + r + lo[1])*pCols + lo[2];
+      const Type *src = in[s][r];
+      for (c = 0; c < ncols; c++)
+	dst[c] = src[c];
+    }
+
+  // Offsets into the padded image, and weights (added for dilation,
+  // subtracted for erosion)
+  long   *offset = new long[nTaps];
+  double *weight = new double[nTaps];
+  for (i = 0; i < nTaps; i++) {
+    offset[i] = (long(sign*strel.sliceOffset(i))*pRows + sign*strel.rowOffset(i))*long(pCols)
+      + sign*strel.colOffset(i);
+    weight[i] = -sign*strel.weight(i);
+  }
+
+  double *acc = new double[ncols];
+  const double init = dilate ? -MAXDOUBLE : MAXDOUBLE;
+
+  for (s = 0; s < nslis; s++)
+    for (r = 0; r < nrows; r++) {
+      const Type *base = padded + ((s + lo[0])*pRows + r + lo[1])*pCols + lo[2];
+      for (c = 0; c < ncols; c++)
+	acc[c] = init;
+      for (i = 0; i < nTaps; i++) {
+	const Type  *src = base + offset[i];
+	const double w   = weight[i];
+	for (c = 0; c < ncols; c++)
+	  acc[c] = Op::apply(acc[c], double(src[c]) + w);
+      }
+      Type *outRow = out[s][r];
+      for (c = 0; c < ncols; c++)
+	outRow[c] = Type(acc[c]);
+    }
+
+  delete [] padded;
+  delete [] offset;
+  delete [] weight;
+  delete [] acc;
+}
+
+// Greylevel erosion (dilate = FALSE) or dilation (dilate = TRUE) of an image
+// of nslis x nrows x ncols by a compiled strel. Flat strels use running
+// minima/maxima, others the sparse tap list. The output must not be the
+// input.
+template <class Type>
+void
+morphology(Type ***out, const Type * const * const *in,
+	   unsigned nslis, unsigned nrows, unsigned ncols,
+	   const CompiledStrel& strel, Boolean dilate)
+{
+  if (!nslis || !nrows || !ncols)
+    return;
+
+  if (!strel.isFlat() || !strel.nTaps()) {
+    if (dilate)
+      _morphologySparse<_MorphMax>(out, in, nslis, nrows, ncols, strel, TRUE);
+    else
+      _morphologySparse<_MorphMin>(out, in, nslis, nrows, ncols, strel, FALSE);
+    return;
+  }
+
+  // Flat strel: support reflected for dilation
+  const unsigned ks = strel.getslis();
+  const unsigned kr = strel.getrows();
+  const unsigned kc = strel.getcols();
+  const char *support = strel.support();
+  char *reflected = 0;
+
+  if (dilate) {
+    const unsigned size = ks*kr*kc;
+    reflected = new char[size];
+    for (unsigned i = 0; i < size; i++)
+      reflected[i] = support[size - 1 - i];
+    support = reflected;
+  }
+
+  int oS = dilate ? ks - 1 - ks/2 : ks/2;
+  int oR = dilate ? kr - 1 - kr/2 : kr/2;
+  int oC = dilate ? kc - 1 - kc/2 : kc/2;
+
+  if (dilate)
+    _morphologyFlat<_MorphMax>(out, in, nslis, nrows, ncols, support, ks, kr, kc,
+			       oS, oR, oC);
+  else
+    _morphologyFlat<_MorphMin>(out, in, nslis, nrows, ncols, support, ks, kr, kc,
+			       oS, oR, oC);
+
+  delete [] reflected;
+}
+
+#endif
@@ -0,0 +1,311 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _PERCENTILE_H
+#define _PERCENTILE_H
+
+/******************************************************************************
+ * Percentiles of the elements of an image, passed as an array of row
+ * pointers (Mat3D passes the rows of all its slices), without copying the
+ * image. Only elements in [minVal, maxVal] are considered, or all elements if
+ * maxVal <= minVal. The pct percentile is the element of rank
+ * floor(pct/100*(N - 1)) (0-based, ascending) of the N elements considered;
+ * pct = 50 gives the low median, like SimpleArray::median().
+ *
+ * 8- and 16-bit integers are counted by value in a single pass. Other data is
+ * selected by bucketing: a pass counts the candidate elements in value
+ * buckets, keeping the extrema of each bucket, after which the candidates are
+ * narrowed down to the bucket holding the rank sought. This is repeated until
+ * the candidates are all equal, or few enough to be gathered and selected
+ * with nth_element(); they are also gathered if a pass fails to narrow them
+ * down (e.g., values too close for their difference to be represented).
+ * Infinite values are counted separately and kept out of the buckets, and
+ * NaNs are skipped. The passes over the image are distributed over threads
+ * when OpenMP is enabled.
+ *****************************************************************************/
+
+#include <string.h>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "Histogram.h"
+
+const unsigned      PERCENTILE_BUCKETS = 4096;
+const unsigned long PERCENTILE_GATHER  = 1 << 16; // Max # candidates gathered
+
+// TRUE unless value is infinite or NaN (always TRUE for integers)
+template <class Type>
+inline Boolean _percentileFinite(Type value) { return (value - value) == Type(0); }
+
+// Per-thread bucket counts and extrema, merged into the first set
+template <class Type>
+struct _PercentileBuckets {
+  unsigned long *count;
+  Type          *min, *max;
+
+  _PercentileBuckets() {
+    count = new unsigned long[PERCENTILE_BUCKETS];
+    min   = new Type[PERCENTILE_BUCKETS];
+    max   = new Type[PERCENTILE_BUCKETS];
+    memset(count, 0, PERCENTILE_BUCKETS*sizeof(unsigned long));
+  }
+  ~_PercentileBuckets() { delete [] count; delete [] min; delete [] max; }
+
+  void add(unsigned b, Type value) {
+    if (!count[b])
+      min[b] = max[b] = value;
+    else if (value < min[b])
+      min[b] = value;
+    else if (value > max[b])
+      max[b] = value;
+    count[b]++;
+  }
+  void merge(const _PercentileBuckets& buckets) {
+    for (unsigned b = 0; b < PERCENTILE_BUCKETS; b++)
+      if (buckets.count[b]) {
+	if (!count[b]) {
+	  min[b] = buckets.min[b];
+	  max[b] = buckets.max[b];
+	}
+	else {
+	  if (buckets.min[b] < min[b]) min[b] = buckets.min[b];
+	  if (buckets.max[b] > max[b]) max[b] = buckets.max[b];
+	}
+	count[b] += buckets.count[b];
+      }
+  }
+};
+
+// Counts the elements in [lo, hi] (lo < hi, both finite) into buckets.
+// Buckets are a monotonic function of value, so bucket b holds exactly the
+// elements in [buckets.min[b], buckets.max[b]]. Halved values keep hi - lo
+// finite; if it still underflows, all elements go to the first bucket.
+template <class Type>
+void
+_percentileCount(const Type * const *rows, unsigned nRows, unsigned nCols,
+		 Type lo, Type hi, _PercentileBuckets<Type>& buckets)
+{
+  const double base  = 0.5*double(lo);
+  const double scale = PERCENTILE_BUCKETS/(0.5*double(hi) - base);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    _PercentileBuckets<Type> local;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int r = 0; r < int(nRows); r++) {
+      const Type *row = rows[r];
+      for (unsigned c = 0; c < nCols; c++) {
+	const Type value = row[c];
+	if (!(value >= lo) || !(value <= hi))
+	  continue;
+	double x = (0.5*double(value) - base)*scale;
+	x = (x > 0) ? x : 0;
+	x = (x < PERCENTILE_BUCKETS) ? x : PERCENTILE_BUCKETS - 1;
+	local.add(unsigned(x), value);
+      }
+    }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    buckets.merge(local);
+  }
+}
+
+// Element of rank rank among the n elements in [lo, hi] (both finite)
+template <class Type>
+Type
+_percentileSelect(const Type * const *rows, unsigned nRows, unsigned nCols,
+		  Type lo, Type hi, unsigned long n, unsigned long rank)
+{
+  while ((lo < hi) && (n > PERCENTILE_GATHER)) {
+    _PercentileBuckets<Type> buckets;
+    _percentileCount(rows, nRows, nCols, lo, hi, buckets);
+
+    unsigned b = 0;
+    while (rank >= buckets.count[b])
+      rank -= buckets.count[b++];
+    lo = buckets.min[b];
+    hi = buckets.max[b];
+    if (buckets.count[b] == n)
+      break; // No progress; gather
+    n  = buckets.count[b];
+  }
+
+  if (!(lo < hi))
+    return lo;
+
+  Type *candidates = new Type[n];
+  unsigned long i  = 0;
+  for (unsigned r = 0; r < nRows; r++) {
+    const Type *row = rows[r];
+    for (unsigned c = 0; c < nCols; c++)
+      if ((row[c] >= lo) && (row[c] <= hi))
+	candidates[i++] = row[c];
+  }
+  std::nth_element(candidates, candidates + rank, candidates + n);
+  const Type value = candidates[rank];
+  delete [] candidates;
+
+  return value;
+}
+
+// Stores the pct[i] percentiles (i < nPct) in value. Returns FALSE if there
+// are no elements to consider.
+template <class Type>
+Boolean
+percentiles(const Type * const *rows, unsigned nRows, unsigned nCols,
+	    const double *pct, unsigned nPct, Type *value,
+	    Type minVal = 0, Type maxVal = 0)
+{
+  const Boolean       inRange = maxVal > minVal;
+  const unsigned      range   = _HistogramRaw<Type>::range;
+  unsigned long       n       = 0;
+  unsigned            j;
+
+  if (range) {
+    // Counts of all values, in ascending order starting at index start
+    unsigned long *count = new unsigned long[range];
+    memset(count, 0, range*sizeof(unsigned long));
+    const unsigned start = 
+      (_HistogramRaw<Type>::value(range/2) < _HistogramRaw<Type>::value(0)) ? range/2 : 0;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      unsigned long *local = new unsigned long[range];
+      memset(local, 0, range*sizeof(unsigned long));
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (int r = 0; r < int(nRows); r++) {
+	const Type *row = rows[r];
+	for (unsigned c = 0; c < nCols; c++)
+	  if (!inRange || ((row[c] >= minVal) && (row[c] <= maxVal)))
+	    local[_HistogramRaw<Type>::index(row[c])]++;
+      }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+      for (unsigned k = 0; k < range; k++)
+	count[k] += local[k];
+      delete [] local;
+    }
+
+    for (j = 0; j < range; j++)
+      n += count[j];
+
+    for (unsigned p = 0; n && (p < nPct); p++) {
+      unsigned long rank = (pct[p] > 0) ? (unsigned long) (pct[p]/100*(n - 1)) : 0;
+      if (rank > n - 1)
+	rank = n - 1;
+      for (j = 0; rank >= count[(start + j) % range]; j++)
+	rank -= count[(start + j) % range];
+      value[p] = Type(_HistogramRaw<Type>::value((start + j) % range));
+    }
+
+    delete [] count;
+    return n ? TRUE : FALSE;
+  }
+
+  // Number and extrema of the finite elements considered, and the numbers
+  // of infinite ones below (nLow, all equal to low) and above (nHigh, all
+  // equal to high) them; NaNs are skipped
+  Type lo = minVal, hi = maxVal, low = minVal, high = maxVal;
+  unsigned long nLow = 0, nHigh = 0;
+  Boolean first = TRUE;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    unsigned long nLocal = 0, nLowLocal = 0, nHighLocal = 0;
+    Type          loLocal = minVal, hiLocal = maxVal;
+    Type          lowLocal = minVal, highLocal = maxVal;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int r = 0; r < int(nRows); r++) {
+      const Type *row = rows[r];
+      for (unsigned c = 0; c < nCols; c++) {
+	const Type v = row[c];
+	if (!(v == v) || (inRange && (!(v >= minVal) || !(v <= maxVal))))
+	  continue;
+	if (!_percentileFinite(v)) {
+	  if (v < 0) {
+	    lowLocal = v;
+	    nLowLocal++;
+	  }
+	  else {
+	    highLocal = v;
+	    nHighLocal++;
+	  }
+	}
+	else if (!nLocal++)
+	  loLocal = hiLocal = v;
+	else if (v < loLocal)
+	  loLocal = v;
+	else if (v > hiLocal)
+	  hiLocal = v;
+      }
+    }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    {
+      if (nLocal) {
+	if (first || (loLocal < lo)) lo = loLocal;
+	if (first || (hiLocal > hi)) hi = hiLocal;
+	first = FALSE;
+	n += nLocal;
+      }
+      if (nLowLocal)  low  = lowLocal;
+      if (nHighLocal) high = highLocal;
+      nLow  += nLowLocal;
+      nHigh += nHighLocal;
+    }
+  }
+
+  const unsigned long nAll = nLow + n + nHigh;
+  for (unsigned p = 0; nAll && (p < nPct); p++) {
+    unsigned long rank = (pct[p] > 0) ? (unsigned long) (pct[p]/100*(nAll - 1)) : 0;
+    if (rank > nAll - 1)
+      rank = nAll - 1;
+    if (rank < nLow)
+      value[p] = low;
+    else if (rank >= nLow + n)
+      value[p] = high;
+    else
+      value[p] = _percentileSelect(rows, nRows, nCols, lo, hi, n, rank - nLow);
+  }
+
+  return nAll ? TRUE : FALSE;
+}
+
+#endif
@@ -0,0 +1,412 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _PYRAMID_H
+#define _PYRAMID_H
+
+/******************************************************************************
+ * Gaussian and Laplacian pyramids, shared by Mat<Type> and Mat3D<Type>
+ * (images are passed as slice/row pointer arrays).
+ *
+ * pyramidReduce() blurs with the 5-tap binomial kernel [1 4 6 4 1]/16 along
+ * each dimension and decimates by 2 in the same pass: only the retained
+ * samples are computed, each output row from the (up to 5 x 5) input rows
+ * around it. Dimensions of size 1 are left alone; others become (n + 1)/2.
+ * pyramidExpand() is the matching interpolation to (at most) twice the size.
+ * Output rows are distributed over threads when OpenMP is enabled.
+ *****************************************************************************/
+
+#include <string.h>
+#include "MatrixSupport.h"
+#include "Convolution.h"
+
+// Taps of output sample i along a dimension of n input samples: reduction
+// (5 taps, or 1 if n == 1) or expansion to nOut samples (up to 3 taps)
+inline unsigned
+_pyramidReduceTaps(unsigned i, unsigned n, BorderMode border, int *index, double *weight)
+{
+  static const double binomial[5] = { 1.0/16, 4.0/16, 6.0/16, 4.0/16, 1.0/16 };
+  if (n == 1) {
+    index[0]  = 0;
+    weight[0] = 1;
+    return 1;
+  }
+  for (unsigned t = 0; t < 5; t++) {
+    index[t]  = borderIndex(int(2*i + t) - 2, n, border);
+    weight[t] = binomial[t];
+  }
+  return 5;
+}
+
+inline unsigned
+_pyramidExpandTaps(unsigned i, unsigned n, unsigned nOut, BorderMode border,
+		   int *index, double *weight)
+{
+  if (n == nOut) {
+    index[0]  = int(i);
+    weight[0] = 1;
+    return 1;
+  }
+  const int half = int(i/2);
+  if (i % 2) {
+    index[0]  = borderIndex(half, n, border);
+    index[1]  = borderIndex(half + 1, n, border);
+    weight[0] = weight[1] = 0.5;
+    return 2;
+  }
+  index[0]  = borderIndex(half - 1, n, border);
+  index[1]  = half;
+  index[2]  = borderIndex(half + 1, n, border);
+  weight[0] = weight[2] = 1.0/8;
+  weight[1] = 6.0/8;
+  return 3;
+}
+
+// Size of a dimension of n samples after reduction
+inline unsigned pyramidReduceSize(unsigned n) { return (n > 1) ? (n + 1)/2 : n; }
+
+// Reduces in (nslis x nrows x ncols) into out, of size pyramidReduceSize()
+// along each dimension
+template <class Type>
+void
+pyramidReduce(Type ***out, const Type * const * const *in,
+	      unsigned nslis, unsigned nrows, unsigned ncols,
+	      BorderMode border = BORDER_CLAMP)
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  if (!nslis || !nrows || !ncols)
+    return;
+
+  const unsigned outSlis = pyramidReduceSize(nslis);
+  const unsigned outRows = pyramidReduceSize(nrows);
+  const unsigned outCols = pyramidReduceSize(ncols);
+  const int      nLines  = int(outSlis*outRows);
+
+  // Column taps, shared by all rows
+  int    *colIndex  = new int[5*outCols];
+  double *colWeight = new double[5*outCols];
+  unsigned nColTaps = 0;
+  for (unsigned c = 0; c < outCols; c++)
+    nColTaps = _pyramidReduceTaps(c, ncols, border, colIndex + 5*c, colWeight + 5*c);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    Acc *line = new Acc[ncols];
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int l = 0; l < nLines; l++) {
+      int      sIndex[5], rIndex[5];
+      double   sWeight[5], rWeight[5];
+      const unsigned ns = _pyramidReduceTaps(l/outRows, nslis, border, sIndex, sWeight);
+      const unsigned nr = _pyramidReduceTaps(l%outRows, nrows, border, rIndex, rWeight);
+      unsigned c;
+
+      // Blur the rows around the output row
+      for (c = 0; c < ncols; c++)
+	line[c] = 0;
+      for (unsigned a = 0; a < ns; a++) {
+	if (sIndex[a] < 0)
+	  continue;
+	for (unsigned b = 0; b < nr; b++) {
+	  if (rIndex[b] < 0)
+	    continue;
+	  const double  w   = sWeight[a]*rWeight[b];
+	  const Type   *row = in[sIndex[a]][rIndex[b]];
+	  for (c = 0; c < ncols; c++)
+	    line[c] += w*Acc(row[c]);
+	}
+      }
+
+      // Blur and decimate along the row
+      Type *outRow = out[l/outRows][l%outRows];
+      for (c = 0; c < outCols; c++) {
+	const int    *index  = colIndex + 5*c;
+	const double *weight = colWeight + 5*c;
+	Acc sum = 0;
+	for (unsigned d = 0; d < nColTaps; d++)
+	  if (index[d] >= 0)
+	    sum += weight[d]*line[index[d]];
+	_convFromAcc(sum, outRow[c]);
+      }
+    }
+
+    delete [] line;
+  }
+
+  delete [] colIndex;
+  delete [] colWeight;
+}
+
+// Expands in (nslis x nrows x ncols) into out (outSlis x outRows x
+// outCols), where each out dimension is either that of in, or 2n - 1 or 2n
+// for an in dimension of n > 1. With sign 0, out receives the expansion E;
+// with sign +1 or -1, out becomes out + E or out - E.
+template <class Type>
+void
+pyramidExpand(Type ***out, unsigned outSlis, unsigned outRows, unsigned outCols,
+	      const Type * const * const *in, unsigned nslis, unsigned nrows,
+	      unsigned ncols, int sign = 0, BorderMode border = BORDER_CLAMP)
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  if (!nslis || !nrows || !ncols)
+    return;
+
+  const int nLines = int(outSlis*outRows);
+
+  int    *colIndex  = new int[3*outCols];
+  double *colWeight = new double[3*outCols];
+  unsigned *nColTaps = new unsigned[outCols];
+  for (unsigned c = 0; c < outCols; c++)
+    nColTaps[c] = _pyramidExpandTaps(c, ncols, outCols, border,
+				     colIndex + 3*c, colWeight + 3*c);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    Acc *line = new Acc[ncols];
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int l = 0; l < nLines; l++) {
+      int      sIndex[3], rIndex[3];
+      double   sWeight[3], rWeight[3];
+      const unsigned ns = _pyramidExpandTaps(l/outRows, nslis, outSlis, border, sIndex, sWeight);
+      const unsigned nr = _pyramidExpandTaps(l%outRows, nrows, outRows, border, rIndex, rWeight);
+      unsigned c;
+
+      for (c = 0; c < ncols; c++)
+	line[c] = 0;
+      for (unsigned a = 0; a < ns; a++) {
+	if (sIndex[a] < 0)
+	  continue;
+	for (unsigned b = 0; b < nr; b++) {
+	  if (rIndex[b] < 0)
+	    continue;
+	  const double  w   = sWeight[a]*rWeight[b];
+	  const Type   *row = in[sIndex[a]][rIndex[b]];
+	  for (c = 0; c < ncols; c++)
+	    line[c] += w*Acc(row[c]);
+	}
+      }
+
+      Type *outRow = out[l/outRows][l%outRows];
+      for (c = 0; c < outCols; c++) {
+	const int    *index  = colIndex + 3*c;
+	const double *weight = colWeight + 3*c;
+	Acc sum = 0;
+	for (unsigned d = 0; d < nColTaps[c]; d++)
+	  if (index[d] >= 0)
+	    sum += weight[d]*line[index[d]];
+	if (sign)
+	  sum = Acc(outRow[c]) + double(sign)*sum;
+	_convFromAcc(sum, outRow[c]);
+      }
+    }
+
+    delete [] line;
+  }
+
+  delete [] colIndex;
+  delete [] colWeight;
+  delete [] nColTaps;
+}
+
+// Gaussian or Laplacian pyramid. All levels live in a single contiguous
+// arena; level l has getslis(l) x getrows(l) x getcols(l) elements, stored
+// row by row from data(l) (so that Mat(nrows, ncols, data) and
+// Mat3D(nslis, nrows, ncols, data) can copy a level), and getEl(l) gives its
+// slice/row pointer arrays. Level 0 has the size of the original image.
+//   Laplacian level l is Gaussian level l minus the expansion of Gaussian
+// level l + 1 (the last level is Gaussian); collapse() turns a Laplacian
+// pyramid back into the Gaussian one, whose level 0 reconstructs the image.
+// Laplacian pyramids need a signed element type.
+template <class Type>
+class Pyramid {
+public:
+  Pyramid(const Type * const * const *in, unsigned nslis, unsigned nrows,
+	  unsigned ncols, unsigned nLevels, Boolean laplacian = FALSE,
+	  BorderMode border = BORDER_CLAMP);
+  Pyramid(const Pyramid&);
+  ~Pyramid() { _free(); }
+  Pyramid& operator = (const Pyramid&);
+
+  unsigned    nLevels()    const { return _nLevels; }
+  Boolean     isLaplacian() const { return _laplacian; }
+  unsigned    getslis(unsigned level) const { return _size[3*level]; }
+  unsigned    getrows(unsigned level) const { return _size[3*level + 1]; }
+  unsigned    getcols(unsigned level) const { return _size[3*level + 2]; }
+  const Type *data(unsigned level)    const { return _data + _offset[level]; }
+  const Type * const * const *getEl(unsigned level) const { return _el[level]; }
+
+  // Converts a Laplacian pyramid into a Gaussian one
+  Pyramid&    collapse();
+
+private:
+  unsigned       _nLevels;
+  Boolean        _laplacian;
+  BorderMode     _border;
+  unsigned      *_size;
+  unsigned long *_offset;
+  Type          *_data;
+  Type       ****_el;
+  Type        ***_slicePtrs;
+  Type         **_rowPtrs;
+
+  void _allocate(unsigned nLevels, const unsigned *size);
+  void _free();
+};
+
+template <class Type>
+void
+Pyramid<Type>::_allocate(unsigned nLevels, const unsigned *size)
+{
+  _nLevels = nLevels;
+  _size    = new unsigned[3*_nLevels];
+  _offset  = new unsigned long[_nLevels + 1];
+  _el      = new Type ***[_nLevels];
+
+  unsigned l, nSlices = 0, nRows = 0;
+  _offset[0] = 0;
+  for (l = 0; l < _nLevels; l++) {
+    _size[3*l]     = size[3*l];
+    _size[3*l + 1] = size[3*l + 1];
+    _size[3*l + 2] = size[3*l + 2];
+    _offset[l + 1] = _offset[l] + (unsigned long) size[3*l]*size[3*l + 1]*size[3*l + 2];
+    nSlices += size[3*l];
+    nRows   += size[3*l]*size[3*l + 1];
+  }
+
+  _data    = new Type[_offset[_nLevels]];
+  _rowPtrs   = new Type *[nRows];
+  _slicePtrs = new Type **[nSlices];
+
+  Type  **rowPtr    = _rowPtrs;
+  Type ***slicePtrs = _slicePtrs;
+  for (l = 0; l < _nLevels; l++) {
+    _el[l] = slicePtrs;
+    Type *dataPtr = _data + _offset[l];
+    for (unsigned s = 0; s < _size[3*l]; s++) {
+      *slicePtrs++ = rowPtr;
+      for (unsigned r = 0; r < _size[3*l + 1]; r++, dataPtr += _size[3*l + 2])
+	*rowPtr++ = dataPtr;
+    }
+  }
+}
+
+template <class Type>
+void
+Pyramid<Type>::_free()
+{
+  delete [] _el;
+  delete [] _slicePtrs;
+  delete [] _rowPtrs;
+  delete [] _data;
+  delete [] _offset;
+  delete [] _size;
+}
+
+template <class Type>
+Pyramid<Type>::Pyramid(const Type * const * const *in, unsigned nslis, unsigned nrows,
+		       unsigned ncols, unsigned nLevels, Boolean laplacian,
+		       BorderMode border)
+{
+  _laplacian = laplacian;
+  _border    = border;
+
+  if (!nslis || !nrows || !ncols || !nLevels)
+    nLevels = 0;
+
+  unsigned *size = new unsigned[3*nLevels];
+  unsigned  l;
+  for (l = 0; l < nLevels; l++) {
+    size[3*l]     = l ? pyramidReduceSize(size[3*l - 3]) : nslis;
+    size[3*l + 1] = l ? pyramidReduceSize(size[3*l - 2]) : nrows;
+    size[3*l + 2] = l ? pyramidReduceSize(size[3*l - 1]) : ncols;
+  }
+  _allocate(nLevels, size);
+  delete [] size;
+
+  if (!_nLevels)
+    return;
+
+  for (unsigned s = 0; s < nslis; s++)
+    for (unsigned r = 0; r < nrows; r++)
+      memcpy(_el[0][s][r], in[s][r], ncols*sizeof(Type));
+
+  for (l = 1; l < _nLevels; l++)
+    pyramidReduce(_el[l], (const Type * const * const *) _el[l - 1],
+		  getslis(l - 1), getrows(l - 1), getcols(l - 1), _border);
+
+  if (_laplacian)
+    for (l = 0; l + 1 < _nLevels; l++)
+      pyramidExpand(_el[l], getslis(l), getrows(l), getcols(l),
+		    (const Type * const * const *) _el[l + 1],
+		    getslis(l + 1), getrows(l + 1), getcols(l + 1), -1, _border);
+}
+
+template <class Type>
+Pyramid<Type>::Pyramid(const Pyramid<Type>& pyramid)
+{
+  _laplacian = pyramid._laplacian;
+  _border    = pyramid._border;
+  _allocate(pyramid._nLevels, pyramid._size);
+  if (_nLevels)
+    memcpy(_data, pyramid._data, _offset[_nLevels]*sizeof(Type));
+}
+
+template <class Type>
+Pyramid<Type>&
+Pyramid<Type>::operator = (const Pyramid<Type>& pyramid)
+{
+  if (this != &pyramid) {
+    _free();
+    _laplacian = pyramid._laplacian;
+    _border    = pyramid._border;
+    _allocate(pyramid._nLevels, pyramid._size);
+    if (_nLevels)
+      memcpy(_data, pyramid._data, _offset[_nLevels]*sizeof(Type));
+  }
+
+  return *this;
+}
+
+template <class Type>
+Pyramid<Type>&
+Pyramid<Type>::collapse()
+{
+  if (_laplacian) {
+    for (int l = int(_nLevels) - 2; l >= 0; l--)
+      pyramidExpand(_el[l], getslis(l), getrows(l), getcols(l),
+		    (const Type * const * const *) _el[l + 1],
+		    getslis(l + 1), getrows(l + 1), getcols(l + 1), +1, _border);
+    _laplacian = FALSE;
+  }
+
+  return *this;
+}
+
+#endif
@@ -0,0 +1,256 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _RANK_FILTER_H
+#define _RANK_FILTER_H
+
+/******************************************************************************
+ * Rank (percentile, median) filtering, shared by Mat<Type> and Mat3D<Type>
+ * (images are passed as slice/row pointer arrays). Every output element is
+ * the element of rank floor(pct/100*(N - 1)) (0-based, ascending) of the
+ * N = kslis x krows x kcols window centered at (kslis/2, krows/2, kcols/2);
+ * pct = 50 gives the low median, like SimpleArray::median().
+ *
+ * Each output line slides its window along the columns, so that per step only
+ * the kslis x krows samples of one column leave and enter the window. Integer
+ * data spanning at most 2^16 values is counted in a histogram, whose selected
+ * bin is tracked incrementally as the window moves (Huang et al.); other data
+ * is kept in a sorted window, updated by merging; NaNs rank above all other
+ * values. Output lines are independent, and are distributed over threads
+ * when OpenMP is enabled.
+ *****************************************************************************/
+
+#include <string.h>
+#include <algorithm>
+#include "MatrixSupport.h"
+
+// Histogram-based filtering is used for integer types only
+template <class Type> struct _RankHistogram { enum { usable = 0 }; };
+template <> struct _RankHistogram<char>           { enum { usable = 1 }; };
+template <> struct _RankHistogram<unsigned char>  { enum { usable = 1 }; };
+template <> struct _RankHistogram<short>          { enum { usable = 1 }; };
+template <> struct _RankHistogram<unsigned short> { enum { usable = 1 }; };
+template <> struct _RankHistogram<int>            { enum { usable = 1 }; };
+template <> struct _RankHistogram<unsigned int>   { enum { usable = 1 }; };
+
+const unsigned RANK_HISTOGRAM_BINS = 1 << 16;
+
+// Histogram of the window with its rank-th sample tracked: bin m holds it,
+// and below samples lie in bins under m
+struct _RankWindowHistogram {
+  unsigned *count;
+  unsigned  m, below, rank;
+
+  _RankWindowHistogram(unsigned nBins, unsigned rank_) : m(0), below(0), rank(rank_) {
+    count = new unsigned[nBins];
+    memset(count, 0, nBins*sizeof(unsigned));
+  }
+  ~_RankWindowHistogram() { delete [] count; }
+
+  void add(unsigned bin)    { count[bin]++; if (bin < m) below++; }
+  void remove(unsigned bin) { count[bin]--; if (bin < m) below--; }
+  unsigned select() {
+    while (below > rank)
+      below -= count[--m];
+    while (below + count[m] <= rank)
+      below += count[m++];
+    return m;
+  }
+};
+
+// Order of the sorted window: NaNs (the only values unequal to themselves)
+// follow all others, so that windows holding NaNs remain sorted and each
+// leaving sample is matched by an equivalent one
+template <class Type>
+inline bool
+_rankLess(const Type& a, const Type& b)
+{
+  return (a < b) || ((b != b) && (a == a));
+}
+
+template <class Type>
+struct _RankLess {
+  bool operator () (const Type& a, const Type& b) const { return _rankLess(a, b); }
+};
+
+// Sorted window. The samples of a column leave and enter in a single merge.
+template <class Type>
+struct _RankWindowSorted {
+  Type     *value, *merged;
+  unsigned  n;
+
+  _RankWindowSorted(unsigned size) : n(0) {
+    value  = new Type[size];
+    merged = new Type[size];
+  }
+  ~_RankWindowSorted() { delete [] value; delete [] merged; }
+
+  void add(Type v) {
+    Type *pos = std::upper_bound(value, value + n, v, _RankLess<Type>());
+    std::copy_backward(pos, value + n, value + n + 1);
+    *pos = v;
+    n++;
+  }
+  // Replaces the k samples in leaving (all in the window) by those in
+  // entering; both are sorted in place
+  void replace(Type *leaving, Type *entering, unsigned k) {
+    std::sort(leaving, leaving + k, _RankLess<Type>());
+    std::sort(entering, entering + k, _RankLess<Type>());
+    unsigned i = 0, l = 0, e = 0, m = 0;
+    while (i < n) {
+      if ((l < k) && !_rankLess(value[i], leaving[l]) && !_rankLess(leaving[l], value[i])) {
+	i++;
+	l++;
+      }
+      else if ((e < k) && _rankLess(entering[e], value[i]))
+	merged[m++] = entering[e++];
+      else
+	merged[m++] = value[i++];
+    }
+    while (e < k)
+      merged[m++] = entering[e++];
+    std::swap(value, merged);
+  }
+};
+
+// Sample col of row (zero if either is outside the image)
+template <class Type>
+inline Type
+_rankSample(const Type *row, int col)
+{
+  return (row && (col >= 0)) ? row[col] : Type(0);
+}
+
+// Rank filter of in into out (which must be distinct from in)
+template <class Type>
+void
+rankFilter(Type ***out, const Type * const * const *in,
+	   unsigned nslis, unsigned nrows, unsigned ncols,
+	   unsigned kslis, unsigned krows, unsigned kcols, double pct,
+	   BorderMode border = BORDER_CLAMP)
+{
+  if (!nslis || !nrows || !ncols || !kslis || !krows || !kcols)
+    return;
+
+  if (pct < 0)   pct = 0;
+  if (pct > 100) pct = 100;
+  const unsigned nWindow = kslis*krows*kcols;
+  const unsigned rank    = unsigned(pct/100*(nWindow - 1));
+  const unsigned nPlanes = kslis*krows; // Rows making up a window
+  const int      c0      = int(kcols/2);
+
+  // Source column of window column c - c0 + j at index c + j (-1: zero)
+  int *colIndex = new int[ncols + kcols];
+  unsigned j;
+  for (j = 0; j < ncols + kcols; j++)
+    colIndex[j] = borderIndex(int(j) - c0, ncols, border);
+
+  // Use a histogram if the (integer) data spans few enough values
+  // (bins are computed modulo 2^32, which also covers unsigned int)
+  Type     minValue = (border == BORDER_ZERO) ? Type(0) : in[0][0][0];
+  unsigned nBins    = 0;
+  if (_RankHistogram<Type>::usable) {
+    Type maxValue = minValue;
+    for (unsigned s = 0; s < nslis; s++)
+      for (unsigned r = 0; r < nrows; r++)
+	for (unsigned c = 0; c < ncols; c++) {
+	  const Type v = in[s][r][c];
+	  if (v < minValue) minValue = v;
+	  if (v > maxValue) maxValue = v;
+	}
+    if (double(maxValue) - double(minValue) < RANK_HISTOGRAM_BINS)
+      nBins = unsigned(maxValue) - unsigned(minValue) + 1;
+  }
+  const unsigned offset = nBins ? unsigned(minValue) : 0;
+
+  const int nLines = int(nslis*nrows);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    const Type **plane = new const Type *[nPlanes];
+    _RankWindowHistogram *histogram = nBins ? new _RankWindowHistogram(nBins, rank) : 0;
+    _RankWindowSorted<Type> *sorted = nBins ? 0 : new _RankWindowSorted<Type>(nWindow);
+    Type *leaving  = new Type[nPlanes];
+    Type *entering = new Type[nPlanes];
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int line = 0; line < nLines; line++) {
+      const unsigned slice = unsigned(line)/nrows;
+      const unsigned row   = unsigned(line)%nrows;
+      Type          *outRow = out[slice][row];
+      unsigned       p, c;
+
+      // Source rows of the window (0: zeros)
+      for (p = 0; p < nPlanes; p++) {
+	const int s = borderIndex(int(slice + p/krows) - int(kslis/2), nslis, border);
+	const int r = borderIndex(int(row + p%krows) - int(krows/2), nrows, border);
+	plane[p] = ((s < 0) || (r < 0)) ? 0 : in[s][r];
+      }
+
+      if (histogram) {
+	for (j = 0; j < kcols; j++)
+	  for (p = 0; p < nPlanes; p++)
+	    histogram->add(unsigned(_rankSample(plane[p], colIndex[j])) - offset);
+	for (c = 0;; c++) {
+	  outRow[c] = Type(histogram->select() + offset);
+	  if (c + 1 == ncols)
+	    break;
+	  for (p = 0; p < nPlanes; p++) {
+	    histogram->remove(unsigned(_rankSample(plane[p], colIndex[c])) - offset);
+	    histogram->add(unsigned(_rankSample(plane[p], colIndex[c + kcols])) - offset);
+	  }
+	}
+	// Empty the histogram for the next line
+	for (j = c; j < c + kcols; j++)
+	  for (p = 0; p < nPlanes; p++)
+	    histogram->remove(unsigned(_rankSample(plane[p], colIndex[j])) - offset);
+      }
+      else {
+	sorted->n = 0;
+	for (j = 0; j < kcols; j++)
+	  for (p = 0; p < nPlanes; p++)
+	    sorted->add(_rankSample(plane[p], colIndex[j]));
+	for (c = 0;; c++) {
+	  outRow[c] = sorted->value[rank];
+	  if (c + 1 == ncols)
+	    break;
+	  for (p = 0; p < nPlanes; p++) {
+	    leaving[p]  = _rankSample(plane[p], colIndex[c]);
+	    entering[p] = _rankSample(plane[p], colIndex[c + kcols]);
+	  }
+	  sorted->replace(leaving, entering, nPlanes);
+	}
+      }
+    }
+
+    delete [] plane;
+    delete histogram;
+    delete sorted;
+    delete [] leaving;
+    delete [] entering;
+  }
+
+  delete [] colIndex;
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _RESAMPLE_H
+#define _RESAMPLE_H
+
+/******************************************************************************
+ * Separable resampling, shared by Mat<Type> and Mat3D<Type> (images are
+ * passed as slice/row pointer arrays). Each dimension is resampled by its
+ * own ResampleTable (see MatrixSupport.h), holding the precomputed taps and
+ * weights of every output sample; no per-sample kernel evaluation or bounds
+ * checking is needed.
+ *
+ * The passes run along columns (gathering from each input row), then along
+ * rows and slices; the latter add whole weighted rows, with a contiguous
+ * inner loop the compiler can vectorize. Intermediate results are kept in
+ * the accumulator type of Convolution.h. Passes with an identity table are
+ * skipped, and the lines of each pass are distributed over threads when
+ * OpenMP is enabled.
+ *****************************************************************************/
+
+#include "MatrixSupport.h"
+#include "Convolution.h"
+
+// dst = sum over t of weight[t] * src[index[t]], for n contiguous samples,
+// where src[-1] is a line of zeros
+template <class Acc, class Src>
+inline void
+_resampleAddLines(Acc *dst, const Src * const *src, unsigned n,
+		  const int *index, const double *weight, unsigned nTaps)
+{
+  unsigned i;
+  for (i = 0; i < n; i++)
+    dst[i] = 0;
+  for (unsigned t = 0; t < nTaps; t++) {
+    if ((index[t] < 0) || (weight[t] == 0))
+      continue;
+    const double  w    = weight[t];
+    const Src    *line = src[index[t]];
+    for (i = 0; i < n; i++)
+      dst[i] += w*Acc(line[i]);
+  }
+}
+
+// Resamples in (nslis x nrows x ncols) into out, whose dimensions are given
+// by the nOut() of the tables. A zero table leaves that dimension as is.
+template <class Type>
+void
+resample(Type ***out, const Type * const * const *in,
+	 unsigned nslis, unsigned nrows, unsigned ncols,
+	 const ResampleTable *sliceTable, const ResampleTable *rowTable,
+	 const ResampleTable *colTable)
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  if (sliceTable && sliceTable->isIdentity()) sliceTable = 0;
+  if (rowTable && rowTable->isIdentity())     rowTable   = 0;
+  if (colTable && colTable->isIdentity())     colTable   = 0;
+
+  const unsigned outSlis = sliceTable ? sliceTable->nOut() : nslis;
+  const unsigned outRows = rowTable   ? rowTable->nOut()   : nrows;
+  const unsigned outCols = colTable   ? colTable->nOut()   : ncols;
+  if (!nslis || !nrows || !ncols || !outSlis || !outRows || !outCols)
+    return;
+
+  // Column pass: (nslis x nrows x outCols), as pointers to its rows
+  Acc  *colData = new Acc[(unsigned long) nslis*nrows*outCols];
+  Acc **colRows = new Acc *[nslis*nrows];
+  int   line;
+  for (line = 0; line < int(nslis*nrows); line++)
+    colRows[line] = colData + (unsigned long) line*outCols;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (line = 0; line < int(nslis*nrows); line++) {
+    const Type *inRow = in[line/nrows][line%nrows];
+    Acc        *dst   = colRows[line];
+    if (!colTable) {
+      for (unsigned c = 0; c < ncols; c++)
+	dst[c] = Acc(inRow[c]);
+      continue;
+    }
+    const unsigned nTaps = colTable->nTaps();
+    for (unsigned c = 0; c < outCols; c++) {
+      const int    *index  = colTable->index(c);
+      const double *weight = colTable->weight(c);
+      Acc sum = 0;
+      for (unsigned t = 0; t < nTaps; t++)
+	if (index[t] >= 0)
+	  sum += weight[t]*Acc(inRow[index[t]]);
+      dst[c] = sum;
+    }
+  }
+
+  // Row pass: (nslis x outRows x outCols)
+  Acc  *rowData = colData;
+  Acc **rowRows = colRows;
+  if (rowTable) {
+    rowData = new Acc[(unsigned long) nslis*outRows*outCols];
+    rowRows = new Acc *[nslis*outRows];
+    for (line = 0; line < int(nslis*outRows); line++)
+      rowRows[line] = rowData + (unsigned long) line*outCols;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (line = 0; line < int(nslis*outRows); line++) {
+      const unsigned s = line/outRows;
+      const unsigned r = line%outRows;
+      _resampleAddLines(rowRows[line], colRows + s*nrows, outCols,
+			rowTable->index(r), rowTable->weight(r), rowTable->nTaps());
+    }
+
+    delete [] colData;
+    delete [] colRows;
+  }
+
+  // Slice pass, into the output
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    Acc        *buffer    = sliceTable ? new Acc[outCols] : 0;
+    const Acc **sliceRows = sliceTable ? new const Acc *[nslis] : 0;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (line = 0; line < int(outSlis*outRows); line++) {
+      const unsigned s      = line/outRows;
+      const unsigned r      = line%outRows;
+      Type          *outRow = out[s][r];
+      const Acc     *src;
+      unsigned       c;
+
+      // Without a slice table, rowRows holds outSlis*outRows lines
+      if (sliceTable) {
+	for (unsigned a = 0; a < nslis; a++)
+	  sliceRows[a] = rowRows[a*outRows + r];
+	_resampleAddLines(buffer, sliceRows, outCols, sliceTable->index(s),
+			  sliceTable->weight(s), sliceTable->nTaps());
+	src = buffer;
+      }
+      else
+	src = rowRows[line];
+      for (c = 0; c < outCols; c++)
+	_convFromAcc(src[c], outRow[c]);
+    }
+
+    delete [] buffer;
+    delete [] sliceRows;
+  }
+
+  delete [] rowData;
+  delete [] rowRows;
+}
+
+#endif
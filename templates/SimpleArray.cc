@@ -669,29 +669,8 @@ template <class Type>
 UnsignedArray
 SimpleArray<Type>::qsortIndexAscending() const
 {
-  unsigned i;
-
-  if (!this->_size)
-    return UnsignedArray(0);
-
-  Type *elementPtr = this->_contents;
-  IndexStruct<Type> *indexStructArray = new IndexStruct<Type>[this->_size];
-  IndexStruct<Type> *indexStructPtr   = indexStructArray;
-  for (i = 0; i < this->_size; i++) {
-    indexStructPtr->element = *elementPtr++;
-    (indexStructPtr++)->index = i;
-  }
-
-  ::qsort(indexStructArray, this->_size, sizeof(IndexStruct<Type>), 
-	  IndexStruct<Type>::compareAscending);
-
   UnsignedArray sortedIndices(this->_size);
-  unsigned     *sortedIndicesPtr = sortedIndices.contents();
-  indexStructPtr = indexStructArray;
-  for (i = 0; i < this->_size; i++)
-    *sortedIndicesPtr++ = (indexStructPtr++)->index;
-  
-  delete [] indexStructArray;
+  sortIndex(this->_contents, this->_size, sortedIndices.contents(), TRUE);
 
   return sortedIndices;
 }
@@ -700,29 +679,8 @@ template <class Type>
 UnsignedArray
 SimpleArray<Type>::qsortIndexDescending() const
 {
-  unsigned i;
-
-  if (!this->_size)
-    return UnsignedArray(0);
-
-  Type *elementPtr = this->_contents;
-  IndexStruct<Type> *indexStructArray = new IndexStruct<Type>[this->_size];
-  IndexStruct<Type> *indexStructPtr   = indexStructArray;
-  for (i = 0; i < this->_size; i++) {
-    indexStructPtr->element = *elementPtr++;
-    (indexStructPtr++)->index   = i;
-  }
-
-  ::qsort(indexStructArray, this->_size, sizeof(IndexStruct<Type>), 
-	  IndexStruct<Type>::compareDescending);
-
   UnsignedArray sortedIndices(this->_size);
-  unsigned     *sortedIndicesPtr = sortedIndices.contents();
-  indexStructPtr = indexStructArray;
-  for (i = 0; i < this->_size; i++)
-    *sortedIndicesPtr++ = (indexStructPtr++)->index;
-  
-  delete [] indexStructArray;
+  sortIndex(this->_contents, this->_size, sortedIndices.contents(), FALSE);
 
   return sortedIndices;
 }
@@ -1497,11 +1455,19 @@ SimpleArray<Type>::map(const ValueMap& map) const
 {
   SimpleArray<Type> result(this->_size);
 
-  Type *sourcePtr = this->_contents;
-  Type *destPtr   = result._contents;
+  mapValues(map, this->_contents, result._contents, this->_size);
 
-  for (unsigned i = this->_size; i; i--)
-    *destPtr++ = Type(map(asDouble(*sourcePtr++)));
+  return result;
+}
+
+template <class Type>
+SimpleArray<Type>
+SimpleArray<Type>::map(const CompiledMap& map) const
+{
+  SimpleArray<Type> result(this->_size);
+
+  const CompiledMapKernel<Type> kernel(map, this->_size);
+  kernel(this->_contents, result._contents, this->_size);
 
   return result;
 }
@@ -22,6 +22,7 @@ $State: Exp $
 
 #include "trivials.h"
 #include "Array.h"
+#include "Sort.h"
 
 /********************************************************************
  * SimpleArray class
@@ -33,6 +34,7 @@ $State: Exp $
  ********************************************************************/
 
 class ValueMap;
+class CompiledMap;
 template <class Type> class SimpleArray;
 
 typedef SimpleArray<char>          BoolArray;
@@ -124,14 +126,15 @@ public:
   // Fills array with normally distributed numbers
   SimpleArray& randnormal(double mean = 0, double std = 1);
 
-  // Quicksort all elements
+  // Sort all elements (see Sort.h); qsort(compare) uses ::qsort()
   virtual void qsort() { qsortAscending(); }
   virtual void qsort(int (*compare) (const void *, const void *)) { 
     ::qsort(this->_contents, this->_size, sizeof(Type), compare); }
   virtual void qsortAscending() { 
-    ::qsort(this->_contents, this->_size, sizeof(Type), compareAscending); }
+    sortValues(this->_contents, this->_size, TRUE); }
   virtual void qsortDescending() {
-    ::qsort(this->_contents, this->_size, sizeof(Type), compareDescending); }
+    sortValues(this->_contents, this->_size, FALSE); }
+  // Indices of the elements in sorted order; equal elements keep their order
   virtual SimpleArray<unsigned> qsortIndexAscending() const;
   virtual SimpleArray<unsigned> qsortIndexDescending() const;
 
@@ -232,6 +235,7 @@ public:
   SimpleArray sample(unsigned maxN) const;
   SimpleArray applyElementWise(Type (*function) (Type)) const;
   SimpleArray map(const ValueMap& map) const;
+  SimpleArray map(const CompiledMap& map) const; // Single pass; see CompiledMap
 
 protected:
   // Median support functions
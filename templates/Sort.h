@@ -0,0 +1,357 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _SORT_H
+#define _SORT_H
+
+/******************************************************************************
+ * Sorting of plain arrays, used by SimpleArray's qsort functions. Comparisons
+ * are inlined function objects, rather than ::qsort() calls through function
+ * pointers. Integer and floating point data of at least RADIX_SORT_MIN
+ * elements is sorted with an LSD radix sort on order-preserving unsigned
+ * keys, a byte per pass (bytes equal for all keys are skipped); other data is
+ * sorted with std::sort() (an introsort). Index sorts are stable.
+ *
+ * With OpenMP, arrays of at least PARALLEL_SORT_MIN elements are cut into one
+ * run per thread. The runs are sorted in parallel and then merged pairwise,
+ * each merge being split over the available threads along its merge path.
+ *****************************************************************************/
+
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "MTypes.h"
+#include "trivials.h"
+
+const unsigned RADIX_SORT_MIN    = 256;
+const unsigned PARALLEL_SORT_MIN = 1 << 16;
+
+// Order-preserving unsigned keys for radix sorting. The keys of floating point
+// values assume IEEE 754; -0 sorts before +0.
+template <class Type> struct _RadixKey { enum { usable = 0 };
+  typedef unsigned Key;
+  static Key key(const Type&) { return 0; } };
+template <> struct _RadixKey<unsigned char> { enum { usable = 1 };
+  typedef unsigned char Key;
+  static Key key(unsigned char v) { return v; } };
+template <> struct _RadixKey<signed char> { enum { usable = 1 };
+  typedef unsigned char Key;
+  static Key key(signed char v) { return Key(Key(v) ^ 0x80); } };
+template <> struct _RadixKey<char> { enum { usable = 1 };
+  typedef unsigned char Key;
+  static Key key(char v) { return Key(Key(v) ^ ((CHAR_MIN < 0) ? 0x80 : 0)); } };
+template <> struct _RadixKey<unsigned short> { enum { usable = 1 };
+  typedef unsigned short Key;
+  static Key key(unsigned short v) { return v; } };
+template <> struct _RadixKey<short> { enum { usable = 1 };
+  typedef unsigned short Key;
+  static Key key(short v) { return Key(Key(v) ^ 0x8000); } };
+template <> struct _RadixKey<unsigned int> { enum { usable = 1 };
+  typedef unsigned int Key;
+  static Key key(unsigned int v) { return v; } };
+template <> struct _RadixKey<int> { enum { usable = 1 };
+  typedef unsigned int Key;
+  static Key key(int v) { return Key(v) ^ (Key(1) << (8*sizeof(Key) - 1)); } };
+template <> struct _RadixKey<unsigned long> { enum { usable = 1 };
+  typedef unsigned long Key;
+  static Key key(unsigned long v) { return v; } };
+template <> struct _RadixKey<long> { enum { usable = 1 };
+  typedef unsigned long Key;
+  static Key key(long v) { return Key(v) ^ (Key(1) << (8*sizeof(Key) - 1)); } };
+template <> struct _RadixKey<float> { enum { usable = (sizeof(unsigned) == sizeof(float)) };
+  typedef unsigned Key;
+  static Key key(float v) {
+    Key bits = 0;
+    memcpy(&bits, &v, std::min(sizeof(Key), sizeof(float)));
+    return (bits >> (8*sizeof(Key) - 1)) ? ~bits : (bits | (Key(1) << (8*sizeof(Key) - 1)));
+  } };
+template <> struct _RadixKey<double> { enum { usable = (sizeof(unsigned long) == sizeof(double)) };
+  typedef unsigned long Key;
+  static Key key(double v) {
+    Key bits = 0;
+    memcpy(&bits, &v, std::min(sizeof(Key), sizeof(double)));
+    return (bits >> (8*sizeof(Key) - 1)) ? ~bits : (bits | (Key(1) << (8*sizeof(Key) - 1)));
+  } };
+
+// Element of an index sort
+template <class Key>
+struct _SortItem {
+  Key      key;
+  unsigned index;
+};
+
+// Order of values; radix sortable values are compared by key, so that merging
+// agrees with radix sorting
+template <class Type>
+struct _SortValueLess {
+  Boolean ascending;
+  _SortValueLess(Boolean ascending_) : ascending(ascending_) {}
+  bool operator () (const Type& a, const Type& b) const {
+    if (_RadixKey<Type>::usable)
+      return ascending ? (_RadixKey<Type>::key(a) < _RadixKey<Type>::key(b))
+	               : (_RadixKey<Type>::key(b) < _RadixKey<Type>::key(a));
+    return ascending ? (a < b) : (b < a);
+  }
+};
+
+// Order of index sort items; equal keys are ordered by index
+template <class Key>
+struct _SortItemLess {
+  Boolean ascending;
+  _SortItemLess(Boolean ascending_) : ascending(ascending_) {}
+  bool operator () (const _SortItem<Key>& a, const _SortItem<Key>& b) const {
+    if (ascending ? (a.key < b.key) : (b.key < a.key))
+      return TRUE;
+    if (ascending ? (b.key < a.key) : (a.key < b.key))
+      return FALSE;
+    return a.index < b.index;
+  }
+};
+
+// Radix keys of values (complemented for a descending sort) and of items
+template <class Type>
+struct _RadixValueKey {
+  typedef typename _RadixKey<Type>::Key Key;
+  Boolean ascending;
+  _RadixValueKey(Boolean ascending_) : ascending(ascending_) {}
+  Key operator () (const Type& value) const {
+    const Key key = _RadixKey<Type>::key(value);
+    return ascending ? key : Key(~key);
+  }
+};
+
+template <class Key_>
+struct _RadixItemKey {
+  typedef Key_ Key;
+  Key operator () (const _SortItem<Key>& item) const { return item.key; }
+};
+
+// Stable LSD radix sort of data by the keys given by keyOf; buffer holds n
+// elements. Returns the array holding the result (data or buffer).
+template <class Elem, class KeyOf>
+Elem *
+_radixSort(Elem *data, Elem *buffer, unsigned n, const KeyOf& keyOf)
+{
+  typedef typename KeyOf::Key Key;
+  const unsigned nBytes = sizeof(Key);
+  unsigned      *count  = new unsigned[256*nBytes];
+  unsigned       i, b;
+
+  // Histograms of all bytes in a single pass
+  memset(count, 0, 256*nBytes*sizeof(unsigned));
+  for (i = 0; i < n; i++) {
+    const Key key = keyOf(data[i]);
+    for (b = 0; b < nBytes; b++)
+      count[256*b + ((key >> (8*b)) & 0xff)]++;
+  }
+
+  for (b = 0; b < nBytes; b++) {
+    unsigned *offset = count + 256*b;
+    if (offset[(keyOf(data[0]) >> (8*b)) & 0xff] == n)
+      continue;
+
+    unsigned sum = 0;
+    for (unsigned d = 0; d < 256; d++) {
+      const unsigned c = offset[d];
+      offset[d] = sum;
+      sum += c;
+    }
+    for (i = 0; i < n; i++)
+      buffer[offset[(keyOf(data[i]) >> (8*b)) & 0xff]++] = data[i];
+    std::swap(data, buffer);
+  }
+
+  delete [] count;
+  return data;
+}
+
+// Run sorts: radix sort if possible, std::sort() otherwise
+template <class Type>
+struct _SortValueRun {
+  Boolean ascending;
+  _SortValueRun(Boolean ascending_) : ascending(ascending_) {}
+  Type *operator () (Type *data, Type *buffer, unsigned n) const {
+    if (_RadixKey<Type>::usable && (n >= RADIX_SORT_MIN))
+      return _radixSort(data, buffer, n, _RadixValueKey<Type>(ascending));
+    std::sort(data, data + n, _SortValueLess<Type>(ascending));
+    return data;
+  }
+};
+
+template <class Key>
+struct _SortItemRun {
+  _SortItem<Key> *operator () (_SortItem<Key> *data, _SortItem<Key> *buffer, unsigned n) const {
+    if (n >= RADIX_SORT_MIN)
+      return _radixSort(data, buffer, n, _RadixItemKey<Key>());
+    std::sort(data, data + n, _SortItemLess<Key>(TRUE));
+    return data;
+  }
+};
+
+template <class Elem, class Less>
+struct _SortComparisonRun {
+  Less less;
+  _SortComparisonRun(const Less& less_) : less(less_) {}
+  Elem *operator () (Elem *data, Elem *, unsigned n) const {
+    std::sort(data, data + n, less);
+    return data;
+  }
+};
+
+// Number of elements of a taken by the first k elements of the (stable) merge
+// of a and b
+template <class Elem, class Less>
+unsigned
+_mergeSplit(unsigned k, const Elem *a, unsigned na, const Elem *b, unsigned nb,
+	    const Less& less)
+{
+  unsigned lo = (k > nb) ? k - nb : 0;
+  unsigned hi = (k < na) ? k : na;
+  while (lo < hi) {
+    const unsigned i = lo + (hi - lo + 1)/2;
+    const unsigned j = k - i;
+    if ((j < nb) && less(b[j], a[i - 1]))
+      hi = i - 1;
+    else
+      lo = i;
+  }
+
+  return lo;
+}
+
+// Sorts the n elements of data: runs are sorted by sortRun, and merged by less
+template <class Elem, class Less, class SortRun>
+void
+_sort(Elem *data, unsigned n, const Less& less, const SortRun& sortRun)
+{
+  if (n < 2)
+    return;
+
+  Elem *buffer   = new Elem[n];
+  int   nThreads = 1;
+#ifdef _OPENMP
+  if ((n >= PARALLEL_SORT_MIN) && !omp_in_parallel())
+    nThreads = omp_get_max_threads();
+#endif
+
+  if (nThreads <= 1) {
+    Elem *result = sortRun(data, buffer, n);
+    if (result != data)
+      std::copy(result, result + n, data);
+    delete [] buffer;
+    return;
+  }
+
+  const int nRuns = nThreads;
+  unsigned *start = new unsigned[nRuns + 1];
+  int       r;
+  for (r = 0; r <= nRuns; r++)
+    start[r] = unsigned((unsigned long) r*n/nRuns);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (r = 0; r < nRuns; r++) {
+    const unsigned length = start[r + 1] - start[r];
+    Elem *result = sortRun(data + start[r], buffer + start[r], length);
+    if (result != data + start[r])
+      std::copy(result, result + length, data + start[r]);
+  }
+
+  // Pairwise merges; each merge is split into parts with equal output
+  Elem *from = data, *to = buffer;
+  for (int width = 1; width < nRuns; width *= 2) {
+    const int nPairs = (nRuns + 2*width - 1)/(2*width);
+    const int nParts = (nThreads > nPairs) ? nThreads/nPairs : 1;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int task = 0; task < nPairs*nParts; task++) {
+      const int      pair = task/nParts, part = task%nParts;
+      const unsigned lo   = start[2*width*pair];
+      const unsigned mid  = start[std::min(2*width*pair + width, nRuns)];
+      const unsigned hi   = start[std::min(2*width*pair + 2*width, nRuns)];
+      const Elem    *a    = from + lo, *b = from + mid;
+      const unsigned na   = mid - lo, nb = hi - mid;
+
+      const unsigned k0 = unsigned((unsigned long) part*(na + nb)/nParts);
+      const unsigned k1 = unsigned((unsigned long) (part + 1)*(na + nb)/nParts);
+      const unsigned i0 = _mergeSplit(k0, a, na, b, nb, less);
+      const unsigned i1 = _mergeSplit(k1, a, na, b, nb, less);
+      std::merge(a + i0, a + i1, b + k0 - i0, b + k1 - i1, to + lo + k0, less);
+    }
+    std::swap(from, to);
+  }
+
+  if (from != data)
+    std::copy(from, from + n, data);
+
+  delete [] start;
+  delete [] buffer;
+}
+
+// Sorts values in ascending (or descending) order
+template <class Type>
+void
+sortValues(Type *values, unsigned n, Boolean ascending = TRUE)
+{
+  _sort(values, n, _SortValueLess<Type>(ascending), _SortValueRun<Type>(ascending));
+}
+
+// Stores in index the permutation that sorts values in ascending (or
+// descending) order; i.e., values[index[0]] is the smallest (largest) value.
+// Equal values keep their order.
+template <class Type>
+void
+sortIndex(const Type *values, unsigned n, unsigned *index, Boolean ascending = TRUE)
+{
+  unsigned i;
+
+  if (_RadixKey<Type>::usable) {
+    typedef typename _RadixKey<Type>::Key Key;
+    const _RadixValueKey<Type> keyOf(ascending);
+    _SortItem<Key> *item = new _SortItem<Key>[n];
+    for (i = 0; i < n; i++) {
+      item[i].key   = keyOf(values[i]);
+      item[i].index = i;
+    }
+    _sort(item, n, _SortItemLess<Key>(TRUE), _SortItemRun<Key>());
+    for (i = 0; i < n; i++)
+      index[i] = item[i].index;
+    delete [] item;
+  }
+  else {
+    _SortItem<Type> *item = new _SortItem<Type>[n];
+    for (i = 0; i < n; i++) {
+      item[i].key   = values[i];
+      item[i].index = i;
+    }
+    const _SortItemLess<Type> less(ascending);
+    _sort(item, n, less, _SortComparisonRun<_SortItem<Type>, _SortItemLess<Type> >(less));
+    for (i = 0; i < n; i++)
+      index[i] = item[i].index;
+    delete [] item;
+  }
+}
+
+#endif
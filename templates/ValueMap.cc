@@ -106,6 +106,25 @@ LinearMap::print(ostream& os) const
  * Lookup table class
  ********************/
 
+// Index of the first of the length sorted keys that is >= value (length if
+// there is none)
+template <class Type>
+static unsigned
+_lutSearch(const Type *keys, unsigned length, double value)
+{
+  unsigned lo = 0, hi = length;
+
+  while (lo < hi) {
+    const unsigned mid = (lo + hi)/2;
+    if (double(keys[mid]) < value)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
 template <class Type>
 LUT<Type>::LUT(unsigned length)
   : _source(length),
@@ -113,6 +132,7 @@ LUT<Type>::LUT(unsigned length)
 {
   _source.newSize(0);
   _dest.newSize(0);
+  _update();
 }
 
 template <class Type>
@@ -134,7 +154,9 @@ template <class Type>
 LUT<Type>::LUT(const LUT<Type>& map)
   : _source(map._source),
     _dest(map._dest)
-{}
+{
+  _update();
+}
 
 template <class Type>
 LUT<Type>::~LUT()
@@ -152,19 +174,26 @@ LUT<Type>::add(Type source, Type dest)
   if (!len) {
     _source.append(source);
     _dest.append(dest);
+    _update();
     return *this;
   }
 
-  const Type *sourcePtr = _source.contents();
-  unsigned i = 0;
-  while ((i < len) && (*sourcePtr < source)) {
-    i++;
-    sourcePtr++;
-  }
+  unsigned i = _lutSearch(_source.contents(), len, double(source));
 
-  if (*sourcePtr != source) {
+  if ((i == len) && (len > 2)) {
+    // Appending (as Histogram::equalize() does) updates the search state in
+    // constant time
+    if (_uniform && !(fabs(double(source) - (_origin + len*_step)) <= 1e-6*_step))
+      _uniform = FALSE;
+    if (_destSorted && !(dest >= _dest[len - 1]))
+      _destSorted = FALSE;
+    _source.append(source);
+    _dest.append(dest);
+  }
+  else if ((i == len) || (_source[i] != source)) {
     _source.insert(source, i);
     _dest.insert(dest, i);
+    _update();
   }
 
   return *this;
@@ -176,6 +205,7 @@ LUT<Type>::operator = (const LUT<Type>& map)
 {
   _source = map._source;
   _dest   = map._dest;
+  _update();
 
   return *this;
 }
@@ -193,11 +223,18 @@ LUT<Type>::inv()
   return *this;
 }
 
+// Maps the destination values through map
 template <class Type>
 ValueMap& 
-LUT<Type>::concat(const ValueMap&)
+LUT<Type>::concat(const ValueMap& map)
 {
-  cerr << "LUT<Type>::concat() called but not implemented" << endl;
+  Type *destPtr = _dest.contents();
+
+  for (unsigned i = size(_source); i; i--, destPtr++)
+    *destPtr = Type(map(double(*destPtr)));
+
+  _update();
+
   return *this;
 }
 
@@ -210,6 +247,8 @@ LUT<Type>::concat(const LUT<Type>& map)
   for (unsigned i = size(_source); i; i--, destPtr++)
     *destPtr = Type(map(double(*destPtr)));
 
+  _update();
+
   return *this;
 }
 
@@ -219,15 +258,26 @@ LUT<Type>::operator () (double sourceValue) const
 {
   unsigned length = size(_source);
 
-  const Type *sourcePtr = _source.contents();
-  for (unsigned i = 0; i < length; i++, sourcePtr++)
-    if (*sourcePtr >= sourceValue)
-      if (!i || (double(*sourcePtr) - sourceValue) < (sourceValue - *(sourcePtr - 1)))
-	return double(_dest[i]);
-      else 
-	return double(_dest[i - 1]);
-  
-  return double(_dest[length - 1]);
+  if (!length)
+    return 0;
+
+  const Type *source = _source.contents();
+  unsigned i = _lowerBound(sourceValue);
+
+  if (i == length)
+    return double(_dest[length - 1]);
+  if (!i || (double(source[i]) - sourceValue) < (sourceValue - source[i - 1]))
+    return double(_dest[i]);
+  else 
+    return double(_dest[i - 1]);
+}
+
+template <class Type>
+void
+LUT<Type>::apply(const double *in, double *out, unsigned n) const
+{
+  for (unsigned i = 0; i < n; i++)
+    out[i] = LUT<Type>::operator () (in[i]);
 }
 
 template <class Type>
@@ -241,14 +291,40 @@ LUT<Type>::reverse(double destValue) const
   if (length < 2)
     return _source[(unsigned int)0];
 
+  const Type *dest = _dest.contents();
   unsigned index = 0;
-  const Type *destPtr = _dest.contents();
-  double minDiff = fabs(destValue - *destPtr++);
-  for (unsigned i = 1; i < length; i++) {
-    double diff = fabs(destValue - *destPtr++);
-    if (diff < minDiff) {
+
+  if (_destSorted && (destValue == destValue)) {
+    // The nearest values are dest[i - 1] and dest[i]. Distances to the
+    // values below destValue do not increase towards dest[i - 1], so the
+    // first value at the smallest distance (which, with rounding, need not
+    // equal dest[i - 1]) is found by a second binary search.
+    unsigned i = _lutSearch(dest, length, destValue);
+    if (i && ((i == length) ||
+	      (fabs(destValue - dest[i - 1]) <= fabs(destValue - dest[i])))) {
+      const double minDiff = fabs(destValue - dest[i - 1]);
+      unsigned lo = 0, hi = i - 1;
+      while (lo < hi) {
+	const unsigned mid = (lo + hi)/2;
+	if (fabs(destValue - dest[mid]) <= minDiff)
+	  hi = mid;
+	else
+	  lo = mid + 1;
+      }
+      index = lo;
+    }
+    else
       index = i;
-      minDiff = diff;
+  }
+  else {
+    const Type *destPtr = dest;
+    double minDiff = fabs(destValue - *destPtr++);
+    for (unsigned i = 1; i < length; i++) {
+      double diff = fabs(destValue - *destPtr++);
+      if (diff < minDiff) {
+	index = i;
+	minDiff = diff;
+      }
     }
   }
   
@@ -272,6 +348,321 @@ LUT<Type>::_sort()
   SimpleArray<unsigned> indexArray(_source.qsortIndexAscending());
   _source.reorder(indexArray);
   _dest.reorder(indexArray);
+  _update();
+}
+
+// Determines whether the source values are evenly spaced, and whether the
+// destination values are non-decreasing
+template <class Type>
+void
+LUT<Type>::_update()
+{
+  const unsigned length = size(_source);
+  const Type    *source = _source.contents();
+  const Type    *dest   = _dest.contents();
+  unsigned i;
+
+  _uniform = (length > 2);
+  _origin  = length ? double(source[0]) : 0;
+  _step    = (length > 1) ? (double(source[length - 1]) - _origin)/(length - 1) : 0;
+  if (!(_step > 0) || (_step*length > MAXDOUBLE))
+    _uniform = FALSE;
+  for (i = 1; _uniform && (i < length); i++)
+    if (!(fabs(double(source[i]) - (_origin + i*_step)) <= 1e-6*_step))
+      _uniform = FALSE;
+
+  _destSorted = TRUE;
+  for (i = 1; _destSorted && (i < length); i++)
+    if (!(dest[i] >= dest[i - 1]))
+      _destSorted = FALSE;
+}
+
+// Index of the first source value >= sourceValue (the length if there is
+// none, or for a NaN)
+template <class Type>
+unsigned
+LUT<Type>::_lowerBound(double sourceValue) const
+{
+  const unsigned length = size(_source);
+  const Type    *source = _source.contents();
+
+  if (sourceValue != sourceValue)
+    return length;
+  if (!_uniform)
+    return _lutSearch(source, length, sourceValue);
+
+  // The grid gives the answer to within one position
+  const double t = (sourceValue - _origin)/_step;
+  unsigned i = !(t > 0) ? 0 : (t >= length - 1) ? length - 1 : unsigned(t);
+  while (i && (double(source[i - 1]) >= sourceValue))
+    i--;
+  while ((i < length) && (double(source[i]) < sourceValue))
+    i++;
+
+  return i;
+}
+
+/******************************
+ * Compiled chain of value maps
+ ******************************/
+
+CompiledMap::CompiledMap()
+{
+  _nStages  = 0;
+  _capacity = 0;
+  _stages   = 0;
+}
+
+CompiledMap::CompiledMap(const CompiledMap& map)
+{
+  _copy(map);
+}
+
+CompiledMap::~CompiledMap()
+{
+  _clear();
+}
+
+CompiledMap&
+CompiledMap::operator = (const CompiledMap& map)
+{
+  if (this != &map) {
+    _clear();
+    _copy(map);
+  }
+
+  return *this;
+}
+
+CompiledMap&
+CompiledMap::add(const LinearMap& map)
+{
+  Stage *last = _last();
+
+  if (last && (last->type == STAGE_LUT))
+    last->lut->concat(map);
+  else if (last && (last->type == STAGE_LINEAR)) {
+    last->offset = map.factor()*last->offset + map.offset();
+    last->factor = map.factor()*last->factor;
+  }
+  else {
+    Stage& stage = _push(STAGE_LINEAR);
+    stage.factor = map.factor();
+    stage.offset = map.offset();
+  }
+
+  return *this;
+}
+
+CompiledMap&
+CompiledMap::add(const ClipMap& map)
+{
+  Stage *last = _last();
+
+  if (last && (last->type == STAGE_LUT))
+    last->lut->concat(map);
+  else {
+    Stage& stage = _push(STAGE_CLIP);
+    stage.minVal  = map.minVal();
+    stage.maxVal  = map.maxVal();
+    stage.minFill = map.minFill();
+    stage.maxFill = map.maxFill();
+  }
+
+  return *this;
+}
+
+CompiledMap&
+CompiledMap::add(const LUT<double>& map)
+{
+  Stage *last = _last();
+
+  if (last && (last->type == STAGE_LUT))
+    last->lut->concat(map);
+  else if (last && (last->type == STAGE_LINEAR)) {
+    // The linear map becomes the input transform of the LUT
+    last->type = STAGE_LUT;
+    last->lut  = new LUT<double>(map);
+  }
+  else {
+    Stage& stage = _push(STAGE_LUT);
+    stage.lut = new LUT<double>(map);
+  }
+
+  return *this;
+}
+
+CompiledMap&
+CompiledMap::add(const CompiledMap& map)
+{
+  for (unsigned i = 0; i < map._nStages; i++) {
+    const Stage& stage = map._stages[i];
+    switch (stage.type) {
+    case STAGE_LINEAR:
+      add(LinearMap(stage.factor, stage.offset));
+      break;
+    case STAGE_CLIP:
+      add(ClipMap(stage.minVal, stage.maxVal, stage.minFill, stage.maxFill));
+      break;
+    case STAGE_LUT:
+      if ((stage.factor != 1) || (stage.offset != 0))
+	add(LinearMap(stage.factor, stage.offset));
+      add(*stage.lut);
+      break;
+    }
+  }
+
+  return *this;
+}
+
+CompiledMap&
+CompiledMap::addScale(double minin, double maxin, double minout, double maxout)
+{
+  add(LinearMap(minin, maxin, minout, maxout));
+  return add(ClipMap(minout, maxout));
+}
+
+ValueMap&
+CompiledMap::inv()
+{
+  cerr << "CompiledMap::inv() called but not implemented" << endl;
+  return *this;
+}
+
+ValueMap&
+CompiledMap::concat(const ValueMap& map)
+{
+  if (const LinearMap *linear = dynamic_cast<const LinearMap *>(&map))
+    add(*linear);
+  else if (const ClipMap *clip = dynamic_cast<const ClipMap *>(&map))
+    add(*clip);
+  else if (const LUT<double> *lut = dynamic_cast<const LUT<double> *>(&map))
+    add(*lut);
+  else if (const CompiledMap *compiled = dynamic_cast<const CompiledMap *>(&map))
+    add(*compiled);
+  else
+    cerr << "CompiledMap::concat() called but not implemented for this map" << endl;
+
+  return *this;
+}
+
+double
+CompiledMap::operator () (double sourceValue) const
+{
+  double value = sourceValue;
+  apply(&value, &value, 1);
+  return value;
+}
+
+void
+CompiledMap::apply(const double *in, double *out, unsigned n) const
+{
+  unsigned i;
+
+  if (out != in)
+    for (i = 0; i < n; i++)
+      out[i] = in[i];
+
+  for (unsigned s = 0; s < _nStages; s++) {
+    const Stage& stage = _stages[s];
+    const double factor = stage.factor, offset = stage.offset;
+
+    switch (stage.type) {
+    case STAGE_LINEAR:
+      for (i = 0; i < n; i++)
+	out[i] = factor*out[i] + offset;
+      break;
+    case STAGE_CLIP: {
+      const double minVal  = stage.minVal, maxVal = stage.maxVal;
+      const double minFill = stage.minFill, maxFill = stage.maxFill;
+      for (i = 0; i < n; i++) {
+	const double value = (out[i] < minVal) ? minFill : out[i];
+	out[i] = (value > maxVal) ? maxFill : value;
+      }
+      break;
+    }
+    case STAGE_LUT:
+      for (i = 0; i < n; i++)
+	out[i] = stage.lut->LUT<double>::operator () (factor*out[i] + offset);
+      break;
+    }
+  }
+}
+
+double
+CompiledMap::reverse(double destValue) const
+{
+  if (_nStages)
+    cerr << "CompiledMap::reverse() called but not implemented" << endl;
+  return destValue;
+}
+
+ostream&
+CompiledMap::print(ostream& os) const
+{
+  for (unsigned s = 0; s < _nStages; s++) {
+    const Stage& stage = _stages[s];
+    switch (stage.type) {
+    case STAGE_LINEAR:
+      os << LinearMap(stage.factor, stage.offset) << endl;
+      break;
+    case STAGE_CLIP:
+      os << ClipMap(stage.minVal, stage.maxVal, stage.minFill, stage.maxFill) << endl;
+      break;
+    case STAGE_LUT:
+      os << "LUT of " << LinearMap(stage.factor, stage.offset) << endl << *stage.lut;
+      break;
+    }
+  }
+
+  return os;
+}
+
+CompiledMap::Stage&
+CompiledMap::_push(StageType type)
+{
+  if (_nStages == _capacity) {
+    _capacity = _capacity ? 2*_capacity : 4;
+    Stage *stages = new Stage[_capacity];
+    for (unsigned s = 0; s < _nStages; s++)
+      stages[s] = _stages[s];
+    delete [] _stages;
+    _stages = stages;
+  }
+
+  Stage& stage = _stages[_nStages++];
+  stage.type   = type;
+  stage.factor = 1;
+  stage.offset = 0;
+  stage.minVal = stage.maxVal = stage.minFill = stage.maxFill = 0;
+  stage.lut    = 0;
+
+  return stage;
+}
+
+void
+CompiledMap::_copy(const CompiledMap& map)
+{
+  _nStages  = map._nStages;
+  _capacity = map._nStages;
+  _stages   = _capacity ? new Stage[_capacity] : 0;
+
+  for (unsigned s = 0; s < _nStages; s++) {
+    _stages[s] = map._stages[s];
+    if (_stages[s].lut)
+      _stages[s].lut = new LUT<double>(*map._stages[s].lut);
+  }
+}
+
+void
+CompiledMap::_clear()
+{
+  for (unsigned s = 0; s < _nStages; s++)
+    delete _stages[s].lut;
+  delete [] _stages;
+
+  _nStages = _capacity = 0;
+  _stages  = 0;
 }
 
 /**************************
@@ -282,11 +673,7 @@ template <class Type>
 SimpleArray<Type>&
 map(SimpleArray<Type>& array, const ValueMap& map)
 {
-  Type    *elPtr = array.contents();
-  unsigned N     = array.size();
-
-  for (unsigned i = N; i; i--, elPtr++)
-    *elPtr = Type(map(double(*elPtr)));
+  mapValues(map, array.contents(), array.contents(), array.size());
 
   return array;
 }
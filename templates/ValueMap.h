@@ -21,7 +21,9 @@ $State: Exp $
 #define _VALUE_MAP_H
 
 #include <iostream>		/* (bert) changed from iostream.h */
+#include <limits.h>
 #include "SimpleArray.h"
+#include "miscTemplateFunc.h"
 
 /*************************
  * Abstract ValueMap class
@@ -38,6 +40,11 @@ public:
 
   // Evaluate map
   virtual double operator () (double sourceValue) const = 0;
+  // Evaluate map for n values (out may be in), in a single virtual call
+  virtual void apply(const double *in, double *out, unsigned n) const {
+    for (unsigned i = 0; i < n; i++)
+      out[i] = (*this)(in[i]);
+  }
   // Reverse evaluate map
   virtual double reverse(double destValue) const = 0;
 
@@ -90,8 +97,13 @@ public:
       return *this; 
   }
 
+  // Only a LinearMap can be concatenated into a LinearMap; see CompiledMap
+  // for other chains
   ValueMap& concat(const ValueMap& map) {
-      std::cerr << "LinearMap::concat() called but not implemented" << std::endl;
+    const LinearMap *linear = dynamic_cast<const LinearMap *>(&map);
+    if (linear)
+      return concat(*linear);
+    std::cerr << "LinearMap::concat() called but not implemented for this map" << std::endl;
     return *this;
   }
 
@@ -103,6 +115,10 @@ public:
 
   ValueMap& operator () (const ValueMap& map) { return concat(map); }
   double operator () (double sourceValue) const { return _offset+_factor*sourceValue;}
+  void apply(const double *in, double *out, unsigned n) const {
+    for (unsigned i = 0; i < n; i++)
+      out[i] = _offset + _factor*in[i];
+  }
 
   LinearMap& operator () (double factor, double offset) {
     _factor = factor; 
@@ -126,15 +142,79 @@ public:
 
 };
 
+/*****************
+ * Clip map class
+ *****************/
+
+// As Mat::clip(): values below minVal become minFill, after which values
+// above maxVal become maxFill
+class ClipMap : public ValueMap {
+private:
+  double _minVal, _maxVal, _minFill, _maxFill;
+
+public:
+  ClipMap(double minVal, double maxVal, double minFill, double maxFill) {
+    _minVal = minVal; _maxVal = maxVal; _minFill = minFill; _maxFill = maxFill;
+  }
+  ClipMap(double minVal, double maxVal) {
+    _minVal = _minFill = minVal; _maxVal = _maxFill = maxVal;
+  }
+
+  double minVal() const  { return _minVal; }
+  double maxVal() const  { return _maxVal; }
+  double minFill() const { return _minFill; }
+  double maxFill() const { return _maxFill; }
+
+  ValueMap& inv() {
+    std::cerr << "ClipMap::inv() called but not implemented" << std::endl;
+    return *this;
+  }
+  ValueMap& concat(const ValueMap&) {
+    std::cerr << "ClipMap::concat() called but not implemented" << std::endl;
+    return *this;
+  }
+
+  double operator () (double sourceValue) const {
+    if (sourceValue < _minVal)
+      sourceValue = _minFill;
+    if (sourceValue > _maxVal)
+      sourceValue = _maxFill;
+    return sourceValue;
+  }
+  void apply(const double *in, double *out, unsigned n) const {
+    for (unsigned i = 0; i < n; i++) {
+      double value = in[i];
+      value = (value < _minVal) ? _minFill : value;
+      out[i] = (value > _maxVal) ? _maxFill : value;
+    }
+  }
+  // Values in range map onto themselves
+  double reverse(double destValue) const { return destValue; }
+
+  std::ostream& print(std::ostream& os) const {
+    os << "clip(" << _minVal << ", " << _maxVal << ", " << _minFill << ", " 
+       << _maxFill << ")";
+    return os;
+  }
+};
+
 /********************
  * Lookup table class
  ********************/
 
+// Evaluation maps to the destination value of the nearest source value
+// (the lower one on ties), found by binary search, or directly when the
+// source values are evenly spaced (as the bin centres of a Histogram).
+// Reverse evaluation maps to the source value of the nearest destination
+// value, by binary search if the destination values are non-decreasing.
 template <class Type>
 class LUT : public ValueMap {
 private:
   SimpleArray<Type> _source;
   SimpleArray<Type> _dest;
+  Boolean           _uniform;    // Source values evenly spaced
+  double            _origin, _step;
+  Boolean           _destSorted; // Destination values non-decreasing
 
 public:
   LUT(unsigned length = 0); // Allocated size; actual size is zero
@@ -152,12 +232,95 @@ public:
 
   ValueMap& operator () (const ValueMap& map) { return concat(map); }
   double operator () (double sourceValue) const;
+  void   apply(const double *in, double *out, unsigned n) const;
   double reverse(double destValue) const;
   
   std::ostream& print(std::ostream&) const;
 
 private:
-  void _sort();
+  void     _sort();
+  void     _update();
+  unsigned _lowerBound(double sourceValue) const;
+};
+
+/******************************
+ * Compiled chain of value maps
+ ******************************/
+
+// A chain of LinearMap, ClipMap (clip and scale) and LUT<double> stages,
+// applied in the order in which they are added, compiled into the fewest
+// stages: adjacent linear maps are combined, a linear map followed by a LUT
+// becomes the input transform of that LUT, and anything following a LUT is
+// folded into its destination values. A chain thus reduces to linear maps and
+// clips, followed by at most one LUT. apply() runs each stage over a whole
+// block of values. For elements of integral types of up to 16 bits,
+// CompiledMapKernel goes further and tabulates the whole chain.
+class CompiledMap : public ValueMap {
+public:
+  CompiledMap();
+  CompiledMap(const CompiledMap&);
+  virtual ~CompiledMap();
+  CompiledMap& operator = (const CompiledMap&);
+
+  // Add a stage
+  CompiledMap& add(const LinearMap&);
+  CompiledMap& add(const ClipMap&);
+  CompiledMap& add(const LUT<double>&);
+  CompiledMap& add(const CompiledMap&);
+  // As Mat::scale(): the linear map of [minin, maxin] onto [minout, maxout],
+  // clipped to [minout, maxout]
+  CompiledMap& addScale(double minin, double maxin, double minout, double maxout);
+
+  unsigned nStages() const { return _nStages; }
+
+  ValueMap& inv();
+  // Adds map as a stage (a LinearMap, ClipMap, LUT<double> or CompiledMap)
+  ValueMap& concat(const ValueMap& map);
+
+  double operator () (double sourceValue) const;
+  void   apply(const double *in, double *out, unsigned n) const;
+  double reverse(double destValue) const;
+
+  std::ostream& print(std::ostream&) const;
+
+private:
+  enum StageType { STAGE_LINEAR, STAGE_CLIP, STAGE_LUT };
+  struct Stage {
+    StageType    type;
+    double       factor, offset; // Linear map, or LUT input transform
+    double       minVal, maxVal, minFill, maxFill;
+    LUT<double> *lut;
+  };
+
+  unsigned _nStages, _capacity;
+  Stage   *_stages;
+
+  Stage& _push(StageType type);
+  Stage *_last() { return _nStages ? _stages + _nStages - 1 : 0; }
+  void   _copy(const CompiledMap&);
+  void   _clear();
+};
+
+// A CompiledMap prepared for elements of type Type. For integral types of up
+// to 16 bits, the map of every possible value is tabulated, provided that at
+// least as many elements are to be mapped (nElements); other types use the
+// compiled stages.
+template <class Type>
+class CompiledMapKernel {
+public:
+  CompiledMapKernel(const CompiledMap& map, unsigned long nElements = ~0UL);
+  ~CompiledMapKernel() { delete [] _table; }
+
+  // Map n elements of in into out (which may be in)
+  void operator () (const Type *in, Type *out, unsigned long n) const;
+
+private:
+  const CompiledMap& _map;
+  Type              *_table;
+  long               _tableMin;
+
+  CompiledMapKernel(const CompiledMapKernel&);
+  CompiledMapKernel& operator = (const CompiledMapKernel&);
 };
 
 /**************************
@@ -184,5 +347,77 @@ SimpleArray<Type>& map(SimpleArray<Type>& array, const Array<LinearMap>&);
 template <class Type>
 SimpleArray<Type>  mapConst(const SimpleArray<Type>& array,const Array<LinearMap>& maps);
 
+// Map n elements of in into out (which may be in). Elements are converted
+// to double in blocks, each mapped by a single ValueMap::apply() call.
+template <class Type>
+void mapValues(const ValueMap& valueMap, const Type *in, Type *out, unsigned long n)
+{
+  const unsigned block = 256;
+  double buffer[block];
+
+  for (unsigned long i = 0; i < n; i += block) {
+    const unsigned count = (n - i < block) ? unsigned(n - i) : block;
+    unsigned j;
+
+    for (j = 0; j < count; j++)
+      buffer[j] = asDouble(in[i + j]);
+    valueMap.apply(buffer, buffer, count);
+    for (j = 0; j < count; j++)
+      out[i + j] = Type(buffer[j]);
+  }
+}
+
+// Range of the types that CompiledMapKernel tabulates (none by default)
+template <class Type> struct _MapTableRange {
+  static const long min = 0, max = -1;
+  static long index(const Type&) { return 0; } };
+#define _MAP_TABLE_RANGE(Type, Min, Max) \
+  template <> struct _MapTableRange<Type> { \
+    static const long min = Min, max = Max; \
+    static long index(Type value) { return long(value); } };
+_MAP_TABLE_RANGE(char, CHAR_MIN, CHAR_MAX)
+_MAP_TABLE_RANGE(signed char, SCHAR_MIN, SCHAR_MAX)
+_MAP_TABLE_RANGE(unsigned char, 0, UCHAR_MAX)
+_MAP_TABLE_RANGE(short, SHRT_MIN, SHRT_MAX)
+_MAP_TABLE_RANGE(unsigned short, 0, USHRT_MAX)
+#undef _MAP_TABLE_RANGE
+
+template <class Type>
+CompiledMapKernel<Type>::CompiledMapKernel(const CompiledMap& map, unsigned long nElements)
+  : _map(map),
+    _table(0),
+    _tableMin(0)
+{
+  _tableMin = _MapTableRange<Type>::min;
+  const long tableSize = _MapTableRange<Type>::max - _tableMin + 1;
+  if ((tableSize <= 0) || (nElements < (unsigned long) tableSize))
+    return;
+
+  const unsigned block = 256;
+  double buffer[block];
+
+  _table = new Type[tableSize];
+  for (long i = 0; i < tableSize; i += block) {
+    const unsigned count = (tableSize - i < block) ? unsigned(tableSize - i) : block;
+    unsigned j;
+    for (j = 0; j < count; j++)
+      buffer[j] = double(_tableMin + i + j);
+    _map.apply(buffer, buffer, count);
+    for (j = 0; j < count; j++)
+      _table[i + j] = Type(buffer[j]);
+  }
+}
+
+template <class Type>
+void
+CompiledMapKernel<Type>::operator () (const Type *in, Type *out, unsigned long n) const
+{
+  if (_table)
+    for (unsigned long i = 0; i < n; i++)
+      out[i] = _table[_MapTableRange<Type>::index(in[i]) - _tableMin];
+  else
+    mapValues(_map, in, out, n);
+}
+
 #endif
 
@@ -0,0 +1,223 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _WARP_H
+#define _WARP_H
+
+/******************************************************************************
+ * Geometric warping of volumes (slice/row pointer arrays) through an affine
+ * transformation or a displacement field. Output voxel (s, r, c) receives the
+ * input interpolated at position
+ *
+ *   affine:        A * (s, r, c, 1)'   (A: 3 x 4, voxel coordinates)
+ *   displacement:  (s + ds(s, r, c), r + dr(s, r, c), c + dc(s, r, c))
+ *
+ * with nearest neighbour, (tri)linear, cubic or windowed-sinc interpolation
+ * (see ResampleKernel). Samples outside the input are supplied according to
+ * the border mode, through index mapping rather than a padded copy. Positions
+ * that are NaN lie outside the input in every border mode (giving zeros), as
+ * do infinite positions, except that BORDER_CLAMP takes the end sample. Affine
+ * positions are updated incrementally along each output row. Output rows are
+ * independent, and are distributed over threads when OpenMP is enabled.
+ *****************************************************************************/
+
+#include <math.h>
+#include "MatrixSupport.h"
+#include "Convolution.h"
+
+// Taps of an interpolation kernel at position x of a line of n samples:
+// indices (-1 for zeros outside the line) and weights, normalized to a sum of
+// 1 as in ResampleTable. Returns the number of taps (at most 6).
+inline unsigned
+_warpTaps(double x, unsigned n, ResampleKernel kernel, BorderMode border,
+	  int *index, double *weight)
+{
+  // Non-finite positions are outside the line
+  if (!(x - x == 0)) {
+    index[0]  = ((border == BORDER_CLAMP) && (x == x)) ? ((x < 0) ? 0 : int(n) - 1) : -1;
+    weight[0] = 1;
+    return 1;
+  }
+
+  // Positions far outside the line are brought back to within a few taps of
+  // it, giving the same samples (periodically for BORDER_MIRROR and
+  // BORDER_WRAP), so that the index arithmetic below stays within int
+  const double margin = 2*resampleSupport(kernel) + 1;
+  if ((x < -margin) || (x > n + margin)) {
+    if ((border == BORDER_MIRROR) || (border == BORDER_WRAP)) {
+      const double period = (border == BORDER_MIRROR) ? 2.0*n : double(n);
+      x = fmod(x, period);
+      if (x < 0)
+	x += period;
+    }
+    else
+      x = (x < 0) ? -margin : n + margin;
+  }
+
+  if (kernel == RESAMPLE_NEAREST) {
+    index[0]  = borderIndex(int(floor(x + 0.5)), n, border);
+    weight[0] = 1;
+    return 1;
+  }
+
+  const double   base  = floor(x);
+  const unsigned nTaps = 2*unsigned(resampleSupport(kernel));
+  const int      first = int(base) + 1 - int(nTaps/2);
+
+  if (kernel == RESAMPLE_LINEAR) {
+    weight[0] = 1 - (x - base);
+    weight[1] = x - base;
+  }
+  else {
+    double   sum = 0;
+    unsigned t;
+    for (t = 0; t < nTaps; t++) {
+      weight[t] = resampleWeight(kernel, first + int(t) - x);
+      sum += weight[t];
+    }
+    if (sum != 0)
+      for (t = 0; t < nTaps; t++)
+	weight[t] /= sum;
+  }
+
+  if ((first >= 0) && (first + int(nTaps) <= int(n)))
+    for (unsigned t = 0; t < nTaps; t++)
+      index[t] = first + int(t);
+  else
+    for (unsigned t = 0; t < nTaps; t++)
+      index[t] = borderIndex(first + int(t), n, border);
+
+  return nTaps;
+}
+
+// Input interpolated at position (s, r, c)
+template <class Type>
+inline typename ConvAccumulator<Type>::Acc
+_warpSample(const Type * const * const *in, unsigned nslis, unsigned nrows,
+	    unsigned ncols, double s, double r, double c, ResampleKernel kernel,
+	    BorderMode border)
+{
+  typedef typename ConvAccumulator<Type>::Acc Acc;
+
+  int      sIndex[6], rIndex[6], cIndex[6];
+  double   sWeight[6], rWeight[6], cWeight[6];
+  const unsigned ns = (nslis == 1) ? 1 : _warpTaps(s, nslis, kernel, border, sIndex, sWeight);
+  const unsigned nr = _warpTaps(r, nrows, kernel, border, rIndex, rWeight);
+  const unsigned nc = _warpTaps(c, ncols, kernel, border, cIndex, cWeight);
+
+  // A single slice is only sampled within the slice
+  if (nslis == 1) {
+    if (fabs(s) < 0.5) {
+      sIndex[0]  = 0;
+      sWeight[0] = 1;
+    }
+    else
+      _warpTaps(s, 1, RESAMPLE_NEAREST, border, sIndex, sWeight);
+  }
+
+  Acc sum = 0;
+  for (unsigned a = 0; a < ns; a++) {
+    if ((sIndex[a] < 0) || (sWeight[a] == 0))
+      continue;
+    const Type * const *slice = in[sIndex[a]];
+    for (unsigned b = 0; b < nr; b++) {
+      if ((rIndex[b] < 0) || (rWeight[b] == 0))
+	continue;
+      const Type *row = slice[rIndex[b]];
+      Acc rowSum = 0;
+      for (unsigned d = 0; d < nc; d++)
+	if (cIndex[d] >= 0)
+	  rowSum += cWeight[d]*Acc(row[cIndex[d]]);
+      sum += (sWeight[a]*rWeight[b])*rowSum;
+    }
+  }
+
+  return sum;
+}
+
+// Affine warp of in (nslis x nrows x ncols) into out (outSlis x outRows x
+// outCols); affine holds the 3 x 4 matrix A row by row.
+template <class Type>
+void
+warpAffine(Type ***out, unsigned outSlis, unsigned outRows, unsigned outCols,
+	   const Type * const * const *in, unsigned nslis, unsigned nrows,
+	   unsigned ncols, const double affine[12],
+	   ResampleKernel kernel = RESAMPLE_LINEAR, BorderMode border = BORDER_ZERO)
+{
+  if (!nslis || !nrows || !ncols)
+    return;
+
+  const int nLines = int(outSlis*outRows);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int line = 0; line < nLines; line++) {
+    const double s = line/outRows;
+    const double r = line%outRows;
+    Type  *outRow  = out[line/outRows][line%outRows];
+
+    // Position of column 0; each column adds the last column of A
+    double x0 = affine[0]*s + affine[1]*r + affine[3];
+    double x1 = affine[4]*s + affine[5]*r + affine[7];
+    double x2 = affine[8]*s + affine[9]*r + affine[11];
+
+    for (unsigned c = 0; c < outCols; c++) {
+      _convFromAcc(_warpSample(in, nslis, nrows, ncols, x0, x1, x2, kernel, border),
+		   outRow[c]);
+      x0 += affine[2];
+      x1 += affine[6];
+      x2 += affine[10];
+    }
+  }
+}
+
+// Warp of in through the displacement field (dSlice, dRow, dCol), which has
+// the dimensions of out (outSlis x outRows x outCols)
+template <class Type>
+void
+warpField(Type ***out, unsigned outSlis, unsigned outRows, unsigned outCols,
+	  const Type * const * const *in, unsigned nslis, unsigned nrows,
+	  unsigned ncols, const double * const * const *dSlice,
+	  const double * const * const *dRow, const double * const * const *dCol,
+	  ResampleKernel kernel = RESAMPLE_LINEAR, BorderMode border = BORDER_ZERO)
+{
+  if (!nslis || !nrows || !ncols)
+    return;
+
+  const int nLines = int(outSlis*outRows);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int line = 0; line < nLines; line++) {
+    const unsigned s = line/outRows;
+    const unsigned r = line%outRows;
+    const double  *ds = dSlice[s][r];
+    const double  *dr = dRow[s][r];
+    const double  *dc = dCol[s][r];
+    Type          *outRow = out[s][r];
+
+    for (unsigned c = 0; c < outCols; c++)
+      _convFromAcc(_warpSample(in, nslis, nrows, ncols, s + ds[c], r + dr[c],
+			       c + dc[c], kernel, border), outRow[c]);
+  }
+}
+
+#endif
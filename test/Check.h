@@ -0,0 +1,84 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+#ifndef _CHECK_H
+#define _CHECK_H
+
+// Minimal support for the regression tests run by 'make check': check()
+// reports a condition that does not hold, and checkStatus() is returned by
+// main() so that any failure fails the test.
+
+#include <iostream>
+#include <math.h>
+
+static unsigned _checkFailures = 0;
+
+#define check(EX)  if(!(EX)) { \
+  std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #EX \
+            << std::endl; _checkFailures++; }
+
+// TRUE if a and b agree to within tol (absolute, or relative to the larger)
+inline bool
+near(double a, double b, double tol = 1e-9)
+{
+  const double scale = (fabs(a) > fabs(b)) ? fabs(a) : fabs(b);
+  return fabs(a - b) <= tol*((scale > 1) ? scale : 1);
+}
+
+// An nslis x nrows x ncols image with the slice/row pointer arrays taken by
+// the image engines (el[s][r][c])
+template <class Type>
+struct Volume {
+  unsigned nslis, nrows, ncols;
+  Type    *data;
+  Type   **rows;
+  Type  ***el;
+
+  Volume(unsigned s, unsigned r, unsigned c, Type value = Type(0))
+    : nslis(s), nrows(r), ncols(c) {
+    data = new Type[s*r*c + 1];
+    rows = new Type *[s*r + 1];
+    el   = new Type **[s + 1];
+    for (unsigned i = 0; i < s*r*c; i++)
+      data[i] = value;
+    for (unsigned i = 0; i < s*r; i++)
+      rows[i] = data + i*c;
+    for (unsigned i = 0; i < s; i++)
+      el[i] = rows + i*r;
+  }
+  ~Volume() { delete [] data; delete [] rows; delete [] el; }
+
+  Type& operator () (unsigned s, unsigned r, unsigned c) {
+    return data[(s*nrows + r)*ncols + c]; }
+  const Type * const * const *in() const { return el; }
+
+private:
+  Volume(const Volume&);
+  Volume& operator = (const Volume&);
+};
+
+inline int
+checkStatus()
+{
+  if (_checkFailures)
+    std::cerr << _checkFailures << " check(s) failed" << std::endl;
+  return _checkFailures ? 1 : 0;
+}
+
+#endif
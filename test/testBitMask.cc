@@ -0,0 +1,227 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for bit-packed binary morphology (BitMask.h): erosion,
+// dilation, opening and closing of random 0/1 masks must match greylevel
+// morphology (Morphology.h, as used by Mat::erode() and Mat::dilate()) for
+// every strel shape, with widths on either side of word boundaries. The
+// greylevel path surrounds the image with zeros, which BitMask must honour
+// for masks touching the border (full and edge-only masks are included).
+// fillHoles() must match a flood fill of the background from the border.
+
+#include <stdlib.h>
+#include <math.h>
+#include "Matrix.h"
+#include "BitMask.h"
+#include "Morphology.h"
+#include "Check.h"
+
+enum StrelShape { BOX, EVEN_BOX, ROW_LINE, COL_LINE, SLICE_LINE, CROSS,
+		  BALL, OFF_CENTER, RANDOM, N_SHAPES };
+
+// Flat strel of the given shape (-1: inactive); 2D strels have one slice
+static CompiledStrel
+makeStrel(StrelShape shape, Boolean volume)
+{
+  unsigned ks = volume ? 3 : 1, kr = 3, kc = 3;
+  switch (shape) {
+  case EVEN_BOX:   ks = volume ? 2 : 1; kr = 4; kc = 2; break;
+  case ROW_LINE:   ks = 1; kr = 1; kc = 7; break;
+  case COL_LINE:   ks = 1; kr = 5; kc = 1; break;
+  case SLICE_LINE: ks = volume ? 4 : 1; kr = 1; kc = 1; break;
+  case BALL:       ks = volume ? 5 : 1; kr = 5; kc = 5; break;
+  case RANDOM:     ks = volume ? 3 : 1; kr = 4; kc = 6; break;
+  default: break;
+  }
+
+  Volume<double> strel(ks, kr, kc, -1.0);
+  for (unsigned s = 0; s < ks; s++)
+    for (unsigned r = 0; r < kr; r++)
+      for (unsigned c = 0; c < kc; c++) {
+	const int ds = int(s) - int(ks/2), dr = int(r) - int(kr/2), dc = int(c) - int(kc/2);
+	Boolean active;
+	switch (shape) {
+	case CROSS:      active = (ds != 0) + (dr != 0) + (dc != 0) <= 1; break;
+	case BALL:       active = ds*ds + dr*dr + dc*dc <= 4; break;
+	case OFF_CENTER: active = (s == 0) && (r == 2) && (c == 1); break;
+	case RANDOM:     active = drand48() < 0.4; break;
+	default:         active = TRUE; break;
+	}
+	if (active)
+	  strel(s, r, c) = 0;
+      }
+
+  return CompiledStrel(strel.in(), ks, kr, kc);
+}
+
+// Greylevel erosion or dilation of in (0/1) into out
+static void
+greylevel(Volume<int>& out, Volume<int>& in, const CompiledStrel& strel,
+	  Boolean dilate)
+{
+  morphology(out.el, (const int * const * const *) in.el, in.nslis, in.nrows,
+	     in.ncols, strel, dilate);
+}
+
+static Boolean
+sameMask(const BitMask& mask, Volume<int>& expected)
+{
+  for (unsigned s = 0; s < expected.nslis; s++)
+    for (unsigned r = 0; r < expected.nrows; r++)
+      for (unsigned c = 0; c < expected.ncols; c++)
+	if (mask(s, r, c) != (expected(s, r, c) != 0))
+	  return FALSE;
+  return TRUE;
+}
+
+static BitMask
+toBitMask(Volume<int>& in)
+{
+  Volume<unsigned char> bytes(in.nslis, in.nrows, in.ncols);
+  for (unsigned i = 0; i < in.nslis*in.nrows*in.ncols; i++)
+    bytes.data[i] = (unsigned char) in.data[i];
+  return BitMask(bytes.in(), in.nslis, in.nrows, in.ncols);
+}
+
+// Background voxels 6-connected (4-connected in 2D) to the border are
+// cleared; all others set
+static void
+fillHoles(Volume<int>& out, Volume<int>& in)
+{
+  const unsigned n = in.nslis*in.nrows*in.ncols;
+  unsigned *stack = new unsigned[n];
+  unsigned  top   = 0;
+  for (unsigned i = 0; i < n; i++)
+    out.data[i] = 1;
+  for (unsigned s = 0; s < in.nslis; s++)
+    for (unsigned r = 0; r < in.nrows; r++)
+      for (unsigned c = 0; c < in.ncols; c++) {
+	const Boolean border = (in.nslis > 1 && (!s || (s == in.nslis - 1))) ||
+	  !r || (r == in.nrows - 1) || !c || (c == in.ncols - 1);
+	const unsigned i = (s*in.nrows + r)*in.ncols + c;
+	if (border && !in.data[i] && out.data[i]) {
+	  out.data[i] = 0;
+	  stack[top++] = i;
+	}
+      }
+  while (top) {
+    const unsigned i = stack[--top];
+    const unsigned c = i % in.ncols, r = (i/in.ncols) % in.nrows, s = i/(in.ncols*in.nrows);
+    const int neighbours[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0},
+				  {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+    for (unsigned k = 0; k < 6; k++) {
+      const int ns = int(s) + neighbours[k][0];
+      const int nr = int(r) + neighbours[k][1];
+      const int nc = int(c) + neighbours[k][2];
+      if ((ns < 0) || (nr < 0) || (nc < 0) || (ns >= int(in.nslis)) ||
+	  (nr >= int(in.nrows)) || (nc >= int(in.ncols)))
+	continue;
+      const unsigned j = (unsigned(ns)*in.nrows + unsigned(nr))*in.ncols + unsigned(nc);
+      if (!in.data[j] && out.data[j]) {
+	out.data[j] = 0;
+	stack[top++] = j;
+      }
+    }
+  }
+  delete [] stack;
+}
+
+enum Fill { RANDOM_FILL, SPARSE_FILL, FULL, EDGES, N_FILLS };
+
+static void
+testMask(unsigned nslis, unsigned nrows, unsigned ncols)
+{
+  Volume<int> in(nslis, nrows, ncols), out(nslis, nrows, ncols);
+  Volume<int> tmp(nslis, nrows, ncols), ref(nslis, nrows, ncols);
+
+  for (unsigned fill = 0; fill < N_FILLS; fill++) {
+    for (unsigned s = 0; s < nslis; s++)
+      for (unsigned r = 0; r < nrows; r++)
+	for (unsigned c = 0; c < ncols; c++) {
+	  int value;
+	  switch (fill) {
+	  case RANDOM_FILL: value = drand48() < 0.6; break;
+	  case SPARSE_FILL: value = drand48() < 0.1; break;
+	  case FULL:        value = 1; break;
+	  default:
+	    value = !r || !c || (r == nrows - 1) || (c == ncols - 1) ||
+	      ((nslis > 1) && (!s || (s == nslis - 1)));
+	    break;
+	  }
+	  in(s, r, c) = value;
+	}
+    const BitMask mask = toBitMask(in);
+
+    for (unsigned shape = 0; shape < N_SHAPES; shape++) {
+      const CompiledStrel strel = makeStrel(StrelShape(shape), nslis > 1);
+
+      greylevel(out, in, strel, FALSE);
+      check(sameMask(mask.erode(strel), out));
+      greylevel(out, in, strel, TRUE);
+      check(sameMask(mask.dilate(strel), out));
+
+      greylevel(tmp, in, strel, FALSE);
+      greylevel(out, tmp, strel, TRUE);
+      check(sameMask(mask.open(strel), out));
+      greylevel(tmp, in, strel, TRUE);
+      greylevel(out, tmp, strel, FALSE);
+      check(sameMask(mask.close(strel), out));
+    }
+
+    fillHoles(ref, in);
+    check(sameMask(mask.fillHoles(), ref));
+  }
+}
+
+int
+main()
+{
+  srand48(33);
+
+  static const unsigned widths[] = {1, 2, 31, 63, 64, 65, 127, 128, 130, 200};
+  for (unsigned w = 0; w < sizeof(widths)/sizeof(widths[0]); w++) {
+    testMask(1, 9, widths[w]);
+    testMask(1, 1, widths[w]);
+    testMask(5, 6, widths[w]);
+  }
+  testMask(2, 3, 70);
+
+  // Through Mat<double>, as the greylevel path of a 2D mask
+  Mat<double> A(11, 70);
+  Volume<int> in(1, 11, 70);
+  for (unsigned r = 0; r < 11; r++)
+    for (unsigned c = 0; c < 70; c++)
+      A(r, c) = in(0, r, c) = drand48() < 0.5;
+  const BitMask mask = toBitMask(in);
+  for (unsigned shape = 0; shape < N_SHAPES; shape++) {
+    const CompiledStrel strel = makeStrel(StrelShape(shape), FALSE);
+    const Mat<double> eroded  = A.erode(strel);
+    const Mat<double> dilated = A.dilate(strel);
+    const BitMask     bitEroded  = mask.erode(strel);
+    const BitMask     bitDilated = mask.dilate(strel);
+    unsigned nDiff = 0;
+    for (unsigned r = 0; r < 11; r++)
+      for (unsigned c = 0; c < 70; c++)
+	nDiff += (bitEroded(0, r, c) != (eroded(r, c) != 0)) +
+	  (bitDilated(0, r, c) != (dilated(r, c) != 0));
+    check(nDiff == 0);
+  }
+
+  return checkStatus();
+}
@@ -0,0 +1,137 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for box filtering (IntegralImage.h and Mat::boxFilter()):
+// sums, means and variances of clipped windows must match brute force for
+// odd and even windows, values with a large offset must not lose their
+// variance to cancellation, and zero-size windows must not produce NaNs.
+
+#include <stdlib.h>
+#include <math.h>
+#include "Matrix.h"
+#include "IntegralImage.h"
+#include "Check.h"
+
+static const BoxStatistic statistics[] = {BOX_SUM, BOX_MEAN, BOX_VARIANCE};
+
+// Box statistic of the window (clipped to the image) centered on (s, r, c)
+static double
+bruteForce(Volume<double>& in, unsigned s, unsigned r, unsigned c,
+	   unsigned ks, unsigned kr, unsigned kc, BoxStatistic statistic)
+{
+  double   sum = 0, sumSq = 0;
+  unsigned n   = 0;
+  for (int i = int(s) - int(ks/2); i < int(s + ks - ks/2); i++)
+    for (int j = int(r) - int(kr/2); j < int(r + kr - kr/2); j++)
+      for (int k = int(c) - int(kc/2); k < int(c + kc - kc/2); k++) {
+	if ((i < 0) || (j < 0) || (k < 0) || (i >= int(in.nslis)) ||
+	    (j >= int(in.nrows)) || (k >= int(in.ncols)))
+	  continue;
+	sum += in(i, j, k);
+	n++;
+      }
+  if (statistic == BOX_SUM)
+    return sum;
+  const double mean = sum/n;
+  if (statistic == BOX_MEAN)
+    return mean;
+  for (int i = int(s) - int(ks/2); i < int(s + ks - ks/2); i++)
+    for (int j = int(r) - int(kr/2); j < int(r + kr - kr/2); j++)
+      for (int k = int(c) - int(kc/2); k < int(c + kc - kc/2); k++) {
+	if ((i < 0) || (j < 0) || (k < 0) || (i >= int(in.nslis)) ||
+	    (j >= int(in.nrows)) || (k >= int(in.ncols)))
+	  continue;
+	sumSq += (in(i, j, k) - mean)*(in(i, j, k) - mean);
+      }
+  return sumSq/n;
+}
+
+static void
+testVolume(unsigned nslis, unsigned nrows, unsigned ncols, double offset)
+{
+  Volume<double> in(nslis, nrows, ncols);
+  for (unsigned i = 0; i < nslis*nrows*ncols; i++)
+    in.data[i] = offset + drand48();
+
+  IntegralImage table(in.in(), nslis, nrows, ncols);
+  for (unsigned ks = 1; ks <= 4; ks++)
+    for (unsigned kr = 1; kr <= 4; kr++)
+      for (unsigned kc = 1; kc <= 5; kc++)
+	for (unsigned t = 0; t < 3; t++) {
+	  Volume<double> out(nslis, nrows, ncols);
+	  table.boxFilter(out.el, ks, kr, kc, statistics[t]);
+	  // Cancellation limits the variance to the precision of the offset
+	  const double tol = (statistics[t] == BOX_VARIANCE) ? 1e-6 : 1e-9;
+	  for (unsigned s = 0; s < nslis; s++)
+	    for (unsigned r = 0; r < nrows; r++)
+	      for (unsigned c = 0; c < ncols; c++)
+		check(near(out(s, r, c),
+			   bruteForce(in, s, r, c, ks, kr, kc, statistics[t]), tol));
+	}
+}
+
+int
+main()
+{
+  srand48(40);
+
+  testVolume(1, 7, 9, 0);
+  testVolume(4, 5, 6, 0);
+  testVolume(3, 6, 5, 1e4);
+
+  // Empty boxes have a zero mean and variance
+  Volume<double> in(2, 3, 4, 1.5);
+  IntegralImage  table(in.in(), 2, 3, 4);
+  check(table.count(1, 1, 0, 3, 0, 4) == 0);
+  check(table.sum(1, 1, 0, 3, 0, 4) == 0);
+  check(table.mean(1, 1, 0, 3, 0, 4) == 0);
+  check(table.variance(0, 2, 2, 2, 0, 4) == 0);
+  check(near(table.mean(0, 2, 0, 3, 0, 4), 1.5));
+
+  // Zero-size windows leave the output untouched
+  for (unsigned t = 0; t < 3; t++) {
+    Volume<double> out(2, 3, 4, -1.0);
+    table.boxFilter(out.el, 0, 3, 3, statistics[t]);
+    table.boxFilter(out.el, 3, 0, 3, statistics[t]);
+    table.boxFilter(out.el, 3, 3, 0, statistics[t]);
+    for (unsigned i = 0; i < 2*3*4; i++)
+      check(out.data[i] == -1.0);
+  }
+
+  // Through Mat: a zero-size window gives zeros
+  Mat<double> A(5, 6);
+  for (unsigned r = 0; r < 5; r++)
+    for (unsigned c = 0; c < 6; c++)
+      A(r, c) = drand48();
+  for (unsigned t = 0; t < 3; t++) {
+    Mat<double> B = A.boxFilter(0, 3, statistics[t]);
+    Mat<double> C = A.boxFilter(3, 0, statistics[t]);
+    for (unsigned r = 0; r < 5; r++)
+      for (unsigned c = 0; c < 6; c++) {
+	check(B(r, c) == 0);
+	check(C(r, c) == 0);
+      }
+  }
+  Mat<double> mean = A.boxFilter(3, 3);
+  check(near(mean(2, 2), (A(1,1) + A(1,2) + A(1,3) + A(2,1) + A(2,2) + A(2,3) +
+			   A(3,1) + A(3,2) + A(3,3))/9));
+  check(near(mean(0, 0), (A(0,0) + A(0,1) + A(1,0) + A(1,1))/4));
+
+  return checkStatus();
+}
@@ -0,0 +1,344 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for CompiledMap and CompiledMapKernel (ValueMap.h): a
+// compiled chain of LinearMap, ClipMap and LUT stages must map values as
+// applying the stages one by one does, with LUT stages evaluated by the
+// linear scan of the former LUT implementation (exactly so at breakpoints,
+// ties and beyond the table), and must compile to the fewest stages; the
+// tables of CompiledMapKernel must reproduce the compiled chain for every
+// value of the tabulated types.
+
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include "Matrix.h"
+#include "ValueMap.h"
+#include "Check.h"
+
+// A LUT stage as evaluated by the former implementation: the nearest entry,
+// the lower one on ties, the last one beyond the table or for a NaN
+struct ScanLUT {
+  enum { MAXLEN = 64 };
+  double   source[MAXLEN], dest[MAXLEN];
+  unsigned length;
+
+  double operator () (double x) const {
+    for (unsigned i = 0; i < length; i++)
+      if (source[i] >= x)
+	return (!i || (source[i] - x) < (x - source[i - 1])) ? dest[i] : dest[i - 1];
+    return dest[length - 1];
+  }
+
+  LUT<double> lut() const {
+    LUT<double> map;
+    for (unsigned i = 0; i < length; i++)
+      map.add(source[i], dest[i]);
+    return map;
+  }
+};
+
+// A chain of stages, both compiled and kept for evaluation one by one
+struct Chain {
+  enum { LINEAR, CLIP, TABLE, MAXSTAGES = 8 };
+  unsigned    nStages;
+  int         type[MAXSTAGES];
+  double      p[MAXSTAGES][4];
+  ScanLUT     table[MAXSTAGES];
+  CompiledMap compiled;
+
+  Chain() : nStages(0) {}
+
+  void linear(double factor, double offset) {
+    type[nStages] = LINEAR;
+    p[nStages][0] = factor; p[nStages][1] = offset;
+    nStages++;
+    compiled.add(LinearMap(factor, offset));
+  }
+  void clip(double minVal, double maxVal, double minFill, double maxFill) {
+    type[nStages] = CLIP;
+    p[nStages][0] = minVal;  p[nStages][1] = maxVal;
+    p[nStages][2] = minFill; p[nStages][3] = maxFill;
+    nStages++;
+    // Through concat(), as a ValueMap
+    const ClipMap map(minVal, maxVal, minFill, maxFill);
+    compiled.concat((const ValueMap&) map);
+  }
+  void lut(const ScanLUT& entries) {
+    type[nStages]  = TABLE;
+    table[nStages] = entries;
+    nStages++;
+    compiled.add(entries.lut());
+  }
+
+  double operator () (double x) const {
+    for (unsigned s = 0; s < nStages; s++)
+      switch (type[s]) {
+      case LINEAR:
+	x = LinearMap(p[s][0], p[s][1])(x);
+	break;
+      case CLIP:
+	x = ClipMap(p[s][0], p[s][1], p[s][2], p[s][3])(x);
+	break;
+      case TABLE:
+	x = table[s](x);
+	break;
+      }
+    return x;
+  }
+};
+
+// Same value, or both NaN, or close (combined linear stages round
+// differently)
+static bool
+same(double a, double b, double tol)
+{
+  return (a == b) || ((a != a) && (b != b)) || near(a, b, tol);
+}
+
+// The compiled chain against the stages, one by one and in a block
+static void
+compare(const Chain& chain, const double *x, unsigned n, double tol)
+{
+  double y[1024];
+  CompiledMap copy;
+  copy = chain.compiled;
+
+  chain.compiled.apply(x, y, n);
+  for (unsigned i = 0; i < n; i++) {
+    const double expected = chain(x[i]);
+    check(same(chain.compiled(x[i]), expected, tol));
+    check(same(y[i], expected, tol));
+    check(same(copy(x[i]), expected, tol));
+  }
+
+  // In place, and as a stage of another chain
+  for (unsigned i = 0; i < n; i++)
+    y[i] = x[i];
+  CompiledMap outer;
+  outer.add(chain.compiled);
+  outer.apply(y, y, n);
+  for (unsigned i = 0; i < n; i++)
+    check(same(y[i], chain(x[i]), tol));
+}
+
+static void
+randomEntries(ScanLUT& entries, Boolean uniform)
+{
+  entries.length = 1 + unsigned(drand48()*(ScanLUT::MAXLEN - 1));
+  for (unsigned i = 0; i < entries.length; i++) {
+    entries.source[i] = uniform ? 0.25*i - 4
+      : (i ? entries.source[i - 1] : -5) + 0.01 + drand48();
+    entries.dest[i] = 20*drand48() - 10;
+  }
+}
+
+// A chain of random stages, probed at random values and the breakpoints of
+// a leading LUT
+static void
+testRandomChain()
+{
+  Chain chain;
+  const unsigned nStages = 1 + unsigned(drand48()*(Chain::MAXSTAGES - 1));
+  for (unsigned s = 0; s < nStages; s++) {
+    const double r = drand48();
+    if (r < 0.4)
+      chain.linear((drand48() < 0.5 ? -1 : 1)*(0.2 + 3*drand48()), 10*drand48() - 5);
+    else if (r < 0.7) {
+      const double lo = 10*drand48() - 8, hi = lo + 10*drand48();
+      if (drand48() < 0.5)
+	chain.clip(lo, hi, lo, hi);
+      else
+	chain.clip(lo, hi, 20*drand48() - 10, 20*drand48() - 10);
+    }
+    else {
+      ScanLUT entries;
+      randomEntries(entries, drand48() < 0.5);
+      chain.lut(entries);
+    }
+  }
+
+  double x[1024];
+  unsigned n = 0, i;
+  for (i = 0; i < 300; i++)
+    x[n++] = 60*drand48() - 30;
+  if (chain.type[0] == Chain::TABLE)
+    for (i = 0; i < chain.table[0].length; i++)
+      x[n++] = chain.table[0].source[i];
+  x[n++] = 1e300;
+  x[n++] = -1e300;
+  x[n++] = HUGE_VAL;
+  x[n++] = -HUGE_VAL;
+  x[n++] = sqrt(-1.0);
+
+  compare(chain, x, n, 1e-9);
+  check(chain.compiled.nStages() <= nStages);
+}
+
+// Linear, LUT, clip and linear stages in exact arithmetic, probed at the
+// breakpoints of the LUT, at ties and beyond the table
+static void
+testBreakpoints(Boolean uniform)
+{
+  ScanLUT entries;
+  entries.length = 17;
+  for (unsigned i = 0; i < entries.length; i++) {
+    entries.source[i] = uniform ? 0.5*i - 4 : (i ? entries.source[i - 1] : -4) + 0.25*(1 + i%3);
+    entries.dest[i]   = floor(20*drand48()) - 10;
+  }
+
+  Chain chain;
+  chain.linear(2, 1);
+  chain.lut(entries);
+  chain.clip(-5, 5, -7, 9);
+  chain.linear(0.5, 3);
+  check(chain.compiled.nStages() == 1);
+
+  double x[256];
+  unsigned n = 0;
+  for (unsigned i = 0; i < entries.length; i++) {
+    // 2x + 1 is the breakpoint, a tie, or next to either
+    x[n++] = (entries.source[i] - 1)/2;
+    x[n++] = (entries.source[i] + 0.125 - 1)/2;
+    x[n++] = (entries.source[i] - 0.125 - 1)/2;
+    x[n++] = (nextafter(entries.source[i], HUGE_VAL) - 1)/2;
+    x[n++] = (entries.source[i] + 0.0625 - 1)/2;
+  }
+  x[n++] = -100;
+  x[n++] = 100;
+  x[n++] = -HUGE_VAL;
+  x[n++] = HUGE_VAL;
+  x[n++] = sqrt(-1.0);
+
+  compare(chain, x, n, 0);
+}
+
+// The tables of CompiledMapKernel (and the compiled stages it otherwise
+// uses) against the compiled chain, for the given values of Type; the chain
+// ends by clipping to the range of Type
+template <class Type>
+static void
+testKernel(const Type *values, unsigned long n, double minValue, double maxValue)
+{
+  for (unsigned t = 0; t < 5; t++) {
+    ScanLUT entries;
+    randomEntries(entries, t%2);
+    for (unsigned i = 0; i < entries.length; i++) {
+      entries.source[i] = minValue + (entries.source[i] + 5)/40*(maxValue - minValue);
+      entries.dest[i]   = minValue + (entries.dest[i] + 10)/20*(maxValue - minValue);
+    }
+
+    CompiledMap map;
+    map.add(LinearMap(1.5, -0.25*(maxValue - minValue)));
+    if (t > 1)
+      map.add(entries.lut());
+    map.add(LinearMap(-1, maxValue + minValue));
+    map.add(ClipMap(minValue, maxValue));
+
+    Type *out      = new Type[n];
+    Type *outBlock = new Type[n];
+    const CompiledMapKernel<Type> tabulated(map);
+    const CompiledMapKernel<Type> direct(map, 1);
+    tabulated(values, out, n);
+    direct(values, outBlock, n);
+    for (unsigned long i = 0; i < n; i++) {
+      const Type expected = Type(map(double(values[i])));
+      check(out[i] == expected);
+      check(outBlock[i] == expected);
+    }
+
+    // In place
+    for (unsigned long i = 0; i < n; i++)
+      out[i] = values[i];
+    tabulated(out, out, n);
+    for (unsigned long i = 0; i < n; i++)
+      check(out[i] == outBlock[i]);
+
+    delete [] out;
+    delete [] outBlock;
+  }
+}
+
+template <class Type>
+static void
+testKernelAll(long minValue, long maxValue)
+{
+  const unsigned long n = maxValue - minValue + 1;
+  Type *values = new Type[n];
+  for (unsigned long i = 0; i < n; i++)
+    values[i] = Type(minValue + long(i));
+  testKernel(values, n, double(minValue), double(maxValue));
+  delete [] values;
+}
+
+int
+main()
+{
+  unsigned i;
+
+  srand48(44);
+
+  for (i = 0; i < 200; i++)
+    testRandomChain();
+  testBreakpoints(TRUE);
+  testBreakpoints(FALSE);
+
+  // Stages are combined as documented
+  CompiledMap empty;
+  check(empty.nStages() == 0);
+  check(empty(-2.5) == -2.5);
+  CompiledMap linear;
+  linear.add(LinearMap(2, 1)).add(LinearMap(3, -1));
+  check(linear.nStages() == 1);
+  check(linear(1.5) == 11);
+  CompiledMap clipped;
+  clipped.add(LinearMap(2, 1)).add(ClipMap(0, 4)).add(LinearMap(0.5, 0));
+  check(clipped.nStages() == 3);
+  check(clipped(-3) == 0);
+  check(clipped(1) == 1.5);
+  check(clipped(7) == 2);
+  ScanLUT entries;
+  randomEntries(entries, TRUE);
+  CompiledMap folded;
+  folded.add(ClipMap(-3, 3)).add(LinearMap(2, 0)).add(entries.lut())
+    .add(ClipMap(-1, 1, -2, 2)).add(LinearMap(4, 1));
+  check(folded.nStages() == 2);
+  CompiledMap scale;
+  scale.addScale(0, 100, 0, 255);
+  check(scale(-10) == 0);
+  check(near(scale(50), 127.5));
+  check(scale(200) == 255);
+
+  // Every value of the tabulated types, and random ones of the others
+  testKernelAll<unsigned char>(0, UCHAR_MAX);
+  testKernelAll<signed char>(SCHAR_MIN, SCHAR_MAX);
+  testKernelAll<short>(SHRT_MIN, SHRT_MAX);
+  testKernelAll<unsigned short>(0, USHRT_MAX);
+  const unsigned long n = 5000;
+  int   intValues[n];
+  float floatValues[n];
+  for (i = 0; i < n; i++) {
+    intValues[i]   = int(2e6*drand48()) - 1000000;
+    floatValues[i] = float(2e3*drand48() - 1e3);
+  }
+  testKernel(intValues, n, -1e6, 1e6);
+  testKernel(floatValues, n, -1e3, 1e3);
+
+  return checkStatus();
+}
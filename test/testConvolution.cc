@@ -0,0 +1,90 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for FFT convolution (Convolution.h): FFT, separable and
+// direct convolution must agree for every border mode, including images and
+// kernels shorter than the shortest (4-point) transform.
+
+#include <stdlib.h>
+#include "Matrix.h"
+#include "Check.h"
+
+static DblMat
+randomMat(unsigned nrows, unsigned ncols)
+{
+  DblMat A(nrows, ncols);
+  for (unsigned r = 0; r < nrows; r++)
+    for (unsigned c = 0; c < ncols; c++)
+      A(r, c) = drand48() - 0.5;
+  return A;
+}
+
+static bool
+agree(const DblMat& A, const DblMat& B, double tol)
+{
+  if ((A.getrows() != B.getrows()) || (A.getcols() != B.getcols()))
+    return false;
+  for (unsigned r = 0; r < A.getrows(); r++)
+    for (unsigned c = 0; c < A.getcols(); c++)
+      if (!near(A(r, c), B(r, c), tol))
+	return false;
+  return true;
+}
+
+int
+main()
+{
+  const BorderMode borders[] = {BORDER_ZERO, BORDER_CLAMP, BORDER_MIRROR, BORDER_WRAP};
+
+  srand48(26);
+  for (unsigned nrows = 1; nrows <= 7; nrows++)
+    for (unsigned ncols = 1; ncols <= 7; ncols += 2)
+      for (unsigned krows = 1; krows <= 4; krows++)
+	for (unsigned kcols = 1; kcols <= 4; kcols++) {
+	  const DblMat image  = randomMat(nrows, ncols);
+	  const DblMat kernel = randomMat(krows, kcols);
+	  for (unsigned b = 0; b < 4; b++) {
+	    const DblMat direct = image.convolv2d(kernel, CONV_DIRECT, borders[b]);
+	    check(agree(image.convolv2d(kernel, CONV_FFT, borders[b]), direct, 1e-9));
+	    check(agree(image.convolv2d(kernel, CONV_AUTO, borders[b]), direct, 1e-9));
+	  }
+	}
+
+  // Separable kernel on a larger image
+  const DblMat image = randomMat(40, 33);
+  DblMat column = randomMat(5, 1), row = randomMat(1, 7);
+  const DblMat kernel = column*row;
+  const DblMat direct = image.convolv2d(kernel, CONV_DIRECT, BORDER_MIRROR);
+  check(agree(image.convolv2d(kernel, CONV_SEPARABLE, BORDER_MIRROR), direct, 1e-9));
+  check(agree(image.convolv2d(kernel, CONV_FFT, BORDER_MIRROR), direct, 1e-9));
+
+  // In place
+  DblMat copy(image);
+  copy.convolv2dInPlace(kernel, CONV_DIRECT, BORDER_MIRROR);
+  check(agree(copy, direct, 1e-9));
+
+  // Lengths of the overlap-save transforms
+  for (unsigned k = 2; k <= 9; k++) {
+    const unsigned N = fftConvolutionLength(3, k);
+    check((N >= k) && !(N & (N - 1)));
+  }
+  check(fftConvolutionLength(100, 1) == 0);
+
+  return checkStatus();
+}
@@ -0,0 +1,93 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for the exact Euclidean distance transform
+// (DistanceTransform.h): squared distances and nearest-element indices must
+// match a brute-force search in 2D and 3D, with anisotropic spacing, and an
+// image without non-zero elements must give MAXDOUBLE everywhere.
+
+#include <stdlib.h>
+#include "MTypes.h"
+#include "DistanceTransform.h"
+#include "Check.h"
+
+static void
+testVolume(unsigned nslis, unsigned nrows, unsigned ncols, double density,
+	   const double spacing[3])
+{
+  Volume<unsigned char> in(nslis, nrows, ncols);
+  Volume<double>        dist(nslis, nrows, ncols);
+  Volume<int>           feature(nslis, nrows, ncols);
+  const unsigned        n = nslis*nrows*ncols;
+  unsigned              i, j;
+
+  for (i = 0; i < n; i++)
+    in.data[i] = (drand48() < density) ? 1 : 0;
+
+  distanceTransform(dist.el, in.in(), nslis, nrows, ncols, spacing, feature.el);
+
+  for (i = 0; i < n; i++) {
+    const unsigned s = i/(nrows*ncols), r = (i/ncols)%nrows, c = i%ncols;
+    double best = MAXDOUBLE;
+    for (j = 0; j < n; j++)
+      if (in.data[j]) {
+	const double ds = spacing[0]*(double(j/(nrows*ncols)) - s);
+	const double dr = spacing[1]*(double((j/ncols)%nrows) - r);
+	const double dc = spacing[2]*(double(j%ncols) - c);
+	const double d  = ds*ds + dr*dr + dc*dc;
+	if (d < best)
+	  best = d;
+      }
+
+    if (best == MAXDOUBLE) {
+      check(dist.data[i] == MAXDOUBLE);
+      check(feature.data[i] == -1);
+      continue;
+    }
+    check(near(dist.data[i], best, 1e-12));
+
+    // The nearest element is non-zero and at the reported distance
+    const int f = feature.data[i];
+    check((f >= 0) && (unsigned(f) < n) && in.data[f]);
+    if ((f >= 0) && (unsigned(f) < n)) {
+      const double ds = spacing[0]*(double(f/(nrows*ncols)) - s);
+      const double dr = spacing[1]*(double((f/ncols)%nrows) - r);
+      const double dc = spacing[2]*(double(f%ncols) - c);
+      check(near(ds*ds + dr*dr + dc*dc, best, 1e-12));
+    }
+  }
+}
+
+int
+main()
+{
+  const double unit[3]  = {1, 1, 1};
+  const double aniso[3] = {2.5, 1, 0.7};
+
+  srand48(34);
+  testVolume(1, 17, 23, 0.05, unit);
+  testVolume(1, 1, 31, 0.1, unit);
+  testVolume(1, 9, 1, 0.2, aniso);
+  testVolume(6, 9, 11, 0.03, unit);
+  testVolume(7, 8, 5, 0.05, aniso);
+  testVolume(4, 5, 6, 0, unit);     // No non-zero elements
+  testVolume(3, 4, 5, 1, aniso);    // All non-zero
+
+  return checkStatus();
+}
@@ -0,0 +1,116 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for batched FFT plans (FFTPlan in MatrixSupport.h): the
+// double and float transforms of interleaved batches must match a direct
+// DFT, the inverse must undo the forward transform (up to the factor n),
+// and lengths that are not powers of 2 must be rounded up.
+
+#include <stdlib.h>
+#include <math.h>
+#include "Matrix.h"
+#include "Check.h"
+
+// Direct DFT of signal b of an interleaved batch
+static void
+dft(unsigned n, unsigned batch, unsigned b, const double *re, const double *im,
+    double *outRe, double *outIm)
+{
+  for (unsigned k = 0; k < n; k++) {
+    outRe[k] = outIm[k] = 0;
+    for (unsigned j = 0; j < n; j++) {
+      const double angle = -2*M_PI*double(j)*k/n;
+      outRe[k] += re[j*batch + b]*cos(angle) - im[j*batch + b]*sin(angle);
+      outIm[k] += re[j*batch + b]*sin(angle) + im[j*batch + b]*cos(angle);
+    }
+  }
+}
+
+int
+main()
+{
+  const unsigned batch = 3;
+
+  srand48(29);
+  for (unsigned n = 1; n <= 64; n *= 2) {
+    FFTPlan plan(n);
+    check(plan.length() == n);
+
+    double *re  = new double[n*batch], *im  = new double[n*batch];
+    double *re0 = new double[n*batch], *im0 = new double[n*batch];
+    float  *ref = new float[n*batch],  *imf = new float[n*batch];
+    double *dftRe = new double[n], *dftIm = new double[n];
+    unsigned i, b, k;
+
+    for (i = 0; i < n*batch; i++) {
+      re0[i] = re[i] = drand48() - 0.5;
+      im0[i] = im[i] = drand48() - 0.5;
+      ref[i] = float(re[i]);
+      imf[i] = float(im[i]);
+    }
+
+    plan.fft(batch, re, im);
+    plan.fft(batch, ref, imf);
+    for (b = 0; b < batch; b++) {
+      dft(n, batch, b, re0, im0, dftRe, dftIm);
+      for (k = 0; k < n; k++) {
+	check(near(re[k*batch + b], dftRe[k], 1e-9));
+	check(near(im[k*batch + b], dftIm[k], 1e-9));
+	check(near(ref[k*batch + b], dftRe[k], 1e-4));
+	check(near(imf[k*batch + b], dftIm[k], 1e-4));
+      }
+    }
+
+    plan.ifft(batch, re, im);
+    for (i = 0; i < n*batch; i++) {
+      check(near(re[i]/n, re0[i], 1e-9));
+      check(near(im[i]/n, im0[i], 1e-9));
+    }
+
+    delete [] re;  delete [] im;
+    delete [] re0; delete [] im0;
+    delete [] ref; delete [] imf;
+    delete [] dftRe; delete [] dftIm;
+  }
+
+  // Other lengths are increased to the next power of 2
+  FFTPlan plan3(3), plan100(100);
+  check(plan3.length() == 4);
+  check(plan100.length() == 128);
+
+  // fftAxis() along each axis of a 4 x 2 x 8 array matches the plan
+  const unsigned dims[3] = {4, 2, 8};
+  const unsigned size = dims[0]*dims[1]*dims[2];
+  double re[64], im[64], re0[64], im0[64];
+  for (unsigned axis = 0; axis < 3; axis++) {
+    unsigned i;
+    for (i = 0; i < size; i++) {
+      re0[i] = re[i] = drand48();
+      im0[i] = im[i] = drand48();
+    }
+    fftAxis(axis, dims[0], dims[1], dims[2], re, im);
+    fftAxis(axis, dims[0], dims[1], dims[2], re, im, 1);
+    for (i = 0; i < size; i++) {
+      check(near(re[i]/dims[axis], re0[i], 1e-9));
+      check(near(im[i]/dims[axis], im0[i], 1e-9));
+    }
+  }
+
+  return checkStatus();
+}
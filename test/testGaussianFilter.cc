@@ -0,0 +1,170 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for recursive Gaussian filtering (GaussianFilter.h): the
+// impulse response must have a sum of 1, a mean of 0 and a variance of
+// sigma^2, and be close to a sampled Gaussian; its first and second
+// derivatives must have the moments of the derivatives of a Gaussian (with
+// their signs and symmetries). Constant images must be preserved (and have
+// zero derivatives), ramps must have a constant first derivative, and 3D
+// impulse responses must be the products of the 1D ones.
+
+#include <stdlib.h>
+#include <math.h>
+#include "Matrix.h"
+#include "GaussianFilter.h"
+#include "Check.h"
+
+// Response of a line of n samples to an impulse at c0
+static void
+impulse(double *h, unsigned n, unsigned c0, double sigma, unsigned order)
+{
+  Volume<double> in(1, 1, n), out(1, 1, n);
+  in(0, 0, c0) = 1;
+  const double   sigmas[3] = {0, 0, sigma};
+  const unsigned orders[3] = {0, 0, order};
+  gaussianFilter(out.el, in.in(), 1, 1, n, sigmas, orders);
+  for (unsigned j = 0; j < n; j++)
+    h[j] = out.data[j];
+}
+
+static void
+testImpulse(double sigma)
+{
+  const unsigned n = 401, c0 = 200;
+  double h[n], moment[3][3];
+  unsigned order, j;
+
+  for (order = 0; order < 3; order++) {
+    impulse(h, n, c0, sigma, order);
+    moment[order][0] = moment[order][1] = moment[order][2] = 0;
+    for (j = 0; j < n; j++) {
+      const double x = double(j) - c0;
+      moment[order][0] += h[j];
+      moment[order][1] += x*h[j];
+      moment[order][2] += x*x*h[j];
+    }
+
+    // Symmetric (orders 0 and 2) or antisymmetric (order 1) about c0
+    for (j = 1; j <= c0; j++)
+      check(near(h[c0 + j], (order == 1) ? -h[c0 - j] : h[c0 - j], 1e-9));
+
+    if (order == 0) {
+      check(h[c0] > h[c0 + 1]);
+      // Close to a sampled Gaussian
+      if (sigma >= 1) {
+	const double peak = 1/(sqrt(2*M_PI)*sigma);
+	for (j = 0; j < n; j++) {
+	  const double x = double(j) - c0;
+	  check(fabs(h[j] - peak*exp(-x*x/(2*sigma*sigma))) < 0.05*peak);
+	}
+      }
+    }
+    // Decreasing through c0, and negative at c0
+    if (order == 1)
+      check((h[c0 + 1] < 0) && (h[c0 - 1] > 0) && near(h[c0], 0, 1e-12));
+    if (order == 2)
+      check(h[c0] < 0);
+  }
+
+  // Sum 1, mean 0, variance sigma^2
+  check(near(moment[0][0], 1, 1e-9));
+  check(near(moment[0][1], 0, 1e-9));
+  check(near(moment[0][2], sigma*sigma, 1e-6));
+  // Moments of g' (0, -1, 0) and g'' (0, 0, 2)
+  check(near(moment[1][0], 0, 1e-9));
+  check(near(moment[1][1], -1, 1e-6));
+  check(near(moment[1][2], 0, 1e-9));
+  check(near(moment[2][0], 0, 1e-9));
+  check(near(moment[2][1], 0, 1e-9));
+  check(near(moment[2][2], 2, 1e-6));
+}
+
+int
+main()
+{
+  unsigned i, s, r, c;
+
+  testImpulse(0.5);
+  testImpulse(1);
+  testImpulse(2);
+  testImpulse(3.7);
+  testImpulse(10);
+
+  // Constant images are preserved, in place too, down to single samples
+  static const unsigned dims[][3] = {{4, 5, 6}, {1, 1, 1}, {2, 1, 3}, {1, 7, 2}};
+  for (unsigned d = 0; d < 4; d++) {
+    Volume<double> constant(dims[d][0], dims[d][1], dims[d][2], 3.5);
+    Volume<double> out(dims[d][0], dims[d][1], dims[d][2]);
+    const unsigned n = dims[d][0]*dims[d][1]*dims[d][2];
+    const double sigmas[3] = {1.5, 0.7, 2.5};
+    for (unsigned o = 0; o < 3; o++) {
+      const unsigned orders[3] = {o, (o + 1) % 3, (o + 2) % 3};
+      gaussianFilter(out.el, constant.in(), dims[d][0], dims[d][1], dims[d][2],
+		     sigmas, orders);
+      for (i = 0; i < n; i++)
+	check(near(out.data[i], (o || orders[1] || orders[2]) ? 0 : 3.5, 1e-12));
+    }
+    const unsigned zero[3] = {0, 0, 0};
+    gaussianFilter(constant.el, constant.in(), dims[d][0], dims[d][1], dims[d][2],
+		   sigmas, zero);
+    for (i = 0; i < n; i++)
+      check(near(constant.data[i], 3.5, 1e-12));
+  }
+
+  // Ramps along rows have a constant first derivative (away from the ends)
+  Volume<double> ramp(3, 200, 4), slope(3, 200, 4);
+  for (s = 0; s < 3; s++)
+    for (r = 0; r < 200; r++)
+      for (c = 0; c < 4; c++)
+	ramp(s, r, c) = 0.25*r - 7;
+  const double   rampSigmas[3] = {1, 2, 0.5};
+  const unsigned rampOrders[3] = {0, 1, 0};
+  gaussianFilter(slope.el, ramp.in(), 3, 200, 4, rampSigmas, rampOrders);
+  for (s = 0; s < 3; s++)
+    for (r = 50; r < 150; r++)
+      for (c = 0; c < 4; c++)
+	check(near(slope(s, r, c), 0.25, 1e-9));
+
+  // 3D impulse responses are products of the 1D responses
+  const unsigned ns = 21, nr = 25, nc = 31;
+  const double   sigmas[3] = {1.2, 2.5, 0.8};
+  const unsigned orders[3] = {2, 0, 1};
+  double hs[ns], hr[nr], hc[nc];
+  impulse(hs, ns, 8, sigmas[0], orders[0]);
+  impulse(hr, nr, 12, sigmas[1], orders[1]);
+  impulse(hc, nc, 20, sigmas[2], orders[2]);
+  Volume<double> delta(ns, nr, nc), response(ns, nr, nc);
+  delta(8, 12, 20) = 1;
+  gaussianFilter(response.el, delta.in(), ns, nr, nc, sigmas, orders);
+  for (s = 0; s < ns; s++)
+    for (r = 0; r < nr; r++)
+      for (c = 0; c < nc; c++)
+	check(near(response(s, r, c), hs[s]*hr[r]*hc[c], 1e-12));
+
+  // Through Mat
+  Mat<double> A(nr, nc);
+  A(12, 20) = 1;
+  Mat<double> B = A.gaussianFilter(sigmas[1], sigmas[2], orders[1], orders[2]);
+  for (r = 0; r < nr; r++)
+    for (c = 0; c < nc; c++)
+      check(near(B(r, c), hr[r]*hc[c], 1e-12));
+
+  return checkStatus();
+}
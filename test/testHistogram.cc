@@ -0,0 +1,160 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for batched histogram filling (Histogram.h): adding a
+// whole image at a time must give the counts of adding its values one by
+// one, for integers counted by raw value as well as for binned values, with
+// out-of-range and NaN values left out; a CachedArray must be added through
+// its blocks also when passed as a SimpleArray.
+
+#include <stdlib.h>
+#include <math.h>
+#include "Histogram.h"
+#include "CachedArray.h"
+#include "Check.h"
+
+// Histogram of the values added one by one
+static Histogram
+reference(const Histogram& layout, const double *values, unsigned long n,
+	  unsigned long& nAdded)
+{
+  Histogram hist(layout);
+  nAdded = 0;
+  for (unsigned long i = 0; i < n; i++)
+    nAdded += hist.add(values[i]);
+  return hist;
+}
+
+static Boolean
+sameCounts(const Histogram& a, const Histogram& b)
+{
+  if (a.nBins() != b.nBins())
+    return FALSE;
+  for (unsigned i = 0; i < a.nBins(); i++)
+    if (a[i] != b[i])
+      return FALSE;
+  return TRUE;
+}
+
+// Adds n random values in [lo, hi) (the first few NaN and infinite if the
+// type has them) as nRows rows to histograms of several layouts
+template <class Type>
+static void
+testType(unsigned nRows, unsigned long nCols, double lo, double hi)
+{
+  const unsigned long n = nRows*nCols;
+  Type   *data   = new Type[n];
+  double *values = new double[n];
+  for (unsigned long i = 0; i < n; i++)
+    data[i] = Type(lo + (hi - lo)*drand48());
+  if (Type(0.5) && (n > 3)) {
+    data[0] = Type(NAN);
+    data[1] = Type(INFINITY);
+    data[2] = Type(-INFINITY);
+  }
+  for (unsigned long i = 0; i < n; i++)
+    values[i] = double(data[i]);
+
+  const Type **rows = new const Type *[nRows];
+  for (unsigned r = 0; r < nRows; r++)
+    rows[r] = data + r*nCols;
+
+  const Histogram layouts[] = {
+    Histogram(lo, hi, 0u),
+    Histogram(lo, hi, 7u),
+    Histogram(lo + (hi - lo)/4, hi - (hi - lo)/3, 50u),
+    Histogram(13u, lo, (hi - lo)/10),
+    Histogram(lo, hi, 1u)
+  };
+
+  for (unsigned l = 0; l < sizeof(layouts)/sizeof(layouts[0]); l++) {
+    unsigned long nExpected;
+    Histogram expected = reference(layouts[l], values, n, nExpected);
+
+    Histogram hist(layouts[l]);
+    check(hist.add(rows, nRows, nCols) == nExpected);
+    check(sameCounts(hist, expected));
+
+    // Adding again doubles the counts
+    Histogram twice(layouts[l]);
+    twice.add(data, n);
+    twice.add(data, n);
+    for (unsigned i = 0; i < expected.nBins(); i++)
+      check(twice[i] == 2*expected[i]);
+
+    // Through SimpleArray
+    Histogram array(layouts[l]);
+    add(array, SimpleArray<Type>(data, unsigned(n)));
+    check(sameCounts(array, expected));
+  }
+
+  delete [] rows;
+  delete [] values;
+  delete [] data;
+}
+
+static void
+testCachedArray(unsigned n, unsigned nBlocks, unsigned blockSize)
+{
+  CachedArray<float> cached(n, nBlocks, blockSize);
+  double *values = new double[n];
+  for (unsigned i = 0; i < n; i++) {
+    cached.setEl(i, float(100*drand48() - 10));
+    values[i] = cached.getElConst(i);
+  }
+
+  const Histogram layout(0.0, 80.0, 33u);
+  unsigned long nExpected;
+  Histogram expected = reference(layout, values, n, nExpected);
+
+  Histogram direct(layout);
+  add(direct, cached);
+  check(sameCounts(direct, expected));
+
+  // A CachedArray passed as a SimpleArray has no contiguous contents
+  const SimpleArray<float>& array = cached;
+  Histogram base(layout);
+  add(base, array);
+  check(sameCounts(base, expected));
+
+  delete [] values;
+}
+
+int
+main()
+{
+  srand48(45);
+
+  testType<unsigned char>(3, 1000, 0, 256);
+  testType<unsigned char>(1, 100, 0, 256);
+  testType<char>(7, 401, -128, 128);
+  testType<short>(2, 50000, -32768, 32768);
+  testType<short>(5, 37, -300, 300);
+  testType<unsigned short>(1, 70000, 0, 65536);
+  testType<int>(4, 5000, -1000, 1000);
+  testType<float>(9, 3001, -5, 5);
+  testType<double>(300, 300, 0, 1);
+  testType<double>(1, 3, 0, 1);
+
+  testCachedArray(10000, 3, 512);
+  testCachedArray(5000, 64, 4096);
+  testCachedArray(1, 2, 16);
+
+  return checkStatus();
+}
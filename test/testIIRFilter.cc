@@ -0,0 +1,148 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for IIR filtering (IIRFilter.h): Mat::filter() must match
+// the direct-form difference equation y(n) = sum b(i)x(n-i) - sum a(i)y(n-i)
+// (with b and a normalized by a(0)) of the former implementation; rows and
+// columns must be filtered as separate signals; and Mat::filtfilt() must
+// reproduce reference vectors of Matlab's filtfilt() algorithm (odd
+// reflections of 3*order samples, steady-state initial conditions), here
+// evaluated in exact rational arithmetic, and preserve constant signals.
+
+#include <stdlib.h>
+#include <math.h>
+#include "Matrix.h"
+#include "IIRFilter.h"
+#include "Check.h"
+
+static const double x[20] = {1, 2, 3, 4, 5, 4, 3, 2, 1, 0, -1, -2, 3, 7, 1, 0, 0, 2, 5, -3};
+
+// Butterworth low-pass filter of order 2 with a cutoff of 0.25 (butter(2, 0.25))
+static const double bButter[3] = {0.0976310729378175, 0.1952621458756350, 0.0976310729378175};
+static const double aButter[3] = {1, -0.9428090415820634, 0.3333333333333333};
+static const double filtfiltButter[20] = {
+  1.0100872136537473, 2.1513149794698712, 3.1746020246154232, 3.9033693587594307,
+  4.1485281927157827, 3.8186421052603094, 3.0002503152123525, 1.9174297748034637,
+  0.85463464479558149, 0.12951615882265913, 0.048986018767038453, 0.71324019932946914,
+  1.7437277077788973, 2.437575924250563, 2.4577476631955819, 2.1074069618257525,
+  1.7080228790934022, 0.99982806421658976, -0.58743112133764552, -3.051090285527351};
+
+// Third-order filter with a shorter numerator and a(0) != 1
+static const double bThird[2] = {0.3, 0.2};
+static const double aThird[4] = {2, -1.2, 0.5, -0.1};
+static const double filtfiltThird[20] = {
+  0.17361271176364226, 0.34773871253505467, 0.52267972700897203, 0.67384581953038258,
+  0.73831320560867564, 0.67448099808456063, 0.52528130190298206, 0.35078544059125921,
+  0.16814753552942061, -0.012461754728307746, -0.10841015680691261, 0.042765967631905911,
+  0.41245154887172492, 0.5987407162782743, 0.39721349767132252, 0.15165267678291641,
+  0.16387301967926074, 0.31173705570314775, 0.15175587294096141, -0.52082460040303102};
+
+// Direct-form difference equation
+static void
+directForm(const double *b, unsigned nb, const double *a, unsigned na,
+	   const double *in, double *out, unsigned n)
+{
+  for (unsigned j = 0; j < n; j++) {
+    double y = 0;
+    for (unsigned i = 0; (i < nb) && (i <= j); i++)
+      y += b[i]/a[0]*in[j - i];
+    for (unsigned i = 1; (i < na) && (i <= j); i++)
+      y -= a[i]/a[0]*out[j - i];
+    out[j] = y;
+  }
+}
+
+static void
+testFilter(const double *b, unsigned nb, const double *a, unsigned na,
+	   const double *expected)
+{
+  const unsigned n = 20;
+  const Mat<double> B(1, nb, b), A(1, na, a);
+  const Mat<double> row(1, n, x), col(n, 1, x);
+  double reference[n];
+  unsigned i;
+
+  directForm(b, nb, a, na, x, reference, n);
+  Mat<double> y = row.filter(B, A);
+  for (i = 0; i < n; i++)
+    check(near(y(0, i), reference[i], 1e-12));
+  y = col.filter(B, A);
+  for (i = 0; i < n; i++)
+    check(near(y(i, 0), reference[i], 1e-12));
+
+  y = row.filtfilt(B, A);
+  for (i = 0; i < n; i++)
+    check(near(y(0, i), expected[i], 1e-12));
+  y = col.filtfilt(B, A);
+  for (i = 0; i < n; i++)
+    check(near(y(i, 0), expected[i], 1e-12));
+
+  // Constant signals start and stay in the steady state
+  const Mat<double> constant(1, n, 2.5);
+  const double gain = (b[0] + ((nb > 1) ? b[1] : 0) + ((nb > 2) ? b[2] : 0))/
+    (a[0] + a[1] + a[2] + ((na > 3) ? a[3] : 0));
+  y = constant.filtfilt(B, A);
+  for (i = 0; i < n; i++)
+    check(near(y(0, i), 2.5*gain*gain, 1e-12));
+
+  // Rows (or columns) are separate signals, each as filter()/filtfilt()
+  Mat<double> rows(37, n), cols(n, 37);
+  for (unsigned r = 0; r < 37; r++)
+    for (i = 0; i < n; i++)
+      rows(r, i) = cols(i, r) = drand48() - 0.5;
+  for (int zeroPhase = 0; zeroPhase < 2; zeroPhase++) {
+    const Mat<double> yRows = rows.filterRows(B, A, zeroPhase ? TRUE : FALSE);
+    const Mat<double> yCols = cols.filterColumns(B, A, zeroPhase ? TRUE : FALSE);
+    for (unsigned r = 0; r < 37; r++) {
+      double signal[n];
+      for (i = 0; i < n; i++)
+	signal[i] = rows(r, i);
+      const Mat<double> signalRow(1, n, signal);
+      const Mat<double> one = zeroPhase ? signalRow.filtfilt(B, A) : signalRow.filter(B, A);
+      for (i = 0; i < n; i++) {
+	check(near(yRows(r, i), one(0, i), 1e-12));
+	check(near(yCols(i, r), one(0, i), 1e-12));
+      }
+    }
+  }
+}
+
+int
+main()
+{
+  srand48(42);
+
+  testFilter(bButter, 3, aButter, 3, filtfiltButter);
+  testFilter(bThird, 2, aThird, 4, filtfiltThird);
+
+  // FIR filters have a zero steady state beyond the numerator
+  const double b[4] = {0.25, 0.5, 0.25, -0.125}, a[1] = {1};
+  double reference[20];
+  directForm(b, 4, a, 1, x, reference, 20);
+  const Mat<double> y = Mat<double>(1, 20, x).filter(Mat<double>(1, 4, b),
+						     Mat<double>(1, 1, a));
+  for (unsigned i = 0; i < 20; i++)
+    check(near(y(0, i), reference[i], 1e-12));
+
+  // A zero leading denominator coefficient is rejected
+  const double zero[2] = {0, 1};
+  check(!IIRFilter(b, 2, zero, 2).isValid());
+
+  return checkStatus();
+}
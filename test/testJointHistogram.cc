@@ -0,0 +1,204 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for JointHistogram: an image against itself must have a
+// mutual information equal to its entropy and a normalized mutual
+// information of 2; partial volume filling with the identity transform must
+// equal direct filling, and a shift of half a voxel must split each voxel
+// evenly between its neighbours; masks and steps must select the voxels
+// counted, in both fills; and values beyond the outer bin edges must not be
+// counted.
+
+#include <stdlib.h>
+#include <math.h>
+#include "JointHistogram.h"
+#include "Check.h"
+
+static const unsigned nslis = 6, nrows = 7, ncols = 9;
+
+// The same counts in every bin
+static bool
+equal(const JointHistogram& h1, const JointHistogram& h2)
+{
+  if ((h1.nBins1() != h2.nBins1()) || (h1.nBins2() != h2.nBins2()))
+    return false;
+  for (unsigned i = 0; i < h1.nBins1(); i++)
+    for (unsigned j = 0; j < h1.nBins2(); j++)
+      if (h1(i, j) != h2(i, j))
+	return false;
+  return true;
+}
+
+static void
+fill(Volume<unsigned char>& image, unsigned maxValue)
+{
+  for (unsigned i = 0; i < nslis*nrows*ncols; i++)
+    image.data[i] = (unsigned char) (drand48()*(maxValue + 1));
+}
+
+// Partial volume filling of image1 against image2 shifted by offset (in
+// voxels), against the weights spread by hand over the neighbours
+static void
+testShift(const Volume<unsigned char>& image1, const Volume<short>& image2,
+	  const double offset[3])
+{
+  const double transform[12] = {1, 0, 0, offset[0],
+				0, 1, 0, offset[1],
+				0, 0, 1, offset[2]};
+  JointHistogram pv(0, 15, 16, 0, 15, 16), expected(pv);
+  const double total = pv.addPartialVolume(image1.in(), nslis, nrows, ncols,
+					    image2.in(), nslis, nrows, ncols, transform);
+
+  const unsigned dims[3] = {nslis, nrows, ncols};
+  double expectedTotal = 0;
+  for (unsigned s = 0; s < nslis; s++)
+    for (unsigned r = 0; r < nrows; r++)
+      for (unsigned c = 0; c < ncols; c++) {
+	const unsigned v[3] = {s, r, c};
+	unsigned d;
+	for (d = 0; d < 3; d++)
+	  if (v[d] + offset[d] > dims[d] - 1)
+	    break;
+	if (d < 3)
+	  continue;
+	// Half of the weight goes to either neighbour along shifted
+	// dimensions
+	for (unsigned n = 0; n < 8; n++) {
+	  unsigned p[3];
+	  double weight = 1;
+	  for (d = 0; d < 3; d++) {
+	    const unsigned up = (n >> d) & 1;
+	    if (offset[d] == 0) {
+	      if (up)
+		weight = 0;
+	      p[d] = v[d];
+	    }
+	    else {
+	      weight *= 0.5;
+	      p[d] = v[d] + up;
+	    }
+	  }
+	  if (!weight)
+	    continue;
+	  expected.add(image1.data[(s*nrows + r)*ncols + c],
+		       image2.data[(p[0]*nrows + p[1])*ncols + p[2]], weight);
+	  expectedTotal += weight;
+	}
+      }
+
+  check(equal(pv, expected));
+  check(total == expectedTotal);
+  check(pv.n() == expectedTotal);
+}
+
+int
+main()
+{
+  const unsigned nVoxels = nslis*nrows*ncols;
+  Volume<unsigned char> image1(nslis, nrows, ncols), mask(nslis, nrows, ncols);
+  Volume<short>         image2(nslis, nrows, ncols);
+  unsigned i, j;
+
+  srand48(48);
+
+  fill(image1, 15);
+  for (i = 0; i < nVoxels; i++) {
+    image2.data[i] = short(drand48()*16);
+    mask.data[i]   = drand48() < 0.6;
+  }
+
+  // An image against itself: a diagonal histogram, MI = H and NMI = 2
+  JointHistogram self(0, 15, 16, 0, 15, 16);
+  check(self.add(image1.in(), image1.in(), nslis, nrows, ncols) == nVoxels);
+  check(self.n() == nVoxels);
+  double count[16] = {0}, entropy = 0;
+  for (i = 0; i < nVoxels; i++)
+    count[image1.data[i]]++;
+  for (i = 0; i < 16; i++)
+    if (count[i])
+      entropy -= count[i]/nVoxels*log(count[i]/nVoxels)/log(2.0);
+  for (i = 0; i < 16; i++)
+    for (j = 0; j < 16; j++)
+      check(self(i, j) == ((i == j) ? count[i] : 0));
+  check(near(self.entropy1(), entropy));
+  check(near(self.entropy2(), entropy));
+  check(near(self.jointEntropy(), entropy));
+  check(near(self.mutualInformation(), entropy));
+  check(near(self.normalizedMutualInformation(), 2));
+
+  // Independent images have a lower MI and NMI
+  JointHistogram pair(0, 15, 16, 0, 15, 16);
+  check(pair.add(image1.in(), image2.in(), nslis, nrows, ncols) == nVoxels);
+  check(pair.mutualInformation() < entropy);
+  check(pair.normalizedMutualInformation() < 2);
+  check(near(pair.mutualInformation(),
+	     pair.entropy1() + pair.entropy2() - pair.jointEntropy()));
+
+  // Partial volume filling with the identity transform
+  const double identity[12] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0};
+  JointHistogram pv(0, 15, 16, 0, 15, 16);
+  check(pv.addPartialVolume(image1.in(), nslis, nrows, ncols,
+			    image2.in(), nslis, nrows, ncols, identity) == nVoxels);
+  check(equal(pv, pair));
+
+  // Shifts of half a voxel along each dimension, and all three
+  const double offsets[4][3] = {{0.5, 0, 0}, {0, 0.5, 0}, {0, 0, 0.5}, {0.5, 0.5, 0.5}};
+  for (i = 0; i < 4; i++)
+    testShift(image1, image2, offsets[i]);
+
+  // Masks and steps, in both fills
+  for (unsigned step = 1; step <= 4; step++) {
+    JointHistogram expected(0, 15, 16, 0, 15, 16);
+    for (unsigned s = 0; s < nslis; s += step)
+      for (unsigned r = 0; r < nrows; r += step)
+	for (unsigned c = 0; c < ncols; c += step)
+	  if (mask(s, r, c))
+	    expected.add(image1(s, r, c), image2(s, r, c));
+
+    JointHistogram direct(0, 15, 16, 0, 15, 16), partial(direct);
+    check(direct.add(image1.in(), image2.in(), nslis, nrows, ncols,
+		     mask.in(), step) == expected.n());
+    check(partial.addPartialVolume(image1.in(), nslis, nrows, ncols,
+				   image2.in(), nslis, nrows, ncols, identity,
+				   mask.in(), step) == expected.n());
+    check(equal(direct, expected));
+    check(equal(partial, expected));
+
+    // Cleared and refilled
+    direct.clear();
+    check(direct.n() == 0);
+    direct.add(image1.in(), image2.in(), nslis, nrows, ncols, mask.in(), step);
+    check(equal(direct, expected));
+  }
+
+  // Values beyond the outer bin edges (here, 15.5) are not counted
+  Volume<unsigned char> wide(nslis, nrows, ncols);
+  fill(wide, 20);
+  JointHistogram clipped(0, 15, 16, 0, 15, 16), expected(clipped);
+  for (i = 0; i < nVoxels; i++)
+    expected.add(wide.data[i], image2.data[i]);
+  check(clipped.add(wide.in(), image2.in(), nslis, nrows, ncols) == expected.n());
+  check(expected.n() < nVoxels);
+  check(equal(clipped, expected));
+  check(clipped.bin1(15.4) == 15);
+  check(clipped.bin1(15.6) == -1);
+  check(clipped.bin1(-0.6) == -1);
+
+  return checkStatus();
+}
@@ -0,0 +1,135 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for connected-component labeling (Labeling.h): labels,
+// sizes and bounding boxes must match a flood fill in raster order, for
+// every connectivity, in 2D and 3D.
+
+#include <stdlib.h>
+#include <vector>
+#include "Labeling.h"
+#include "Check.h"
+
+// TRUE if voxels (ds, dr, dc) apart are neighbours under connectivity
+static bool
+neighbours(int ds, int dr, int dc, unsigned connectivity)
+{
+  const int n = abs(ds) + abs(dr) + abs(dc);
+  if (!n || (abs(ds) > 1) || (abs(dr) > 1) || (abs(dc) > 1))
+    return false;
+  switch (connectivity) {
+  case 4:  return !ds && (n == 1);
+  case 8:  return !ds;
+  case 6:  return n == 1;
+  case 18: return n <= 2;
+  default: return true;
+  }
+}
+
+static void
+testVolume(unsigned nslis, unsigned nrows, unsigned ncols, double density,
+	   unsigned connectivity)
+{
+  Volume<unsigned char> in(nslis, nrows, ncols);
+  Volume<int>           labels(nslis, nrows, ncols, -1);
+  const int             n = int(nslis*nrows*ncols);
+  int                   i;
+
+  for (i = 0; i < n; i++)
+    in.data[i] = (drand48() < density) ? 1 : 0;
+
+  Array<Component> components;
+  const unsigned nLabels = labelComponents(labels.el, in.in(), nslis, nrows, ncols,
+					   connectivity, &components);
+
+  // Flood fill, assigning labels in raster order of the first element
+  std::vector<int> expected(n, 0), stack;
+  int nExpected = 0;
+  for (i = 0; i < n; i++) {
+    if (!in.data[i] || expected[i])
+      continue;
+    expected[i] = ++nExpected;
+    stack.push_back(i);
+
+    unsigned long size = 0;
+    unsigned minS = nslis, maxS = 0, minR = nrows, maxR = 0, minC = ncols, maxC = 0;
+    while (!stack.empty()) {
+      const int v = stack.back();
+      stack.pop_back();
+      const int s = v/(nrows*ncols), r = (v/ncols)%nrows, c = v%ncols;
+      size++;
+      minS = std::min(minS, unsigned(s)); maxS = std::max(maxS, unsigned(s));
+      minR = std::min(minR, unsigned(r)); maxR = std::max(maxR, unsigned(r));
+      minC = std::min(minC, unsigned(c)); maxC = std::max(maxC, unsigned(c));
+      for (int w = 0; w < n; w++) {
+	if (!in.data[w] || expected[w])
+	  continue;
+	const int ws = w/(nrows*ncols), wr = (w/ncols)%nrows, wc = w%ncols;
+	if (neighbours(ws - s, wr - r, wc - c, connectivity)) {
+	  expected[w] = nExpected;
+	  stack.push_back(w);
+	}
+      }
+    }
+
+    if (unsigned(nExpected) <= components.size()) {
+      const Component& component = components[nExpected - 1];
+      check(component.size == size);
+      check((component.minSlice == minS) && (component.maxSlice == maxS));
+      check((component.minRow == minR) && (component.maxRow == maxR));
+      check((component.minCol == minC) && (component.maxCol == maxC));
+    }
+  }
+
+  check(nLabels == unsigned(nExpected));
+  check(components.size() == unsigned(nExpected));
+  for (i = 0; i < n; i++)
+    check(labels.data[i] == expected[i]);
+}
+
+int
+main()
+{
+  srand48(35);
+  const unsigned connectivity2D[] = {4, 8};
+  const unsigned connectivity3D[] = {4, 8, 6, 18, 26};
+  unsigned k;
+
+  for (k = 0; k < 2; k++) {
+    testVolume(1, 23, 31, 0.45, connectivity2D[k]);
+    testVolume(1, 1, 40, 0.5, connectivity2D[k]);
+    testVolume(1, 40, 1, 0.5, connectivity2D[k]);
+    testVolume(1, 64, 9, 0.6, connectivity2D[k]);
+  }
+  for (k = 0; k < 5; k++) {
+    testVolume(7, 9, 11, 0.3, connectivity3D[k]);
+    testVolume(12, 5, 4, 0.2, connectivity3D[k]);
+    testVolume(3, 3, 3, 1, connectivity3D[k]);
+    testVolume(3, 4, 5, 0, connectivity3D[k]);
+  }
+
+  // Invalid connectivity
+  Volume<unsigned char> in(1, 2, 2, 1);
+  Volume<int>           labels(1, 2, 2);
+  Array<Component>      components(3);
+  check(labelComponents(labels.el, in.in(), 1, 2, 2, 5, &components) == 0);
+  check(components.size() == 0);
+
+  return checkStatus();
+}
@@ -0,0 +1,191 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for percentiles (Percentile.h): percentiles must match
+// those of the sorted elements for all types, with NaNs skipped and infinite
+// values ranked at either end, also when they make up the extrema of large
+// images or when values are too close for bucketing to tell them apart.
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include "Matrix.h"
+#include "Percentile.h"
+#include "Check.h"
+
+static const double pcts[] = {0, 0.1, 1, 10, 25, 49.9, 50, 50.1, 75, 90, 99, 99.9, 100};
+static const unsigned nPcts = sizeof(pcts)/sizeof(pcts[0]);
+
+// Percentiles of the sorted non-NaN elements in [minVal, maxVal] (all if
+// maxVal <= minVal)
+template <class Type>
+static void
+reference(const Type *data, unsigned long n, Type minVal, Type maxVal, Type *value)
+{
+  Type *sorted = new Type[n];
+  unsigned long m = 0;
+  for (unsigned long i = 0; i < n; i++)
+    if ((data[i] == data[i]) &&
+	((maxVal <= minVal) || ((data[i] >= minVal) && (data[i] <= maxVal))))
+      sorted[m++] = data[i];
+  std::sort(sorted, sorted + m);
+  for (unsigned p = 0; m && (p < nPcts); p++) {
+    unsigned long rank = (unsigned long) (pcts[p]/100*(m - 1));
+    value[p] = sorted[(rank < m) ? rank : m - 1];
+  }
+  delete [] sorted;
+}
+
+template <class Type>
+static void
+compare(const Type *data, unsigned nRows, unsigned nCols,
+	Type minVal = 0, Type maxVal = 0)
+{
+  const Type **rows = new const Type *[nRows];
+  for (unsigned r = 0; r < nRows; r++)
+    rows[r] = data + (unsigned long) r*nCols;
+
+  Type value[nPcts], expected[nPcts];
+  const Boolean found = percentiles(rows, nRows, nCols, pcts, nPcts, value,
+				    minVal, maxVal);
+  check(found);
+  if (found) {
+    reference(data, (unsigned long) nRows*nCols, minVal, maxVal, expected);
+    for (unsigned p = 0; p < nPcts; p++)
+      check(value[p] == expected[p]);
+  }
+
+  delete [] rows;
+}
+
+// Random values in [lo, hi)
+template <class Type>
+static void
+testType(unsigned nRows, unsigned nCols, double lo, double hi)
+{
+  const unsigned long n = (unsigned long) nRows*nCols;
+  Type *data = new Type[n];
+  for (unsigned long i = 0; i < n; i++)
+    data[i] = Type(lo + (hi - lo)*drand48());
+
+  compare(data, nRows, nCols);
+  compare(data, nRows, nCols, Type(lo + (hi - lo)/4), Type(hi - (hi - lo)/3));
+
+  // Few distinct values
+  for (unsigned long i = 0; i < n; i++)
+    data[i] = Type(lo + floor(3*drand48())*(hi - lo)/4);
+  compare(data, nRows, nCols);
+
+  delete [] data;
+}
+
+// Floating-point data with NaNs and infinite values
+template <class Type>
+static void
+testSpecial(unsigned nRows, unsigned nCols)
+{
+  const unsigned long n = (unsigned long) nRows*nCols;
+  Type *data = new Type[n];
+  for (unsigned long i = 0; i < n; i++)
+    data[i] = Type(drand48());
+
+  // A single infinity as the maximum, then as the minimum
+  data[n/3] = Type(INFINITY);
+  compare(data, nRows, nCols);
+  data[n/3] = Type(-INFINITY);
+  compare(data, nRows, nCols);
+
+  // Both, and NaNs; enough at either end to be the extreme percentiles
+  for (unsigned long i = 0; i < n/100; i++) {
+    data[lrand48() % n] = Type(INFINITY);
+    data[lrand48() % n] = Type(-INFINITY);
+    data[lrand48() % n] = Type(NAN);
+  }
+  compare(data, nRows, nCols);
+  compare(data, nRows, nCols, Type(0.2), Type(0.7));
+
+  // Extreme finite values
+  data[n/2] = Type(-FLT_MAX);
+  data[n/2 + 1] = Type(FLT_MAX);
+  compare(data, nRows, nCols);
+
+  // Only infinite values and NaNs
+  for (unsigned long i = 0; i < n; i++)
+    data[i] = Type((i % 3) ? ((i % 3 == 1) ? INFINITY : -INFINITY) : NAN);
+  compare(data, nRows, nCols);
+
+  // No values at all
+  for (unsigned long i = 0; i < n; i++)
+    data[i] = Type(NAN);
+  const Type **rows = new const Type *[nRows];
+  for (unsigned r = 0; r < nRows; r++)
+    rows[r] = data + (unsigned long) r*nCols;
+  Type value[nPcts];
+  check(!percentiles(rows, nRows, nCols, pcts, nPcts, value));
+  delete [] rows;
+
+  delete [] data;
+}
+
+int
+main()
+{
+  srand48(49);
+
+  // Fail rather than hang
+  alarm(120);
+
+  testType<unsigned char>(50, 31, 0, 256);
+  testType<short>(300, 300, -32768, 32768);
+  testType<int>(1, 17, -1000, 1000);
+  testType<int>(400, 500, -1e9, 1e9);
+  testType<unsigned>(600, 300, 0, 4e9);
+  testType<float>(7, 5, -1, 1);
+  testType<float>(500, 400, -1e30, 1e30);
+  testType<double>(400, 400, 0, 1);
+  testType<double>(3, 100000, -1e300, 1e300);
+
+  testSpecial<float>(3, 10);
+  testSpecial<float>(300, 400);
+  testSpecial<double>(400, 400);
+
+  // Values too close together for their halved difference to be represented
+  {
+    const unsigned long n = 200000;
+    double *data = new double[n];
+    for (unsigned long i = 0; i < n; i++)
+      data[i] = (i % 3) ? 0 : 4.9406564584124654e-324;
+    compare(data, 400, 500);
+    delete [] data;
+  }
+
+  // A single infinity in a 400 x 400 matrix
+  Mat<double> A(400, 400);
+  for (unsigned r = 0; r < 400; r++)
+    for (unsigned c = 0; c < 400; c++)
+      A(r, c) = r*400 + c + 1;
+  A(123, 321) = INFINITY;
+  check(A.median() == 80001);
+  check(A.percentile(100) == INFINITY);
+  check(A.percentile(99.9) == 159841);
+
+  return checkStatus();
+}
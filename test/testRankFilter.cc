@@ -0,0 +1,113 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for rank filtering (RankFilter.h): the sorted-window path
+// (floating point data, including NaNs, which rank above all other values)
+// and the histogram path (integer data) must match a brute-force sort of
+// every window, for each border mode, in 2D and 3D.
+
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "trivials.h"
+#include "RankFilter.h"
+#include "Check.h"
+
+// Ascending order with NaNs last
+template <class Type>
+struct NaNLast {
+  bool operator () (Type a, Type b) const { return (a < b) || ((a == a) && (b != b)); }
+};
+
+template <class Type>
+static bool
+same(Type a, Type b)
+{
+  return (a == b) || ((a != a) && (b != b));
+}
+
+template <class Type>
+static void
+testVolume(unsigned nslis, unsigned nrows, unsigned ncols, unsigned kslis,
+	   unsigned krows, unsigned kcols, double pct, BorderMode border,
+	   double nanFraction, int range)
+{
+  Volume<Type> in(nslis, nrows, ncols), out(nslis, nrows, ncols);
+  const unsigned n = nslis*nrows*ncols;
+  unsigned i;
+
+  for (i = 0; i < n; i++)
+    in.data[i] = (drand48() < nanFraction) ? Type(NAN) : Type(int(drand48()*range) - range/4);
+
+  rankFilter(out.el, in.in(), nslis, nrows, ncols, kslis, krows, kcols, pct, border);
+
+  const unsigned nWindow = kslis*krows*kcols;
+  const unsigned rank    = unsigned(pct/100*(nWindow - 1));
+  std::vector<Type> window(nWindow);
+  for (i = 0; i < n; i++) {
+    const int s = i/(nrows*ncols), r = (i/ncols)%nrows, c = i%ncols;
+    unsigned w = 0;
+    for (unsigned a = 0; a < kslis; a++)
+      for (unsigned b = 0; b < krows; b++)
+	for (unsigned d = 0; d < kcols; d++) {
+	  const int ws = borderIndex(s + int(a) - int(kslis/2), nslis, border);
+	  const int wr = borderIndex(r + int(b) - int(krows/2), nrows, border);
+	  const int wc = borderIndex(c + int(d) - int(kcols/2), ncols, border);
+	  window[w++] = ((ws < 0) || (wr < 0) || (wc < 0)) ? Type(0) : in(ws, wr, wc);
+	}
+    std::sort(window.begin(), window.end(), NaNLast<Type>());
+    check(same(out.data[i], window[rank]));
+  }
+}
+
+int
+main()
+{
+  const BorderMode borders[] = {BORDER_ZERO, BORDER_CLAMP, BORDER_MIRROR, BORDER_WRAP};
+
+  srand48(36);
+  for (unsigned b = 0; b < 4; b++) {
+    // Sorted windows, with and without NaNs
+    testVolume<double>(1, 13, 17, 1, 3, 5, 50, borders[b], 0, 1000);
+    testVolume<double>(1, 13, 17, 1, 4, 3, 25, borders[b], 0.2, 10);
+    testVolume<double>(1, 9, 12, 1, 3, 3, 100, borders[b], 0.5, 10);
+    testVolume<double>(5, 6, 7, 3, 3, 3, 50, borders[b], 0.1, 20);
+    testVolume<float>(4, 7, 9, 2, 3, 3, 75, borders[b], 0.3, 5);
+    // Histograms
+    testVolume<unsigned char>(1, 15, 19, 1, 5, 5, 50, borders[b], 0, 200);
+    testVolume<short>(4, 6, 9, 3, 3, 3, 10, borders[b], 0, 3000);
+    testVolume<int>(3, 8, 8, 3, 1, 3, 90, borders[b], 0, 100);
+  }
+
+  // The same NaN appearing in every window position
+  Volume<double> in(1, 1, 6), out(1, 1, 6);
+  for (unsigned c = 0; c < 6; c++)
+    in(0, 0, c) = double(c);
+  in(0, 0, 2) = NAN;
+  rankFilter(out.el, in.in(), 1, 1, 6, 1, 1, 3, 0, BORDER_CLAMP);
+  check(out(0, 0, 0) == 0);
+  check(out(0, 0, 1) == 0);
+  check(out(0, 0, 2) == 1);
+  check(out(0, 0, 3) == 3);
+  check(out(0, 0, 4) == 3);
+  check(out(0, 0, 5) == 4);
+
+  return checkStatus();
+}
@@ -0,0 +1,115 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for separable resampling (Resample.h): the result must
+// match a direct evaluation of the three ResampleTables for every element,
+// when upsampling and downsampling along each dimension (including slices),
+// with and without skipped (identity or absent) tables.
+
+#include <stdlib.h>
+#include "MatrixSupport.h"
+#include "Resample.h"
+#include "Check.h"
+
+// Weight of input sample j for output sample i of table (j < 0: zeros)
+static double
+tapWeight(const ResampleTable *table, unsigned i, int j)
+{
+  if (!table)
+    return (int(i) == j) ? 1 : 0;
+  double w = 0;
+  for (unsigned t = 0; t < table->nTaps(); t++)
+    if (table->index(i, t) == j)
+      w += table->weight(i, t);
+  return w;
+}
+
+static void
+testResample(unsigned nslis, unsigned nrows, unsigned ncols,
+	     const ResampleTable *sliceTable, const ResampleTable *rowTable,
+	     const ResampleTable *colTable)
+{
+  const unsigned outSlis = sliceTable ? sliceTable->nOut() : nslis;
+  const unsigned outRows = rowTable   ? rowTable->nOut()   : nrows;
+  const unsigned outCols = colTable   ? colTable->nOut()   : ncols;
+
+  Volume<double> in(nslis, nrows, ncols), out(outSlis, outRows, outCols, -1);
+  unsigned i;
+  for (i = 0; i < nslis*nrows*ncols; i++)
+    in.data[i] = drand48();
+
+  resample(out.el, in.in(), nslis, nrows, ncols, sliceTable, rowTable, colTable);
+
+  for (unsigned s = 0; s < outSlis; s++)
+    for (unsigned r = 0; r < outRows; r++)
+      for (unsigned c = 0; c < outCols; c++) {
+	double sum = 0;
+	for (unsigned a = 0; a < nslis; a++) {
+	  const double ws = tapWeight(sliceTable, s, a);
+	  if (ws == 0)
+	    continue;
+	  for (unsigned b = 0; b < nrows; b++) {
+	    const double wr = tapWeight(rowTable, r, b);
+	    if (wr == 0)
+	      continue;
+	    for (unsigned d = 0; d < ncols; d++)
+	      sum += ws*wr*tapWeight(colTable, c, d)*in(a, b, d);
+	  }
+	}
+	check(near(out(s, r, c), sum, 1e-12));
+      }
+}
+
+int
+main()
+{
+  const ResampleKernel kernels[] = {RESAMPLE_NEAREST, RESAMPLE_LINEAR,
+				    RESAMPLE_CUBIC, RESAMPLE_LANCZOS};
+
+  srand48(37);
+  for (unsigned k = 0; k < 4; k++) {
+    const ResampleKernel kernel = kernels[k];
+
+    // Upsampling and downsampling along slices only
+    ResampleTable slicesUp(2, 5, 0.25, 0, kernel, BORDER_CLAMP);
+    ResampleTable slicesDown(9, 3, 3, 1, kernel, BORDER_MIRROR);
+    testResample(2, 3, 4, &slicesUp, 0, 0);
+    testResample(9, 4, 3, &slicesDown, 0, 0);
+
+    // Along every dimension
+    ResampleTable rowsUp(4, 7, 0.5, 0, kernel, BORDER_ZERO);
+    ResampleTable colsDown(10, 4, 2.5, 0.75, kernel, BORDER_WRAP);
+    testResample(2, 4, 10, &slicesUp, &rowsUp, &colsDown);
+    testResample(9, 4, 10, &slicesDown, &rowsUp, &colsDown);
+
+    // Rows or columns only
+    testResample(3, 4, 5, 0, &rowsUp, 0);
+    testResample(3, 5, 10, 0, 0, &colsDown);
+    testResample(1, 4, 10, 0, &rowsUp, &colsDown);
+  }
+
+  // Identity tables are skipped
+  ResampleTable identity(6, 6, 1, 0);
+  check(identity.isIdentity());
+  ResampleTable slicesUp(3, 6, 0.5, 0);
+  testResample(3, 6, 6, &slicesUp, &identity, &identity);
+  testResample(6, 6, 6, &identity, &identity, &identity);
+
+  return checkStatus();
+}
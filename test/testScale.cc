@@ -0,0 +1,138 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for Mat::scale(): values are mapped linearly from
+// [minin, maxin] (by default, the range of the matrix) onto [minout, maxout]
+// and clipped to [minout, maxout] before the conversion to the element type,
+// so that values far out of range neither overflow nor wrap around. The
+// same holds for SimpleArray::map() of CompiledMap::addScale().
+
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include "Matrix.h"
+#include "ValueMap.h"
+#include "Check.h"
+
+// The expected value of x, scaled and clipped, converted to Type
+template <class Type>
+static Type
+scaled(double x, double minout, double maxout, double minin, double maxin)
+{
+  double value = LinearMap(minin, maxin, minout, maxout)(x);
+  value = (value < minout) ? minout : value;
+  value = (value > maxout) ? maxout : value;
+  return Type(value);
+}
+
+template <class Type>
+static void
+testScale(const double *x, unsigned nrows, unsigned ncols,
+	  double minout, double maxout, double minin, double maxin)
+{
+  Mat<Type> A(nrows, ncols);
+  unsigned r, c;
+
+  for (r = 0; r < nrows; r++)
+    for (c = 0; c < ncols; c++)
+      A(r, c) = Type(x[r*ncols + c]);
+
+  const Mat<Type> B = A.scaleConst(minout, maxout, minin, maxin);
+  const Mat<Type> C = scale(A, minout, maxout, minin, maxin);
+  A.scale(minout, maxout, minin, maxin);
+  for (r = 0; r < nrows; r++)
+    for (c = 0; c < ncols; c++) {
+      const Type expected = scaled<Type>(Type(x[r*ncols + c]), minout, maxout, minin, maxin);
+      check(near(A(r, c), expected));
+      check(B(r, c) == A(r, c));
+      check(C(r, c) == A(r, c));
+      check((A(r, c) >= minout) && (A(r, c) <= maxout));
+    }
+}
+
+int
+main()
+{
+  const unsigned nrows = 23, ncols = 37;
+  double x[nrows*ncols];
+  unsigned i;
+
+  srand48(44);
+
+  // Values within [-50, 150] scaled from [0, 100]
+  for (i = 0; i < nrows*ncols; i++)
+    x[i] = 200*drand48() - 50;
+  x[0] = 0;
+  x[1] = 100;
+  x[2] = -50;
+  x[3] = 150;
+  testScale<double>(x, nrows, ncols, 0, 255, 0, 100);
+  testScale<float>(x, nrows, ncols, 0, 255, 0, 100);
+  testScale<int>(x, nrows, ncols, 0, 255, 0, 100);
+  testScale<double>(x, nrows, ncols, -1, 1, 25, 75);
+
+  // Values far out of range: scaled by 255, these would overflow an int
+  for (i = 0; i < nrows*ncols; i++)
+    x[i] = floor(4e9*drand48() - 2e9);
+  testScale<int>(x, nrows, ncols, 0, 255, 0, 1);
+  testScale<int>(x, nrows, ncols, -1000000, 1000000, -1, 1);
+  testScale<float>(x, nrows, ncols, 0, 1, 0, 1);
+
+  // By default, from the range of the matrix
+  Mat<double> A(nrows, ncols);
+  double minValue = 0, maxValue = 0;
+  for (i = 0; i < nrows*ncols; i++) {
+    x[i] = 30*drand48() - 10;
+    A(i/ncols, i%ncols) = x[i];
+    minValue = (!i || (x[i] < minValue)) ? x[i] : minValue;
+    maxValue = (!i || (x[i] > maxValue)) ? x[i] : maxValue;
+  }
+  const Mat<double> B = A.scaleConst();
+  const Mat<double> C = A.scaleConst(-1, 1);
+  const Mat<double> D = A.scaleConst(0, 255, 3, 3); // Empty input range
+  for (i = 0; i < nrows*ncols; i++) {
+    check(near(B(i/ncols, i%ncols), scaled<double>(x[i], 0, 255, minValue, maxValue)));
+    check(near(C(i/ncols, i%ncols), scaled<double>(x[i], -1, 1, minValue, maxValue)));
+    check(D(i/ncols, i%ncols) == B(i/ncols, i%ncols));
+  }
+
+  // Unsigned char elements: [0, 100] onto [0, 255] maps 200 to 255 (rather
+  // than wrapping around)
+  SimpleArray<unsigned char> pixels(256);
+  for (i = 0; i < 256; i++)
+    pixels[i] = (unsigned char) i;
+  CompiledMap toByte;
+  toByte.addScale(0, 100, 0, 255);
+  const SimpleArray<unsigned char> bytes = pixels.map(toByte);
+  for (i = 0; i < 256; i++)
+    check(bytes[i] == scaled<unsigned char>(i, 0, 255, 0, 100));
+  check(bytes[200] == 255);
+
+  // Short elements scaled onto a range beyond that of the type
+  SimpleArray<short> samples(1000);
+  for (i = 0; i < 1000; i++)
+    samples[i] = short(floor(65536*drand48()) - 32768);
+  CompiledMap toShort;
+  toShort.addScale(-100, 100, SHRT_MIN, SHRT_MAX);
+  const SimpleArray<short> shorts = samples.map(toShort);
+  for (i = 0; i < 1000; i++)
+    check(shorts[i] == scaled<short>(samples[i], SHRT_MIN, SHRT_MAX, -100, 100));
+
+  return checkStatus();
+}
@@ -0,0 +1,133 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for sorting (Sort.h): sorted values and index
+// permutations must match those of std::stable_sort(), in both directions,
+// for radix-sorted and comparison-sorted types, across the radix and
+// parallel size thresholds, and with many equal values (index sorts are
+// stable). Sort.h is included first, to check that it stands on its own.
+
+#include "Sort.h"
+#include <stdlib.h>
+#include <math.h>
+#include <functional>
+#include "SimpleArray.h"
+#include "Check.h"
+
+// Orders indices by their values, for std::stable_sort()
+template <class Type>
+struct IndexLess {
+  const Type *values;
+  Boolean     ascending;
+  IndexLess(const Type *v, Boolean a) : values(v), ascending(a) {}
+  bool operator () (unsigned i, unsigned j) const {
+    return ascending ? (values[i] < values[j]) : (values[j] < values[i]); }
+};
+
+template <class Type>
+static void
+compare(const Type *values, unsigned n)
+{
+  Type     *sorted   = new Type[n];
+  Type     *expected = new Type[n];
+  unsigned *index    = new unsigned[n];
+  unsigned *expectedIndex = new unsigned[n];
+
+  for (int a = 0; a < 2; a++) {
+    const Boolean ascending = a ? FALSE : TRUE;
+
+    std::copy(values, values + n, sorted);
+    std::copy(values, values + n, expected);
+    sortValues(sorted, n, ascending);
+    if (ascending)
+      std::stable_sort(expected, expected + n);
+    else
+      std::stable_sort(expected, expected + n, std::greater<Type>());
+    unsigned i;
+    for (i = 0; (i < n) && (sorted[i] == expected[i]); i++);
+    check(i == n);
+
+    for (i = 0; i < n; i++)
+      expectedIndex[i] = i;
+    std::stable_sort(expectedIndex, expectedIndex + n, IndexLess<Type>(values, ascending));
+    sortIndex(values, n, index, ascending);
+    for (i = 0; (i < n) && (index[i] == expectedIndex[i]); i++);
+    check(i == n);
+  }
+
+  delete [] sorted;
+  delete [] expected;
+  delete [] index;
+  delete [] expectedIndex;
+}
+
+// Random values in [lo, hi), and values from only a few distinct ones
+template <class Type>
+static void
+testType(double lo, double hi)
+{
+  static const unsigned sizes[] = {0, 1, 2, 3, 100, 255, 256, 257, 1000,
+				   65535, 65536, 65537, 300001};
+  for (unsigned s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+    const unsigned n = sizes[s];
+    Type *values = new Type[n + 1];
+    for (unsigned i = 0; i < n; i++)
+      values[i] = Type(lo + (hi - lo)*drand48());
+    compare(values, n);
+    for (unsigned i = 0; i < n; i++)
+      values[i] = Type(lo + floor(5*drand48())*(hi - lo)/5);
+    compare(values, n);
+    delete [] values;
+  }
+}
+
+int
+main()
+{
+  srand48(50);
+
+  testType<unsigned char>(0, 256);
+  testType<char>(-128, 128);
+  testType<short>(-32768, 32768);
+  testType<unsigned short>(0, 65536);
+  testType<int>(-2e9, 2e9);
+  testType<unsigned>(0, 4e9);
+  testType<long>(-1e15, 1e15);
+  testType<float>(-1e20, 1e20);
+  testType<double>(-1, 1);
+  testType<double>(1e-310, 1e300);
+  testType<long double>(-1e5, 1e5);
+
+  // Through SimpleArray
+  SimpleArray<double> array(1000);
+  for (unsigned i = 0; i < 1000; i++)
+    array[i] = floor(10*drand48());
+  SimpleArray<unsigned> index = array.qsortIndexDescending();
+  SimpleArray<double>   sorted(array);
+  sorted.qsortDescending();
+  for (unsigned i = 0; i < 1000; i++) {
+    check(sorted[i] == array[index[i]]);
+    if (i) {
+      check(sorted[i] <= sorted[i - 1]);
+      check((sorted[i] < sorted[i - 1]) || (index[i] > index[i - 1]));
+    }
+  }
+
+  return checkStatus();
+}
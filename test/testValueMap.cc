@@ -0,0 +1,246 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for LUT evaluation (ValueMap.h): the binary search, the
+// direct lookup of evenly spaced source values and reverse evaluation must
+// reproduce the linear scans of the former implementation (the nearest
+// entry, the lower one on ties, the last one beyond the table or for a NaN),
+// for tables built in any order, at breakpoints, between and beyond them.
+
+#include <stdlib.h>
+#include <math.h>
+#include "Matrix.h"
+#include "ValueMap.h"
+#include "Check.h"
+
+// The former implementation: entries sorted by source value, scanned
+// linearly
+struct ScanLUT {
+  enum { MAXLEN = 512 };
+  double   source[MAXLEN], dest[MAXLEN];
+  unsigned length;
+
+  ScanLUT() : length(0) {}
+
+  void add(double s, double d) {
+    unsigned i = 0;
+    while ((i < length) && (source[i] < s))
+      i++;
+    if ((i < length) && (source[i] == s))
+      return;
+    for (unsigned j = length; j > i; j--) {
+      source[j] = source[j - 1];
+      dest[j]   = dest[j - 1];
+    }
+    source[i] = s;
+    dest[i]   = d;
+    length++;
+  }
+
+  double operator () (double x) const {
+    if (!length)
+      return 0;
+    for (unsigned i = 0; i < length; i++)
+      if (source[i] >= x)
+	return (!i || (source[i] - x) < (x - source[i - 1])) ? dest[i] : dest[i - 1];
+    return dest[length - 1];
+  }
+
+  double reverse(double y) const {
+    if (!length)
+      return 0;
+    if (length < 2)
+      return source[0];
+    unsigned index = 0;
+    double minDiff = fabs(y - dest[0]);
+    for (unsigned i = 1; i < length; i++)
+      if (fabs(y - dest[i]) < minDiff) {
+	index   = i;
+	minDiff = fabs(y - dest[i]);
+      }
+    return source[index];
+  }
+};
+
+// Breakpoints, midpoints (ties), their neighbours, random values in and
+// beyond the range of values, infinities and a NaN
+static unsigned
+probes(double *x, const double *values, unsigned length)
+{
+  unsigned n = 0, i;
+
+  for (i = 0; i < length; i++) {
+    x[n++] = values[i];
+    x[n++] = nextafter(values[i], -HUGE_VAL);
+    x[n++] = nextafter(values[i], HUGE_VAL);
+    if (i)
+      x[n++] = 0.5*(values[i - 1] + values[i]);
+  }
+
+  double lo = 0, hi = 1;
+  for (i = 0; i < length; i++) {
+    lo = (!i || (values[i] < lo)) ? values[i] : lo;
+    hi = (!i || (values[i] > hi)) ? values[i] : hi;
+  }
+  const double margin = (hi - lo) + 1;
+  for (i = 0; i < 200; i++)
+    x[n++] = lo - margin + (hi - lo + 2*margin)*drand48();
+
+  x[n++] = HUGE_VAL;
+  x[n++] = -HUGE_VAL;
+  x[n++] = 1e300;
+  x[n++] = -1e300;
+  x[n++] = sqrt(-1.0);
+
+  return n;
+}
+
+// Same value, or both NaN
+static bool
+same(double a, double b)
+{
+  return (a == b) || ((a != a) && (b != b));
+}
+
+static void
+compare(const LUT<double>& lut, const ScanLUT& ref)
+{
+  double   x[4*ScanLUT::MAXLEN + 210], y[4*ScanLUT::MAXLEN + 210];
+  unsigned n, i;
+
+  // Forward, one by one and in a block
+  n = probes(x, ref.source, ref.length);
+  lut.apply(x, y, n);
+  for (i = 0; i < n; i++) {
+    check(same(lut(x[i]), ref(x[i])));
+    check(same(y[i], ref(x[i])));
+  }
+
+  // Reverse
+  n = probes(x, ref.dest, ref.length);
+  for (i = 0; i < n; i++)
+    check(same(lut.reverse(x[i]), ref.reverse(x[i])));
+}
+
+// A LUT and its reference built by add(), in random order (with duplicate
+// sources) if shuffle, otherwise in ascending order of source
+static void
+testAdd(const double *source, const double *dest, unsigned length, bool shuffle)
+{
+  unsigned order[ScanLUT::MAXLEN], i;
+
+  for (i = 0; i < length; i++)
+    order[i] = i;
+  if (shuffle)
+    for (i = length; i > 1; i--) {
+      const unsigned j = unsigned(drand48()*i);
+      const unsigned t = order[i - 1]; order[i - 1] = order[j]; order[j] = t;
+    }
+
+  LUT<double> lut;
+  ScanLUT     ref;
+  for (i = 0; i < length; i++) {
+    lut.add(source[order[i]], dest[order[i]]);
+    ref.add(source[order[i]], dest[order[i]]);
+    if (shuffle && (drand48() < 0.1)) {
+      // A duplicate source keeps the first entry
+      lut.add(source[order[i]], dest[order[i]] + 1);
+      ref.add(source[order[i]], dest[order[i]] + 1);
+    }
+    if ((i < 5) || (i == length - 1) || (drand48() < 0.05))
+      compare(lut, ref);
+  }
+
+  // Copies, and the array constructor (which sorts)
+  const LUT<double> copy(lut);
+  compare(copy, ref);
+  SimpleArray<double> sourceArray(length), destArray(length);
+  for (i = 0; i < length; i++) {
+    sourceArray[i] = source[order[i]];
+    destArray[i]   = dest[order[i]];
+  }
+  compare(LUT<double>(sourceArray, destArray), ref);
+}
+
+// Destination values: non-decreasing (with repeats), or random
+static void
+fillDest(double *dest, unsigned length, bool sorted)
+{
+  for (unsigned i = 0; i < length; i++)
+    if (sorted)
+      dest[i] = (i ? dest[i - 1] : -10) + ((drand48() < 0.2) ? 0 : floor(8*drand48()));
+    else
+      dest[i] = floor(100*drand48()) - 50;
+}
+
+int
+main()
+{
+  const unsigned lengths[] = {0, 1, 2, 3, 4, 7, 64, 300};
+  const unsigned nLengths  = sizeof(lengths)/sizeof(lengths[0]);
+  double source[ScanLUT::MAXLEN], dest[ScanLUT::MAXLEN];
+  unsigned l, i;
+
+  srand48(43);
+
+  for (l = 0; l < nLengths; l++) {
+    const unsigned length = lengths[l];
+    for (int sorted = 0; sorted < 2; sorted++) {
+      fillDest(dest, length, sorted);
+
+      // Evenly spaced sources (the direct lookup), exactly and to rounding
+      for (i = 0; i < length; i++)
+	source[i] = -3 + 0.5*i;
+      testAdd(source, dest, length, FALSE);
+      testAdd(source, dest, length, TRUE);
+      for (i = 0; i < length; i++)
+	source[i] = 0.1*i - 7.3;
+      testAdd(source, dest, length, FALSE);
+      testAdd(source, dest, length, TRUE);
+
+      // Unevenly spaced sources (the binary search)
+      for (i = 0; i < length; i++)
+	source[i] = (i ? source[i - 1] : -20) + 0.01 + 2*drand48()*drand48();
+      testAdd(source, dest, length, FALSE);
+      testAdd(source, dest, length, TRUE);
+
+      // Evenly spaced but for the last source, appended (and thus no longer
+      // evenly spaced) or inserted
+      if (length > 3) {
+	for (i = 0; i < length; i++)
+	  source[i] = 2.0*i;
+	source[length - 1] += 0.75;
+	testAdd(source, dest, length, FALSE);
+	source[length - 1] = -1.25;
+	testAdd(source, dest, length, FALSE);
+      }
+    }
+  }
+
+  // A grid too wide for the direct lookup
+  LUT<double> wide;
+  ScanLUT     wideRef;
+  for (i = 0; i < 5; i++) {
+    wide.add(-1e308 + 5e307*i, double(i));
+    wideRef.add(-1e308 + 5e307*i, double(i));
+  }
+  compare(wide, wideRef);
+
+  return checkStatus();
+}
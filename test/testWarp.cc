@@ -0,0 +1,221 @@
+/*--------------------------------------------------------------------------
+@COPYRIGHT  :
+              Copyright 1996, Alex P. Zijdenbos,
+              McConnell Brain Imaging Centre,
+              Montreal Neurological Institute, McGill University.
+              Permission to use, copy, modify, and distribute this
+              software and its documentation for any purpose and without
+              fee is hereby granted, provided that the above copyright
+              notice appear in all copies.  The author and McGill University
+              make no representations about the suitability of this
+              software for any purpose.  It is provided "as is" without
+              express or implied warranty.
+----------------------------------------------------------------------------
+$RCSfile$
+$Revision$
+$Author$
+$Date$
+$State$
+--------------------------------------------------------------------------*/
+// Regression tests for warping (Warp.h): interpolation weights must sum to 1
+// (a constant volume stays constant under any kernel), identity and integer
+// shifts must reproduce the input, linear interpolation must match trilinear
+// interpolation, and a displacement field must agree with the equivalent
+// affine transformation. NaN, infinite and huge displacements must give the
+// samples of the border mode.
+
+#include <stdlib.h>
+#include <math.h>
+#include "MatrixSupport.h"
+#include "Warp.h"
+#include "Check.h"
+
+static const ResampleKernel kernels[] = {RESAMPLE_NEAREST, RESAMPLE_LINEAR,
+					 RESAMPLE_CUBIC, RESAMPLE_LANCZOS};
+static const BorderMode     borders[] = {BORDER_ZERO, BORDER_CLAMP, BORDER_MIRROR,
+					 BORDER_WRAP};
+
+// Affine transformation rotating about the slice axis, plus a shift
+static void
+rotation(double affine[12], double angle, double s0, double r0, double c0)
+{
+  const double a[12] = {1, 0, 0, s0,
+			0, cos(angle), -sin(angle), r0,
+			0, sin(angle), cos(angle), c0};
+  for (unsigned i = 0; i < 12; i++)
+    affine[i] = a[i];
+}
+
+// Input at (s, r, c), zero outside
+static double
+sample(Volume<double>& in, int s, int r, int c)
+{
+  if ((s < 0) || (r < 0) || (c < 0) ||
+      (s >= int(in.nslis)) || (r >= int(in.nrows)) || (c >= int(in.ncols)))
+    return 0;
+  return in(s, r, c);
+}
+
+// Input at row r + d (d integral or infinite; NaN: outside) of (s, r, c),
+// per the border mode
+static double
+shifted(Volume<double>& in, unsigned s, unsigned r, unsigned c, double d,
+	BorderMode border)
+{
+  const double n = in.nrows;
+  if (!(d == d) || ((border != BORDER_CLAMP) && !(d - d == 0)))
+    return 0;
+  const double x = r + d;
+  if ((x >= 0) && (x < n))
+    return in(s, unsigned(x), c);
+  switch (border) {
+  case BORDER_CLAMP:
+    return in(s, (x < 0) ? 0 : in.nrows - 1, c);
+  case BORDER_MIRROR: {
+    double m = fmod(x, 2*n);
+    if (m < 0)
+      m += 2*n;
+    return in(s, unsigned((m < n) ? m : 2*n - 1 - m), c); }
+  case BORDER_WRAP: {
+    double m = fmod(x, n);
+    if (m < 0)
+      m += n;
+    return in(s, unsigned(m), c); }
+  default:
+    return 0;
+  }
+}
+
+static double
+trilinear(Volume<double>& in, double s, double r, double c)
+{
+  const int    s0 = int(floor(s)), r0 = int(floor(r)), c0 = int(floor(c));
+  const double fs = s - s0, fr = r - r0, fc = c - c0;
+  double sum = 0;
+  for (int a = 0; a < 2; a++)
+    for (int b = 0; b < 2; b++)
+      for (int d = 0; d < 2; d++)
+	sum += (a ? fs : 1 - fs)*(b ? fr : 1 - fr)*(d ? fc : 1 - fc)*
+	  sample(in, s0 + a, r0 + b, c0 + d);
+  return sum;
+}
+
+int
+main()
+{
+  const unsigned nslis = 5, nrows = 9, ncols = 11;
+  Volume<double> in(nslis, nrows, ncols), out(nslis, nrows, ncols);
+  double affine[12];
+  unsigned i, k;
+
+  srand48(38);
+
+  // A constant volume stays constant
+  Volume<double> constant(nslis, nrows, ncols, 7.25);
+  rotation(affine, 0.3, 0.4, 1.3, -0.6);
+  for (k = 0; k < 4; k++) {
+    warpAffine(out.el, nslis, nrows, ncols, constant.in(), nslis, nrows, ncols,
+	       affine, kernels[k], BORDER_CLAMP);
+    for (i = 0; i < nslis*nrows*ncols; i++)
+      check(near(out.data[i], 7.25, 1e-12));
+  }
+
+  for (i = 0; i < nslis*nrows*ncols; i++)
+    in.data[i] = drand48();
+
+  // Identity
+  rotation(affine, 0, 0, 0, 0);
+  for (k = 0; k < 4; k++) {
+    warpAffine(out.el, nslis, nrows, ncols, in.in(), nslis, nrows, ncols,
+	       affine, kernels[k], BORDER_ZERO);
+    for (i = 0; i < nslis*nrows*ncols; i++)
+      check(near(out.data[i], in.data[i], 1e-12));
+  }
+
+  // Integer shift
+  rotation(affine, 0, 1, -2, 3);
+  for (k = 0; k < 4; k++) {
+    warpAffine(out.el, nslis, nrows, ncols, in.in(), nslis, nrows, ncols,
+	       affine, kernels[k], BORDER_ZERO);
+    for (unsigned s = 0; s < nslis; s++)
+      for (unsigned r = 0; r < nrows; r++)
+	for (unsigned c = 0; c < ncols; c++)
+	  check(near(out(s, r, c), sample(in, s + 1, r - 2, c + 3), 1e-12));
+  }
+
+  // Linear interpolation is trilinear, into a larger output
+  Volume<double> large(nslis + 2, nrows + 3, ncols + 1);
+  rotation(affine, -0.7, -0.35, 2.2, 1.1);
+  affine[0] = 0.9;
+  warpAffine(large.el, large.nslis, large.nrows, large.ncols, in.in(), nslis, nrows,
+	     ncols, affine, RESAMPLE_LINEAR, BORDER_ZERO);
+  for (unsigned s = 0; s < large.nslis; s++)
+    for (unsigned r = 0; r < large.nrows; r++)
+      for (unsigned c = 0; c < large.ncols; c++) {
+	const double x[3] = {affine[0]*s + affine[1]*r + affine[2]*c + affine[3],
+			     affine[4]*s + affine[5]*r + affine[6]*c + affine[7],
+			     affine[8]*s + affine[9]*r + affine[10]*c + affine[11]};
+	check(near(large(s, r, c), trilinear(in, x[0], x[1], x[2]), 1e-9));
+      }
+
+  // A displacement field equivalent to an affine transformation
+  Volume<double> dSlice(nslis, nrows, ncols), dRow(nslis, nrows, ncols);
+  Volume<double> dCol(nslis, nrows, ncols), fromField(nslis, nrows, ncols);
+  rotation(affine, 0.2, 0.3, -0.4, 0.45);
+  for (unsigned s = 0; s < nslis; s++)
+    for (unsigned r = 0; r < nrows; r++)
+      for (unsigned c = 0; c < ncols; c++) {
+	dSlice(s, r, c) = affine[0]*s + affine[1]*r + affine[2]*c + affine[3] - s;
+	dRow(s, r, c)   = affine[4]*s + affine[5]*r + affine[6]*c + affine[7] - r;
+	dCol(s, r, c)   = affine[8]*s + affine[9]*r + affine[10]*c + affine[11] - c;
+      }
+  for (k = 0; k < 4; k++) {
+    warpAffine(out.el, nslis, nrows, ncols, in.in(), nslis, nrows, ncols,
+	       affine, kernels[k], BORDER_MIRROR);
+    warpField(fromField.el, nslis, nrows, ncols, in.in(), nslis, nrows, ncols,
+	      dSlice.in(), dRow.in(), dCol.in(), kernels[k], BORDER_MIRROR);
+    for (i = 0; i < nslis*nrows*ncols; i++)
+      check(near(fromField.data[i], out.data[i], 1e-9));
+  }
+
+  // A single slice is only sampled within the slice
+  Volume<double> slice(1, nrows, ncols, 2.5), sliceOut(1, nrows, ncols);
+  rotation(affine, 0.5, 0, 0.5, 0.5);
+  warpAffine(sliceOut.el, 1, nrows, ncols, slice.in(), 1, nrows, ncols, affine,
+	     RESAMPLE_LANCZOS, BORDER_CLAMP);
+  for (i = 0; i < nrows*ncols; i++)
+    check(near(sliceOut.data[i], 2.5, 1e-12));
+
+  // NaN, infinite and huge row displacements
+  const double displacements[] = {NAN, 1e12, -1e12 - 3, 5e18, INFINITY, -INFINITY};
+  for (i = 0; i < nslis*nrows*ncols; i++)
+    dSlice.data[i] = dCol.data[i] = 0;
+  for (unsigned d = 0; d < sizeof(displacements)/sizeof(displacements[0]); d++) {
+    for (i = 0; i < nslis*nrows*ncols; i++)
+      dRow.data[i] = displacements[d];
+    for (k = 0; k < 4; k++)
+      for (unsigned b = 0; b < 4; b++) {
+	warpField(out.el, nslis, nrows, ncols, in.in(), nslis, nrows, ncols,
+		  dSlice.in(), dRow.in(), dCol.in(), kernels[k], borders[b]);
+	unsigned nWrong = 0;
+	for (unsigned s = 0; s < nslis; s++)
+	  for (unsigned r = 0; r < nrows; r++)
+	    for (unsigned c = 0; c < ncols; c++)
+	      nWrong += !near(out(s, r, c),
+			      shifted(in, s, r, c, displacements[d], borders[b]), 1e-12);
+	check(nWrong == 0);
+      }
+  }
+
+  // A NaN slice position of a single slice
+  rotation(affine, 0, 0, 0, 0);
+  affine[3] = NAN;
+  for (unsigned b = 0; b < 4; b++) {
+    warpAffine(sliceOut.el, 1, nrows, ncols, slice.in(), 1, nrows, ncols, affine,
+	       RESAMPLE_LINEAR, borders[b]);
+    for (i = 0; i < nrows*ncols; i++)
+      check(sliceOut.data[i] == 0);
+  }
+
+  return checkStatus();
+}